@@ -78,6 +78,15 @@ OpenGL4
 		BlendMode = Add;
 	}
 
+	context CLUSTERED_LIGHTING
+	{
+		VertexShader = compile GLSL VS_FSQUAD_GL4;
+		PixelShader = compile GLSL FS_CLUSTERED_LIGHTING_GL4;
+		
+		ZWriteEnable = false;
+		BlendMode = Add;
+	}
+
 	context COPY_DEPTH
 	{
 		VertexShader = compile GLSL VS_FSQUAD_GL4;
@@ -240,6 +249,30 @@ void main( void )
 	else discard;
 }
 
+[[FS_CLUSTERED_LIGHTING_GL4]]
+
+#include "shaders/utilityLib/fragClusteredLightingGL4.glsl"
+#include "shaders/utilityLib/fragDeferredReadGL4.glsl"
+
+uniform mat4 viewMat;
+in vec2 texCoords;
+
+out vec4 fragColor;
+
+void main( void )
+{
+	if( getMatID( texCoords ) == 1.0 )	// Standard phong material
+	{
+		vec3 pos = getPos( texCoords ) + viewerPos;
+		vec3 vsPos = (viewMat * vec4( pos, 1.0 )).xyz;
+		vec4 specParams = getSpecParams( texCoords );
+		
+		fragColor.rgb = calcClusteredLighting( pos, vsPos, getNormal( texCoords ),
+											   getAlbedo( texCoords ), specParams.rgb, specParams.a );
+	}
+	else discard;
+}
+
 
 [[FS_COPY_DEPTH]]
 
@@ -7,6 +7,7 @@
 	_F03_ParallaxMapping
 	_F04_EnvMapping
 	_F05_AlphaTest
+	_F06_Instancing
 */
 
 
@@ -96,6 +97,15 @@ OpenGL4
 		ZWriteEnable = false;
 		BlendMode = Add;
 	}
+
+	context CLUSTERED_LIGHTING
+	{
+		VertexShader = compile GLSL VS_GENERAL_GL4;
+		PixelShader = compile GLSL FS_CLUSTERED_LIGHTING_GL4;
+		
+		ZWriteEnable = false;
+		BlendMode = Add;
+	}
 	
 	context AMBIENT
 	{
@@ -194,6 +204,10 @@ void main( void )
 	#define _F02_NormalMapping
 #endif
 
+#ifdef _F06_Instancing
+	#define INSTANCING
+#endif
+
 #include "shaders/utilityLib/vertCommon.glsl"
 
 #ifdef _F01_Skinning
@@ -459,6 +473,10 @@ void main( void )
 	
 [[VS_SHADOWMAP_GL4]]
 // =================================================================================================
+
+#ifdef _F06_Instancing
+	#define INSTANCING
+#endif
 	
 #include "shaders/utilityLib/vertCommon.glsl"
 #include "shaders/utilityLib/vertSkinningGL4.glsl"
@@ -696,6 +714,82 @@ void main( void )
 }
 
 
+[[FS_CLUSTERED_LIGHTING_GL4]]
+// =================================================================================================
+
+#ifdef _F03_ParallaxMapping
+	#define _F02_NormalMapping
+#endif
+
+#include "shaders/utilityLib/fragClusteredLightingGL4.glsl" 
+
+uniform vec4 matDiffuseCol;
+uniform vec4 matSpecParams;
+uniform sampler2D albedoMap;
+
+#ifdef _F02_NormalMapping
+	uniform sampler2D normalMap;
+#endif
+
+in vec4 pos, vsPos;
+in vec2 texCoords;
+
+#ifdef _F02_NormalMapping
+	in mat3 tsbMat;
+#else
+	in vec3 tsbNormal;
+#endif
+#ifdef _F03_ParallaxMapping
+	in vec3 eyeTS;
+#endif
+
+out vec4 fragColor;
+
+void main( void )
+{
+	vec3 newCoords = vec3( texCoords, 0 );
+	
+#ifdef _F03_ParallaxMapping	
+	const float plxScale = 0.03;
+	const float plxBias = -0.015;
+	
+	// Iterative parallax mapping
+	vec3 eye = normalize( eyeTS );
+	for( int i = 0; i < 4; ++i )
+	{
+		vec4 nmap = texture( normalMap, newCoords.st * vec2( 1, -1 ) );
+		float height = nmap.a * plxScale + plxBias;
+		newCoords += (height - newCoords.p) * nmap.z * eye;
+	}
+#endif
+
+	// Flip texture vertically to match the GL coordinate system
+	newCoords.t *= -1.0;
+
+	vec4 albedo = texture( albedoMap, newCoords.st ) * matDiffuseCol;
+	
+#ifdef _F05_AlphaTest
+	if( albedo.a < 0.01 ) discard;
+#endif
+	
+#ifdef _F02_NormalMapping
+	vec3 normalMap = texture( normalMap, newCoords.st ).rgb * 2.0 - 1.0;
+	vec3 normal = tsbMat * normalMap;
+#else
+	vec3 normal = tsbNormal;
+#endif
+
+	vec3 newPos = pos.xyz;
+
+#ifdef _F03_ParallaxMapping
+	newPos += vec3( 0.0, newCoords.p, 0.0 );
+#endif
+	
+	fragColor.rgb = calcClusteredLighting( newPos, vsPos.xyz, normalize( normal ), albedo.rgb,
+										   matSpecParams.rgb, matSpecParams.a );
+}
+
+
 [[FS_AMBIENT]]	
 // =================================================================================================
 
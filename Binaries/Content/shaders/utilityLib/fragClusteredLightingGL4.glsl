@@ -0,0 +1,81 @@
+// *************************************************************************************************
+// Horde3D Shader Utility Library
+// --------------------------------------
+//		- Clustered lighting functions -
+//
+// Copyright (C) 2006-2016 Nicolas Schulz and Horde3D team
+//
+// You may use the following code in projects based on the Horde3D graphics engine.
+//
+// *************************************************************************************************
+
+uniform 	vec3 viewerPos;
+uniform 	sampler2D clusterLightMap;
+uniform 	sampler2D clusterItemMap;
+uniform 	vec4 clusterGridSize;
+uniform 	vec4 clusterDepthParams;
+uniform 	mat4 clusterProjMat;
+
+const int clusterItemMapWidth = 1024;
+
+
+vec3 calcPhongLight( const vec3 pos, const vec3 normal, const vec3 albedo, const vec3 specColor,
+					 const float gloss, const vec4 lightPos, const vec4 lightDir, const vec3 lightColor )
+{
+	vec3 light = lightPos.xyz - pos;
+	float lightLen = length( light );
+	light /= lightLen;
+
+	// Distance attenuation
+	float lightDepth = lightLen / lightPos.w;
+	float atten = max( 1.0 - lightDepth * lightDepth, 0.0 );
+
+	// Spotlight falloff
+	float angle = dot( lightDir.xyz, -light );
+	atten *= clamp( (angle - lightDir.w) / 0.2, 0.0, 1.0 );
+
+	// Lambert diffuse
+	float NdotL = max( dot( normal, light ), 0.0 );
+	atten *= NdotL;
+
+	// Blinn-Phong specular with energy conservation
+	vec3 view = normalize( viewerPos - pos );
+	vec3 halfVec = normalize( light + view );
+	float specExp = exp2( 10.0 * gloss + 1.0 );
+	vec3 specular = specColor * pow( max( dot( halfVec, normal ), 0.0 ), specExp );
+	specular *= (specExp * 0.125 + 0.25);  // Normalization factor (n+2)/8
+
+	return (albedo + specular) * lightColor * atten;
+}
+
+
+vec3 calcClusteredLighting( const vec3 pos, const vec3 vsPos, const vec3 normal, const vec3 albedo,
+							const vec3 specColor, const float gloss )
+{
+	// Find cluster of fragment
+	vec4 clipPos = clusterProjMat * vec4( vsPos, 1.0 );
+	vec2 tile = clamp( clipPos.xy / clipPos.w * 0.5 + 0.5, 0.0, 0.9999 ) * clusterGridSize.xy;
+	float depth = clusterDepthParams.z > 0.5 ? log( max( -vsPos.z, 0.0001 ) ) : -vsPos.z;
+	float slice = clamp( floor( depth * clusterDepthParams.x + clusterDepthParams.y ), 0.0, clusterGridSize.z - 1.0 );
+	int cluster = int( (slice * clusterGridSize.y + floor( tile.y )) * clusterGridSize.x + floor( tile.x ) );
+
+	vec4 clusterInfo = texelFetch( clusterItemMap, ivec2( cluster % clusterItemMapWidth, cluster / clusterItemMapWidth ), 0 );
+	int first = int( clusterInfo.x );
+	int count = int( clusterInfo.y );
+
+	// Accumulate lights of cluster
+	vec3 color = vec3( 0.0 );
+	for( int i = first; i < first + count; ++i )
+	{
+		int texel = i / 4;
+		int light = int( texelFetch( clusterItemMap, ivec2( texel % clusterItemMapWidth, texel / clusterItemMapWidth ), 0 )[i % 4] );
+
+		vec4 lightPos = texelFetch( clusterLightMap, ivec2( 0, light ), 0 );
+		vec4 lightDir = texelFetch( clusterLightMap, ivec2( 1, light ), 0 );
+		vec3 lightColor = texelFetch( clusterLightMap, ivec2( 2, light ), 0 ).rgb;
+
+		color += calcPhongLight( pos, normal, albedo, specColor, gloss, lightPos, lightDir, lightColor );
+	}
+
+	return color;
+}
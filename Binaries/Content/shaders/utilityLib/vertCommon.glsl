@@ -10,8 +10,35 @@
 // *************************************************************************************************
 
 uniform mat4 viewMat;
-uniform mat4 worldMat;
-uniform	mat3 worldNormalMat;
+
+#ifdef INSTANCING
+	// Per-instance data from the engine's instance buffer: the upper three rows of the world transformation
+	// (only available in the GL4 shaders)
+	layout( location = 7 ) in vec4 instWorldRow0;
+	layout( location = 8 ) in vec4 instWorldRow1;
+	layout( location = 9 ) in vec4 instWorldRow2;
+	
+	mat4 calcInstWorldMat()
+	{
+		return transpose( mat4( instWorldRow0, instWorldRow1, instWorldRow2, vec4( 0.0, 0.0, 0.0, 1.0 ) ) );
+	}
+	
+	mat3 calcInstWorldNormalMat()
+	{
+		// Inverse transpose of the rotation/scale part, built from its cofactors
+		mat3 m = mat3( calcInstWorldMat() );
+		vec3 c0 = cross( m[1], m[2] );
+		vec3 c1 = cross( m[2], m[0] );
+		vec3 c2 = cross( m[0], m[1] );
+		return mat3( c0, c1, c2 ) / dot( m[0], c0 );
+	}
+	
+	#define worldMat calcInstWorldMat()
+	#define worldNormalMat calcInstWorldNormalMat()
+#else
+	uniform mat4 worldMat;
+	uniform	mat3 worldNormalMat;
+#endif
 
 
 vec4 calcWorldPos( const vec4 pos )
@@ -10,30 +10,29 @@
 // *************************************************************************************************
 
 uniform mat4 viewMatInv;
-uniform vec3 parPosArray[64];
-uniform vec2 parSizeAndRotArray[64];
-uniform vec4 parColorArray[64];
 
-layout( location = 1 ) in float parIdx;
+// Per-instance particle data
+layout( location = 1 ) in vec3 parPos;
+layout( location = 2 ) in vec2 parSizeAndRot;
+layout( location = 3 ) in vec4 parColor;
 
 
 vec4 getParticleColor()
 {
-	return parColorArray[int( parIdx )];
+	return parColor;
 }
 
 vec3 calcParticlePos( const vec2 texCoords )
 {
-	int index = int( parIdx );
 	vec3 camAxisX = viewMatInv[0].xyz;
 	vec3 camAxisY = viewMatInv[1].xyz;
 	
 	vec2 cornerPos = texCoords - vec2( 0.5, 0.5 );
 	
 	// Apply rotation
-	float s = sin( parSizeAndRotArray[index].y );
-	float c = cos( parSizeAndRotArray[index].y );
+	float s = sin( parSizeAndRot.y );
+	float c = cos( parSizeAndRot.y );
 	cornerPos = mat2( c, -s, s, c ) * cornerPos;
 	
-	return parPosArray[index] + (camAxisX * cornerPos.x + camAxisY * cornerPos.y) * parSizeAndRotArray[index].x;
+	return parPos + (camAxisX * cornerPos.x + camAxisY * cornerPos.y) * parSizeAndRot.x;
 }
\ No newline at end of file
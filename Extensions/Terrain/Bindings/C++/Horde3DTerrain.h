@@ -44,6 +44,14 @@
 	height information, you can simply copy the greyscale image to the red channel of the height
 	map and leave the green channel black.
 
+	Large terrains can be split into a grid of height tiles that are streamed from disk. Only the tiles
+	around the camera are kept in memory; they are loaded on a background thread and released again
+	when the camera moves away. Each tile is stored in a separate raw file named
+	*<tilePath>_<x>_<y>.r16* with x and y being the column and row of the tile in the grid. The file
+	contains (tileSize+1)^2 unsigned 16 bit little endian height samples in row-major order. The last
+	row and column of a tile must be equal to the first row and column of its neighbours so that
+	there are no cracks at the tile borders.
+
 	The extension defines the uniform *terBlockParams* and the attribute *terHeight* that can be used
 	in a shader to render the terrain. To see how this is working in detail, have a look at the included
 	sample shader.
@@ -67,6 +75,8 @@ struct H3DEXTTerrain
 		MeshQualityF   - Constant controlling the overall resolution of the terrain mesh (default: 50.0)
 		SkirtHeightF   - Height of the skirts used to hide cracks (default: 0.1)
 		BlockSizeI     - Size of a terrain block that is drawn in a single render call; must be 2^n+1 (default: 17)
+		TileLoadRadiusF    - Distance from the camera in tiles up to which height tiles are loaded (default: 2.0)
+		ResidentTileCountI - Number of height tiles that are currently in memory [read-only]
 	*/
 	enum List
 	{
@@ -74,7 +84,9 @@ struct H3DEXTTerrain
 		MatResI,
 		MeshQualityF,
 		SkirtHeightF,
-		BlockSizeI
+		BlockSizeI,
+		TileLoadRadiusF,
+		ResidentTileCountI
 	};
 };
 
@@ -97,6 +109,37 @@ struct H3DEXTTerrain
 DLL H3DNode h3dextAddTerrainNode( H3DNode parent, const char *name, H3DRes heightMapRes, H3DRes materialRes );
 
 
+/* Function: h3dextAddTiledTerrainNode
+		Adds a Terrain node with streamed height tiles to the scene.
+	
+	Details:
+		This function creates a new Terrain node whose height data is split into a grid of tiles that are
+		loaded around the camera. The terrain covers the same unit square in local space as a
+		terrain created from a height map. Tiles that are not loaded yet are neither rendered nor
+		considered for intersection tests. See the introduction for the tile file format.
+		
+		The tiles in range of the camera are determined each time a camera is rendered, before the
+		pipeline is executed. They are read from the files *<tilePath>_<x>_<y>.r16* and processed on a
+		background thread, so the application does not have to load them. A tile becomes visible
+		in one of the following frames once it has been loaded. Tiles that move out of range are
+		released immediately. If a tile file is missing or has the wrong size, an error is logged and
+		the tile stays empty.
+	
+	Parameters:
+		parent       - handle to parent node to which the new node will be attached
+		name         - name of the node
+		tilePath     - file system path of the tiles without the *_<x>_<y>.r16* suffix
+		tileCount    - number of tiles per side of the terrain (1 to 1024)
+		tileSize     - number of height samples per side of a tile minus one (must be POT, 16 to 8192)
+		materialRes  - handle to the Material resource used for rendering the terrain
+
+	Returns:
+		 handle to the created node or 0 in case of failure
+*/
+DLL H3DNode h3dextAddTiledTerrainNode( H3DNode parent, const char *name, const char *tilePath,
+                                       int tileCount, int tileSize, H3DRes materialRes );
+
+
 /* Function: h3dextCreateTerrainGeoRes
 		Creates a Geometry resource from a specified Terrain node.
 			
@@ -104,7 +147,8 @@ DLL H3DNode h3dextAddTerrainNode( H3DNode parent, const char *name, H3DRes heigh
 		This function creates a new Geometry resource that contains the vertex data of the specified Terrain node.
 		To reduce the amount of data, it is possible to specify a quality value which controls the overall resolution
 		of the terrain mesh. The algorithm will automatically create a higher resoultion in regions where the
-		geometrical complexity is higher and optimize the vertex count for flat regions.
+		geometrical complexity is higher and optimize the vertex count for flat regions. For tiled terrains
+		only the tiles that are currently resident are included.
 	
 	Parameters:
 		node         - handle to terrain node that will be accessed
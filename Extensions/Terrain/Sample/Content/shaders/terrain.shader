@@ -79,7 +79,7 @@ varying vec2 texCoords;
 
 void main( void )
 {
-	vec4 newPos = vec4( vertPos.x * terBlockParams.z + terBlockParams.x, terHeight,
+	vec4 newPos = vec4( vertPos.x * terBlockParams.z + terBlockParams.x, max( terHeight - vertPos.y * terBlockParams.w, 0.0 ),
 						vertPos.z * terBlockParams.z + terBlockParams.y, 1.0 );
 						
 	pos = calcWorldPos( newPos );
@@ -103,7 +103,7 @@ out vec2 texCoords;
 
 void main( void )
 {
-	vec4 newPos = vec4( vertPos.x * terBlockParams.z + terBlockParams.x, terHeight,
+	vec4 newPos = vec4( vertPos.x * terBlockParams.z + terBlockParams.x, max( terHeight - vertPos.y * terBlockParams.w, 0.0 ),
 						vertPos.z * terBlockParams.z + terBlockParams.y, 1.0 );
 						
 	pos = calcWorldPos( newPos );
@@ -183,7 +183,7 @@ varying float dist;
 
 void main( void )
 {
-	vec4 newPos = vec4( vertPos.x * terBlockParams.z + terBlockParams.x, terHeight,
+	vec4 newPos = vec4( vertPos.x * terBlockParams.z + terBlockParams.x, max( terHeight - vertPos.y * terBlockParams.w, 0.0 ),
 						vertPos.z * terBlockParams.z + terBlockParams.y, 1.0 );
 						
 	vec4 pos = calcWorldPos( newPos );
@@ -206,7 +206,7 @@ out float dist;
 
 void main( void )
 {
-	vec4 newPos = vec4( vertPos.x * terBlockParams.z + terBlockParams.x, terHeight,
+	vec4 newPos = vec4( vertPos.x * terBlockParams.z + terBlockParams.x, max( terHeight - vertPos.y * terBlockParams.w, 0.0 ),
 						vertPos.z * terBlockParams.z + terBlockParams.y, 1.0 );
 						
 	vec4 pos = calcWorldPos( newPos );
@@ -29,6 +29,7 @@ bool ExtTerrain::init()
 	Modules::sceneMan().registerNodeType( SNT_TerrainNode, "Terrain",
 		TerrainNode::parsingFunc, TerrainNode::factoryFunc );
 	Modules::renderer().registerRenderFunc( SNT_TerrainNode, TerrainNode::renderFunc );
+	Modules::renderer().registerCameraUpdateFunc( TerrainNode::cameraUpdateFunc );
 
 	// Create vertex layout
 	VertexLayoutAttrib attribs[2] = {
@@ -91,6 +92,28 @@ DLLEXP NodeHandle h3dextAddTerrainNode( NodeHandle parent, const char *name, Res
 }
 
 
+DLLEXP NodeHandle h3dextAddTiledTerrainNode( NodeHandle parent, const char *name, const char *tilePath,
+                                             int tileCount, int tileSize, ResHandle materialRes )
+{
+	SceneNode *parentNode = Modules::sceneMan().resolveNodeHandle( parent );
+	if( parentNode == 0x0 ) return 0;
+	
+	if( safeStr( tilePath ).empty() || !TerrainNode::isValidTileLayout( tileCount, tileSize ) ) return 0;
+	
+	Resource *matRes =  Modules::resMan().resolveResHandle( materialRes );
+	if( matRes == 0x0 || matRes->getType() != ResourceTypes::Material ) return 0;
+	
+	Modules::log().writeInfo( "Adding tiled Terrain node '%s'", safeStr( name ).c_str() );
+	
+	TerrainNodeTpl tpl( safeStr( name ), 0x0, (MaterialResource *)matRes );
+	tpl.tilePath = tilePath;
+	tpl.tileCount = tileCount;
+	tpl.tileSize = tileSize;
+	SceneNode *sn = Modules::sceneMan().findType( SNT_TerrainNode )->factoryFunc( tpl );
+	return Modules::sceneMan().addNode( sn, *parentNode );
+}
+
+
 DLLEXP ResHandle h3dextCreateTerrainGeoRes( NodeHandle node, const char *name, float meshQuality )
 {	
 	SceneNode *sn = Modules::sceneMan().resolveNodeHandle( node );
@@ -16,6 +16,9 @@
 #include "egRenderer.h"
 #include "egMaterial.h"
 #include "egCamera.h"
+#include <sstream>
+#include <fstream>
+#include <algorithm>
 
 #include "utDebug.h"
 
@@ -34,7 +37,7 @@ const char *vsTerrainDebugView =
 	"attribute float terHeight;\n"
 	"void main() {\n"
 	"	gl_Position = viewProjMat * worldMat *"
-	"		vec4( vertPos.x * terBlockParams.z + terBlockParams.x, terHeight, "
+	"		vec4( vertPos.x * terBlockParams.z + terBlockParams.x, max( terHeight - vertPos.y * terBlockParams.w, 0.0 ), "
 	"			  vertPos.z * terBlockParams.z + terBlockParams.y, 1.0 );\n"
 	"}";
 
@@ -47,7 +50,7 @@ const char *vsTerrainDebugViewGL4 =
 	"layout(location = 1) in float terHeight;\n"
 	"void main() {\n"
 	"	gl_Position = viewProjMat * worldMat *"
-	"		vec4( vertPos.x * terBlockParams.z + terBlockParams.x, terHeight, "
+	"		vec4( vertPos.x * terBlockParams.z + terBlockParams.x, max( terHeight - vertPos.y * terBlockParams.w, 0.0 ), "
 	"			  vertPos.z * terBlockParams.z + terBlockParams.y, 1.0 );\n"
 	"}";
 
@@ -67,16 +70,31 @@ const char *fsTerrainDebugViewGL4 =
 
 uint32 TerrainNode::vlTerrain;
 ShaderCombination TerrainNode::debugViewShader;
+std::vector< TerrainNode * > TerrainNode::tiledNodes;
 
 
 TerrainNode::TerrainNode( const TerrainNodeTpl &terrainTpl ) :
 	SceneNode( terrainTpl ), _materialRes( terrainTpl.matRes ), _blockSize( terrainTpl.blockSize ),
 	_skirtHeight( terrainTpl.skirtHeight ), _lodThreshold( 1.0f / terrainTpl.meshQuality ),
-	_hmapSize( 0 ), _heightData( 0x0 ), _maxLevel( 0 ), _heightArray( 0x0 ), _vertexBuffer( 0 ),
-	_indexBuffer( 0 ), _geometry( 0 )
+	_hmapSize( 0 ), _maxLevel( 0 ), _heightArray( 0x0 ), _vertexBuffer( 0 ), _indexBuffer( 0 ),
+	_tileCount( 0 ), _tileLoadRadius( terrainTpl.tileLoadRadius ), _tileGeneration( 0 ),
+	_tileUpdateFrame( 0 ), _tileLoader( 0x0 ), _lruHead( -1 ), _lruTail( -1 )
 {
 	_renderable = true;
-	if( terrainTpl.hmapRes != 0x0 ) updateHeightData( *terrainTpl.hmapRes );
+	if( !terrainTpl.tilePath.empty() )
+	{
+		// Tiles are streamed in around the camera
+		_tilePath = terrainTpl.tilePath;
+		_hmapSize = terrainTpl.tileSize;
+		initTiles( terrainTpl.tileCount );
+		_tileLoader = new TerrainTileLoader();
+		tiledNodes.push_back( this );
+	}
+	else
+	{
+		initTiles( 1 );
+		if( terrainTpl.hmapRes != 0x0 ) updateHeightData( *terrainTpl.hmapRes );
+	}
 	
 	// Ensure correct block size
 	if( _hmapSize % (_blockSize - 1) != 0 )
@@ -93,45 +111,49 @@ TerrainNode::TerrainNode( const TerrainNodeTpl &terrainTpl ) :
 
 TerrainNode::~TerrainNode()
 {
-	delete[] _heightData;
+	RenderDeviceInterface *rdi = Modules::renderer().getRenderDevice();
+
+	releaseTileLoader();
+
+	releaseBlockCache();
+	rdi->destroyBuffer( _vertexBuffer );
+	rdi->destroyBuffer( _indexBuffer );
+	
+	for( size_t i = 0; i < _tiles.size(); ++i ) delete[] _tiles[i].heightData;
 	delete[] _heightArray;
 }
 
 
-SceneNodeTpl *TerrainNode::parsingFunc( map< string, string > &attribs )
+SceneNodeTpl *TerrainNode::parsingFunc( const SceneNodeAttribs &attribs )
 {
-	map< string, string >::iterator itr;
 	TerrainNodeTpl *terrainTpl = new TerrainNodeTpl( "", 0x0, 0x0 );
+	string str;
 
-	itr = attribs.find( "heightmap" );
-	if( itr != attribs.end() )
+	if( attribs.getString( "heightmap", str ) )
 	{
-		uint32 res = Modules::resMan().addResource( ResourceTypes::Texture, itr->second, 
+		uint32 res = Modules::resMan().addResource( ResourceTypes::Texture, str, 
 			ResourceFlags::NoTexCompression | ResourceFlags::NoTexMipmaps, false );
 		if( res != 0 )
 			terrainTpl->hmapRes = (TextureResource *)Modules::resMan().resolveResHandle( res );
 	}
-	itr = attribs.find( "material" );
-	if( itr != attribs.end() )
+	if( attribs.getString( "material", str ) )
 	{
-		uint32 res = Modules::resMan().addResource( ResourceTypes::Material, itr->second, 0, false );
+		uint32 res = Modules::resMan().addResource( ResourceTypes::Material, str, 0, false );
 		if( res != 0 )
 			terrainTpl->matRes = (MaterialResource *)Modules::resMan().resolveResHandle( res );
 	}
-	itr = attribs.find( "meshQuality" );
-	if ( itr != attribs.end() )
+	attribs.getFloat( "meshQuality", terrainTpl->meshQuality );
+	attribs.getFloat( "skirtHeight", terrainTpl->skirtHeight );
+	attribs.getInt( "blockSize", terrainTpl->blockSize );
+	attribs.getString( "heightTiles", terrainTpl->tilePath );
+	attribs.getInt( "tileCount", terrainTpl->tileCount );
+	attribs.getInt( "tileSize", terrainTpl->tileSize );
+	attribs.getFloat( "tileLoadRadius", terrainTpl->tileLoadRadius );
+
+	if( !terrainTpl->tilePath.empty() && !isValidTileLayout( terrainTpl->tileCount, terrainTpl->tileSize ) )
 	{
-		terrainTpl->meshQuality = (float)atof( itr->second.c_str() );
-	}
-	itr = attribs.find( "skirtHeight" );
-	if ( itr != attribs.end() )
-	{
-		terrainTpl->skirtHeight = (float)atof( itr->second.c_str() );
-	}
-	itr = attribs.find( "blockSize" );
-	if ( itr != attribs.end() )
-	{
-		terrainTpl->blockSize = atoi( itr->second.c_str() );
+		Modules::log().writeError( "Invalid tileCount or tileSize of tiled Terrain node" );
+		terrainTpl->tilePath.clear();
 	}
 
 	return terrainTpl;
@@ -153,12 +175,17 @@ void TerrainNode::onPostUpdate()
 }
 
 
-void TerrainNode::drawTerrainBlock( TerrainNode *terrain, float minU, float minV, float maxU, float maxV,
-                                    int level, float scale, const Vec3f &localCamPos, const Frustum *frust1,
-                                    const Frustum *frust2, int uni_terBlockParams )
+void TerrainNode::drawTerrainBlock( TerrainNode *terrain, uint32 tileIndex, float minU, float minV, float maxU,
+                                    float maxV, int level, float scale, const Vec3f &localCamPos,
+                                    const Frustum *frust1, const Frustum *frust2, int uni_terBlockParams )
 {
 	RenderDeviceInterface *rdi = Modules::renderer().getRenderDevice();
 
+	// Block coordinates are relative to the tile
+	const TerrainTile &tile = terrain->_tiles[tileIndex];
+	const float tileScale = 1.0f / terrain->_tileCount;
+	const float tileU = tile.x * tileScale, tileV = tile.y * tileScale;
+	
 	const float halfU = (minU + maxU) / 2.0f;
 	const float halfV = (minV + maxV) / 2.0f;
 
@@ -166,10 +193,11 @@ void TerrainNode::drawTerrainBlock( TerrainNode *terrain, float minU, float minV
 	for( int i = 0; i < level; ++i ) offset += (1 << i) * (1 << i);
 	
 	const uint32 blockIndex = offset + ftoi_t( minV * (1 << level) ) * (1 << level) + ftoi_t( minU * (1 << level) );
-	BlockInfo &block = terrain->_blockTree[blockIndex];
+	const BlockInfo &block = tile.blockTree[blockIndex];
 
 	// Create AABB for block
-	Vec3f bBMin( minU, block.minHeight - terrain->_skirtHeight, minV), bBMax( maxU, block.maxHeight, maxV );
+	Vec3f bBMin( tileU + minU * tileScale, block.minHeight - terrain->_skirtHeight, tileV + minV * tileScale );
+	Vec3f bBMax( tileU + maxU * tileScale, block.maxHeight, tileV + maxV * tileScale );
 	
 	// Frustum culling
 	BoundingBox bb;
@@ -187,43 +215,12 @@ void TerrainNode::drawTerrainBlock( TerrainNode *terrain, float minU, float minV
 		// Render terrain block
 		if( uni_terBlockParams >= 0 )
 		{
-			float values[4] = { minU, minV, scale, scale };
-			rdi->setShaderConst( uni_terBlockParams, CONST_FLOAT4, values );  // Bias and scale
+			// Skirt can be smaller when camera is near
+			float values[4] = { bBMin.x, bBMin.z, scale * tileScale, terrain->_skirtHeight * dist };
+			rdi->setShaderConst( uni_terBlockParams, CONST_FLOAT4, values );  // Bias, scale and skirt height
 		}
 	
-		const uint32 size = terrain->_blockSize + 2;
-		const float invScale = 1.0f / ( terrain->_blockSize - 1 );
-		
-		for( uint32 v = 0; v < size; ++v )
-		{	
-			float t = (v - 1) * invScale;
-			if( v == 0 ) t = 0.0f; else if( v == size - 1 ) t = 1.0f;	// Skirt
-			
-			for( uint32 u = 0; u < size; ++u )
-			{
-				float s = (u - 1) * invScale;
-				if( u == 0 ) s = 0.0f; else if( u == size - 1 ) s = 1.0f;	// Skirt
-				
-				float *vertHeight = &terrain->_heightArray[v * size + u];
-				const float newU = (s * scale + minU) * (terrain->_hmapSize) + 0.5f;
-				const float newV = (t * scale + minV) * (terrain->_hmapSize) + 0.5f;
-				uint32 index = ftoi_t( newV ) * (terrain->_hmapSize + 1) + ftoi_t( newU );
-				
-				*vertHeight = terrain->_heightData[index] / 65535.0f;
-				
-				// Create skirt
-				if( v == 0 || v == size - 1 || u == 0 || u == size - 1 )
-				{
-					// Skirt can be smaller when camera is near
-					const float skirtHeight = terrain->_skirtHeight * dist;
-					*vertHeight = maxf( *vertHeight - skirtHeight, 0 );
-				}
-			}
-		}
-		
-		rdi->updateBufferData( terrain->_geometry,
-			terrain->_vertexBuffer, terrain->getVertexCount() * sizeof( float ) * 3,
-			terrain->getVertexCount() * sizeof( float ), terrain->_heightArray );
+		rdi->setGeometry( terrain->getBlockGeometry( tileIndex, blockIndex, minU, minV, scale ) );
 		rdi->drawIndexed( PRIM_TRISTRIP, 0, terrain->getIndexCount(), 0, terrain->getVertexCount() );
 		Modules::stats().incStat( EngineStats::BatchCount, 1 );
 		Modules::stats().incStat( EngineStats::TriCount, (terrain->_blockSize + 1) * (terrain->_blockSize + 1) * 2.0f );
@@ -242,12 +239,12 @@ void TerrainNode::drawTerrainBlock( TerrainNode *terrain, float minU, float minV
 		};
 		
 		// Sort blocks by distance from camera
-		if( localCamPos.x > halfU )
+		if( localCamPos.x > tileU + halfU * tileScale )
 		{
 			std::swap( blocks[0], blocks[1] );
 			std::swap( blocks[2], blocks[3] );
 		}
-		if( localCamPos.z > halfV )
+		if( localCamPos.z > tileV + halfV * tileScale )
 		{
 			std::swap( blocks[0], blocks[2] );
 			std::swap( blocks[1], blocks[3] );
@@ -255,14 +252,14 @@ void TerrainNode::drawTerrainBlock( TerrainNode *terrain, float minU, float minV
 
 		for( uint32 i = 0; i < 4; ++i )
 		{
-			drawTerrainBlock( terrain, blocks[i].x, blocks[i].y, blocks[i].z, blocks[i].w,
+			drawTerrainBlock( terrain, tileIndex, blocks[i].x, blocks[i].y, blocks[i].z, blocks[i].w,
 			                  level + 1, scale, localCamPos, frust1, frust2, uni_terBlockParams );
 		}
 	}
 }
 
 
-void TerrainNode::renderFunc( uint32 firstItem, uint32 lastItem, const string &shaderContext, const string &theClass,
+void TerrainNode::renderFunc( uint32 firstItem, uint32 lastItem, uint32 shaderContext, uint32 classFilter,
                               bool debugView, const Frustum *frust1, const Frustum *frust2, RenderingOrder::List order,
                               int occSet )
 {
@@ -280,7 +277,7 @@ void TerrainNode::renderFunc( uint32 firstItem, uint32 lastItem, const string &s
 		
 		if( !debugView )
 		{
-			if( !terrain->_materialRes->isOfClass( theClass ) ) continue;
+			if( !terrain->_materialRes->isOfClass( classFilter ) ) continue;
 			if( !Modules::renderer().setMaterial( terrain->_materialRes, shaderContext ) ) continue;
 		}
 		else
@@ -297,13 +294,6 @@ void TerrainNode::renderFunc( uint32 firstItem, uint32 lastItem, const string &s
 		Vec3f localCamPos( curCam->getAbsTrans().x[12], curCam->getAbsTrans().x[13], curCam->getAbsTrans().x[14] );
 		localCamPos = terrain->_absTrans.inverted() * localCamPos;
 		
-		// Bind geometry and apply vertex layout
-// 		rdi->setIndexBuffer( terrain->_indexBuffer, IDXFMT_16 );
-// 		rdi->setVertexBuffer( 0, terrain->_vertexBuffer, 0, 12 );
-// 		rdi->setVertexBuffer( 1, terrain->_vertexBuffer, terrain->getVertexCount() * 12, 4 );
-// 		rdi->setVertexLayout( vlTerrain );
-		rdi->setGeometry( terrain->_geometry );
-
 		// Set uniforms
 		ShaderCombination *curShader = Modules::renderer().getCurShader();
 		if( curShader->uni_worldMat >= 0 )
@@ -324,9 +314,30 @@ void TerrainNode::renderFunc( uint32 firstItem, uint32 lastItem, const string &s
 			rdi->setShaderConst( curShader->uni_nodeId, CONST_FLOAT, &id );
 		}
 
-		drawTerrainBlock( terrain, 0.0f, 0.0f, 1.0f, 1.0f, 0, 1.0f, localCamPos, frust1, frust2, uni_terBlockParams );
+		for( uint32 j = 0; j < terrain->_tiles.size(); ++j )
+		{
+			if( terrain->_tiles[j].state != TileStates::Resident ) continue;
+			
+			drawTerrainBlock( terrain, j, 0.0f, 0.0f, 1.0f, 1.0f, 0, 1.0f, localCamPos,
+			                  frust1, frust2, uni_terBlockParams );
+		}
+	}
+}
+
 
-// 		rdi->setVertexLayout( 0 );
+void TerrainNode::cameraUpdateFunc( CameraNode &camera )
+{
+	// Tiles are paged once per frame around the first camera that is rendered
+	for( size_t i = 0; i < tiledNodes.size(); ++i )
+	{
+		TerrainNode *terrain = tiledNodes[i];
+		if( terrain->_tileUpdateFrame == Modules::renderer().getFrameID() ) continue;
+		
+		Vec3f localCamPos( camera.getAbsTrans().x[12], camera.getAbsTrans().x[13], camera.getAbsTrans().x[14] );
+		localCamPos = terrain->_absTrans.inverted() * localCamPos;
+		
+		terrain->updateTiles( localCamPos );
+		terrain->_tileUpdateFrame = Modules::renderer().getFrameID();
 	}
 }
 
@@ -339,7 +350,9 @@ bool TerrainNode::canAttach( SceneNode &parent )
 
 bool TerrainNode::updateHeightData( TextureResource &hmap )
 {
-	delete[] _heightData; _heightData = 0x0;
+	TerrainTile &tile = _tiles[0];
+	delete[] tile.heightData; tile.heightData = 0x0;
+	tile.state = TileStates::Resident;
 
 	if( hmap.getTexFormat() == TextureFormats::BGRA8 &&
 	    hmap.getWidth() == hmap.getHeight() &&
@@ -348,7 +361,7 @@ bool TerrainNode::updateHeightData( TextureResource &hmap )
 	    hmap.getWidth() == 2048 || hmap.getWidth() == 4096 || hmap.getWidth() == 8192) )
 	{
 		_hmapSize = hmap.getWidth();
-		_heightData = new uint16[(_hmapSize+1) * (_hmapSize+1)];
+		tile.heightData = new uint16[(_hmapSize+1) * (_hmapSize+1)];
 		
 		unsigned char *pixels = (unsigned char *)hmap.mapStream(
 			TextureResData::ImageElem, 0, TextureResData::ImgPixelStream, true, false );
@@ -359,7 +372,7 @@ bool TerrainNode::updateHeightData( TextureResource &hmap )
 			for( uint32 j = 0; j < _hmapSize; ++j )
 			{
 				// Decode 16 bit data from red and green channels
-				_heightData[i*(_hmapSize+1)+j] =
+				tile.heightData[i*(_hmapSize+1)+j] =
 					pixels[(i*_hmapSize+j)*4+2] * 256 + pixels[(i*_hmapSize+j)*4+1];
 			}
 		}
@@ -368,13 +381,13 @@ bool TerrainNode::updateHeightData( TextureResource &hmap )
 		for( uint32 i = 0; i < _hmapSize; ++i )
 		{
 			// Decode 16 bit data from red and green channels
-			_heightData[i*(_hmapSize+1)+_hmapSize] =
+			tile.heightData[i*(_hmapSize+1)+_hmapSize] =
 				pixels[(i*_hmapSize+_hmapSize-1)*4+2] * 256 + pixels[(i*_hmapSize+_hmapSize-1)*4+1];
 		}
 
 		for( uint32 i = 0; i < _hmapSize + 1; ++i )
 		{
-			_heightData[_hmapSize*(_hmapSize+1)+i] = _heightData[(_hmapSize-1)*(_hmapSize+1)+i];
+			tile.heightData[_hmapSize*(_hmapSize+1)+i] = tile.heightData[(_hmapSize-1)*(_hmapSize+1)+i];
 		}
 
 		hmap.unmapStream();
@@ -384,8 +397,8 @@ bool TerrainNode::updateHeightData( TextureResource &hmap )
 	{
 		// Init default data
 		_hmapSize = 32;
-		_heightData = new uint16[ (_hmapSize + 1) * (_hmapSize + 1)];
-		memset( _heightData, 0, (_hmapSize + 1) * (_hmapSize + 1) );
+		tile.heightData = new uint16[ (_hmapSize + 1) * (_hmapSize + 1)];
+		memset( tile.heightData, 0, (_hmapSize + 1) * (_hmapSize + 1) * sizeof( uint16 ) );
 		return false;
 	}
 }
@@ -408,12 +421,12 @@ uint32 TerrainNode::getVertexCount()
 
 float *TerrainNode::createVertices()
 {
-	float *positions = new float[getVertexCount() * 4];	// After the positions, the height is stored as separate stream
+	float *positions = new float[getVertexCount() * 3];	// The height is stored per block in a separate stream
 	float *posIterator = positions;
 	const uint32 size = _blockSize + 2;
 	const float invScale = 1.0f / (_blockSize - 1);
 
-	// Create vertex positions and leave height uninitialized
+	// Create vertex positions, y is 1 for skirt vertices which get lowered by the skirt height
 	for( uint32 v = 0; v < size; ++v )
 	{
 		for( uint32 u = 0; u < size; ++u )
@@ -427,6 +440,7 @@ float *TerrainNode::createVertices()
 			if( v == 0 ) *(posIterator + 2) = 0;
 			if( u == size - 1 ) *(posIterator + 0) = 1.0f;
 			if( v == size - 1 ) *(posIterator + 2) = 1.0f;
+			if( u == 0 || v == 0 || u == size - 1 || v == size - 1 ) *(posIterator + 1) = 1.0f;
 
 			posIterator += 3;
 		}
@@ -475,49 +489,343 @@ void TerrainNode::recreateVertexBuffer()
 {
 	RenderDeviceInterface *rdi = Modules::renderer().getRenderDevice();
 
-// 	rdi->destroyBuffer( _vertexBuffer );
-// 	rdi->destroyBuffer( _indexBuffer );
-	rdi->destroyGeometry( _geometry );
-
-	_geometry = rdi->beginCreatingGeometry( vlTerrain );
+	// Block geometries reference the buffers, so they have to be released first
+	releaseBlockCache();
+	rdi->destroyBuffer( _vertexBuffer );
+	rdi->destroyBuffer( _indexBuffer );
 
 	delete[] _heightArray; _heightArray = 0x0;
 	_heightArray = new float[ getVertexCount() ];
 	float *posArray = createVertices();
-	_vertexBuffer = rdi->createVertexBuffer( getVertexCount() * sizeof( float ) * 4, posArray );
+	_vertexBuffer = rdi->createVertexBuffer( getVertexCount() * sizeof( float ) * 3, posArray );
 	delete[] posArray;
 
 	uint16 *indices = createIndices();
 	_indexBuffer = rdi->createIndexBuffer( getIndexCount() * sizeof( short ), indices );
 	delete[] indices;
+}
+
+
+uint32 TerrainNode::getBlockGeometry( uint32 tileIndex, uint32 blockIndex, float minU, float minV, float scale )
+{
+	RenderDeviceInterface *rdi = Modules::renderer().getRenderDevice();
+	
+	TerrainTile &tile = _tiles[tileIndex];
+	BlockInfo &block = tile.blockTree[blockIndex];
+	int slot = block.cacheSlot;
+
+	if( slot < 0 )
+	{
+		if( _blockCache.size() < MaxCachedBlocks )
+		{
+			slot = (int)_blockCache.size();
+			_blockCache.push_back( BlockCacheSlot() );
+			
+			BlockCacheSlot &newSlot = _blockCache.back();
+			newSlot.heightBuffer = rdi->createVertexBuffer( getVertexCount() * sizeof( float ), 0x0 );
+			newSlot.geometry = rdi->beginCreatingGeometry( vlTerrain );
+			rdi->setGeomIndexParams( newSlot.geometry, _indexBuffer, IDXFMT_16 );
+			rdi->setGeomVertexParams( newSlot.geometry, _vertexBuffer, 0, 0, 12 );
+			rdi->setGeomVertexParams( newSlot.geometry, newSlot.heightBuffer, 1, 0, 4 );
+			rdi->finishCreatingGeometry( newSlot.geometry );
+		}
+		else
+		{
+			// Evict least recently used block
+			slot = _lruTail;
+			unlinkCacheSlot( slot );
+
+			BlockCacheSlot &oldSlot = _blockCache[slot];
+			if( oldSlot.tileIndex >= 0 )
+				_tiles[oldSlot.tileIndex].blockTree[oldSlot.blockIndex].cacheSlot = -1;
+		}
+		
+		_blockCache[slot].tileIndex = (int)tileIndex;
+		_blockCache[slot].blockIndex = blockIndex;
+		block.cacheSlot = slot;
+
+		// Sample heights of block, skirt vertices use the height of the border
+		const uint32 size = _blockSize + 2;
+		const float invScale = 1.0f / ( _blockSize - 1 );
+		
+		for( uint32 v = 0; v < size; ++v )
+		{	
+			float t = (v - 1) * invScale;
+			if( v == 0 ) t = 0.0f; else if( v == size - 1 ) t = 1.0f;	// Skirt
+			
+			for( uint32 u = 0; u < size; ++u )
+			{
+				float s = (u - 1) * invScale;
+				if( u == 0 ) s = 0.0f; else if( u == size - 1 ) s = 1.0f;	// Skirt
+				
+				const float newU = (s * scale + minU) * (_hmapSize) + 0.5f;
+				const float newV = (t * scale + minV) * (_hmapSize) + 0.5f;
+				uint32 index = ftoi_t( newV ) * (_hmapSize + 1) + ftoi_t( newU );
+				
+				_heightArray[v * size + u] = tile.heightData[index] / 65535.0f;
+			}
+		}
+		
+		rdi->updateBufferData( _blockCache[slot].geometry, _blockCache[slot].heightBuffer, 0,
+			getVertexCount() * sizeof( float ), _heightArray );
+	}
+	else if( slot != _lruHead )
+	{
+		unlinkCacheSlot( slot );
+	}
+
+	// Move block to front of LRU list
+	if( slot != _lruHead ) linkCacheSlot( slot, true );
+
+	return _blockCache[slot].geometry;
+}
+
+
+void TerrainNode::unlinkCacheSlot( int slot )
+{
+	BlockCacheSlot &cacheSlot = _blockCache[slot];
+	
+	if( cacheSlot.prev >= 0 ) _blockCache[cacheSlot.prev].next = cacheSlot.next;
+	else if( _lruHead == slot ) _lruHead = cacheSlot.next;
+	if( cacheSlot.next >= 0 ) _blockCache[cacheSlot.next].prev = cacheSlot.prev;
+	else if( _lruTail == slot ) _lruTail = cacheSlot.prev;
+
+	cacheSlot.prev = -1;
+	cacheSlot.next = -1;
+}
+
+
+void TerrainNode::linkCacheSlot( int slot, bool mostRecent )
+{
+	BlockCacheSlot &cacheSlot = _blockCache[slot];
+
+	if( mostRecent )
+	{
+		cacheSlot.prev = -1;
+		cacheSlot.next = _lruHead;
+		if( _lruHead >= 0 ) _blockCache[_lruHead].prev = slot;
+		_lruHead = slot;
+		if( _lruTail < 0 ) _lruTail = slot;
+	}
+	else
+	{
+		cacheSlot.next = -1;
+		cacheSlot.prev = _lruTail;
+		if( _lruTail >= 0 ) _blockCache[_lruTail].next = slot;
+		_lruTail = slot;
+		if( _lruHead < 0 ) _lruHead = slot;
+	}
+}
 
-	rdi->setGeomIndexParams( _geometry, _indexBuffer, IDXFMT_16 );
-	rdi->setGeomVertexParams( _geometry, _vertexBuffer, 0, 0, 12 );
-	rdi->setGeomVertexParams( _geometry, _vertexBuffer, 1, getVertexCount() * 12, 4 );
 
-	rdi->finishCreatingGeometry( _geometry );
+void TerrainNode::releaseBlockCache()
+{
+	RenderDeviceInterface *rdi = Modules::renderer().getRenderDevice();
+
+	for( size_t i = 0; i < _blockCache.size(); ++i )
+	{
+		BlockCacheSlot &slot = _blockCache[i];
+		
+		rdi->destroyGeometry( slot.geometry, false );
+		rdi->destroyBuffer( slot.heightBuffer );
+		if( slot.tileIndex >= 0 )
+			_tiles[slot.tileIndex].blockTree[slot.blockIndex].cacheSlot = -1;
+	}
+
+	_blockCache.clear();
+	_lruHead = -1; _lruTail = -1;
 }
 
 
-void TerrainNode::buildBlockInfo( BlockInfo &block, float minU, float minV, float maxU, float maxV )
+void TerrainNode::initTiles( uint32 tileCount )
 {
-	const float pixelStep = 1.0f / _hmapSize;
-	const float stepU = (maxU - minU) / (_blockSize - 1);
-	const float stepV = (maxV - minV) / (_blockSize - 1);
+	releaseBlockCache();
+	for( size_t i = 0; i < _tiles.size(); ++i ) delete[] _tiles[i].heightData;
 	
-	for( uint32 v = 0; v < _blockSize - 1; ++v )
+	_tileCount = tileCount;
+	_tiles.clear();
+	_tiles.resize( tileCount * tileCount );
+
+	for( uint32 y = 0; y < tileCount; ++y )
 	{
-		for( uint32 u = 0; u < _blockSize - 1; ++u )
+		for( uint32 x = 0; x < tileCount; ++x )
 		{
-			Vec3f corner0( minU + u * stepU, 0, minV + v * stepV);
-			Vec3f corner1( minU + u * stepU, 0, minV + (v + 1) * stepV);
-			Vec3f corner2( minU + (u + 1) * stepU, 0, minV + v * stepV);
-			Vec3f corner3( minU + (u + 1) * stepU, 0, minV + (v + 1) * stepV);
+			_tiles[y * tileCount + x].x = x;
+			_tiles[y * tileCount + x].y = y;
+		}
+	}
+}
+
+
+void TerrainNode::releaseTile( uint32 tileIndex )
+{
+	TerrainTile &tile = _tiles[tileIndex];
 
-			corner0.y = getHeight( corner0.x, corner0.z );
-			corner1.y = getHeight( corner1.x, corner1.z );
-			corner2.y = getHeight( corner2.x, corner2.z );
-			corner3.y = getHeight( corner3.x, corner3.z );
+	// Cached blocks of the tile are free for reuse, so they become least recently used
+	for( size_t i = 0; i < tile.blockTree.size(); ++i )
+	{
+		int slot = tile.blockTree[i].cacheSlot;
+		if( slot < 0 ) continue;
+		
+		unlinkCacheSlot( slot );
+		linkCacheSlot( slot, false );
+		_blockCache[slot].tileIndex = -1;
+	}
+
+	delete[] tile.heightData; tile.heightData = 0x0;
+	std::vector< BlockInfo >().swap( tile.blockTree );
+	tile.state = TileStates::Unloaded;
+}
+
+
+void TerrainNode::releaseTileLoader()
+{
+	if( _tileLoader == 0x0 ) return;
+
+	tiledNodes.erase( std::find( tiledNodes.begin(), tiledNodes.end(), this ) );
+	delete _tileLoader; _tileLoader = 0x0;
+}
+
+
+void TerrainNode::updateTiles( const Vec3f &localCamPos )
+{
+	if( _tileLoader == 0x0 ) return;
+
+	// Take over tiles finished by the loader
+	bool tilesChanged = false;
+	TerrainTileLoader::Result result;
+	while( _tileLoader->popResult( result ) )
+	{
+		TerrainTile &tile = _tiles[result.tileIndex];
+		
+		if( result.generation != _tileGeneration || tile.state != TileStates::Loading )
+		{
+			delete[] result.heightData;
+		}
+		else if( result.heightData == 0x0 )
+		{
+			Modules::log().writeError( "Terrain node '%s': failed to load height tile %d,%d",
+				_name.c_str(), tile.x, tile.y );
+			tile.state = TileStates::Failed;
+		}
+		else
+		{
+			tile.heightData = result.heightData;
+			tile.blockTree.swap( result.blockTree );
+			tile.state = TileStates::Resident;
+			tilesChanged = true;
+		}
+	}
+
+	// Request tiles around the camera, release the ones that are far enough away. The hysteresis
+	// of one tile avoids reloading when the camera moves along a tile border.
+	const float camX = localCamPos.x * _tileCount, camY = localCamPos.z * _tileCount;
+	std::vector< std::pair< float, uint32 > > loadList;
+	
+	for( uint32 i = 0; i < (uint32)_tiles.size(); ++i )
+	{
+		TerrainTile &tile = _tiles[i];
+		
+		float dx = maxf( maxf( tile.x - camX, camX - (tile.x + 1) ), 0 );
+		float dy = maxf( maxf( tile.y - camY, camY - (tile.y + 1) ), 0 );
+		float dist = sqrtf( dx * dx + dy * dy );
+
+		if( dist <= _tileLoadRadius )
+		{
+			if( tile.state == TileStates::Unloaded )
+				loadList.push_back( std::make_pair( dist, i ) );
+		}
+		else if( dist > _tileLoadRadius + 1 && tile.state != TileStates::Unloaded )
+		{
+			releaseTile( i );
+			tilesChanged = true;
+		}
+	}
+
+	// Invalidates cached shadow maps
+	if( tilesChanged ) Modules::sceneMan().updateSpatialNode( _sgHandle );
+
+	// Closest tiles are read and built first
+	std::sort( loadList.begin(), loadList.end() );
+	
+	for( size_t i = 0; i < loadList.size(); ++i )
+	{
+		TerrainTile &tile = _tiles[loadList[i].second];
+		
+		std::stringstream ss;
+		ss << _tilePath << "_" << tile.x << "_" << tile.y << ".r16";
+		
+		TerrainTileLoader::Request request;
+		request.fileName = ss.str();
+		request.tileIndex = loadList[i].second;
+		request.generation = _tileGeneration;
+		request.hmapSize = _hmapSize;
+		request.blockSize = _blockSize;
+		request.maxLevel = _maxLevel;
+		request.horizScale = 1.0f / _tileCount;
+		_tileLoader->addRequest( request );
+
+		tile.state = TileStates::Loading;
+	}
+}
+
+
+bool TerrainNode::isValidTileLayout( int tileCount, int tileSize )
+{
+	if( tileCount < 1 || tileCount > 1024 ) return false;
+	if( tileSize < 16 || tileSize > 8192 || (tileSize & (tileSize - 1)) != 0 ) return false;
+	
+	return true;
+}
+
+
+float TerrainNode::getHeight( float x, float y ) const
+{
+	// Coordinates are relative to the complete terrain
+	int tileX = std::min( ftoi_t( x * _tileCount ), (int)_tileCount - 1 );
+	int tileY = std::min( ftoi_t( y * _tileCount ), (int)_tileCount - 1 );
+	if( tileX < 0 || tileY < 0 ) return 0;
+
+	const TerrainTile &tile = _tiles[tileY * _tileCount + tileX];
+	if( tile.heightData == 0x0 ) return 0;
+
+	return getTileHeight( tile.heightData, _hmapSize, x * _tileCount - tileX, y * _tileCount - tileY );
+}
+
+
+bool TerrainNode::getSampleHeight( int x, int y, float &height ) const
+{
+	// Sample coordinates are global; border samples are shared by neighbouring tiles
+	int tileX = std::min( x / (int)_hmapSize, (int)_tileCount - 1 );
+	int tileY = std::min( y / (int)_hmapSize, (int)_tileCount - 1 );
+
+	const TerrainTile &tile = _tiles[tileY * _tileCount + tileX];
+	if( tile.heightData == 0x0 ) return false;
+
+	height = tile.heightData[(y - tileY * _hmapSize) * (_hmapSize + 1) + (x - tileX * _hmapSize)] / 65535.0f;
+	return true;
+}
+
+
+void TerrainNode::buildBlockInfo( const uint16 *heightData, uint32 hmapSize, uint32 blockSize, float horizScale,
+                                  BlockInfo &block, float minU, float minV, float maxU, float maxV )
+{
+	// Error metric is evaluated in terrain space, so blocks of different tiles are comparable
+	const float pixelStep = 1.0f / hmapSize;
+	const float stepU = (maxU - minU) / (blockSize - 1);
+	const float stepV = (maxV - minV) / (blockSize - 1);
+	
+	for( uint32 v = 0; v < blockSize - 1; ++v )
+	{
+		for( uint32 u = 0; u < blockSize - 1; ++u )
+		{
+			float u0 = minU + u * stepU, u1 = minU + (u + 1) * stepU;
+			float v0 = minV + v * stepV, v1 = minV + (v + 1) * stepV;
+			
+			Vec3f corner0( u0 * horizScale, getTileHeight( heightData, hmapSize, u0, v0 ), v0 * horizScale );
+			Vec3f corner1( u0 * horizScale, getTileHeight( heightData, hmapSize, u0, v1 ), v1 * horizScale );
+			Vec3f corner2( u1 * horizScale, getTileHeight( heightData, hmapSize, u1, v0 ), v0 * horizScale );
+			Vec3f corner3( u1 * horizScale, getTileHeight( heightData, hmapSize, u1, v1 ), v1 * horizScale );
 			
 			Plane tri0( corner0, corner1, corner2 );
 			Plane tri1( corner1, corner2, corner3 );
@@ -528,8 +836,8 @@ void TerrainNode::buildBlockInfo( BlockInfo &block, float minU, float minV, floa
 				{
 					Plane &curTri = uu <= vv ? tri0 : tri1;
 					
-					Vec3f point( minU + u * stepU + uu, 0, minV + v * stepV + vv );
-					point.y = getHeight( point.x, point.z );
+					Vec3f point( (u0 + uu) * horizScale, getTileHeight( heightData, hmapSize, u0 + uu, v0 + vv ),
+					             (v0 + vv) * horizScale );
 					
 					block.minHeight = minf( point.y, block.minHeight );
 					block.maxHeight = maxf( point.y, block.maxHeight );
@@ -541,16 +849,18 @@ void TerrainNode::buildBlockInfo( BlockInfo &block, float minU, float minV, floa
 }
 
 
-void TerrainNode::createBlockTree()
+void TerrainNode::buildBlockTree( const uint16 *heightData, uint32 hmapSize, uint32 blockSize,
+                                  uint32 maxLevel, float horizScale, std::vector< BlockInfo > &blockTree )
 {
 	// The block tree contains the renderable blocks for each quad tree level, starting at the
-	// lowest resolution level 0 (just one block for the complete terrain)
+	// lowest resolution level 0 (just one block for the complete tile)
 
 	uint32 size = 0, index = 0;
-	for( uint32 i = 0; i <= _maxLevel; ++i ) size += (1 << i) * (1 << i);
-	_blockTree.resize( size );
+	for( uint32 i = 0; i <= maxLevel; ++i ) size += (1 << i) * (1 << i);
+	blockTree.clear();
+	blockTree.resize( size );
 
-	for( uint32 i = 0; i <= _maxLevel; ++i )
+	for( uint32 i = 0; i <= maxLevel; ++i )
 	{
 		uint32 numBlocks = 1 << i;
 
@@ -558,7 +868,8 @@ void TerrainNode::createBlockTree()
 		{
 			for( uint32 x = 0; x < numBlocks; ++x )
 			{
-				buildBlockInfo( _blockTree[index++], (float)x / numBlocks, (float)y / numBlocks,
+				buildBlockInfo( heightData, hmapSize, blockSize, horizScale, blockTree[index++],
+				                (float)x / numBlocks, (float)y / numBlocks,
 				                (float)(x + 1) / numBlocks, (float)(y + 1) / numBlocks );
 			}
 		}
@@ -566,6 +877,23 @@ void TerrainNode::createBlockTree()
 }
 
 
+void TerrainNode::createBlockTree()
+{
+	releaseBlockCache();
+
+	if( _tileLoader == 0x0 )
+	{
+		buildBlockTree( _tiles[0].heightData, _hmapSize, _blockSize, _maxLevel, 1.0f, _tiles[0].blockTree );
+	}
+	else
+	{
+		// Streamed tiles are reloaded with the new block layout
+		for( uint32 i = 0; i < (uint32)_tiles.size(); ++i ) releaseTile( i );
+		++_tileGeneration;
+	}
+}
+
+
 int TerrainNode::getParamI( int param ) const
 {
 	switch( param )
@@ -574,6 +902,13 @@ int TerrainNode::getParamI( int param ) const
 		return _materialRes != 0x0 ? _materialRes->getHandle() : 0;
 	case TerrainNodeParams::BlockSizeI:
 		return _blockSize;
+	case TerrainNodeParams::ResidentTileCountI:
+		{
+			int count = 0;
+			for( size_t i = 0; i < _tiles.size(); ++i )
+				if( _tiles[i].state == TileStates::Resident ) ++count;
+			return count;
+		}
 	}
 
 	return SceneNode::getParamI( param );
@@ -590,6 +925,14 @@ void TerrainNode::setParamI( int param, int value )
 		if( res != 0x0 && res->getType() == ResourceTypes::Texture &&
 		    ((TextureResource *)res)->getTexType() != TextureTypes::Tex2D )
 		{
+			if( _tileLoader != 0x0 )
+			{
+				// Height map replaces streamed tiles
+				releaseTileLoader();
+				_tilePath = "";
+				initTiles( 1 );
+			}
+			
 			bool result = updateHeightData( *((TextureResource *)res) );
 			recreateVertexBuffer();
 			calcMaxLevel();
@@ -632,6 +975,8 @@ float TerrainNode::getParamF( int param, int compIdx ) const
 		return 1.0f / _lodThreshold;
 	case TerrainNodeParams::SkirtHeightF:
 		return _skirtHeight;
+	case TerrainNodeParams::TileLoadRadiusF:
+		return _tileLoadRadius;
 	}
 
 	return SceneNode::getParamF( param, compIdx );
@@ -648,6 +993,12 @@ void TerrainNode::setParamF( int param, int compIdx, float value )
 	case TerrainNodeParams::SkirtHeightF:
 		_skirtHeight = value; 
 		return;
+	case TerrainNodeParams::TileLoadRadiusF:
+		if( value >= 0 )
+			_tileLoadRadius = value;
+		else
+			Modules::setError( "Invalid value in h3dSetNodeParamF for H3DEXTTerrain::TileLoadRadiusF" );
+		return;
 	}
 
 	SceneNode::setParamF( param, compIdx, value );
@@ -696,15 +1047,17 @@ bool TerrainNode::checkIntersection( const Vec3f &rayOrig, const Vec3f &rayDir,
 
 	dir /= dir.length();
 
-	int x = ftoi_t( startX * (_hmapSize + 1) );
-	int y = ftoi_t( startZ * (_hmapSize + 1) );
+	// Samples of all tiles form one global grid; only resident tiles can be hit
+	const int size = _tileCount * _hmapSize;
+	int x = ftoi_t( startX * size );
+	int y = ftoi_t( startZ * size );
 
 	// Check heightmap with Bresenham algorithm (code based on http://de.wikipedia.org/wiki/Bresenham-Algorithmus)
 	int t, dx, dy, incX, incY, pdx, pdy, ddx, ddy, err_step_fast, err_step_slow, err;
 
 	// Get deltas in image space
-	dx = ftoi_t( (endX - startX) * (_hmapSize + 1) );
-	dy = ftoi_t( (endZ - startZ) * (_hmapSize + 1) );
+	dx = ftoi_t( (endX - startX) * size );
+	dy = ftoi_t( (endZ - startZ) * size );
 
 	// Check directions
 	incX = (dx > 0) ? 1 : (dx < 0) ? -1 : 0;
@@ -728,7 +1081,8 @@ bool TerrainNode::checkIntersection( const Vec3f &rayOrig, const Vec3f &rayDir,
 	// Init error
 	err = err_step_slow / 2;		
 	
-	float height1 = _heightData[y * (_hmapSize + 1) + x] / 65535.0f, height2;
+	float height1 = 0, height2 = 0;
+	bool valid1 = getSampleHeight( x, y, height1 ), valid2;
 
 	Vec3f pos;
 	Vec3f prevPos;
@@ -736,7 +1090,7 @@ bool TerrainNode::checkIntersection( const Vec3f &rayOrig, const Vec3f &rayDir,
 	// Check for perpendicular ray
 	if( fabs(dir.z) <= Math::Epsilon && fabs(dir.x) <= Math::Epsilon )
 	{
-		if( (height1 < orig.y && height1 > dir.y) || (height1 > orig.y && height1 < dir.y) )
+		if( valid1 && ((height1 < orig.y && height1 > dir.y) || (height1 > orig.y && height1 < dir.y)) )
 		{
 			intsPos = _absTrans * Vec3f(orig.x, height1, orig.z);
 			return true;
@@ -766,27 +1120,31 @@ bool TerrainNode::checkIntersection( const Vec3f &rayOrig, const Vec3f &rayDir,
 			x += pdx;
 			y += pdy;
 		}					
-		height2 = _heightData[y * (_hmapSize + 1) + x] / 65535.0f;
+		valid2 = getSampleHeight( x, y, height2 );
 
-		pos.x = x / (float)_hmapSize;
-		pos.z = y / (float)_hmapSize;
+		pos.x = x / (float)size;
+		pos.z = y / (float)size;
 		// Calculate y value based on the fraction of the current position on the direction vector						
 		if( fabs(dir.z) <= Math::Epsilon)
 			pos.y = (dir.y * (pos.x - orig.x) + dir.x * orig.y) / dir.x;
 		else
 			pos.y = (dir.y * (pos.z - orig.z) + dir.z * orig.y) / dir.z;
 
-		if( prevPos.y >= pos.y && prevPos.y >= height1 && pos.y <= height2 ) 
+		if( valid1 && valid2 )
 		{
-			intsPos = _absTrans * pos;
-			return true;
-		}
-		if( prevPos.y <= pos.y && prevPos.y <= height1 && pos.y >= height2 )
-		{
-			intsPos = _absTrans * pos;
-			return true;
+			if( prevPos.y >= pos.y && prevPos.y >= height1 && pos.y <= height2 ) 
+			{
+				intsPos = _absTrans * pos;
+				return true;
+			}
+			if( prevPos.y <= pos.y && prevPos.y <= height1 && pos.y >= height2 )
+			{
+				intsPos = _absTrans * pos;
+				return true;
+			}
 		}
 		height1 = height2;
+		valid1 = valid2;
 		prevPos = pos;	
 	}
 	
@@ -794,8 +1152,8 @@ bool TerrainNode::checkIntersection( const Vec3f &rayOrig, const Vec3f &rayDir,
 }
 
 
-uint32 TerrainNode::calculateGeometryBlockCount( float lodThreshold, float minU, float minV,
-                                                 float maxU, float maxV, int level, float scale)
+uint32 TerrainNode::calculateGeometryBlockCount( const TerrainTile &tile, float lodThreshold, float minU,
+                                                 float minV, float maxU, float maxV, int level, float scale)
 {
 	int blockCount = 0;
 	const float halfU = (minU + maxU) / 2.0f;
@@ -805,7 +1163,7 @@ uint32 TerrainNode::calculateGeometryBlockCount( float lodThreshold, float minU,
 	for( int i = 0; i < level; ++i ) offset += (1 << i) * (1 << i);
 
 	const uint32 blockIndex = offset + ftoi_t( minV * (1 << level) ) * (1 << level) + ftoi_t( minU * (1 << level) );
-	BlockInfo &block = _blockTree[blockIndex];
+	const BlockInfo &block = tile.blockTree[blockIndex];
 	
 	const float p = block.geoError;
 
@@ -827,7 +1185,7 @@ uint32 TerrainNode::calculateGeometryBlockCount( float lodThreshold, float minU,
 
 		for( uint32 i = 0; i < 4; ++i )
 		{
-			blockCount += calculateGeometryBlockCount( lodThreshold, blocks[i].x, blocks[i].y,
+			blockCount += calculateGeometryBlockCount( tile, lodThreshold, blocks[i].x, blocks[i].y,
 			                                           blocks[i].z, blocks[i].w, level + 1, scale );
 		}
 	}
@@ -835,8 +1193,8 @@ uint32 TerrainNode::calculateGeometryBlockCount( float lodThreshold, float minU,
 }
 
 
-void TerrainNode::createGeometryVertices( float lodThreshold, float minU, float minV, float maxU,
-	float maxV, int level, float scale, float *&vertData, uint32 *&indexData, uint32 &indexOffset )
+void TerrainNode::createGeometryVertices( const TerrainTile &tile, float lodThreshold, float minU, float minV,
+	float maxU, float maxV, int level, float scale, float *&vertData, uint32 *&indexData, uint32 &indexOffset )
 {
 	const float halfU = (minU + maxU) / 2.0f;
 	const float halfV = (minV + maxV) / 2.0f;
@@ -845,7 +1203,7 @@ void TerrainNode::createGeometryVertices( float lodThreshold, float minU, float
 	for( int i = 0; i < level; ++i ) offset += (1 << i) * (1 << i);
 
 	const uint32 blockIndex =  offset + ftoi_t( minV * (1 << level) ) * (1 << level) + ftoi_t( minU * (1 << level) );
-	BlockInfo &block = _blockTree[blockIndex];
+	const BlockInfo &block = tile.blockTree[blockIndex];
 
 	// Determine level of detail
 	const float p = block.geoError;
@@ -854,6 +1212,7 @@ void TerrainNode::createGeometryVertices( float lodThreshold, float minU, float
 	{
 		const uint32 size = _blockSize + 2;
 		const float invScale = 1.0f / (_blockSize - 1);
+		const float tileScale = 1.0f / _tileCount;
 
 		for( uint32 v = 0; v < size; ++v )
 		{	
@@ -869,14 +1228,14 @@ void TerrainNode::createGeometryVertices( float lodThreshold, float minU, float
 				const float newV = (t * scale + minV) * _hmapSize + 0.5f;
 				uint32 index = ftoi_t( newV ) * (_hmapSize + 1) + ftoi_t( newU );
 
-                vertData = (float*) elemset_le(vertData, (s * scale + minU));
+                vertData = (float*) elemset_le(vertData, (tile.x + s * scale + minU) * tileScale);
 
 				if( v == 0 || v == size - 1 || u == 0 || u == size - 1 )
-					vertData = (float*) elemset_le(vertData, (maxf( _heightData[index] / 65535.0f - _skirtHeight, 0 )));
+					vertData = (float*) elemset_le(vertData, (maxf( tile.heightData[index] / 65535.0f - _skirtHeight, 0 )));
 				else
-					vertData = (float*) elemset_le(vertData, (_heightData[index] / 65535.0f));
+					vertData = (float*) elemset_le(vertData, (tile.heightData[index] / 65535.0f));
 
-                vertData = (float*) elemset_le(vertData, (t * scale + minV));
+                vertData = (float*) elemset_le(vertData, (tile.y + t * scale + minV) * tileScale);
 			}
 		}
 
@@ -909,7 +1268,7 @@ void TerrainNode::createGeometryVertices( float lodThreshold, float minU, float
 
 		for( uint32 i = 0; i < 4; ++i )
 		{
-			createGeometryVertices( lodThreshold, blocks[i].x, blocks[i].y, blocks[i].z, blocks[i].w,
+			createGeometryVertices( tile, lodThreshold, blocks[i].x, blocks[i].y, blocks[i].z, blocks[i].w,
 			                        level + 1, scale, vertData, indexData, indexOffset );
 		}
 	}
@@ -927,7 +1286,18 @@ ResHandle TerrainNode::createGeometryResource( const string &name, float lodThre
 		return 0;
 	}
 
-	uint32 blockCount = calculateGeometryBlockCount( lodThreshold, 0.0f, 0.0f, 1.0f, 1.0f, 0, 1.0f );
+	// Only resident tiles are included
+	uint32 blockCount = 0;
+	for( size_t i = 0; i < _tiles.size(); ++i )
+	{
+		if( _tiles[i].state == TileStates::Resident )
+			blockCount += calculateGeometryBlockCount( _tiles[i], lodThreshold, 0.0f, 0.0f, 1.0f, 1.0f, 0, 1.0f );
+	}
+	if( blockCount == 0 )
+	{
+		Modules::log().writeDebugInfo( "No resident terrain tiles in h3dextCreateTerrainGeoRes" );
+		return 0;
+	}
 	// Calculate number of vertices 
 	const uint32 streamSize = blockCount * getVertexCount();
 	// Calculate size of elements in stream
@@ -967,7 +1337,12 @@ ResHandle TerrainNode::createGeometryResource( const string &name, float lodThre
 	//const unsigned int* const refIndexData = (unsigned int*)(pData + streamSize * streamElementSize + sizeof( uint32 ));
 	uint32 *indexData = (uint32 *)(pData + streamSize * streamElementSize + sizeof( uint32 ));
 	
-	createGeometryVertices( lodThreshold, 0.0f, 0.0f, 1.0f, 1.0f, 0, 1.0f, vertexData, indexData, index );
+	for( size_t i = 0; i < _tiles.size(); ++i )
+	{
+		if( _tiles[i].state == TileStates::Resident )
+			createGeometryVertices( _tiles[i], lodThreshold, 0.0f, 0.0f, 1.0f, 1.0f, 0, 1.0f,
+			                        vertexData, indexData, index );
+	}
 	
 	// Skip vertex data
 	pData += streamSize * streamElementSize;
@@ -989,4 +1364,108 @@ ResHandle TerrainNode::createGeometryResource( const string &name, float lodThre
 	return res;
 }
 
+
+// =================================================================================================
+// Class TerrainTileLoader
+// =================================================================================================
+
+TerrainTileLoader::TerrainTileLoader() :
+	_quit( false )
+{
+	_worker = std::thread( &TerrainTileLoader::workerMain, this );
+}
+
+
+TerrainTileLoader::~TerrainTileLoader()
+{
+	{
+		std::lock_guard< std::mutex > lock( _mutex );
+		_quit = true;
+	}
+	_wakeCond.notify_one();
+	_worker.join();
+
+	for( size_t i = 0; i < _results.size(); ++i ) delete[] _results[i].heightData;
+}
+
+
+void TerrainTileLoader::addRequest( const Request &request )
+{
+	{
+		std::lock_guard< std::mutex > lock( _mutex );
+		_requests.push_back( request );
+	}
+	_wakeCond.notify_one();
+}
+
+
+bool TerrainTileLoader::popResult( Result &result )
+{
+	std::lock_guard< std::mutex > lock( _mutex );
+
+	if( _results.empty() ) return false;
+	
+	result.heightData = _results.back().heightData;
+	result.blockTree.swap( _results.back().blockTree );
+	result.tileIndex = _results.back().tileIndex;
+	result.generation = _results.back().generation;
+	_results.pop_back();
+	
+	return true;
+}
+
+
+void TerrainTileLoader::workerMain()
+{
+	std::unique_lock< std::mutex > lock( _mutex );
+
+	while( true )
+	{
+		_wakeCond.wait( lock, [this] { return _quit || !_requests.empty(); } );
+		if( _quit ) break;
+
+		Request request = _requests.front();
+		_requests.pop_front();
+
+		lock.unlock();
+		Result result;
+		loadTile( request, result );
+		lock.lock();
+
+		_results.push_back( Result() );
+		_results.back().heightData = result.heightData;
+		_results.back().blockTree.swap( result.blockTree );
+		_results.back().tileIndex = result.tileIndex;
+		_results.back().generation = result.generation;
+	}
+}
+
+
+void TerrainTileLoader::loadTile( const Request &request, Result &result )
+{
+	result.heightData = 0x0;
+	result.tileIndex = request.tileIndex;
+	result.generation = request.generation;
+	
+	const uint32 numSamples = (request.hmapSize + 1) * (request.hmapSize + 1);
+
+	std::ifstream inf( request.fileName.c_str(), std::ios::in | std::ios::binary );
+	if( !inf.good() ) return;
+
+	char *data = new char[numSamples * sizeof( uint16 )];
+	inf.read( data, numSamples * sizeof( uint16 ) );
+	
+	// File must contain exactly the samples of one tile
+	if( inf.gcount() == (std::streamsize)(numSamples * sizeof( uint16 )) && inf.peek() == EOF )
+	{
+		// Samples are stored as little endian
+		result.heightData = new uint16[numSamples];
+		elemcpy_le( result.heightData, (const uint16 *)data, numSamples );
+
+		TerrainNode::buildBlockTree( result.heightData, request.hmapSize, request.blockSize,
+		                             request.maxLevel, request.horizScale, result.blockTree );
+	}
+	delete[] data;
+}
+
 }  // namespace
@@ -17,6 +17,11 @@
 #include "egMaterial.h"
 #include "egTexture.h"
 #include "egScene.h"
+#include "egCamera.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
 
 
 namespace Horde3DTerrain {
@@ -36,13 +41,17 @@ struct TerrainNodeTpl : public SceneNodeTpl
 {
 	PTextureResource   hmapRes;
 	PMaterialResource  matRes;
+	std::string        tilePath;  // Height tiles are streamed from disk if not empty
 	float              meshQuality;
 	float              skirtHeight;
+	float              tileLoadRadius;
 	int                blockSize;
+	int                tileCount, tileSize;
 
 	TerrainNodeTpl( const std::string &name, TextureResource *hmapRes, MaterialResource *matRes ) :
 		SceneNodeTpl( SNT_TerrainNode, name ), hmapRes( hmapRes ), matRes( matRes ),
-		meshQuality( 50.0f ), skirtHeight( 0.1f ), blockSize( 17 )
+		meshQuality( 50.0f ), skirtHeight( 0.1f ), tileLoadRadius( 2.0f ), blockSize( 17 ),
+		tileCount( 1 ), tileSize( 256 )
 	{
 	}
 };
@@ -56,7 +65,9 @@ struct TerrainNodeParams
 		MatResI,
 		MeshQualityF,
 		SkirtHeightF,
-		BlockSizeI
+		BlockSizeI,
+		TileLoadRadiusF,
+		ResidentTileCountI
 	};
 };
 
@@ -65,8 +76,86 @@ struct BlockInfo
 	float minHeight;
 	float maxHeight;
 	float geoError;		// Maximum geometric error
+	int   cacheSlot;	// Slot in height cache or -1 if heights are not resident
 
-	BlockInfo() : minHeight( 1.0f ), maxHeight( 0.0f ), geoError( 0.0f ) {}
+	BlockInfo() : minHeight( 1.0f ), maxHeight( 0.0f ), geoError( 0.0f ), cacheSlot( -1 ) {}
+};
+
+// The heights of recently drawn blocks stay resident in vertex buffers, so that a block only needs
+// to be uploaded when it becomes visible or changes its level of detail
+struct BlockCacheSlot
+{
+	uint32  blockIndex;
+	uint32  geometry;      // Shares position and index buffer of terrain node
+	uint32  heightBuffer;
+	int     prev, next;    // LRU list, most recently used first
+
+	int     tileIndex;     // -1 if slot is free
+	
+	BlockCacheSlot() : blockIndex( 0 ), geometry( 0 ), heightBuffer( 0 ), prev( -1 ), next( -1 ),
+		tileIndex( -1 ) {}
+};
+
+struct TileStates
+{
+	enum List
+	{
+		Unloaded,
+		Loading,   // Read and processed by the tile loader
+		Resident,
+		Failed
+	};
+};
+
+// A square part of the terrain with its own height data and block tree. Terrains created from a
+// height map texture consist of a single tile which is always resident.
+struct TerrainTile
+{
+	uint16                    *heightData;  // (hmapSize + 1)^2 samples, 0x0 if not resident
+	std::vector< BlockInfo >  blockTree;
+	uint32                    x, y;
+	TileStates::List          state;
+
+	TerrainTile() : heightData( 0x0 ), x( 0 ), y( 0 ), state( TileStates::Unloaded ) {}
+};
+
+// Reads height tiles from disk and builds their block trees on a background thread
+class TerrainTileLoader
+{
+public:
+	struct Request
+	{
+		std::string  fileName;
+		uint32       tileIndex, generation;
+		uint32       hmapSize, blockSize, maxLevel;
+		float        horizScale;
+	};
+
+	struct Result
+	{
+		uint16                    *heightData;  // 0x0 if the tile could not be read
+		std::vector< BlockInfo >  blockTree;
+		uint32                    tileIndex, generation;
+	};
+
+	TerrainTileLoader();
+	~TerrainTileLoader();
+
+	// Requests are processed in the order in which they are added
+	void addRequest( const Request &request );
+	bool popResult( Result &result );
+
+private:
+	void workerMain();
+	static void loadTile( const Request &request, Result &result );
+
+private:
+	std::thread                _worker;
+	std::mutex                 _mutex;
+	std::condition_variable    _wakeCond;
+	std::deque< Request >      _requests;
+	std::vector< Result >      _results;
+	bool                       _quit;
 };
 
 class TerrainNode : public SceneNode
@@ -74,10 +163,11 @@ class TerrainNode : public SceneNode
 public:
 	~TerrainNode();
 
-	static SceneNodeTpl *parsingFunc( std::map< std::string, std::string > &attribs );
+	static SceneNodeTpl *parsingFunc( const SceneNodeAttribs &attribs );
 	static SceneNode *factoryFunc( const SceneNodeTpl &nodeTpl );
-	static void renderFunc(uint32 firstItem, uint32 lastItem, const std::string &shaderContext, const std::string &theClass,
+	static void renderFunc(uint32 firstItem, uint32 lastItem, uint32 shaderContext, uint32 classFilter,
 		bool debugView, const Frustum *frust1, const Frustum *frust2, RenderingOrder::List order, int occSet );
+	static void cameraUpdateFunc( CameraNode &camera );
 
 	virtual bool canAttach( SceneNode &parent );
 	virtual int getParamI( int param ) const;
@@ -89,12 +179,19 @@ public:
 
 	ResHandle createGeometryResource( const std::string &name, float lodThreshold );
 	
-	float getHeight( float x, float y )
-		{ return _heightData[ftoi_r( y * _hmapSize ) * (_hmapSize + 1) + ftoi_r( x * _hmapSize ) ] / 65535.0f; }
+	float getHeight( float x, float y ) const;  // Returns 0 if tile is not resident
+
+	static bool isValidTileLayout( int tileCount, int tileSize );
+	static float getTileHeight( const uint16 *heightData, uint32 hmapSize, float u, float v )
+		{ return heightData[ftoi_r( v * hmapSize ) * (hmapSize + 1) + ftoi_r( u * hmapSize ) ] / 65535.0f; }
+	static void buildBlockTree( const uint16 *heightData, uint32 hmapSize, uint32 blockSize,
+	                            uint32 maxLevel, float horizScale, std::vector< BlockInfo > &blockTree );
 
 public:
 	static uint32 vlTerrain;
 	static ShaderCombination debugViewShader;
+	static const uint32 MaxCachedBlocks = 1024;
+	static std::vector< TerrainNode * > tiledNodes;  // Nodes that stream their tiles
 
 protected:
 	TerrainNode( const TerrainNodeTpl &terrainTpl );
@@ -104,22 +201,33 @@ protected:
 	bool updateHeightData( TextureResource &hmap );
 	void calcMaxLevel();
 	
+	void initTiles( uint32 tileCount );
+	void releaseTile( uint32 tileIndex );
+	void releaseTileLoader();
+	void updateTiles( const Vec3f &localCamPos );
+	bool getSampleHeight( int x, int y, float &height ) const;
+	
 	uint32 getVertexCount();
 	float *createVertices();
 	uint32 getIndexCount();
 	uint16 *createIndices();
 	void recreateVertexBuffer();
+	uint32 getBlockGeometry( uint32 tileIndex, uint32 blockIndex, float minU, float minV, float scale );
+	void unlinkCacheSlot( int slot );
+	void linkCacheSlot( int slot, bool mostRecent );
+	void releaseBlockCache();
 	
-	void buildBlockInfo( BlockInfo &block, float minU, float minV, float maxU, float maxV );
+	static void buildBlockInfo( const uint16 *heightData, uint32 hmapSize, uint32 blockSize, float horizScale,
+	                            BlockInfo &block, float minU, float minV, float maxU, float maxV );
 	void createBlockTree();
 
-	static void drawTerrainBlock( TerrainNode *terrain, float minU, float minV, float maxU, float maxV,
-	                              int level, float scale, const Vec3f &localCamPos, const Frustum *frust1,
-	                              const Frustum *frust2, int uni_terBlockParams );
+	static void drawTerrainBlock( TerrainNode *terrain, uint32 tileIndex, float minU, float minV, float maxU,
+	                              float maxV, int level, float scale, const Vec3f &localCamPos,
+	                              const Frustum *frust1, const Frustum *frust2, int uni_terBlockParams );
 
-	uint32 calculateGeometryBlockCount( float lodThreshold, float minU, float minV,
+	uint32 calculateGeometryBlockCount( const TerrainTile &tile, float lodThreshold, float minU, float minV,
 	                                    float maxU, float maxV, int level, float scale);
-	void createGeometryVertices( float lodThreshold, float minU, float minV,
+	void createGeometryVertices( const TerrainTile &tile, float lodThreshold, float minU, float minV,
 	                             float maxU, float maxV, int level, float scale, 
 	                             float *&vertData, unsigned int *&indexData, uint32 &indexOffset );
 
@@ -129,15 +237,22 @@ protected:
 	float              _skirtHeight;
 	float              _lodThreshold;
 	
-	uint32             _hmapSize;
-	uint16             *_heightData;
+	uint32             _hmapSize;  // Size of a tile
 	uint32             _maxLevel;
 	float              *_heightArray;
 	uint32             _vertexBuffer, _indexBuffer;
 	BoundingBox        _localBBox;
 
-	std::vector< BlockInfo >  _blockTree;
-	uint32 _geometry;
+	std::vector< TerrainTile >     _tiles;
+	uint32                         _tileCount;  // Number of tiles per side
+	std::string                    _tilePath;
+	float                          _tileLoadRadius;  // In tiles
+	uint32                         _tileGeneration;  // Changes when loaded tiles become invalid
+	uint32                         _tileUpdateFrame;
+	TerrainTileLoader              *_tileLoader;
+	
+	std::vector< BlockCacheSlot >  _blockCache;
+	int                            _lruHead, _lruTail;
 };
 
 }  // namespace
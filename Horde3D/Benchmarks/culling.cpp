@@ -0,0 +1,129 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2016 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+
+// Compares frustum culling of boxes stored in the individual scene nodes, tested one at a time with
+// Frustum::cullBox as the spatial graph did before, with the batch kernel Frustum::cullBoxes over
+// the structure-of-arrays copy that the spatial graph keeps now. Only the leaf test is measured,
+// tree traversal is the same for both paths.
+//
+//   CullingBench [iterations]
+//
+// CullingBenchScalar is built with H3D_NO_SIMD and shows how much of the difference comes from the
+// memory layout alone. Build with AVX2 enabled (e.g. -mavx2) to use the 8-wide kernel.
+
+#include "egPrimitives.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace Horde3D;
+using namespace std;
+
+
+// Stand-in for a scene node: boxes are embedded in large polymorphic objects on the heap
+class BenchNode
+{
+public:
+	virtual ~BenchNode() {}
+
+	BoundingBox  bBox;
+	char         otherMembers[320];
+};
+
+
+static float randf( float min, float max )
+{
+	return min + (max - min) * (float)rand() / RAND_MAX;
+}
+
+
+static void runBenchmark( uint32 count, int iterations, const Frustum &frustum )
+{
+	// Random boxes in front of the camera, roughly a quarter of them visible
+	vector< BenchNode * > nodes( count );
+	BoundingBoxArray boxes;
+	boxes.resize( count );
+	vector< uint32 > indices( count ), visible( count );
+	
+	for( uint32 i = 0; i < count; ++i )
+	{
+		Vec3f pos( randf( -500, 500 ), randf( -500, 500 ), randf( -1000, 0 ) );
+		float size = randf( 1, 5 );
+		
+		nodes[i] = new BenchNode();
+		nodes[i]->bBox.min = pos;
+		nodes[i]->bBox.max = pos + Vec3f( size, size, size );
+		indices[i] = i;
+	}
+	
+	// Nodes are created and destroyed in arbitrary order over the lifetime of a scene
+	for( uint32 i = count - 1; i > 0; --i ) swap( nodes[i], nodes[rand() % (i + 1)] );
+	for( uint32 i = 0; i < count; ++i ) boxes.set( i, nodes[i]->bBox );
+
+	uint32 visibleNodes = 0, visibleBoxes = 0;
+	
+	chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+	for( int it = 0; it < iterations; ++it )
+	{
+		visibleNodes = 0;
+		for( uint32 i = 0; i < count; ++i )
+		{
+			if( !frustum.cullBox( nodes[i]->bBox ) ) ++visibleNodes;
+		}
+	}
+	chrono::steady_clock::time_point t1 = chrono::steady_clock::now();
+	for( int it = 0; it < iterations; ++it )
+	{
+		visibleBoxes = frustum.cullBoxes( boxes, &indices[0], count, &visible[0] );
+	}
+	chrono::steady_clock::time_point t2 = chrono::steady_clock::now();
+
+	double nodeTime = chrono::duration< double, nano >( t1 - t0 ).count() / ((double)iterations * count);
+	double batchTime = chrono::duration< double, nano >( t2 - t1 ).count() / ((double)iterations * count);
+	printf( "%7u nodes: per node %6.2f ns/box, batch %6.2f ns/box, speedup %5.2fx, visible %u%s\n",
+	        count, nodeTime, batchTime, nodeTime / batchTime, visibleBoxes,
+	        visibleNodes != visibleBoxes ? " (MISMATCH)" : "" );
+
+	for( uint32 i = 0; i < count; ++i ) delete nodes[i];
+}
+
+
+int main( int argc, char **argv )
+{
+	int iterations = argc > 1 ? atoi( argv[1] ) : 0;
+	
+#if defined( H3D_SIMD_AVX2 )
+	printf( "Batch kernel: AVX2\n" );
+#elif defined( H3D_SIMD_SSE2 )
+	printf( "Batch kernel: SSE2\n" );
+#elif defined( H3D_SIMD_NEON )
+	printf( "Batch kernel: NEON\n" );
+#else
+	printf( "Batch kernel: scalar\n" );
+#endif
+
+	Frustum frustum;
+	Matrix4f camTrans;
+	frustum.buildViewFrustum( camTrans, 45, 16.0f / 9.0f, 0.1f, 1000.0f );
+	
+	srand( 1 );
+	const uint32 counts[3] = { 1000, 10000, 100000 };
+	for( uint32 i = 0; i < 3; ++i )
+	{
+		// Same number of box tests for each size unless given
+		runBenchmark( counts[i], iterations > 0 ? iterations : 10000000 / counts[i], frustum );
+	}
+
+	return 0;
+}
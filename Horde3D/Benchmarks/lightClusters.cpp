@@ -0,0 +1,182 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2016 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+// Measures the CPU binning of lights into the cluster grid used by DoClusteredLightLoop, with the
+// default grid of 16x9 tiles and 24 slices. The binning is compared with testing each light against
+// the bounding box of every cluster. The boxes are larger than the clusters, so this finds more
+// pairs; whether a light is missing from a cluster is checked by sampling points of the light
+// volumes instead. LightClusterBenchScalar is the same program built with H3D_NO_SIMD.
+//
+//   LightClusterBench [iterations]
+
+#include "egLightClusters.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace Horde3D;
+using namespace std;
+
+
+static const uint32 tilesX = 16, tilesY = 9, slices = 24;
+static const float nearPlane = 0.5f, farPlane = 1000.0f;
+static const float frustTop = nearPlane * 0.41421f;  // 45 degrees field of view
+static const float frustRight = frustTop * 16.0f / 9.0f;
+
+
+struct Light
+{
+	Vec3f  viewPos;
+	float  radius;
+};
+
+
+static float randf( float min, float max )
+{
+	return min + (max - min) * (rand() / (float)RAND_MAX);
+}
+
+
+// Sphere test against the view space bounding box of every cluster
+static uint32 binBruteForce( const vector< Light > &lights, vector< vector< uint32 > > &clusters )
+{
+	uint32 numPairs = 0;
+	for( uint32 z = 0; z < slices; ++z )
+	{
+		float d0 = nearPlane * powf( farPlane / nearPlane, (float)z / slices );
+		float d1 = nearPlane * powf( farPlane / nearPlane, (float)(z + 1) / slices );
+
+		for( uint32 y = 0; y < tilesY; ++y )
+		{
+			float y0 = -frustTop + 2 * frustTop * y / tilesY, y1 = -frustTop + 2 * frustTop * (y + 1) / tilesY;
+			float minY = minf( y0 * d0, y0 * d1 ) / nearPlane, maxY = maxf( y1 * d0, y1 * d1 ) / nearPlane;
+
+			for( uint32 x = 0; x < tilesX; ++x )
+			{
+				float x0 = -frustRight + 2 * frustRight * x / tilesX, x1 = -frustRight + 2 * frustRight * (x + 1) / tilesX;
+				float minX = minf( x0 * d0, x0 * d1 ) / nearPlane, maxX = maxf( x1 * d0, x1 * d1 ) / nearPlane;
+				vector< uint32 > &cluster = clusters[(z * tilesY + y) * tilesX + x];
+				cluster.resize( 0 );
+
+				for( uint32 i = 0; i < (uint32)lights.size(); ++i )
+				{
+					const Vec3f &p = lights[i].viewPos;
+					float dx = maxf( maxf( minX - p.x, p.x - maxX ), 0 );
+					float dy = maxf( maxf( minY - p.y, p.y - maxY ), 0 );
+					float dz = maxf( maxf( -d1 - p.z, p.z + d0 ), 0 );
+					if( dx * dx + dy * dy + dz * dz <= lights[i].radius * lights[i].radius )
+						cluster.push_back( i );
+				}
+				numPairs += (uint32)cluster.size();
+			}
+		}
+	}
+
+	return numPairs;
+}
+
+
+// Cluster that contains a view space point, or -1 if it is outside of the frustum
+static int findCluster( const Vec3f &p )
+{
+	float depth = -p.z;
+	if( depth < nearPlane || depth >= farPlane ) return -1;
+
+	float u = (p.x / depth * nearPlane + frustRight) / (2 * frustRight);
+	float v = (p.y / depth * nearPlane + frustTop) / (2 * frustTop);
+	if( u < 0 || u >= 1 || v < 0 || v >= 1 ) return -1;
+
+	uint32 z = min( (uint32)(logf( depth / nearPlane ) / logf( farPlane / nearPlane ) * slices), slices - 1 );
+	return (int)((z * tilesY + (uint32)(v * tilesY)) * tilesX + (uint32)(u * tilesX));
+}
+
+
+int main( int argc, char **argv )
+{
+	int iterations = argc > 1 ? atoi( argv[1] ) : 100;
+	if( iterations < 1 ) iterations = 1;
+
+#if defined( H3D_SIMD_SSE2 )
+	printf( "Cluster tests: SSE2\n" );
+#elif defined( H3D_SIMD_NEON )
+	printf( "Cluster tests: NEON\n" );
+#else
+	printf( "Cluster tests: scalar\n" );
+#endif
+
+	LightClusterGrid grid;
+	vector< vector< uint32 > > clusters( tilesX * tilesY * slices );
+	uint32 lightCounts[] = { 256, 1024, 4096 };
+
+	for( uint32 c = 0; c < sizeof( lightCounts ) / sizeof( lightCounts[0] ); ++c )
+	{
+		// Lights are scattered in front of the camera, partially intersecting the frustum
+		srand( 12345 );
+		vector< Light > lights( lightCounts[c] );
+		for( size_t i = 0; i < lights.size(); ++i )
+		{
+			float depth = randf( 1.0f, 300.0f );
+			lights[i].viewPos = Vec3f( randf( -1.0f, 1.0f ) * depth * frustRight / nearPlane,
+			                           randf( -1.0f, 1.0f ) * depth * frustTop / nearPlane, -depth );
+			lights[i].radius = randf( 2.0f, 20.0f );
+		}
+
+		chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+		for( int it = 0; it < iterations; ++it )
+		{
+			grid.setup( tilesX, tilesY, slices, -frustRight, frustRight, -frustTop, frustTop,
+			            nearPlane, farPlane, false );
+			grid.beginBinning();
+			for( uint32 i = 0; i < (uint32)lights.size(); ++i )
+				grid.addLight( lights[i].viewPos, lights[i].radius, i );
+			grid.finishBinning();
+		}
+		chrono::steady_clock::time_point t1 = chrono::steady_clock::now();
+		uint32 numPairs = 0;
+		int bruteIterations = max( iterations / 20, 1 );
+		for( int it = 0; it < bruteIterations; ++it )
+			numPairs = binBruteForce( lights, clusters );
+		chrono::steady_clock::time_point t2 = chrono::steady_clock::now();
+
+		// The cluster of every point inside a light volume must list the light
+		uint32 missing = 0;
+		const vector< uint32 > &offsets = grid.getOffsets();
+		const vector< uint32 > &indices = grid.getLightIndices();
+		for( uint32 i = 0; i < (uint32)lights.size(); ++i )
+		{
+			for( uint32 j = 0; j < 64; ++j )
+			{
+				Vec3f dir( randf( -1.0f, 1.0f ), randf( -1.0f, 1.0f ), randf( -1.0f, 1.0f ) );
+				if( dir.length() > 1.0f || dir.length() < Math::Epsilon ) continue;
+				int cluster = findCluster( lights[i].viewPos + dir * lights[i].radius );
+				if( cluster < 0 ) continue;
+
+				bool found = false;
+				for( uint32 k = offsets[cluster]; k < offsets[cluster + 1] && !found; ++k )
+					found = indices[k] == i;
+				if( !found ) ++missing;
+			}
+		}
+
+		double binTime = chrono::duration< double, milli >( t1 - t0 ).count() / iterations;
+		double bruteTime = chrono::duration< double, milli >( t2 - t1 ).count() / bruteIterations;
+		printf( "%5u lights: binning %8.3f ms, all clusters %8.3f ms, speedup %6.1fx, "
+		        "light/cluster pairs %u (bounding boxes %u)%s\n",
+		        lightCounts[c], binTime, bruteTime, bruteTime / binTime, (uint32)indices.size(), numPairs,
+		        missing > 0 ? " MISSING" : "" );
+	}
+
+	return 0;
+}
@@ -0,0 +1,108 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2016 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+// Measures software skinning of a crowd of animated characters from the sample content:
+//
+//   SkinningBench <contentDir> [models] [frames] [workers]
+//
+// Each frame advances the animation of all models, either with one h3dUpdateModel call per model
+// or with a single h3dUpdateModels call for the whole crowd. Both are run once without worker
+// threads and once with the given number of workers (default: the engine's default). The engine
+// is initialized with the null render device, so only CPU work is measured.
+
+#include "Horde3D.h"
+#include "Horde3DUtils.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace std;
+
+
+int main( int argc, char **argv )
+{
+	if( argc < 2 )
+	{
+		printf( "Usage: SkinningBench <contentDir> [models] [frames] [workers]\n" );
+		return 1;
+	}
+	const char *contentDir = argv[1];
+	int modelCount = argc > 2 ? atoi( argv[2] ) : 200;
+	int frameCount = argc > 3 ? atoi( argv[3] ) : 100;
+	if( modelCount < 1 ) modelCount = 1;
+	if( frameCount < 1 ) frameCount = 1;
+
+	if( !h3dInit( H3DRenderDevice::Null ) )
+	{
+		h3dutDumpMessages();
+		return 1;
+	}
+	h3dSetOption( H3DOptions::MaxLogLevel, 2 );
+	int workers = argc > 4 ? atoi( argv[4] ) : (int)h3dGetOption( H3DOptions::WorkerThreadCount );
+
+	H3DRes characterRes = h3dAddResource( H3DResTypes::SceneGraph, "models/man/man.scene.xml", 0 );
+	H3DRes walkRes = h3dAddResource( H3DResTypes::Animation, "animations/man.anim", 0 );
+	if( !h3dutLoadResourcesFromDisk( contentDir ) )
+	{
+		printf( "Failed to load the character, see Horde3D_Log.html\n" );
+		h3dutDumpMessages();
+		h3dRelease();
+		return 1;
+	}
+
+	vector< H3DNode > models;
+	for( int i = 0; i < modelCount; ++i )
+	{
+		H3DNode model = h3dAddNodes( H3DRootNode, characterRes );
+		h3dSetNodeParamI( model, H3DModel::SWSkinningI, 1 );
+		h3dSetupModelAnimStage( model, 0, walkRes, 0, "", false );
+		h3dSetNodeTransform( model, sinf( i * 0.1f ) * 10.0f, 0, cosf( i * 0.1f ) * 10.0f, 0, 0, 0, 1, 1, 1 );
+		models.push_back( model );
+	}
+	int vertCount = h3dGetResParamI( h3dGetNodeParamI( models[0], H3DModel::GeoResI ),
+	                                 H3DGeoRes::GeometryElem, 0, H3DGeoRes::GeoVertexCountI );
+
+	printf( "%i models with %i vertices each, %i frames\n", modelCount, vertCount, frameCount );
+
+	const int flags = H3DModelUpdateFlags::Animation | H3DModelUpdateFlags::Geometry;
+	int workerCounts[] = { 0, workers };
+	for( int run = 0; run < (workers > 0 ? 4 : 2); ++run )
+	{
+		bool batched = (run & 1) != 0;
+		h3dSetOption( H3DOptions::WorkerThreadCount, (float)workerCounts[run / 2] );
+		h3dGetStat( H3DStats::GeoUpdateTime, true );
+
+		chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+		for( int frame = 0; frame < frameCount; ++frame )
+		{
+			for( int i = 0; i < modelCount; ++i )
+			{
+				h3dSetModelAnimParams( models[i], 0, (frame + i) * 0.5f, 1.0f );
+				if( !batched ) h3dUpdateModel( models[i], flags );
+			}
+			if( batched ) h3dUpdateModels( &models[0], modelCount, flags );
+		}
+		chrono::steady_clock::time_point t1 = chrono::steady_clock::now();
+
+		double frameTime = chrono::duration< double, milli >( t1 - t0 ).count() / frameCount;
+		double skinTime = h3dGetStat( H3DStats::GeoUpdateTime, true ) / frameCount;
+		printf( "%2i workers, %-16s %7.3f ms per frame, skinning %7.3f ms (%.2f ns per vertex)\n",
+		        workerCounts[run / 2], batched ? "h3dUpdateModels:" : "h3dUpdateModel:", frameTime, skinTime,
+		        skinTime * 1e6 / ((double)modelCount * vertCount) );
+	}
+
+	h3dutDumpMessages();
+	h3dRelease();
+	return 0;
+}
@@ -0,0 +1,92 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2016 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+// Measures how long the textures of the sample content take to load. Run it on the original
+// content and on a copy whose images were replaced by TextureBaker output to compare decoding,
+// mip generation and compression at load time with loading baked DDS files:
+//
+//   TextureLoadBench <contentDir> [iterations] [resourceFlags]
+//
+// The engine is initialized with the null render device, so only CPU work is measured. The first
+// iteration warms up the file cache and is not included in the average.
+
+#include "Horde3D.h"
+#include "Horde3DUtils.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace std;
+
+
+static const char *textureNames[] = {
+	"models/knight/knight.jpg", "models/man/civil01.jpg", "overlays/font.tga", "overlays/logo.tga",
+	"terrains/terrain1/detail.jpg", "textures/common/defnorm.tga", "textures/common/white.tga",
+	"textures/models/layingrock.jpg", "textures/models/layingrockBump.tga",
+	"textures/particles/compParticle.png", "textures/particles/computeParticle.png",
+	"textures/particles/particle1.tga"
+};
+static const int textureCount = sizeof( textureNames ) / sizeof( textureNames[0] );
+
+
+int main( int argc, char **argv )
+{
+	if( argc < 2 )
+	{
+		printf( "Usage: TextureLoadBench <contentDir> [iterations] [resourceFlags]\n" );
+		return 1;
+	}
+	const char *contentDir = argv[1];
+	int iterations = argc > 2 ? atoi( argv[2] ) : 10;
+	int flags = argc > 3 ? atoi( argv[3] ) : 0;
+	if( iterations < 1 ) iterations = 1;
+
+	double totalTime = 0;
+	for( int it = 0; it <= iterations; ++it )
+	{
+		if( !h3dInit( H3DRenderDevice::Null ) )
+		{
+			h3dutDumpMessages();
+			return 1;
+		}
+		h3dSetOption( H3DOptions::MaxLogLevel, 2 );
+
+		vector< H3DRes > textures;
+		for( int i = 0; i < textureCount; ++i )
+			textures.push_back( h3dAddResource( H3DResTypes::Texture, textureNames[i], flags ) );
+
+		chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+		bool loaded = h3dutLoadResourcesFromDisk( contentDir );
+		chrono::steady_clock::time_point t1 = chrono::steady_clock::now();
+		if( it > 0 ) totalTime += chrono::duration< double, milli >( t1 - t0 ).count();
+
+		if( it == 0 )
+		{
+			for( int i = 0; i < textureCount; ++i )
+			{
+				printf( "%-40s %4i x %-4i format %i\n", textureNames[i],
+				        h3dGetResParamI( textures[i], H3DTexRes::ImageElem, 0, H3DTexRes::ImgWidthI ),
+				        h3dGetResParamI( textures[i], H3DTexRes::ImageElem, 0, H3DTexRes::ImgHeightI ),
+				        h3dGetResParamI( textures[i], H3DTexRes::TextureElem, 0, H3DTexRes::TexFormatI ) );
+			}
+			if( !loaded ) printf( "Some textures failed to load, see Horde3D_Log.html\n" );
+		}
+
+		h3dutDumpMessages();
+		h3dRelease();
+	}
+
+	printf( "Average load time of %i textures: %.2f ms (%i iterations)\n", textureCount,
+	        totalTime / iterations, iterations );
+	return 0;
+}
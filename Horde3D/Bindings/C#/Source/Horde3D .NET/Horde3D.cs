@@ -33,11 +33,15 @@ public static int H3DRootNode
         /// The available engine Renderer backends.
         /// OpenGL2	- use OpenGL 2 as renderer backend (can be used to force OpenGL 2 when higher version is undesirable)
         /// OpenGL4	- use OpenGL 4 as renderer backend (falls back to OpenGL 2 in case of error)
+        /// Null	- headless backend that does not require a GPU or an OpenGL context; resources are
+        ///		  only allocated in memory and all state changes and draw calls are recorded in a
+        ///		  command log (useful for automated CPU performance tests)
         /// </summary>
         public enum H3DRenderDevice
         {
             OpenGL2 = 2,
-            OpenGL4 = 4
+            OpenGL4 = 4,
+            Null = 16
         };
 
         /// <summary>
@@ -63,6 +67,24 @@ public enum H3DRenderDevice
         ///   DumpFailedShaders   - Enables or disables storing of shader code that failed to compile in a text file; this can be
         ///                         useful in combination with the line numbers given back by the shader compiler. (Values: 0, 1; Default: 0)
         ///   GatherTimeStats     - Enables or disables gathering of time stats that are useful for profiling (Values: 0, 1; Default: 1)
+        ///   WorkerThreadCount   - Number of worker threads used for parallel CPU work like software skinning; the calling
+        ///                         thread always takes part in the work, so 0 disables threading (Values: 0..64;
+        ///                         Default: number of CPU cores minus one)
+        ///   ShadowMapCacheSize  - Maximum number of lights whose shadow maps are kept between frames; a kept shadow map is
+        ///                         reused as long as the camera, the light and its shadow casters do not change, which saves
+        ///                         rendering shadow maps while the view is static. Each kept shadow map needs as much memory as
+        ///                         the shadow map buffer; 0 disables reusing shadow maps (Values: 0..64; Default: 8)
+        ///   EnableProfiler      - Enables or disables recording of CPU and GPU scopes for getProfilerTrace; the recording
+        ///                         has a small overhead and uses GPU timer queries (Values: 0, 1; Default: 0)
+        ///   TextureStreamingBudget - Video memory in Mb for streamed textures; large 2D DDS textures with mipmaps that are
+        ///                         loaded while the budget is set get only their small mips uploaded and the larger mips are
+        ///                         streamed in when meshes using them get big enough on screen. Least recently used textures
+        ///                         lose their large mips when the budget is exceeded. The mips are kept in main memory;
+        ///                         0 disables streaming and uploads all mips of streamed textures (Default: 0)
+        ///   AsyncShaderCompilation - Enables or disables compiling missing shader combinations in the background; when
+        ///                         enabled, objects whose shader combination is not compiled yet are not drawn until the
+        ///                         combination is available a few frames later, instead of stalling the frame. See also
+        ///                         warmUpShaders (Values: 0, 1; Default: 0)
         /// </summary>
         public enum H3DOptions
         {
@@ -79,7 +101,12 @@ public enum H3DOptions
             WireframeMode,
             DebugViewMode,
             DumpFailedShaders,
-            GatherTimeStats
+            GatherTimeStats,
+            WorkerThreadCount,
+            ShadowMapCacheSize,
+            EnableProfiler,
+            TextureStreamingBudget,
+            AsyncShaderCompilation
         }
 
        /// <summary>
@@ -100,6 +127,24 @@ public enum H3DOptions
        ///    TextureVMem       - Estimated amount of video memory used by textures (in Mb)
        ///    GeometryVMem      - Estimated amount of video memory used by geometry (in Mb)
        ///    ComputeGPUTime    - GPU time in ms spent for processing compute shaders
+       ///    CullingNodeTests  - Average number of spatial graph nodes tested per culling query
+       ///    AnimationMem      - Memory used by animation resources (in Mb)
+       ///    InstancedBatchCount - Number of instanced draw calls issued for meshes
+       ///    DrawCallsSaved    - Number of mesh draw calls saved by hardware instancing
+       ///    ParticleUploadSize - Particle data uploaded to instance buffers (in Kb)
+       ///    ParticleDrawCalls - Number of draw calls issued for particles
+       ///    ShaderBindCount   - Number of shader program changes
+       ///    GeometryBindCount - Number of geometry changes
+       ///    ShadowMapsRendered - Number of shadow maps that were rendered
+       ///    ShadowMapsSkipped - Number of shadow maps that were reused because nothing changed (see H3DOptions.ShadowMapCacheSize)
+       ///    LightClusterTime  - CPU time in ms spent for binning lights into clusters
+       ///    StreamedTextureMem - Video memory used by the resident mips of streamed textures (in Mb)
+       ///    StreamedTextureUploadSize - Texture data uploaded by mip streaming (in Kb)
+       ///    ShaderHitchesAvoided - Number of shader combinations that were compiled in the background instead of
+       ///                      stalling the frame (see H3DOptions.AsyncShaderCompilation)
+       ///    PendingShaderCombinations - Number of shader combinations that are waiting to be compiled
+       ///    ShaderCacheHits   - Number of shaders that were created from a program binary of the shader cache
+       ///    ShaderCacheMisses - Number of shaders that were not found in the shader cache and had to be compiled
        /// </summary>
         public enum H3DStats
         {
@@ -116,7 +161,24 @@ public enum H3DStats
             ParticleGPUTime,
             TextureVMem,
             GeometryVMem,
-            ComputeGPUTime
+            ComputeGPUTime,
+            CullingNodeTests,
+            AnimationMem,
+            InstancedBatchCount,
+            DrawCallsSaved,
+            ParticleUploadSize,
+            ParticleDrawCalls,
+            ShaderBindCount,
+            GeometryBindCount,
+            ShadowMapsRendered,
+            ShadowMapsSkipped,
+            LightClusterTime,
+            StreamedTextureMem,
+            StreamedTextureUploadSize,
+            ShaderHitchesAvoided,
+            PendingShaderCombinations,
+            ShaderCacheHits,
+            ShaderCacheMisses
         }
 
         /// <summary>
@@ -177,6 +239,12 @@ public enum H3DResTypes
         /// TexRenderable     - Makes Texture resource usable as render target.
         /// TexSRGB           - Indicates that Texture resource is in sRGB color space and should be converted
         ///                    to linear space when being sampled.
+        /// AnimCompression   - Stores Animation resource with quantized and key-reduced tracks that are decoded
+        ///                    on the fly; the achieved compression ratio and maximum error are written to the log.
+        /// GeoNoCPUCopy      - Keeps only the vertex positions of Geometry resource in main memory after uploading
+        ///                    the data to the GPU, unless it is skinned or has morph targets; such geometry cannot be
+        ///                    cloned, its other streams cannot be mapped and it is ignored by ray casts.
+        /// TexNoStreaming    - Uploads all mips of Texture resource when loading it, even if texture streaming is enabled.
         /// </summary>
         public enum H3DResFlags
         {
@@ -186,7 +254,10 @@ public enum H3DResFlags
             TexCubemap = 8,
             TexDynamic = 16,
             TexRenderable = 32,
-            TexSRGB = 64
+            TexSRGB = 64,
+            AnimCompression = 128,
+            GeoNoCPUCopy = 256,
+            TexNoStreaming = 512
         }
 
         /// <summary>
@@ -200,6 +271,9 @@ public enum H3DResFlags
         /// TEX_DXT5     - DXT5 compressed texture
         /// TEX_RGBA16F  - Half float RGBA texture
         /// TEX_RGBA32F  - Float RGBA texture
+        /// TEX_BC4      - BC4 compressed single channel texture
+        /// TEX_BC5      - BC5 compressed two channel texture
+        /// TEX_BC7      - BC7 compressed texture
         /// </summary>
         public enum H3DFormats
         {
@@ -209,7 +283,10 @@ public enum H3DFormats
             TEX_DXT3,
             TEX_DXT5,
             TEX_RGBA16F,
-            TEX_RGBA32F
+            TEX_RGBA32F,
+            TEX_BC4,
+            TEX_BC5,
+            TEX_BC7
         }
 
         /// <summary>
@@ -819,6 +896,18 @@ public static float getStat(H3DStats param, bool reset)
             return NativeMethodsEngine.h3dGetStat((int)param, reset);
         }
 
+        /// <summary>
+        /// Gets the scopes recorded for the last profiled frame.
+        /// </summary>
+        /// This function returns the CPU and GPU scopes of the most recent frame for which all GPU timings are
+        /// available, as JSON in the Chrome trace event format. Profiling has to be enabled with the
+        /// EnableProfiler option and a frame ends when finalizeFrame is called.
+        /// <returns>trace of the last complete profiled frame</returns>
+        public static string getProfilerTrace()
+        {
+            return Marshal.PtrToStringAnsi(NativeMethodsEngine.h3dGetProfilerTrace());
+        }
+
         /// <summary>
         /// Checks whether GPU supports a certain feature.
         /// </summary>
@@ -1219,6 +1308,18 @@ public static int queryUnloadedResource(int index)
             return NativeMethodsEngine.h3dQueryUnloadedResource(index);            
         }
 
+        /// <summary>
+        /// Returns the next unloaded resource after a given handle.
+        /// </summary>
+        /// This function searches the next resource that is not yet loaded, beginning after the specified start handle.
+        /// All unloaded resources can be enumerated in a single pass by using as start the return value of the previous call.
+        /// <param name="start">resource handle after which the search begins (can be 0 for beginning of resource list)</param>
+        /// <returns>handle to the next unloaded resource or 0</returns>
+        public static int queryNextUnloadedResource(int start)
+        {
+            return NativeMethodsEngine.h3dQueryNextUnloadedResource(start);
+        }
+
         /// <summary>
         /// This function releases resources that are no longer used. 
         /// Unused resources were either told to be released by the user calling removeResource() or are no more referenced by any other engine objects.
@@ -1228,6 +1329,29 @@ public static void releaseUnusedResources()
             NativeMethodsEngine.h3dReleaseUnusedResources();
         }
 
+        /// <summary>
+        /// This function queues all shader combinations that are used by the loaded materials and are not compiled yet.
+        /// The queued combinations are compiled during the following finalizeFrame calls unless wait is set.
+        /// </summary>
+        /// <param name="wait">true to compile all queued combinations before the function returns</param>
+        /// <returns>number of shader combinations that were not compiled yet</returns>
+        public static int warmUpShaders(bool wait)
+        {
+            return NativeMethodsEngine.h3dWarmUpShaders(wait);
+        }
+
+        /// <summary>
+        /// This function enables a persistent cache of shader program binaries in an existing directory, so that shaders
+        /// do not need to be compiled again on the next start. Outdated, corrupt and rejected entries are compiled again.
+        /// </summary>
+        /// <param name="path">existing directory for the cache files; null or an empty string disables the cache</param>
+        /// <param name="maxSize">maximum size of all cache files in Mb</param>
+        /// <returns>true in case of success, otherwise false</returns>
+        public static bool setShaderCache(string path, int maxSize)
+        {
+            return NativeMethodsEngine.h3dSetShaderCache(path, maxSize);
+        }
+
         /// <summary>
         /// Adds a Texture2D resource.
         /// </summary>
@@ -1849,6 +1973,21 @@ public static void updateModel(int modelNode, int flags)
             NativeMethodsEngine.h3dUpdateModel(modelNode, flags);
         }
 
+        /// <summary>
+        /// Applies animation and/or geometry updates to several models.
+        /// <remarks>
+        /// This function has the same effect as calling updateModel for each of the specified models but distributes
+        /// the animation sampling, the update of the model transformations and software skinning across the engine's
+        /// worker threads. The results do not depend on the number of threads.
+        /// </remarks>
+        /// <param name="modelNodes">array of handles to the Model nodes to be updated</param>
+        /// <param name="count">number of handles in the array</param>
+        /// <param name="flags">combination of H3DModelUpdateFlags flags</param>
+        public static void updateModels(int[] modelNodes, int count, int flags)
+        {
+            NativeMethodsEngine.h3dUpdateModels(modelNodes, count, flags);
+        }
+
 
 
         // Mesh specific
@@ -1988,6 +2127,20 @@ public static void updateEmitter(int node, float timeDelta)
             NativeMethodsEngine.h3dUpdateEmitter(node, timeDelta);
         }
 
+        /// <summary>
+        /// Advances the time of several emitters and performs their particle simulation.
+        /// <remarks>
+        /// This function has the same effect as calling updateEmitter for each of the specified emitters but
+        /// simulates the emitters in parallel on the engine's worker threads.
+        /// </remarks>
+        /// <param name="emitterNodes">array of handles to the Emitter nodes to be updated</param>
+        /// <param name="count">number of handles in the array</param>
+        /// <param name="timeDelta">time delta in seconds</param>
+        public static void advanceEmitterTimes(int[] emitterNodes, int count, float timeDelta)
+        {
+            NativeMethodsEngine.h3dAdvanceEmitterTimes(emitterNodes, count, timeDelta);
+        }
+
         /// <summary>
         /// Checks if an Emitter node is still alive.
         /// </summary>
@@ -41,6 +41,16 @@ public static bool dumpMessages()
             return NativeMethodsUtils.h3dutDumpMessages();
         }
 
+        /// <summary>
+        /// This utility function writes the trace of the last profiled frame to a file that can be opened with chrome://tracing.
+        /// </summary>
+        /// <param name="filename">name of the file to be written</param>
+        /// <returns>true in case of success, otherwise false</returns>
+        public static bool dumpProfilerTrace(string filename)
+        {
+            return NativeMethodsUtils.h3dutDumpProfilerTrace(filename);
+        }
+
         /// <summary>
         /// This function returns the search path of a specified resource type.
         /// </summary>
@@ -78,6 +88,42 @@ public static bool loadResourcesFromDisk(string contenDir)
             return NativeMethodsUtils.h3dutLoadResourcesFromDisk(contenDir);
         }
 
+        /// <summary>
+        /// This utility function starts loading all unloaded resources from the specified directories in the background.
+        /// Worker threads read and decode the files; updateLoadResourcesAsync has to be called regularly to pass the data to the engine.
+        /// </summary>
+        /// <param name="contentDir">directories where data is located on the drive</param>
+        /// <param name="numThreads">number of worker threads; 0 uses one thread per hardware thread</param>
+        /// <returns>false if an asynchronous load is already active, otherwise true</returns>
+        public static bool beginLoadResourcesAsync(string contentDir, int numThreads)
+        {
+            if (contentDir == null) throw new ArgumentNullException("contentDir", Resources.StringNullExceptionString);
+
+            return NativeMethodsUtils.h3dutBeginLoadResourcesAsync(contentDir, numThreads);
+        }
+
+        /// <summary>
+        /// This utility function loads resources whose files are ready into the engine until the specified time has elapsed.
+        /// </summary>
+        /// <param name="maxTime">time in milliseconds after which the function returns</param>
+        /// <returns>true if all resources are loaded and the asynchronous load has finished, otherwise false</returns>
+        public static bool updateLoadResourcesAsync(float maxTime)
+        {
+            return NativeMethodsUtils.h3dutUpdateLoadResourcesAsync(maxTime);
+        }
+
+        /// <summary>
+        /// This utility function returns how many of the resources of the current or last asynchronous load are loaded.
+        /// </summary>
+        /// <param name="numLoaded">number of loaded resources</param>
+        /// <param name="numTotal">total number of resources; grows when loaded resources reference further resources</param>
+        /// <param name="numFailed">number of resources that could not be loaded</param>
+        /// <returns>fraction of loaded resources between 0 and 1</returns>
+        public static float getLoadResourcesAsyncProgress(out int numLoaded, out int numTotal, out int numFailed)
+        {
+            return NativeMethodsUtils.h3dutGetLoadResourcesAsyncProgress(out numLoaded, out numTotal, out numFailed);
+        }
+
         /// <summary>
         /// Creates a Geometry resource from specified vertex data.
         /// </summary>
@@ -227,6 +273,59 @@ public static int pickNode( int node, float nwx, float nwy)
             NativeMethodsUtils.h3dutShowText(text, x, y, size, colR, colG, colB, fontMatRes );
         }
 
+        /// <summary>
+        /// This utility function creates a text object which keeps the glyph geometry of a text string, so that static text is not rebuilt every frame.
+        /// </summary>
+        /// <param name="fontMatRes">font material resource used for rendering</param>
+        /// <returns>handle to the created text object</returns>
+        public static int createText(int fontMatRes)
+        {
+            if (fontMatRes < 0) throw new ArgumentOutOfRangeException("fontMatRes", Resources.UIntOutOfRangeExceptionString);
+
+            return NativeMethodsUtils.h3dutCreateText(fontMatRes);
+        }
+
+        /// <summary>
+        /// This utility function destroys a text object that was created with createText.
+        /// </summary>
+        /// <param name="textObj">handle to the text object</param>
+        public static void destroyText(int textObj)
+        {
+            NativeMethodsUtils.h3dutDestroyText(textObj);
+        }
+
+        /// <summary>
+        /// This utility function sets the parameters of a text object.
+        /// </summary>
+        /// <remarks>
+        /// The glyph geometry is only rebuilt if the text, position or size differ from the previous call.
+        /// </remarks>
+        /// <param name="textObj">handle to the text object</param>
+        /// <param name="text">text string to be displayed</param>
+        /// <param name="x">x position of the lower left corner of the first character; for more details on coordinate system see overlay documentation</param>
+        /// <param name="y">y position of the lower left corner of the first character; for more details on coordinate system see overlay documentation</param>
+        /// <param name="size">size factor of the font</param>
+        /// <param name="colR">red part of font color</param>
+        /// <param name="colG">green part of font color</param>
+        /// <param name="colB">blue part of font color</param>
+        /// <returns>true in case of success, otherwise false</returns>
+        public static bool setText(int textObj, string text, float x, float y, float size,
+                                   float colR, float colG, float colB)
+        {
+            if (text == null) throw new ArgumentNullException("text", Resources.StringNullExceptionString);
+
+            return NativeMethodsUtils.h3dutSetText(textObj, text, x, y, size, colR, colG, colB);
+        }
+
+        /// <summary>
+        /// This utility function shows the text of a text object for the current frame.
+        /// </summary>
+        /// <param name="textObj">handle to the text object</param>
+        public static void showTextObject(int textObj)
+        {
+            NativeMethodsUtils.h3dutShowTextObject(textObj);
+        }
+
         /// <summary>
         /// This utility function displays an info box with customizable text for the current frame on the screen.
         /// </summary>
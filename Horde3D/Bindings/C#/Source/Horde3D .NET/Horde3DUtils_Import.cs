@@ -31,6 +31,10 @@ internal static class NativeMethodsUtils
         [return: MarshalAs(UnmanagedType.U1)]   // represents C++ bool type 
         internal static extern bool h3dutDumpMessages();
 
+        [DllImport(UTILS_DLL, CharSet = CharSet.Ansi, CallingConvention = CallingConvention.Cdecl), SuppressUnmanagedCodeSecurity]
+        [return: MarshalAs(UnmanagedType.U1)]   // represents C++ bool type 
+        internal static extern bool h3dutDumpProfilerTrace(string filename);
+
         // Utilities
         [DllImport(UTILS_DLL, CharSet = CharSet.Ansi, CallingConvention = CallingConvention.Cdecl), SuppressUnmanagedCodeSecurity]
         internal static extern IntPtr h3dutGetResourcePath(h3d.H3DResTypes type);
@@ -43,6 +47,17 @@ internal static class NativeMethodsUtils
         [return: MarshalAs(UnmanagedType.U1)]   // represents C++ bool type 
         internal static extern bool h3dutLoadResourcesFromDisk(string contentDir);
 
+        [DllImport(UTILS_DLL, CharSet = CharSet.Ansi, CallingConvention = CallingConvention.Cdecl), SuppressUnmanagedCodeSecurity]
+        [return: MarshalAs(UnmanagedType.U1)]   // represents C++ bool type 
+        internal static extern bool h3dutBeginLoadResourcesAsync(string contentDir, int numThreads);
+
+        [DllImport(UTILS_DLL, CharSet = CharSet.Ansi, CallingConvention = CallingConvention.Cdecl), SuppressUnmanagedCodeSecurity]
+        [return: MarshalAs(UnmanagedType.U1)]   // represents C++ bool type 
+        internal static extern bool h3dutUpdateLoadResourcesAsync(float maxTime);
+
+        [DllImport(UTILS_DLL, CharSet = CharSet.Ansi, CallingConvention = CallingConvention.Cdecl), SuppressUnmanagedCodeSecurity]
+        internal static extern float h3dutGetLoadResourcesAsyncProgress(out int numLoaded, out int numTotal, out int numFailed);
+
         [DllImport(UTILS_DLL, CharSet = CharSet.Ansi, CallingConvention = CallingConvention.Cdecl), SuppressUnmanagedCodeSecurity]        
         internal static extern int h3dutCreateGeometryRes(string name, int numVertices, int numTriangleIndices,
                                            float[] posData, int[] indexData, short[] normalData,
@@ -66,6 +81,20 @@ internal static class NativeMethodsUtils
                                              float colR, float colG, float colB,
                                              int fontMatRes);
 
+        [DllImport(UTILS_DLL, CharSet = CharSet.Ansi, CallingConvention = CallingConvention.Cdecl), SuppressUnmanagedCodeSecurity]
+        internal static extern int h3dutCreateText(int fontMatRes);
+
+        [DllImport(UTILS_DLL, CharSet = CharSet.Ansi, CallingConvention = CallingConvention.Cdecl), SuppressUnmanagedCodeSecurity]
+        internal static extern void h3dutDestroyText(int textObj);
+
+        [DllImport(UTILS_DLL, CharSet = CharSet.Ansi, CallingConvention = CallingConvention.Cdecl), SuppressUnmanagedCodeSecurity]
+        [return: MarshalAs(UnmanagedType.U1)]   // represents C++ bool type 
+        internal static extern bool h3dutSetText(int textObj, string text, float x, float y, float size,
+                                             float colR, float colG, float colB);
+
+        [DllImport(UTILS_DLL, CharSet = CharSet.Ansi, CallingConvention = CallingConvention.Cdecl), SuppressUnmanagedCodeSecurity]
+        internal static extern void h3dutShowTextObject(int textObj);
+
         [DllImport(UTILS_DLL, CharSet = CharSet.Ansi, CallingConvention = CallingConvention.Cdecl), SuppressUnmanagedCodeSecurity]
         internal static extern void h3dutShowInfoBox(float x, float y, float width, string title,
                                              int numRows, string[] column1, string[] column2,
@@ -78,6 +78,9 @@ internal static class NativeMethodsEngine
         [DllImport(ENGINE_DLL, CharSet = CharSet.Ansi, CallingConvention = CallingConvention.Cdecl), SuppressUnmanagedCodeSecurity]
         internal static extern float h3dGetStat(int param, [MarshalAs(UnmanagedType.U1)]bool reset);
 
+        [DllImport(ENGINE_DLL, CharSet = CharSet.Ansi, CallingConvention = CallingConvention.Cdecl), SuppressUnmanagedCodeSecurity]
+        internal static extern IntPtr h3dGetProfilerTrace();
+
         [DllImport(ENGINE_DLL, CharSet = CharSet.Ansi, CallingConvention = CallingConvention.Cdecl), SuppressUnmanagedCodeSecurity]
         internal static extern float h3dGetDeviceCapabilities(int param);
 
@@ -153,9 +156,19 @@ internal static class NativeMethodsEngine
         [DllImport(ENGINE_DLL, CharSet = CharSet.Ansi, CallingConvention = CallingConvention.Cdecl), SuppressUnmanagedCodeSecurity]
         internal static extern int h3dQueryUnloadedResource(int index);
 
+        [DllImport(ENGINE_DLL, CharSet = CharSet.Ansi, CallingConvention = CallingConvention.Cdecl), SuppressUnmanagedCodeSecurity]
+        internal static extern int h3dQueryNextUnloadedResource(int start);
+
         [DllImport(ENGINE_DLL, CharSet = CharSet.Ansi, CallingConvention = CallingConvention.Cdecl), SuppressUnmanagedCodeSecurity]
         internal static extern void h3dReleaseUnusedResources();
 
+        [DllImport(ENGINE_DLL, CharSet = CharSet.Ansi, CallingConvention = CallingConvention.Cdecl), SuppressUnmanagedCodeSecurity]
+        internal static extern int h3dWarmUpShaders([MarshalAs(UnmanagedType.U1)]bool wait);
+
+        [DllImport(ENGINE_DLL, CharSet = CharSet.Ansi, CallingConvention = CallingConvention.Cdecl), SuppressUnmanagedCodeSecurity]
+        [return: MarshalAs(UnmanagedType.U1)]   // represents C++ bool type 
+        internal static extern bool h3dSetShaderCache(string path, int maxSize);
+
         [DllImport(ENGINE_DLL, CharSet = CharSet.Ansi, CallingConvention = CallingConvention.Cdecl), SuppressUnmanagedCodeSecurity]
         internal static extern int h3dCreateTexture(string name, int width, int height, int fmt, int flags);
 
@@ -286,6 +299,9 @@ internal static class NativeMethodsEngine
         [DllImport(ENGINE_DLL, CharSet = CharSet.Ansi, CallingConvention = CallingConvention.Cdecl), SuppressUnmanagedCodeSecurity]
         internal static extern void h3dUpdateModel(int modelNode, int flags);
 
+        [DllImport(ENGINE_DLL, CharSet = CharSet.Ansi, CallingConvention = CallingConvention.Cdecl), SuppressUnmanagedCodeSecurity]
+        internal static extern void h3dUpdateModels(int[] modelNodes, int count, int flags);
+
         // Mesh specific
         [DllImport(ENGINE_DLL, CharSet = CharSet.Ansi, CallingConvention = CallingConvention.Cdecl), SuppressUnmanagedCodeSecurity]
         internal static extern int h3dAddMeshNode(int parent, string name, int matRes, 
@@ -325,6 +341,9 @@ internal static class NativeMethodsEngine
         [DllImport(ENGINE_DLL, CharSet = CharSet.Ansi, CallingConvention = CallingConvention.Cdecl), SuppressUnmanagedCodeSecurity]
         internal static extern void h3dUpdateEmitter(int node, float timeDelta);
 
+        [DllImport(ENGINE_DLL, CharSet = CharSet.Ansi, CallingConvention = CallingConvention.Cdecl), SuppressUnmanagedCodeSecurity]
+        internal static extern void h3dAdvanceEmitterTimes(int[] emitterNodes, int count, float timeDelta);
+
         [DllImport(ENGINE_DLL, CharSet = CharSet.Ansi, CallingConvention = CallingConvention.Cdecl), SuppressUnmanagedCodeSecurity]
         [return: MarshalAs(UnmanagedType.U1)]   // represents C++ bool type 
         internal static extern bool h3dHasEmitterFinished(int emitterNode);
@@ -66,11 +66,15 @@ struct H3DRenderDevice
 
 	OpenGL2				- use OpenGL 2 as renderer backend (can be used to force OpenGL 2 when higher version is undesirable)
 	OpenGL4				- use OpenGL 4 as renderer backend (falls back to OpenGL 2 in case of error)
+	Null				- headless backend that does not require a GPU or an OpenGL context; resources are
+						  only allocated in memory and all state changes and draw calls are recorded in a
+						  command log (useful for automated CPU performance tests)
 	*/
 	enum List
 	{
 		OpenGL2 = 2,
-		OpenGL4 = 4
+		OpenGL4 = 4,
+		Null = 16
 	};
 };
 
@@ -100,6 +104,24 @@ struct H3DOptions
 		DumpFailedShaders   - Enables or disables storing of shader code that failed to compile in a text file; this can be
 		                      useful in combination with the line numbers given back by the shader compiler. (Values: 0, 1; Default: 0)
 		GatherTimeStats     - Enables or disables gathering of time stats that are useful for profiling (Values: 0, 1; Default: 1)
+		WorkerThreadCount   - Number of worker threads used for parallel CPU work like software skinning; the calling
+		                      thread always takes part in the work, so 0 disables threading (Values: 0..64;
+		                      Default: number of CPU cores minus one)
+		ShadowMapCacheSize  - Maximum number of lights whose shadow maps are kept between frames; a kept shadow map is
+		                      reused as long as the camera, the light and its shadow casters do not change, which saves
+		                      rendering shadow maps while the view is static. Each kept shadow map needs as much memory as
+		                      the shadow map buffer; 0 disables reusing shadow maps (Values: 0..64; Default: 8)
+		EnableProfiler      - Enables or disables recording of CPU and GPU scopes for h3dGetProfilerTrace; the recording
+		                      has a small overhead and uses GPU timer queries (Values: 0, 1; Default: 0)
+		TextureStreamingBudget - Video memory in Mb for streamed textures; large 2D DDS textures with mipmaps that are
+		                      loaded while the budget is set get only their small mips uploaded and the larger mips are
+		                      streamed in when meshes using them get big enough on screen. Least recently used textures
+		                      lose their large mips when the budget is exceeded. The mips are kept in main memory;
+		                      0 disables streaming and uploads all mips of streamed textures (Default: 0)
+		AsyncShaderCompilation - Enables or disables compiling missing shader combinations in the background; when
+		                      enabled, objects whose shader combination is not compiled yet are not drawn until the
+		                      combination is available a few frames later, instead of stalling the frame. See also
+		                      h3dWarmUpShaders (Values: 0, 1; Default: 0)
 	*/
 	enum List
 	{
@@ -116,7 +138,12 @@ struct H3DOptions
 		WireframeMode,
 		DebugViewMode,
 		DumpFailedShaders,
-		GatherTimeStats
+		GatherTimeStats,
+		WorkerThreadCount,
+		ShadowMapCacheSize,
+		EnableProfiler,
+		TextureStreamingBudget,
+		AsyncShaderCompilation
 	};
 };
 
@@ -139,6 +166,24 @@ struct H3DStats
 		TextureVMem       - Estimated amount of video memory used by textures (in Mb)
 		GeometryVMem      - Estimated amount of video memory used by geometry (in Mb),
 		ComputeGPUTime	  - GPU time in ms spent for processing compute shaders
+		CullingNodeTests  - Average number of spatial graph nodes tested per culling query
+		AnimationMem      - Memory used by animation resources (in Mb)
+		InstancedBatchCount - Number of instanced draw calls issued for meshes
+		DrawCallsSaved    - Number of mesh draw calls saved by hardware instancing
+		ParticleUploadSize - Particle data uploaded to instance buffers (in Kb)
+		ParticleDrawCalls - Number of draw calls issued for particles
+		ShaderBindCount   - Number of shader program changes
+		GeometryBindCount - Number of geometry changes
+		ShadowMapsRendered - Number of shadow maps that were rendered
+		ShadowMapsSkipped - Number of shadow maps that were reused because nothing changed (see H3DOptions::ShadowMapCacheSize)
+		LightClusterTime  - CPU time in ms spent for binning lights into clusters
+		StreamedTextureMem - Video memory used by the resident mips of streamed textures (in Mb)
+		StreamedTextureUploadSize - Texture data uploaded by mip streaming (in Kb)
+		ShaderHitchesAvoided - Number of shader combinations that were compiled in the background instead of
+		                      stalling the frame (see H3DOptions::AsyncShaderCompilation)
+		PendingShaderCombinations - Number of shader combinations that are waiting to be compiled
+		ShaderCacheHits   - Number of shaders that were created from a program binary of the shader cache
+		ShaderCacheMisses - Number of shaders that were not found in the shader cache and had to be compiled
 	*/
 	enum List
 	{
@@ -155,7 +200,24 @@ struct H3DStats
 		ParticleGPUTime,
 		TextureVMem,
 		GeometryVMem,
-		ComputeGPUTime
+		ComputeGPUTime,
+		CullingNodeTests,
+		AnimationMem,
+		InstancedBatchCount,
+		DrawCallsSaved,
+		ParticleUploadSize,
+		ParticleDrawCalls,
+		ShaderBindCount,
+		GeometryBindCount,
+		ShadowMapsRendered,
+		ShadowMapsSkipped,
+		LightClusterTime,
+		StreamedTextureMem,
+		StreamedTextureUploadSize,
+		ShaderHitchesAvoided,
+		PendingShaderCombinations,
+		ShaderCacheHits,
+		ShaderCacheMisses
 	};
 };
 
@@ -222,6 +284,12 @@ struct H3DResFlags
 		TexRenderable     - Makes Texture resource usable as render target.
 		TexSRGB           - Indicates that Texture resource is in sRGB color space and should be converted
 		                    to linear space when being sampled.
+		AnimCompression   - Stores Animation resource with quantized and key-reduced tracks that are decoded
+		                    on the fly; the achieved compression ratio and maximum error are written to the log.
+		GeoNoCPUCopy      - Keeps only the vertex positions of Geometry resource in main memory after uploading
+		                    the data to the GPU, unless it is skinned or has morph targets; such geometry cannot be
+		                    cloned, its other streams cannot be mapped and it is ignored by ray casts.
+		TexNoStreaming    - Uploads all mips of Texture resource when loading it, even if texture streaming is enabled.
 	*/
 	enum Flags
 	{
@@ -231,7 +299,10 @@ struct H3DResFlags
 		TexCubemap = 8,
 		TexDynamic = 16,
 		TexRenderable = 32,
-		TexSRGB = 64
+		TexSRGB = 64,
+		AnimCompression = 128,
+		GeoNoCPUCopy = 256,
+		TexNoStreaming = 512
 	};
 };
 
@@ -248,6 +319,9 @@ struct H3DFormats
 		TEX_DXT5     - DXT5 compressed texture
 		TEX_RGBA16F  - Half float RGBA texture
 		TEX_RGBA32F  - Float RGBA texture
+		TEX_BC4      - BC4 compressed single channel texture
+		TEX_BC5      - BC5 compressed two channel texture
+		TEX_BC7      - BC7 compressed texture
 	*/
 	enum List
 	{
@@ -257,7 +331,10 @@ struct H3DFormats
 		TEX_DXT3,
 		TEX_DXT5,
 		TEX_RGBA16F,
-		TEX_RGBA32F
+		TEX_RGBA32F,
+		TEX_BC4,
+		TEX_BC5,
+		TEX_BC7
 	};
 };
 
@@ -966,6 +1043,27 @@ DLL bool h3dSetOption( H3DOptions::List param, float value );
 */
 DLL float h3dGetStat( H3DStats::List param, bool reset );
 
+/* Function: h3dGetProfilerTrace
+		Gets the scopes recorded for the last profiled frame.
+	
+	Details:
+		This function returns the CPU and GPU scopes of the most recent frame for which all GPU timings are
+		available, as JSON in the Chrome trace event format, which can be viewed with chrome://tracing or
+		similar tools. Profiling has to be enabled with the EnableProfiler option and a frame ends when
+		h3dFinalizeFrame is called. CPU scopes are shown on one track per thread and cover pipeline stages and
+		commands, lights, shadow map updates, culling, animation, skinning, particle simulation and resource
+		loading. GPU scopes are shown on a separate track; since GPU and CPU clocks are not synchronized, a
+		GPU scope starts at the time its commands were submitted and has the duration measured on the GPU.
+		If no frame is complete yet, the trace contains no scopes. The string stays valid until the next call.
+	
+	Parameters:
+		none
+		
+	Returns:
+		trace of the last complete profiled frame
+*/
+DLL const char *h3dGetProfilerTrace();
+
 /* Function: h3dGetDeviceCapabilities
 		Checks whether GPU supports a certain feature.
 
@@ -994,6 +1092,9 @@ DLL float h3dGetDeviceCapabilities( H3DDeviceCapabilities::List param );
 		Overlays are drawn in the order in which they are pushed using this function. Overlays with
 		the same state will be batched together, so it can make sense to group overlays that have the
 		same material, color and flags in order to achieve best performance.
+		Only the used range of overlay vertices is uploaded to the GPU and the upload is skipped completely
+		if the vertex data is identical to the previous frame. The number of overlay vertices per frame is
+		limited to 16384; overlays exceeding the limit are ignored.
 		Note that the overlays have to be removed manually using the function h3dClearOverlays.
 	
 	Parameters:
@@ -1179,6 +1280,61 @@ DLL bool h3dIsResLoaded( H3DRes res );
 */
 DLL bool h3dLoadResource( H3DRes res, const char *data, int size );
 
+/* Function: h3dDecodeResourceData
+		Decodes resource data ahead of loading.
+	
+	Details:
+		This function runs the CPU intensive decoding step of a resource type on the specified data
+		without touching any engine state, so it can be called from any thread, e.g. from a background
+		loader while the engine is rendering. The returned block is loaded with h3dLoadDecodedResource
+		instead of passing the original data to h3dLoadResource and must be freed with
+		h3dReleaseDecodedResourceData afterwards.
+		Currently only Texture resources in one of the image formats that are decoded by the engine
+		(all formats except DDS) have a decoding step. For all other data NULL is returned and the
+		original data should be loaded as usual.
+	
+	Parameters:
+		type         - type of the resource the data belongs to
+		data         - pointer to the data to be decoded
+		size         - size of the data block
+		decodedSize  - pointer to variable where the size of the decoded data will be stored (can be NULL)
+		
+	Returns:
+		pointer to the decoded data or NULL if there is nothing to decode
+*/
+DLL char *h3dDecodeResourceData( int type, const char *data, int size, int *decodedSize );
+
+/* Function: h3dLoadDecodedResource
+		Loads a resource from decoded data.
+	
+	Details:
+		This function loads a resource like h3dLoadResource, but from a data block that was returned by
+		h3dDecodeResourceData for the type of the resource. The data block is not freed by this function.
+	
+	Parameters:
+		res   - handle to the resource for which data will be loaded
+		data  - pointer to the decoded data
+		size  - size of the decoded data block
+		
+	Returns:
+		true in case of success, otherwise false
+*/
+DLL bool h3dLoadDecodedResource( H3DRes res, const char *data, int size );
+
+/* Function: h3dReleaseDecodedResourceData
+		Frees data returned by h3dDecodeResourceData.
+	
+	Details:
+		This function frees a data block that was returned by h3dDecodeResourceData.
+	
+	Parameters:
+		data  - pointer to the decoded data (can be NULL)
+		
+	Returns:
+		nothing
+*/
+DLL void h3dReleaseDecodedResourceData( char *data );
+
 /* Function: h3dUnloadResource
 		Unloads a resource.
 	
@@ -1404,6 +1560,24 @@ DLL void h3dUnmapResStream( H3DRes res );
 */
 DLL H3DRes h3dQueryUnloadedResource( int index );
 
+/* Function: h3dQueryNextUnloadedResource
+		Returns the next unloaded resource after a given handle.
+	
+	Details:
+		This function searches the next resource that is not yet loaded and returns its handle.
+		The search begins after the specified start handle, so all unloaded resources can be
+		enumerated in a single pass by using as start the return value of the previous iteration
+		step. In contrast to h3dQueryUnloadedResource, which searches from the beginning of the
+		resource list on every call, this does not get slower with each step. 
+	
+	Parameters:
+		start  - resource handle after which the search begins (can be 0 for beginning of resource list)
+		
+	Returns:
+		handle to the next unloaded resource or 0 if it does not exist
+*/
+DLL H3DRes h3dQueryNextUnloadedResource( H3DRes start );
+
 /* Function: h3dReleaseUnusedResources
 		Frees resources that are no longer used.
 	
@@ -1420,6 +1594,49 @@ DLL H3DRes h3dQueryUnloadedResource( int index );
 */
 DLL void h3dReleaseUnusedResources();
 
+/* Function: h3dWarmUpShaders
+		Compiles the shader combinations required by the loaded materials ahead of time.
+	
+	Details:
+		This function queues all shader combinations that are used by the loaded materials in any context of
+		their shaders and are not compiled yet. The shader code of the queued combinations is assembled on the
+		worker threads. Unless wait is set, the combinations are compiled during the following h3dFinalizeFrame
+		calls within a small time budget per frame. The function should be called after loading the resources
+		of a level, e.g. behind a loading screen, so that the first frames do not need to compile shaders.
+	
+	Parameters:
+		wait  - true to compile all queued combinations before the function returns
+		
+	Returns:
+		number of shader combinations that were not compiled yet, including the ones that were
+		already waiting for being compiled
+*/
+DLL int h3dWarmUpShaders( bool wait );
+
+/* Function: h3dSetShaderCache
+		Sets the directory where compiled shaders are cached between runs.
+	
+	Details:
+		This function enables a persistent cache of shader program binaries. Every shader combination that is
+		compiled while the cache is enabled is stored in the directory, so that it can be loaded without
+		compiling when the same shader code is used again, usually on the next start of the application.
+		Entries are identified by a hash of the complete code of all shader stages and of the render device
+		and driver, so that changed shaders or drivers are never served from outdated entries. Corrupt entries
+		and binaries that the driver rejects are removed and compiled again. When the cache exceeds its
+		maximum size, the least recently used entries are removed. The directory must exist and be writable.
+		
+		The cache should be set up right after h3dInit so that it can be used for all shaders. It is only used
+		when the render device supports program binaries (OpenGL 4.1).
+	
+	Parameters:
+		path     - existing directory for the cache files; 0 or an empty string disables the cache
+		maxSize  - maximum size of all cache files in Mb
+		
+	Returns:
+		true in case of success, otherwise false
+*/
+DLL bool h3dSetShaderCache( const char *path, int maxSize );
+
 
 /* Group: Specific resource management functions */
 /* Function: h3dCreateTexture
@@ -2148,6 +2365,26 @@ DLL bool h3dSetModelMorpher( H3DNode modelNode, const char *target, float weight
 */
 DLL void h3dUpdateModel( H3DNode modelNode, int flags );
 
+/* Function: h3dUpdateModels
+		Applies animation and/or geometry updates to several models.
+	
+	Details:
+		This function has the same effect as calling h3dUpdateModel for each of the specified models but
+		distributes the animation sampling, the update of the model transformations and skinning matrices
+		and software skinning across the engine's worker threads (see H3DOptions::WorkerThreadCount).
+		The results do not depend on the number of threads. If one of the handles is not a valid Model
+		node, none of the models is updated.
+	
+	Parameters:
+		modelNodes  - array of handles to the Model nodes to be updated
+		count       - number of handles in the array
+		flags       - combination of H3DModelUpdate flags
+		
+	Returns:
+		nothing
+*/
+DLL void h3dUpdateModels( const H3DNode *modelNodes, int count, int flags );
+
 
 /* Group: Mesh-specific scene graph functions */
 /* Function: h3dAddMeshNode
@@ -2325,6 +2562,25 @@ DLL H3DNode h3dAddEmitterNode( H3DNode parent, const char *name, H3DRes material
 */
 DLL void h3dUpdateEmitter( H3DNode emitterNode, float timeDelta );
 
+/* Function: h3dAdvanceEmitterTimes
+		Advances the time of several emitters and performs their particle simulation.
+	
+	Details:
+		This function has the same effect as calling h3dUpdateEmitter for each of the specified emitters
+		but simulates the emitters in parallel on the engine's worker threads (see
+		H3DOptions::WorkerThreadCount). If one of the handles is not a valid Emitter node, none of the
+		emitters is updated.
+	
+	Parameters:
+		emitterNodes  - array of handles to the Emitter nodes to be updated
+		count         - number of handles in the array
+		timeDelta     - time delta in seconds
+		
+	Returns:
+		nothing
+*/
+DLL void h3dAdvanceEmitterTimes( const H3DNode *emitterNodes, int count, float timeDelta );
+
 /* Function: h3dHasEmitterFinished
 		Checks if an Emitter node is still alive.
 	
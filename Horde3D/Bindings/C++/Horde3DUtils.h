@@ -77,6 +77,21 @@ DLL void h3dutFreeMem( char **ptr );
 */
 DLL bool h3dutDumpMessages();
 
+/*	Function: h3dutDumpProfilerTrace
+		Writes the trace of the last profiled frame to a file.
+	
+	Details:
+		This utility function writes the JSON returned by h3dGetProfilerTrace to the specified file, which can
+		then be opened with chrome://tracing. Profiling needs to be enabled with the EnableProfiler option.
+	
+	Parameters:
+		filename  - name of the file to be written
+		
+	Returns:
+		true in case of success, otherwise false
+*/
+DLL bool h3dutDumpProfilerTrace( const char *filename );
+
 /*	Group: Resource management */
 /* Function: h3dutGetResourcePath
 		*Deprecated*
@@ -124,6 +139,10 @@ DLL void h3dutSetResourcePath( int type, const char *path );
 		as separator. All resource names are directly converted to filenames and the function tries to
 		find them in the specified directories using the given order of the search paths.
 	
+	The files are read and decoded by a pool of worker threads (see h3dutBeginLoadResourcesAsync) while
+	the calling thread passes the data to the engine, so that the function returns when all resources,
+	including the ones referenced by loaded resources, are loaded.
+	
 	Parameters:
 		contentDir  - directories where data is located on the drive ((back-)slashes at end are removed)
 		
@@ -132,6 +151,61 @@ DLL void h3dutSetResourcePath( int type, const char *path );
 */
 DLL bool h3dutLoadResourcesFromDisk( const char *contentDir );
 
+/* Function: h3dutBeginLoadResourcesAsync
+		Starts loading resources from a data drive in the background.
+	
+	Details:
+		This utility function starts asynchronous loading of all unloaded resources from the specified
+		directories, using the same search rules as h3dutLoadResourcesFromDisk. Worker threads read the
+		files and run the CPU intensive decoding step (see h3dDecodeResourceData). The data is passed to the
+		engine by h3dutUpdateLoadResourcesAsync which has to be called regularly, e.g. once per frame, from
+		the thread that uses the engine. Only one asynchronous load can be active at a time.
+	
+	Parameters:
+		contentDir  - directories where data is located on the drive ((back-)slashes at end are removed)
+		numThreads  - number of worker threads; 0 uses one thread per hardware thread
+		
+	Returns:
+		false if an asynchronous load is already active, otherwise true
+*/
+DLL bool h3dutBeginLoadResourcesAsync( const char *contentDir, int numThreads );
+
+/* Function: h3dutUpdateLoadResourcesAsync
+		Passes data of the asynchronous load to the engine.
+	
+	Details:
+		This utility function loads resources whose files have been read by the workers into the engine,
+		which includes uploading them to the GPU. It returns after the specified time has elapsed or when no
+		more data is ready, but loads at least one resource if possible. Resources that are referenced by
+		loaded resources (e.g. textures of a material) are added to the asynchronous load. When all resources
+		are loaded, the worker threads are shut down.
+	
+	Parameters:
+		maxTime  - time in milliseconds after which the function returns
+		
+	Returns:
+		true if all resources are loaded and the asynchronous load has finished, otherwise false
+*/
+DLL bool h3dutUpdateLoadResourcesAsync( float maxTime );
+
+/* Function: h3dutGetLoadResourcesAsyncProgress
+		Gets the progress of the current or last asynchronous load.
+	
+	Details:
+		This utility function returns how many of the resources of the asynchronous load are loaded. The
+		total number grows when loaded resources reference further resources, so the progress can decrease.
+	
+	Parameters:
+		numLoaded  - pointer to variable where the number of loaded resources will be stored (can be NULL)
+		numTotal   - pointer to variable where the total number of resources will be stored (can be NULL)
+		numFailed  - pointer to variable where the number of resources that could not be loaded will be
+		             stored (can be NULL)
+		
+	Returns:
+		fraction of loaded resources between 0 and 1
+*/
+DLL float h3dutGetLoadResourcesAsyncProgress( int *numLoaded, int *numTotal, int *numFailed );
+
 /* Function: h3dutCreateGeometryRes
 		Creates a Geometry resource from specified vertex data.
 	
@@ -285,7 +359,9 @@ DLL bool h3dutScreenshotRaw( unsigned char *rgb, int rgb_len);
 	Details:
 		This utility function uses overlays to display a text string at a specified position on the screen.
 		The font texture of the specified font material has to be a regular 16x16 grid containing all
-		ASCII characters in row-major order.
+		ASCII characters in row-major order. A line break character starts a new line below the
+		previous one. For text that does not change every frame, a text object (see h3dutCreateText)
+		avoids rebuilding the glyph geometry.
 	
 	Parameters:
 		text              - text string to be displayed
@@ -301,6 +377,74 @@ DLL bool h3dutScreenshotRaw( unsigned char *rgb, int rgb_len);
 DLL void h3dutShowText( const char *text, float x, float y, float size,
                         float colR, float colG, float colB, H3DRes fontMaterialRes );
 
+/* Function: h3dutCreateText
+		Creates a text object.
+	
+	Details:
+		This utility function creates a text object which keeps the glyph geometry of a text string, so
+		that static text like HUD labels or console lines is not rebuilt every frame. The text is empty
+		until it is set with h3dutSetText. Text objects are drawn in the same way as with h3dutShowText.
+	
+	Parameters:
+		fontMaterialRes  - font material resource used for rendering
+		
+	Returns:
+		handle to the created text object
+*/
+DLL int h3dutCreateText( H3DRes fontMaterialRes );
+
+/* Function: h3dutDestroyText
+		Destroys a text object.
+	
+	Details:
+		This utility function destroys a text object that was created with h3dutCreateText.
+	
+	Parameters:
+		textObj  - handle to the text object
+		
+	Returns:
+		nothing
+*/
+DLL void h3dutDestroyText( int textObj );
+
+/* Function: h3dutSetText
+		Sets the text string and appearance of a text object.
+	
+	Details:
+		This utility function sets the parameters of a text object. The glyph geometry is only rebuilt
+		if the text, position or size differ from the previous call, so the function can be called every
+		frame. Changing only the color is cheap.
+	
+	Parameters:
+		textObj           - handle to the text object
+		text              - text string to be displayed
+		x, y              - position of the lower left corner of the first character;
+		                    for more details on coordinate system see overlay documentation
+		size              - size (scale) factor of the font
+		colR, colG, colB  - font color
+		
+	Returns:
+		true in case of success, otherwise false
+*/
+DLL bool h3dutSetText( int textObj, const char *text, float x, float y, float size,
+                       float colR, float colG, float colB );
+
+/* Function: h3dutShowTextObject
+		Shows a text object on the screen.
+	
+	Details:
+		This utility function shows the text of a text object for the current frame. Like other overlays,
+		it has to be called every frame. Since the engine only uploads overlay geometry that has changed
+		since the last frame, unchanged text objects cause no additional upload.
+	
+	Parameters:
+		textObj  - handle to the text object
+		
+	Returns:
+		nothing
+*/
+DLL void h3dutShowTextObject( int textObj );
+
 /* Function: h3dutShowInfoBox
 		Shows a customizable info box on the screen.
 	
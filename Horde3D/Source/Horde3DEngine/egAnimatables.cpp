@@ -36,8 +36,7 @@ MeshNode::MeshNode( const MeshNodeTpl &meshTpl ) :
 	_renderable = true;
 	_lodSupported = true;
 
-	if( _materialRes != 0x0 )
-		_sortKey = (float)_materialRes->getHandle();
+	updateSortKey();
 }
 
 
@@ -54,46 +53,34 @@ MeshNode::~MeshNode()
 }
 
 
-SceneNodeTpl *MeshNode::parsingFunc( map< string, string > &attribs )
+SceneNodeTpl *MeshNode::parsingFunc( const SceneNodeAttribs &attribs )
 {
 	bool result = true;
 	
-	map< string, string >::iterator itr;
 	MeshNodeTpl *meshTpl = new MeshNodeTpl( "", 0x0, 0, 0, 0, 0 );
+	string str;
+	int value;
+	bool flag;
 
-	itr = attribs.find( "material" );
-	if( itr != attribs.end() )
+	if( attribs.getString( "material", str ) )
 	{
-		uint32 res = Modules::resMan().addResource( ResourceTypes::Material, itr->second, 0, false );
+		uint32 res = Modules::resMan().addResource( ResourceTypes::Material, str, 0, false );
 		if( res != 0 )
 			meshTpl->matRes = (MaterialResource *)Modules::resMan().resolveResHandle( res );
 	}
 	else result = false;
-	itr = attribs.find( "batchStart" );
-	if( itr != attribs.end() ) meshTpl->batchStart = atoi( itr->second.c_str() );
+	if( attribs.getInt( "batchStart", value ) ) meshTpl->batchStart = value;
 	else result = false;
-	itr = attribs.find( "batchCount" );
-	if( itr != attribs.end() ) meshTpl->batchCount = atoi( itr->second.c_str() );
+	if( attribs.getInt( "batchCount", value ) ) meshTpl->batchCount = value;
 	else result = false;
-	itr = attribs.find( "vertRStart" );
-	if( itr != attribs.end() ) meshTpl->vertRStart = atoi( itr->second.c_str() );
+	if( attribs.getInt( "vertRStart", value ) ) meshTpl->vertRStart = value;
 	else result = false;
-	itr = attribs.find( "vertREnd" );
-	if( itr != attribs.end() ) meshTpl->vertREnd = atoi( itr->second.c_str() );
+	if( attribs.getInt( "vertREnd", value ) ) meshTpl->vertREnd = value;
 	else result = false;
 
-	itr = attribs.find( "lodLevel" );
-	if( itr != attribs.end() ) meshTpl->lodLevel = atoi( itr->second.c_str() );
+	if( attribs.getInt( "lodLevel", value ) ) meshTpl->lodLevel = value;
 
-	itr = attribs.find( "tessellatable" );
-	if ( itr != attribs.end() )
-	{
-		if ( _stricmp( itr->second.c_str(), "true" ) == 0 ||
-		   	 _stricmp( itr->second.c_str(), "1" ) == 0 )
-		{
-			meshTpl->tessellatable = 1;
-		}
-	}
+	if( attribs.getBool( "tessellatable", flag ) && flag ) meshTpl->tessellatable = 1;
 
 	if( !result )
 	{
@@ -171,7 +158,7 @@ void MeshNode::setParamI( int param, int value )
 		if( res != 0x0 && res->getType() == ResourceTypes::Material )
 		{
 			_materialRes = (MaterialResource *)res;
-			_sortKey = (float)_materialRes->getHandle();
+			updateSortKey();
 		}
 		else
 		{
@@ -259,6 +246,23 @@ void MeshNode::onAttach( SceneNode &parentNode )
 	while( node->getType() != SceneNodeTypes::Model ) node = node->getParent();
 	_parentModel = (ModelNode *)node;
 	_parentModel->markNodeListDirty();
+	updateSortKey();
+}
+
+
+void MeshNode::updateSortKey()
+{
+	// Meshes with the same shader, material and geometry end up next to each other in the render queue
+	uint32 shader = 0, material = 0, geometry = 0;
+	if( _materialRes != 0x0 )
+	{
+		material = _materialRes->getHandle();
+		if( _materialRes->_shaderRes != 0x0 ) shader = _materialRes->_shaderRes->getHandle();
+	}
+	if( _parentModel != 0x0 && _parentModel->getGeometryResource() != 0x0 )
+		geometry = _parentModel->getGeometryResource()->getHandle();
+	
+	_sortKey = RenderSortKey::fromState( shader, material, geometry );
 }
 
 
@@ -285,15 +289,14 @@ JointNode::JointNode( const JointNodeTpl &jointTpl ) :
 }
 
 
-SceneNodeTpl *JointNode::parsingFunc( map< string, string > &attribs )
+SceneNodeTpl *JointNode::parsingFunc( const SceneNodeAttribs &attribs )
 {
 	bool result = true;
 	
-	map< string, string >::iterator itr;
 	JointNodeTpl *jointTpl = new JointNodeTpl( "", 0 );
+	int value;
 
-	itr = attribs.find( "jointIndex" );
-	if( itr != attribs.end() ) jointTpl->jointIndex = atoi( itr->second.c_str() );
+	if( attribs.getInt( "jointIndex", value ) ) jointTpl->jointIndex = value;
 	else result = false;
 
 	if( !result )
@@ -66,7 +66,7 @@ struct MeshNodeTpl : public SceneNodeTpl
 class MeshNode : public SceneNode, public IAnimatableNode
 {
 public:
-	static SceneNodeTpl *parsingFunc( std::map< std::string, std::string > &attribs );
+	static SceneNodeTpl *parsingFunc( const SceneNodeAttribs &attribs );
 	static SceneNode *factoryFunc( const SceneNodeTpl &nodeTpl );
 
 	// IAnimatableNode
@@ -94,6 +94,7 @@ public:
 	uint32 getLodLevel() const { return _lodLevel; }
 	uint32 getTessellationStatus() const { return _tessellatable; }
 	ModelNode *getParentModel() const { return _parentModel; }
+	void updateSortKey();
 
 protected:
 	MeshNode( const MeshNodeTpl &meshTpl );
@@ -148,7 +149,7 @@ struct JointNodeTpl : public SceneNodeTpl
 class JointNode : public SceneNode, public IAnimatableNode
 {
 public:
-	static SceneNodeTpl *parsingFunc( std::map< std::string, std::string > &attribs );
+	static SceneNodeTpl *parsingFunc( const SceneNodeAttribs &attribs );
 	static SceneNode *factoryFunc( const SceneNodeTpl &nodeTpl );
 	
 	// IAnimatableNode
@@ -25,10 +25,173 @@ namespace Horde3D {
 using namespace std;
 
 
+// =================================================================================================
+// Compressed Animation Tracks
+// =================================================================================================
+
+namespace {
+	const float Sqrt2 = 1.41421356f;
+	
+	// Error bounds for key reduction of compressed animations
+	const float MaxRotError = 0.001f;   // Radians
+	const float MaxVecError = 0.001f;   // Absolute error of translation and scale components
+	const uint32 MaxKeySpan = 128;      // Maximum number of frames between two keys
+
+	inline uint32 findKey( const std::vector< uint16 > &keyFrames, uint32 frame )
+	{
+		// Index of last key at or before frame (first key is always at frame 0)
+		return (uint32)(std::upper_bound( keyFrames.begin(), keyFrames.end(), frame ) - keyFrames.begin()) - 1;
+	}
+
+	void encodeQuat( const Quaternion &quat, uint16 *dest )
+	{
+		// Smallest-three encoding: the largest component is dropped and reconstructed from the
+		// others which are stored with 15 bits each; the 2 bit index of the dropped component
+		// uses the spare bits of the first two words
+		const float *q = &quat.x;
+		uint32 largest = 0;
+		for( uint32 i = 1; i < 4; ++i )
+		{
+			if( fabsf( q[i] ) > fabsf( q[largest] ) ) largest = i;
+		}
+		float sign = q[largest] < 0 ? -1.0f : 1.0f;
+
+		for( uint32 i = 0, j = 0; i < 4; ++i )
+		{
+			if( i == largest ) continue;
+			float v = clamp( q[i] * sign * Sqrt2 * 0.5f + 0.5f, 0.0f, 1.0f );
+			dest[j++] = (uint16)ftoi_r( v * 32767.0f );
+		}
+		dest[0] |= (uint16)((largest >> 1) << 15);
+		dest[1] |= (uint16)((largest & 1) << 15);
+	}
+
+	Quaternion decodeQuat( const uint16 *src )
+	{
+		uint32 largest = ((src[0] >> 15) << 1) | (src[1] >> 15);
+		float q[4], sqSum = 0;
+		
+		for( uint32 i = 0, j = 0; i < 4; ++i )
+		{
+			if( i == largest ) continue;
+			q[i] = ((src[j++] & 0x7FFF) / 32767.0f * 2.0f - 1.0f) / Sqrt2;
+			sqSum += q[i] * q[i];
+		}
+		q[largest] = sqrtf( maxf( 1.0f - sqSum, 0.0f ) );
+
+		return Quaternion( q[0], q[1], q[2], q[3] );
+	}
+
+	float quatError( const Quaternion &a, const Quaternion &b )
+	{
+		// Angle between both rotations
+		float cosHalfAngle = fabsf( a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w );
+		return 2.0f * acosf( minf( cosHalfAngle, 1.0f ) );
+	}
+
+	float vecError( const Vec3f &a, const Vec3f &b )
+	{
+		return maxf( maxf( fabsf( a.x - b.x ), fabsf( a.y - b.y ) ), fabsf( a.z - b.z ) );
+	}
+
+	bool isRotSpanValid( const std::vector< Frame > &frames, uint32 first, uint32 last )
+	{
+		for( uint32 i = first + 1; i < last; ++i )
+		{
+			Quaternion q = frames[first].rotQuat.nlerp( frames[last].rotQuat, (float)(i - first) / (last - first) );
+			if( quatError( q, frames[i].rotQuat ) > MaxRotError ) return false;
+		}
+		return true;
+	}
+
+	bool isVecSpanValid( const std::vector< Frame > &frames, Vec3f Frame::*member, uint32 first, uint32 last )
+	{
+		for( uint32 i = first + 1; i < last; ++i )
+		{
+			Vec3f v = (frames[first].*member).lerp( frames[last].*member, (float)(i - first) / (last - first) );
+			if( vecError( v, frames[i].*member ) > MaxVecError ) return false;
+		}
+		return true;
+	}
+
+	void reduceKeys( const std::vector< Frame > &frames, Vec3f Frame::*member, std::vector< uint16 > &keyFrames )
+	{
+		// Greedily extend each key span as long as linear interpolation stays within the error bound
+		uint32 numFrames = (uint32)frames.size();
+		uint32 first = 0;
+		
+		keyFrames.push_back( 0 );
+		while( first < numFrames - 1 )
+		{
+			uint32 last = first + 1;
+			while( last + 1 < numFrames && last + 1 - first <= MaxKeySpan &&
+			       (member != 0x0 ? isVecSpanValid( frames, member, first, last + 1 ) :
+			                        isRotSpanValid( frames, first, last + 1 )) )
+			{
+				++last;
+			}
+			keyFrames.push_back( (uint16)last );
+			first = last;
+		}
+	}
+}
+
+
+Vec3f AnimResVecTrack::sample( uint32 frame ) const
+{
+	if( keyFrames.empty() ) return base;
+	
+	uint32 key = findKey( keyFrames, frame );
+	const uint16 *k0 = &keys[key * 3];
+	Vec3f v0( base.x + step.x * k0[0], base.y + step.y * k0[1], base.z + step.z * k0[2] );
+	if( key + 1 >= keyFrames.size() || frame == keyFrames[key] ) return v0;
+
+	const uint16 *k1 = &keys[key * 3 + 3];
+	Vec3f v1( base.x + step.x * k1[0], base.y + step.y * k1[1], base.z + step.z * k1[2] );
+	return v0.lerp( v1, (float)(frame - keyFrames[key]) / (keyFrames[key + 1] - keyFrames[key]) );
+}
+
+
+Quaternion AnimResQuatTrack::sample( uint32 frame ) const
+{
+	if( keyFrames.empty() ) return constQuat;
+
+	uint32 key = findKey( keyFrames, frame );
+	Quaternion q0 = decodeQuat( &keys[key * 3] );
+	if( key + 1 >= keyFrames.size() || frame == keyFrames[key] ) return q0;
+
+	return q0.nlerp( decodeQuat( &keys[key * 3 + 3] ),
+	                 (float)(frame - keyFrames[key]) / (keyFrames[key + 1] - keyFrames[key]) );
+}
+
+
+const Frame &AnimResEntity::getFrame( uint32 frame, Frame &decodedFrame, bool bakeTransMat ) const
+{
+	if( !compressed ) return frames[frame];
+
+	decodedFrame.rotQuat = rotTrack.sample( frame );
+	decodedFrame.transVec = transTrack.sample( frame );
+	decodedFrame.scaleVec = scaleTrack.sample( frame );
+	if( !bakeTransMat ) return decodedFrame;
+
+	// Same transformation order as prebaked matrices
+	Matrix4f mat( Math::NO_INIT );
+	Matrix4f::fastMult43( mat, Matrix4f( decodedFrame.rotQuat ),
+		Matrix4f::ScaleMat( decodedFrame.scaleVec.x, decodedFrame.scaleVec.y, decodedFrame.scaleVec.z ) );
+	Matrix4f::fastMult43( decodedFrame.bakedTransMat,
+		Matrix4f::TransMat( decodedFrame.transVec.x, decodedFrame.transVec.y, decodedFrame.transVec.z ), mat );
+	
+	return decodedFrame;
+}
+
+
 // =================================================================================================
 // Animation Resource
 // =================================================================================================
 
+std::atomic< size_t > AnimationResource::_totalMemSize( 0 );
+
+
 AnimationResource::AnimationResource( const string &name, int flags ) :
 	Resource( ResourceTypes::Animation, name, flags )
 {
@@ -47,6 +210,7 @@ Resource *AnimationResource::clone()
 	AnimationResource *res = new AnimationResource( "", _flags );
 
 	*res = *this;
+	_totalMemSize += res->_memSize;
 	
 	return res;
 }
@@ -55,12 +219,16 @@ Resource *AnimationResource::clone()
 void AnimationResource::initDefault()
 {
 	_numFrames = 0;
+	_memSize = 0;
 }
 
 
 void AnimationResource::release()
 {
 	_entities.clear();
+
+	_totalMemSize -= _memSize;
+	_memSize = 0;
 }
 
 
@@ -150,15 +318,145 @@ bool AnimationResource::load( const char *data, int size )
 
 		if( !entity.frames.empty() )
 			entity.firstFrameInvTrans = entity.frames[0].bakedTransMat.inverted();
+		
+		entity.numFrames = (uint32)entity.frames.size();
+		entity.compressed = false;
 	}
 
 	// Sort entities by name id
 	std::sort( _entities.begin(), _entities.end(), AnimEntCompFunc() );
+
+	// Compress animation data if requested (frame indices are stored with 16 bits)
+	if( (_flags & ResourceFlags::AnimCompression) && _numFrames > 1 && _numFrames <= 65536 )
+	{
+		size_t uncompressedSize = calcMemSize();
+		float maxRotError = 0, maxVecError = 0;
+		
+		for( size_t i = 0, s = _entities.size(); i < s; ++i )
+		{
+			compressEntity( _entities[i], maxRotError, maxVecError );
+		}
+
+		_memSize = calcMemSize();
+		Modules::log().writeInfo( "Animation resource '%s': compressed to %.1f%% (%u -> %u bytes), "
+			"max error %f rad (rotation), %f (translation/scale)", _name.c_str(),
+			100.0f * _memSize / uncompressedSize, (uint32)uncompressedSize, (uint32)_memSize,
+			maxRotError, maxVecError );
+	}
+	else
+	{
+		_memSize = calcMemSize();
+	}
+	_totalMemSize += _memSize;
 	
 	return true;
 }
 
 
+void AnimationResource::compressEntity( AnimResEntity &entity, float &maxRotError, float &maxVecError )
+{
+	if( entity.frames.size() < 2 ) return;
+	
+	const std::vector< Frame > &frames = entity.frames;
+	uint32 numFrames = (uint32)frames.size();
+
+	// Value ranges of translation and scale
+	Vec3f minVals[2], maxVals[2];
+	for( uint32 t = 0; t < 2; ++t )
+	{
+		Vec3f Frame::*member = t == 0 ? &Frame::transVec : &Frame::scaleVec;
+		
+		minVals[t] = frames[0].*member; maxVals[t] = frames[0].*member;
+		for( uint32 i = 1; i < numFrames; ++i )
+		{
+			const Vec3f &v = frames[i].*member;
+			minVals[t] = Vec3f( minf( minVals[t].x, v.x ), minf( minVals[t].y, v.y ), minf( minVals[t].z, v.z ) );
+			maxVals[t] = Vec3f( maxf( maxVals[t].x, v.x ), maxf( maxVals[t].y, v.y ), maxf( maxVals[t].z, v.z ) );
+		}
+
+		// The rounding error of 16 bit keys is half a quantization step; entities with tracks whose
+		// range is too large for the error bound keep their frames in full precision
+		Vec3f range = maxVals[t] - minVals[t];
+		if( maxf( maxf( range.x, range.y ), range.z ) * (0.5f / 65535.0f) > MaxVecError ) return;
+	}
+
+	// Rotation track
+	AnimResQuatTrack &rotTrack = entity.rotTrack;
+	rotTrack.constQuat = frames[0].rotQuat;
+	bool constant = true;
+	for( uint32 i = 1; i < numFrames && constant; ++i )
+		constant = quatError( frames[i].rotQuat, frames[0].rotQuat ) <= MaxRotError;
+
+	if( !constant )
+	{
+		reduceKeys( frames, 0x0, rotTrack.keyFrames );
+		rotTrack.keys.resize( rotTrack.keyFrames.size() * 3 );
+		for( size_t i = 0, s = rotTrack.keyFrames.size(); i < s; ++i )
+			encodeQuat( frames[rotTrack.keyFrames[i]].rotQuat, &rotTrack.keys[i * 3] );
+	}
+
+	// Translation and scale tracks
+	for( uint32 t = 0; t < 2; ++t )
+	{
+		Vec3f Frame::*member = t == 0 ? &Frame::transVec : &Frame::scaleVec;
+		AnimResVecTrack &track = t == 0 ? entity.transTrack : entity.scaleTrack;
+		
+		const Vec3f &minVal = minVals[t], &maxVal = maxVals[t];
+		if( vecError( minVal, maxVal ) <= MaxVecError )
+		{
+			track.base = frames[0].*member;
+			track.step = Vec3f( 0, 0, 0 );
+			continue;
+		}
+
+		// Quantize to 16 bit within value range of track
+		track.base = minVal;
+		track.step = (maxVal - minVal) * (1.0f / 65535.0f);
+		reduceKeys( frames, member, track.keyFrames );
+		track.keys.resize( track.keyFrames.size() * 3 );
+		for( size_t i = 0, s = track.keyFrames.size(); i < s; ++i )
+		{
+			const Vec3f &v = frames[track.keyFrames[i]].*member;
+			track.keys[i * 3 + 0] = track.step.x > 0 ? (uint16)ftoi_r( (v.x - minVal.x) / track.step.x ) : 0;
+			track.keys[i * 3 + 1] = track.step.y > 0 ? (uint16)ftoi_r( (v.y - minVal.y) / track.step.y ) : 0;
+			track.keys[i * 3 + 2] = track.step.z > 0 ? (uint16)ftoi_r( (v.z - minVal.z) / track.step.z ) : 0;
+		}
+	}
+
+	// Measure error of decoded data
+	entity.compressed = true;
+	Frame decodedFrame;
+	for( uint32 i = 0; i < numFrames; ++i )
+	{
+		entity.getFrame( i, decodedFrame );
+		maxRotError = maxf( maxRotError, quatError( decodedFrame.rotQuat, frames[i].rotQuat ) );
+		maxVecError = maxf( maxVecError, vecError( decodedFrame.transVec, frames[i].transVec ) );
+		maxVecError = maxf( maxVecError, vecError( decodedFrame.scaleVec, frames[i].scaleVec ) );
+	}
+
+	// Only first frame is kept in full precision (required for additive animations)
+	entity.frames.resize( 1 );
+	std::vector< Frame >( entity.frames ).swap( entity.frames );
+}
+
+
+size_t AnimationResource::calcMemSize() const
+{
+	size_t size = _entities.capacity() * sizeof( AnimResEntity );
+	
+	for( size_t i = 0, s = _entities.size(); i < s; ++i )
+	{
+		const AnimResEntity &entity = _entities[i];
+		size += entity.frames.capacity() * sizeof( Frame );
+		size += (entity.rotTrack.keyFrames.capacity() + entity.rotTrack.keys.capacity()) * sizeof( uint16 );
+		size += (entity.transTrack.keyFrames.capacity() + entity.transTrack.keys.capacity()) * sizeof( uint16 );
+		size += (entity.scaleTrack.keyFrames.capacity() + entity.scaleTrack.keys.capacity()) * sizeof( uint16 );
+	}
+
+	return size;
+}
+
+
 int AnimationResource::getElemCount( int elem ) const
 {
 	switch( elem )
@@ -383,11 +681,9 @@ bool AnimationController::animate()
 
 	Quaternion nodeRotQuat;
 	Vec3f nodeTransVec, nodeScaleVec;
+	Frame decodedFrame0, decodedFrame1;
 	
-	Timer *timer = Modules::stats().getTimer( EngineStats::AnimationTime );
-	if( Modules::config().gatherTimeStats ) timer->setEnabled( true );
-	
-	// Animate
+	// Animate (may run on worker threads, so only data of this controller is modified)
 	for( size_t i = 0, si = _nodeList.size(); i < si; ++i )
 	{
 		// Fast path
@@ -395,11 +691,11 @@ bool AnimationController::animate()
 		{
 			uint32 firstStage = _activeStages[0];
 			AnimResEntity *animEnt = _nodeList[i].animEntities[firstStage];
-			if( animEnt != 0x0 && !animEnt->frames.empty() )
+			if( animEnt != 0x0 && animEnt->numFrames > 0 )
 			{
-				uint32 frame = (uint32)ftoi_t( _animStages[firstStage].animTime ) % animEnt->frames.size();
-				if( animEnt->frames.size() == 1 ) frame = 0;  // Animation compression
-				_nodeList[i].node->getANRelTransRef() = animEnt->frames[frame].bakedTransMat;
+				uint32 frame = (uint32)ftoi_t( _animStages[firstStage].animTime ) % animEnt->numFrames;
+				if( animEnt->numFrames == 1 ) frame = 0;  // Animation compression
+				_nodeList[i].node->getANRelTransRef() = animEnt->getFrame( frame, decodedFrame0, true ).bakedTransMat;
 			}
 			continue;
 		}
@@ -435,7 +731,7 @@ bool AnimationController::animate()
 			AnimResEntity *animEnt = _nodeList[i].animEntities[stageIdx];
 			if( animEnt == 0x0 || layerWeightSum < Math::Epsilon ) continue;
 			
-			uint32 numFrames = (uint32)animEnt->frames.size();
+			uint32 numFrames = animEnt->numFrames;
 			if( numFrames > 0 )
 			{
 				// Normalize weight and apply to remaining weight
@@ -450,7 +746,7 @@ bool AnimationController::animate()
 				if( numFrames == 1 ) f0 = f1 = 0;	// Animation compression
 
 				// Assign data of first frame
-				Frame &frame0 = animEnt->frames[f0];
+				const Frame &frame0 = animEnt->getFrame( f0, decodedFrame0 );
 				Vec3f transVec( frame0.transVec );
 				Vec3f scaleVec( frame0.scaleVec );
 				Quaternion rotQuat( frame0.rotQuat );
@@ -458,7 +754,7 @@ bool AnimationController::animate()
 				// Inter-frame interpolation
 				if( !Modules::config().fastAnimation )
 				{
-					Frame &frame1 = animEnt->frames[f1];
+					const Frame &frame1 = animEnt->getFrame( f1, decodedFrame1 );
 					transVec = transVec.lerp( frame1.transVec, amount );
 					scaleVec = scaleVec.lerp( frame1.scaleVec, amount );
 					rotQuat = rotQuat.nlerp( frame1.rotQuat, amount );
@@ -514,8 +810,6 @@ bool AnimationController::animate()
 		}
 	}
 
-	timer->setEnabled( false );
-
 	_dirty = false;
 	return true;
 }
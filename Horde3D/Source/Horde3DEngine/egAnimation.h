@@ -16,6 +16,7 @@
 #include "egPrerequisites.h"
 #include "egResource.h"
 #include "utMath.h"
+#include <atomic>
 
 
 namespace Horde3D {
@@ -43,11 +44,38 @@ struct Frame
 };
 
 
+struct AnimResVecTrack
+{
+	Vec3f                  base, step;  // Value is base + step * quantized value; constant tracks just use base
+	std::vector< uint16 >  keyFrames;   // Frame of each key, empty for constant tracks
+	std::vector< uint16 >  keys;        // Three 16 bit components per key
+	
+	Vec3f sample( uint32 frame ) const;
+};
+
+
+struct AnimResQuatTrack
+{
+	Quaternion             constQuat;
+	std::vector< uint16 >  keyFrames;   // Frame of each key, empty for constant tracks
+	std::vector< uint16 >  keys;        // 48 bit smallest-three encoding per key
+	
+	Quaternion sample( uint32 frame ) const;
+};
+
+
 struct AnimResEntity
 {
 	uint32                nameId;
 	Matrix4f              firstFrameInvTrans;
-	std::vector< Frame >  frames;
+	std::vector< Frame >  frames;  // Only first frame if entity is compressed
+	uint32                numFrames;
+	bool                  compressed;
+	AnimResQuatTrack      rotTrack;
+	AnimResVecTrack       transTrack, scaleTrack;
+	
+	// The baked matrix of decoded frames is only calculated if requested
+	const Frame &getFrame( uint32 frame, Frame &decodedFrame, bool bakeTransMat = false ) const;
 };
 
 // =================================================================================================
@@ -71,11 +99,18 @@ public:
 
 	AnimResEntity *findEntity( uint32 nameId );
 
+	static size_t getTotalMemSize() { return _totalMemSize; }
+
 private:
 	bool raiseError( const std::string &msg );
+	void compressEntity( AnimResEntity &entity, float &maxRotError, float &maxVecError );
+	size_t calcMemSize() const;
 
 private:
+	static std::atomic< size_t >  _totalMemSize;  // Updated by resources loaded on other threads
+	
 	uint32                        _numFrames;
+	size_t                        _memSize;
 	std::vector< AnimResEntity >  _entities;
 
 	friend class Renderer;
@@ -49,56 +49,33 @@ CameraNode::~CameraNode()
 }
 
 
-SceneNodeTpl *CameraNode::parsingFunc( map< string, string > &attribs )
+SceneNodeTpl *CameraNode::parsingFunc( const SceneNodeAttribs &attribs )
 {
 	bool result = true;
 	
-	map< string, string >::iterator itr;
 	CameraNodeTpl *cameraTpl = new CameraNodeTpl( "", 0x0 );
+	string str;
 
-	itr = attribs.find( "pipeline" );
-	if( itr != attribs.end() )
+	if( attribs.getString( "pipeline", str ) )
 	{
-		uint32 res = Modules::resMan().addResource( ResourceTypes::Pipeline, itr->second, 0, false );
+		uint32 res = Modules::resMan().addResource( ResourceTypes::Pipeline, str, 0, false );
 		cameraTpl->pipeRes = (PipelineResource *)Modules::resMan().resolveResHandle( res );
 	}
 	else result = false;
-	itr = attribs.find( "outputTex" );
-	if( itr != attribs.end() )
+	if( attribs.getString( "outputTex", str ) )
 	{	
 		cameraTpl->outputTex = (TextureResource *)Modules::resMan().findResource(
-			ResourceTypes::Texture, itr->second );
-	}
-	itr = attribs.find( "outputBufferIndex" );
-	if( itr != attribs.end() ) cameraTpl->outputBufferIndex = atoi( itr->second.c_str() );
-	itr = attribs.find( "leftPlane" );
-	if( itr != attribs.end() ) cameraTpl->leftPlane = (float)atof( itr->second.c_str() );
-	itr = attribs.find( "rightPlane" );
-	if( itr != attribs.end() ) cameraTpl->rightPlane = (float)atof( itr->second.c_str() );
-	itr = attribs.find( "bottomPlane" );
-	if( itr != attribs.end() ) cameraTpl->bottomPlane = (float)atof( itr->second.c_str() );
-	itr = attribs.find( "topPlane" );
-	if( itr != attribs.end() ) cameraTpl->topPlane = (float)atof( itr->second.c_str() );
-	itr = attribs.find( "nearPlane" );
-	if( itr != attribs.end() ) cameraTpl->nearPlane = (float)atof( itr->second.c_str() );
-	itr = attribs.find( "farPlane" );
-	if( itr != attribs.end() ) cameraTpl->farPlane = (float)atof( itr->second.c_str() );
-	itr = attribs.find( "orthographic" );
-	if( itr != attribs.end() ) 
-	{
-		if ( _stricmp( itr->second.c_str(), "true" ) == 0 || _stricmp( itr->second.c_str(), "1" ) == 0 )
-			cameraTpl->orthographic = true;
-		else
-			cameraTpl->orthographic = false;
-	}
-	itr = attribs.find( "occlusionCulling" );
-	if( itr != attribs.end() ) 
-	{
-		if ( _stricmp( itr->second.c_str(), "true" ) == 0 || _stricmp( itr->second.c_str(), "1" ) == 0 )
-			cameraTpl->occlusionCulling = true;
-		else
-			cameraTpl->occlusionCulling = false;
+			ResourceTypes::Texture, str );
 	}
+	attribs.getInt( "outputBufferIndex", cameraTpl->outputBufferIndex );
+	attribs.getFloat( "leftPlane", cameraTpl->leftPlane );
+	attribs.getFloat( "rightPlane", cameraTpl->rightPlane );
+	attribs.getFloat( "bottomPlane", cameraTpl->bottomPlane );
+	attribs.getFloat( "topPlane", cameraTpl->topPlane );
+	attribs.getFloat( "nearPlane", cameraTpl->nearPlane );
+	attribs.getFloat( "farPlane", cameraTpl->farPlane );
+	attribs.getBool( "orthographic", cameraTpl->orthographic );
+	attribs.getBool( "occlusionCulling", cameraTpl->occlusionCulling );
 
 	if( !result )
 	{
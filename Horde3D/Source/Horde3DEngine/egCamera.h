@@ -77,7 +77,7 @@ struct CameraNodeTpl : public SceneNodeTpl
 class CameraNode : public SceneNode
 {
 public:
-	static SceneNodeTpl *parsingFunc( std::map< std::string, std::string > &attribs );
+	static SceneNodeTpl *parsingFunc( const SceneNodeAttribs &attribs );
 	static SceneNode *factoryFunc( const SceneNodeTpl &nodeTpl );
 
 	~CameraNode();
@@ -14,6 +14,10 @@
 #include "utMath.h"
 #include "egModules.h"
 #include "egRenderer.h"
+#include "egAnimation.h"
+#include "egTexture.h"
+#include "utThreadPool.h"
+#include "egProfiler.h"
 #include <stdarg.h>
 #include <stdio.h>
 
@@ -36,10 +40,13 @@ EngineConfig::EngineConfig()
 	loadTextures = true;
 	fastAnimation = true;
 	shadowMapSize = 1024;
+	shadowMapCacheSize = 8;
+	texStreamingBudget = 0;
 	sampleCount = 0;
 	wireframeMode = false;
 	debugViewMode = false;
 	dumpFailedShaders = false;
+	asyncShaderCompilation = false;
 	gatherTimeStats = true;
 }
 
@@ -76,6 +83,16 @@ float EngineConfig::getOption( EngineOptions::List param ) const
 		return dumpFailedShaders ? 1.0f : 0.0f;
 	case EngineOptions::GatherTimeStats:
 		return gatherTimeStats ? 1.0f : 0.0f;
+	case EngineOptions::WorkerThreadCount:
+		return (float)Modules::threadPool().getNumWorkers();
+	case EngineOptions::ShadowMapCacheSize:
+		return (float)shadowMapCacheSize;
+	case EngineOptions::EnableProfiler:
+		return Profiler::isEnabled() ? 1.0f : 0.0f;
+	case EngineOptions::TextureStreamingBudget:
+		return (float)texStreamingBudget;
+	case EngineOptions::AsyncShaderCompilation:
+		return asyncShaderCompilation ? 1.0f : 0.0f;
 	default:
 		Modules::setError( "Invalid param for h3dGetOption" );
 		return Math::NaN;
@@ -149,6 +166,33 @@ bool EngineConfig::setOption( EngineOptions::List param, float value )
 	case EngineOptions::GatherTimeStats:
 		gatherTimeStats = (value != 0);
 		return true;
+	case EngineOptions::WorkerThreadCount:
+		size = ftoi_r( value );
+		if( size < 0 || size > 64 ) return false;
+		
+		Modules::threadPool().setNumWorkers( (uint32)size );
+		return true;
+	case EngineOptions::ShadowMapCacheSize:
+		size = ftoi_r( value );
+		if( size < 0 || size > 64 ) return false;
+
+		if( size < shadowMapCacheSize ) Modules::renderer().releaseShadowMapCache( 0x0 );
+		shadowMapCacheSize = size;
+		return true;
+	case EngineOptions::EnableProfiler:
+		Modules::profiler().setEnabled( value != 0 );
+		return true;
+	case EngineOptions::TextureStreamingBudget:
+		size = ftoi_r( value );
+		if( size < 0 ) return false;
+
+		// Textures that are already streamed get all of their mips when streaming is disabled
+		if( size == 0 ) TextureResource::finishStreaming();
+		texStreamingBudget = size;
+		return true;
+	case EngineOptions::AsyncShaderCompilation:
+		asyncShaderCompilation = (value != 0);
+		return true;
 	default:
 		Modules::setError( "Invalid param for h3dSetOption" );
 		return false;
@@ -271,6 +315,18 @@ StatManager::StatManager() : _fwdLightsGPUTimer( 0 ), _defLightsGPUTimer( 0 ), _
 	_statTriCount = 0;
 	_statBatchCount = 0;
 	_statLightPassCount = 0;
+	_statCullingNodeTests = 0;
+	_statCullingQueries = 0;
+	_statInstancedBatchCount = 0;
+	_statDrawCallsSaved = 0;
+	_statParticleUploadBytes = 0;
+	_statParticleDrawCalls = 0;
+	_statShadowMapsRendered = 0;
+	_statShadowMapsSkipped = 0;
+	_statStreamedTextureUploadBytes = 0;
+	_statShaderHitchesAvoided = 0;
+	_statShaderCacheHits = 0;
+	_statShaderCacheMisses = 0;
 
 	_frameTime = 0;
 }
@@ -335,6 +391,10 @@ float StatManager::getStat( int param, bool reset )
 		value = _particleSimTimer.getElapsedTimeMS();
 		if( reset ) _particleSimTimer.reset();
 		return value;
+	case EngineStats::LightClusterTime:
+		value = _lightClusterTimer.getElapsedTimeMS();
+		if( reset ) _lightClusterTimer.reset();
+		return value;
 	case EngineStats::FwdLightsGPUTime:
 		value = _fwdLightsGPUTimer->getTimeMS();
 		if( reset ) _fwdLightsGPUTimer->reset();
@@ -359,6 +419,64 @@ float StatManager::getStat( int param, bool reset )
 		value = _computeGPUTimer->getTimeMS();
 		if ( reset ) _computeGPUTimer->reset();
 		return value;
+	case EngineStats::CullingNodeTests:
+		value = _statCullingQueries > 0 ? (float)_statCullingNodeTests / (float)_statCullingQueries : 0.0f;
+		if( reset ) { _statCullingNodeTests = 0; _statCullingQueries = 0; }
+		return value;
+	case EngineStats::AnimationMem:
+		return ( AnimationResource::getTotalMemSize() / 1024 ) / 1024.0f;
+	case EngineStats::InstancedBatchCount:
+		value = (float)_statInstancedBatchCount;
+		if( reset ) _statInstancedBatchCount = 0;
+		return value;
+	case EngineStats::DrawCallsSaved:
+		value = (float)_statDrawCallsSaved;
+		if( reset ) _statDrawCallsSaved = 0;
+		return value;
+	case EngineStats::ParticleUploadSize:
+		value = _statParticleUploadBytes / 1024.0f;
+		if( reset ) _statParticleUploadBytes = 0;
+		return value;
+	case EngineStats::ParticleDrawCalls:
+		value = (float)_statParticleDrawCalls;
+		if( reset ) _statParticleDrawCalls = 0;
+		return value;
+	case EngineStats::ShaderBindCount:
+		value = (float)Modules::renderer().getRenderDevice()->getShaderBindCount();
+		if( reset ) Modules::renderer().getRenderDevice()->resetShaderBindCount();
+		return value;
+	case EngineStats::GeometryBindCount:
+		value = (float)Modules::renderer().getRenderDevice()->getGeometryBindCount();
+		if( reset ) Modules::renderer().getRenderDevice()->resetGeometryBindCount();
+		return value;
+	case EngineStats::ShadowMapsRendered:
+		value = (float)_statShadowMapsRendered;
+		if( reset ) _statShadowMapsRendered = 0;
+		return value;
+	case EngineStats::ShadowMapsSkipped:
+		value = (float)_statShadowMapsSkipped;
+		if( reset ) _statShadowMapsSkipped = 0;
+		return value;
+	case EngineStats::StreamedTextureMem:
+		return ( TextureResource::getStreamedMemSize() / 1024 ) / 1024.0f;
+	case EngineStats::StreamedTextureUploadSize:
+		value = _statStreamedTextureUploadBytes / 1024.0f;
+		if( reset ) _statStreamedTextureUploadBytes = 0;
+		return value;
+	case EngineStats::ShaderHitchesAvoided:
+		value = (float)_statShaderHitchesAvoided;
+		if( reset ) _statShaderHitchesAvoided = 0;
+		return value;
+	case EngineStats::PendingShaderCombinations:
+		return (float)ShaderResource::getPendingCombinationCount();
+	case EngineStats::ShaderCacheHits:
+		value = (float)_statShaderCacheHits;
+		if( reset ) _statShaderCacheHits = 0;
+		return value;
+	case EngineStats::ShaderCacheMisses:
+		value = (float)_statShaderCacheMisses;
+		if( reset ) _statShaderCacheMisses = 0;
+		return value;
 	default:
 		Modules::setError( "Invalid param for h3dGetStat" );
 		return Math::NaN;
@@ -379,6 +497,43 @@ void StatManager::incStat( int param, float value )
 	case EngineStats::LightPassCount:
 		_statLightPassCount += ftoi_r( value );
 		break;
+	case EngineStats::CullingNodeTests:
+		// Each increment corresponds to one culling query
+		_statCullingNodeTests += ftoi_r( value );
+		++_statCullingQueries;
+		break;
+	case EngineStats::InstancedBatchCount:
+		_statInstancedBatchCount += ftoi_r( value );
+		break;
+	case EngineStats::DrawCallsSaved:
+		_statDrawCallsSaved += ftoi_r( value );
+		break;
+	case EngineStats::ParticleUploadSize:
+		// Incremented in bytes
+		_statParticleUploadBytes += ftoi_r( value );
+		break;
+	case EngineStats::ParticleDrawCalls:
+		_statParticleDrawCalls += ftoi_r( value );
+		break;
+	case EngineStats::ShadowMapsRendered:
+		_statShadowMapsRendered += ftoi_r( value );
+		break;
+	case EngineStats::ShadowMapsSkipped:
+		_statShadowMapsSkipped += ftoi_r( value );
+		break;
+	case EngineStats::StreamedTextureUploadSize:
+		// Incremented in bytes
+		_statStreamedTextureUploadBytes += ftoi_r( value );
+		break;
+	case EngineStats::ShaderHitchesAvoided:
+		_statShaderHitchesAvoided += ftoi_r( value );
+		break;
+	case EngineStats::ShaderCacheHits:
+		_statShaderCacheHits += ftoi_r( value );
+		break;
+	case EngineStats::ShaderCacheMisses:
+		_statShaderCacheMisses += ftoi_r( value );
+		break;
 	case EngineStats::FrameTime:
 		_frameTime += value;
 		break;
@@ -398,6 +553,8 @@ Timer *StatManager::getTimer( int param )
 		return &_geoUpdateTimer;
 	case EngineStats::ParticleSimTime:
 		return &_particleSimTimer;
+	case EngineStats::LightClusterTime:
+		return &_lightClusterTimer;
 	default:
 		return 0x0;
 	}
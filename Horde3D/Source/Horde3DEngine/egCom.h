@@ -45,7 +45,12 @@ struct EngineOptions
 		WireframeMode,
 		DebugViewMode,
 		DumpFailedShaders,
-		GatherTimeStats
+		GatherTimeStats,
+		WorkerThreadCount,
+		ShadowMapCacheSize,
+		EnableProfiler,
+		TextureStreamingBudget,
+		AsyncShaderCompilation
 	};
 };
 
@@ -63,6 +68,8 @@ public:
 	int   maxLogLevel;
 	int   maxAnisotropy;
 	int   shadowMapSize;
+	int   shadowMapCacheSize;
+	int   texStreamingBudget;  // In Mb, 0 disables streaming
 	int   sampleCount;
 	bool  texCompression;
 	bool  sRGBLinearization;
@@ -72,6 +79,7 @@ public:
 	bool  wireframeMode;
 	bool  debugViewMode;
 	bool  dumpFailedShaders;
+	bool  asyncShaderCompilation;
 	bool  gatherTimeStats;
 };
 
@@ -146,7 +154,24 @@ struct EngineStats
 		ParticleGPUTime,
 		TextureVMem,
 		GeometryVMem,
-		ComputeGPUTime
+		ComputeGPUTime,
+		CullingNodeTests,
+		AnimationMem,
+		InstancedBatchCount,
+		DrawCallsSaved,
+		ParticleUploadSize,
+		ParticleDrawCalls,
+		ShaderBindCount,
+		GeometryBindCount,
+		ShadowMapsRendered,
+		ShadowMapsSkipped,
+		LightClusterTime,
+		StreamedTextureMem,
+		StreamedTextureUploadSize,
+		ShaderHitchesAvoided,
+		PendingShaderCombinations,
+		ShaderCacheHits,
+		ShaderCacheMisses
 	};
 };
 
@@ -169,11 +194,24 @@ protected:
 	uint32    _statTriCount;
 	uint32    _statBatchCount;
 	uint32    _statLightPassCount;
+	uint32    _statCullingNodeTests;
+	uint32    _statCullingQueries;
+	uint32    _statInstancedBatchCount;
+	uint32    _statDrawCallsSaved;
+	uint32    _statParticleUploadBytes;
+	uint32    _statParticleDrawCalls;
+	uint32    _statShadowMapsRendered;
+	uint32    _statShadowMapsSkipped;
+	uint32    _statStreamedTextureUploadBytes;
+	uint32    _statShaderHitchesAvoided;
+	uint32    _statShaderCacheHits;
+	uint32    _statShaderCacheMisses;
 
 	Timer     _frameTimer;
 	Timer     _animTimer;
 	Timer     _geoUpdateTimer;
 	Timer     _particleSimTimer;
+	Timer     _lightClusterTimer;
 	float     _frameTime;
 
 	GPUTimer  *_fwdLightsGPUTimer;
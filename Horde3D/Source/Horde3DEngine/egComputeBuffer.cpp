@@ -146,6 +146,7 @@ bool ComputeBufferResource::load( const char *data, int size )
 		layout.offset = atoi( node1.getAttribute( "offset", "0" ) );
 		layout.size = atoi( node1.getAttribute( "size", "0" ) );
 		layout.vbSlot = 0;
+		layout.divisor = 0;
 
 		int curAttribSlot = atoi( node1.getAttribute( "attribNumber" ) );
 		if ( curAttribSlot >= 0 && curAttribSlot <= totalBindingsCount )
@@ -419,7 +420,7 @@ void ComputeBufferResource::setElemParamI( int elem, int elemIdx, int param, int
 		{
 			VertexLayoutAttrib params;
 			params.vbSlot = 0; // always zero because only one buffer can be specified at a time
-			params.offset = params.size = 0;
+			params.offset = params.size = params.divisor = 0;
 
 			switch ( param )
 			{
@@ -509,7 +510,7 @@ void ComputeBufferResource::setElemParamStr( int elem, int elemIdx, int param, c
 				{
 					VertexLayoutAttrib params;
 					params.vbSlot = 0; // always zero because only one buffer can be specified at a time
-					params.offset = params.size = 0;
+					params.offset = params.size = params.divisor = 0;
 
 					if ( _vlBindingsData.empty() || elemIdx == _vlBindingsData.size() )
 					{
@@ -42,69 +42,47 @@ ComputeNode::~ComputeNode()
 }
 
 
-SceneNodeTpl *ComputeNode::parsingFunc( map< string, string > &attribs )
+SceneNodeTpl *ComputeNode::parsingFunc( const SceneNodeAttribs &attribs )
 {
 	bool result = true;
 
-	map< string, string >::iterator itr;
     ComputeNodeTpl *computeTpl = new ComputeNodeTpl( "", 0x0, 0x0, 0, 0 );
+	string str;
 
-	itr = attribs.find( "computeBuffer" );
-	if ( itr != attribs.end() )
+	if ( attribs.getString( "computeBuffer", str ) )
 	{
-		uint32 res = Modules::resMan().addResource( ResourceTypes::ComputeBuffer, itr->second, 0, false );
+		uint32 res = Modules::resMan().addResource( ResourceTypes::ComputeBuffer, str, 0, false );
 		if ( res != 0 )
 			computeTpl->compBufRes = ( ComputeBufferResource * ) Modules::resMan().resolveResHandle( res );
 	}
 	else result = false;
 
-	itr = attribs.find( "material" );
-	if ( itr != attribs.end() )
+	if ( attribs.getString( "material", str ) )
 	{
-		uint32 res = Modules::resMan().addResource( ResourceTypes::Material, itr->second, 0, false );
+		uint32 res = Modules::resMan().addResource( ResourceTypes::Material, str, 0, false );
 		if ( res != 0 )
 			computeTpl->matRes = ( MaterialResource * ) Modules::resMan().resolveResHandle( res );
 	}
 	else result = false;
 
-	itr = attribs.find( "drawType" );
-	if ( itr != attribs.end() )
+	if ( attribs.getString( "drawType", str ) )
 	{
-		if ( _stricmp( itr->second.c_str(), "triangles" ) == 0 ) computeTpl->drawType = 0; // triangles
-		else if ( _stricmp( itr->second.c_str(), "lines" ) == 0 ) computeTpl->drawType = 1; // lines
-		else if ( _stricmp( itr->second.c_str(), "points" ) == 0 ) computeTpl->drawType = 2; // points
+		if ( _stricmp( str.c_str(), "triangles" ) == 0 ) computeTpl->drawType = 0; // triangles
+		else if ( _stricmp( str.c_str(), "lines" ) == 0 ) computeTpl->drawType = 1; // lines
+		else if ( _stricmp( str.c_str(), "points" ) == 0 ) computeTpl->drawType = 2; // points
 		else result = false;
 	}
 	else result = false;
 	
-	itr = attribs.find( "elementsCount" );
-	if ( itr != attribs.end() ) computeTpl->elementsCount = atoi( itr->second.c_str() );
-	else result = false;
+	if ( !attribs.getInt( "elementsCount", computeTpl->elementsCount ) ) result = false;
 	
 	// AABB
-	itr = attribs.find( "aabbMinX" );
-	if ( itr != attribs.end() ) computeTpl->aabbMin.x = ( float ) atof( itr->second.c_str() );
-	else result = false;
-
-	itr = attribs.find( "aabbMinY" );
-	if ( itr != attribs.end() ) computeTpl->aabbMin.y = ( float ) atof( itr->second.c_str() );
-	else result = false;
-
-	itr = attribs.find( "aabbMinZ" );
-	if ( itr != attribs.end() ) computeTpl->aabbMin.z = ( float ) atof( itr->second.c_str() );
-	else result = false;
-
-	itr = attribs.find( "aabbMaxX" );
-	if ( itr != attribs.end() ) computeTpl->aabbMax.x = ( float ) atof( itr->second.c_str() );
-	else result = false;
-
-	itr = attribs.find( "aabbMaxY" );
-	if ( itr != attribs.end() ) computeTpl->aabbMax.y = ( float ) atof( itr->second.c_str() );
-	else result = false;
-
-	itr = attribs.find( "aabbMaxZ" );
-	if ( itr != attribs.end() ) computeTpl->aabbMax.z = ( float ) atof( itr->second.c_str() );
-	else result = false;
+	if ( !attribs.getFloat( "aabbMinX", computeTpl->aabbMin.x ) ) result = false;
+	if ( !attribs.getFloat( "aabbMinY", computeTpl->aabbMin.y ) ) result = false;
+	if ( !attribs.getFloat( "aabbMinZ", computeTpl->aabbMin.z ) ) result = false;
+	if ( !attribs.getFloat( "aabbMaxX", computeTpl->aabbMax.x ) ) result = false;
+	if ( !attribs.getFloat( "aabbMaxY", computeTpl->aabbMax.y ) ) result = false;
+	if ( !attribs.getFloat( "aabbMaxZ", computeTpl->aabbMax.z ) ) result = false;
 
 	if ( !result )
 	{
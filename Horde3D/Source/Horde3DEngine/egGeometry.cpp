@@ -61,6 +61,12 @@ GeometryResource::~GeometryResource()
 
 Resource *GeometryResource::clone()
 {
+	if( _vertCount > 0 && (_indexData == 0x0 || _vertTanData == 0x0 || _vertStaticData == 0x0) )
+	{
+		Modules::log().writeError( "Geometry resource '%s' has no CPU copy of its data and cannot be cloned", _name.c_str() );
+		return 0x0;
+	}
+	
 	GeometryResource *res = new GeometryResource( "", _flags );
 
 	*res = *this;
@@ -112,6 +118,7 @@ void GeometryResource::initDefault()
 	_tanVBuf = defVertBuffer;
 	_staticVBuf = defVertBuffer;
 	_geoObj = 0;
+	_instGeoObj = 0;
 	_minMorphIndex = 0; _maxMorphIndex = 0;
 	_skelAABB.min = Vec3f( 0, 0, 0 );
 	_skelAABB.max = Vec3f( 0, 0, 0 );
@@ -124,6 +131,8 @@ void GeometryResource::release()
 
 	if ( _geoObj != 0 )
 		rdi->destroyGeometry( _geoObj, false );
+	if( _instGeoObj != 0 )
+		rdi->destroyGeometry( _instGeoObj, false );
 
 	if( _posVBuf != 0 && _posVBuf != defVertBuffer )
 		rdi->destroyBuffer( _posVBuf );
@@ -142,6 +151,7 @@ void GeometryResource::release()
 	
 	_joints.clear();
 	_morphTargets.clear();
+	_vertJointIndices.clear();
 }
 
 
@@ -190,13 +200,8 @@ bool GeometryResource::load( const char *data, int size )
 	_joints.resize( count );
 	for( uint32 i = 0; i < count; ++i )
 	{
-		Joint &joint = _joints[i];
-		
 		// Inverse bind matrix
-		for( uint32 j = 0; j < 16; ++j )
-		{
-			pData = elemcpy_le(&joint.invBindMat.x[j], (float*)(pData), 1);
-		}
+		pData = elemcpy_le(_joints[i].invBindMat.x, (float*)(pData), 16);
 	}
 	
 	// Load vertex stream data
@@ -233,12 +238,7 @@ bool GeometryResource::load( const char *data, int size )
 				errormsg = "Invalid position base stream";
 				break;
 			}
-			for( uint32 j = 0; j < streamSize; ++j )
-			{
-				pData = elemcpy_le(&_vertPosData[j].x, (float*)(pData), 1);
-				pData = elemcpy_le(&_vertPosData[j].y, (float*)(pData), 1);
-				pData = elemcpy_le(&_vertPosData[j].z, (float*)(pData), 1);
-			}
+			pData = elemcpy_le(&_vertPosData[0].x, (float*)(pData), streamSize * 3);
 			break;
 		case 1:		// Normal
 			if( streamElemSize != 6 )
@@ -355,25 +355,10 @@ bool GeometryResource::load( const char *data, int size )
 
 	_indexCount = count;
     _16BitIndices = _vertCount <= 65536;
-	_indexData = new char[count * (_16BitIndices ? 2 : 4)];
-	if( _16BitIndices )
-	{
-		uint32 index;
-		uint16 *pIndexData = (uint16 *)_indexData;
-		for( uint32 i = 0; i < count; ++i )
-		{
-			pData = elemcpy_le(&index, (uint32*)(pData), 1);
-			pIndexData[i] = (uint16)index;
-		}
-	}
-	else
-	{
-		uint32 *pIndexData = (uint32 *)_indexData;
-		for( uint32 i = 0; i < count; ++i )
-		{
-			pData = elemcpy_le(&pIndexData[i], (uint32*)(pData), 1);
-		}
-	}
+	
+	// Conversion is deferred until it is known whether a CPU copy is required
+	const char *fileIndexData = pData;
+	pData += count * sizeof( uint32 );
 
 	// Load morph targets
 	uint32 numTargets;
@@ -476,12 +461,42 @@ bool GeometryResource::load( const char *data, int size )
 		if( pos.z > _skelAABB.max.z ) _skelAABB.max.z = pos.z;
 	}
 
+	// Skinned and morphed geometry may be deformed on the CPU and always keeps its data
+	bool keepCPUData = !(_flags & ResourceFlags::GeoNoCPUCopy) || _joints.size() > 1 || !_morphTargets.empty();
+	
 	// Add default joint if necessary
 	if( _joints.empty() )
 	{
 		_joints.push_back( Joint() );
 	}
 
+	// 32 bit indices can be uploaded straight from the file data if no copy is kept
+	const char *indexData = 0x0;
+#if defined( PLATFORM_LITTLE_ENDIAN )
+	if( !_16BitIndices && !keepCPUData ) indexData = fileIndexData;
+#endif
+	if( indexData == 0x0 )
+	{
+		_indexData = new char[_indexCount * (_16BitIndices ? 2 : 4)];
+		if( _16BitIndices )
+		{
+			uint32 index;
+			uint16 *pIndexData = (uint16 *)_indexData;
+			for( uint32 i = 0; i < _indexCount; ++i )
+			{
+				fileIndexData = elemcpy_le(&index, (uint32*)(fileIndexData), 1);
+				pIndexData[i] = (uint16)index;
+			}
+		}
+		else
+		{
+			elemcpy_le((uint32 *)_indexData, (uint32*)(fileIndexData), _indexCount);
+		}
+		indexData = _indexData;
+	}
+
+	if( keepCPUData ) updateJointIndices();
+
 	// Upload data
 	if( _vertCount > 0 && _indexCount > 0 )
 	{
@@ -490,7 +505,7 @@ bool GeometryResource::load( const char *data, int size )
 		_geoObj = rdi->beginCreatingGeometry( Modules::renderer().getDefaultVertexLayout( DefaultVertexLayouts::Model ) );
 
 		// Upload indices
-		_indexBuf = rdi->createIndexBuffer( _indexCount * (_16BitIndices ? 2 : 4), _indexData );
+		_indexBuf = rdi->createIndexBuffer( _indexCount * (_16BitIndices ? 2 : 4), indexData );
 		
 		// Upload vertices
 		_posVBuf = rdi->createVertexBuffer(_vertCount * sizeof( Vec3f ), _vertPosData );
@@ -506,6 +521,14 @@ bool GeometryResource::load( const char *data, int size )
 
 		rdi->finishCreatingGeometry( _geoObj );
 	}
+
+	if( !keepCPUData )
+	{
+		// Positions are still required for the bounding boxes of meshes
+		delete[] _indexData; _indexData = 0x0;
+		delete[] _vertTanData; _vertTanData = 0x0;
+		delete[] _vertStaticData; _vertStaticData = 0x0;
+	}
 	
 	return true;
 }
@@ -547,25 +570,34 @@ void *GeometryResource::mapStream( int elem, int elemIdx, int stream, bool read,
 {
 	if( (read || write) && mappedWriteStream == -1 )
 	{
+		void *streamData = 0x0;
+		
 		switch( elem )
 		{
 		case GeometryResData::GeometryElem:
 			switch( stream )
 			{
 			case GeometryResData::GeoIndexStream:
-				if( write ) mappedWriteStream = GeometryResData::GeoIndexStream;
-				return _indexData;
+				streamData = _indexData;
+				break;
 			case GeometryResData::GeoVertPosStream:
-				if( write ) mappedWriteStream = GeometryResData::GeoVertPosStream;
-				return _vertPosData != 0x0 ? _vertPosData : 0x0;
+				streamData = _vertPosData;
+				break;
 			case GeometryResData::GeoVertTanStream:
-				if( write ) mappedWriteStream = GeometryResData::GeoVertTanStream;
-				return _vertTanData != 0x0 ? _vertTanData : 0x0;
+				streamData = _vertTanData;
+				break;
 			case GeometryResData::GeoVertStaticStream:
-				if( write ) mappedWriteStream = GeometryResData::GeoVertStaticStream;
-				return _vertStaticData != 0x0 ? _vertStaticData : 0x0;
+				streamData = _vertStaticData;
+				break;
 			}
 		}
+
+		// Streams that were dropped after uploading (GeoNoCPUCopy) cannot be mapped
+		if( streamData != 0x0 )
+		{
+			if( write ) mappedWriteStream = stream;
+			return streamData;
+		}
 	}
 
 	return Resource::mapStream( elem, elemIdx, stream, read, write );
@@ -594,7 +626,10 @@ void GeometryResource::unmapStream()
 			break;
 		case GeometryResData::GeoVertStaticStream:
 			if( _vertStaticData != 0x0 )
+			{
 				rdi->updateBufferData( _geoObj, _staticVBuf, 0, _vertCount * sizeof( VertexDataStatic ), _vertStaticData );
+				updateJointIndices();
+			}
 			break;
 		}
 
@@ -603,6 +638,19 @@ void GeometryResource::unmapStream()
 }
 
 
+void GeometryResource::updateJointIndices()
+{
+	// Joint indices are stored as floats for the GPU; keep integer copy so that CPU skinning
+	// does not need to convert them for every vertex
+	_vertJointIndices.resize( _vertStaticData != 0x0 ? _vertCount * 4 : 0 );
+	
+	for( uint32 i = 0, s = (uint32)_vertJointIndices.size(); i < s; ++i )
+	{
+		_vertJointIndices[i] = (uint16)ftoi_r( _vertStaticData[i / 4].jointVec[i % 4] );
+	}
+}
+
+
 void GeometryResource::updateDynamicVertData()
 {
 	// Upload dynamic stream data
@@ -616,4 +664,28 @@ void GeometryResource::updateDynamicVertData()
 	}
 }
 
+
+uint32 GeometryResource::getInstancedGeometryInfo()
+{
+	if( _instGeoObj == 0 && _geoObj != 0 )
+	{
+		// Same streams as the regular geometry, the world transformations come from the renderer's
+		// mesh instance buffer
+		RenderDeviceInterface *rdi = Modules::renderer().getRenderDevice();
+		
+		_instGeoObj = rdi->beginCreatingGeometry( Modules::renderer().getDefaultVertexLayout( DefaultVertexLayouts::ModelInstanced ) );
+
+		rdi->setGeomVertexParams( _instGeoObj, _posVBuf, 0, 0, sizeof( Vec3f ) );
+		rdi->setGeomVertexParams( _instGeoObj, _tanVBuf, 1, 0, sizeof( VertexDataTan ) );
+		rdi->setGeomVertexParams( _instGeoObj, _tanVBuf, 2, sizeof( Vec3f ), sizeof( VertexDataTan ) );
+		rdi->setGeomVertexParams( _instGeoObj, _staticVBuf, 3, 0, sizeof( VertexDataStatic ) );
+		rdi->setGeomVertexParams( _instGeoObj, Modules::renderer().getMeshInstanceBuf(), 4, 0, sizeof( MeshInstanceData ) );
+		rdi->setGeomIndexParams( _instGeoObj, _indexBuf, _16BitIndices ? IDXFMT_16 : IDXFMT_32 );
+
+		rdi->finishCreatingGeometry( _instGeoObj );
+	}
+
+	return _instGeoObj;
+}
+
 }  // namespace
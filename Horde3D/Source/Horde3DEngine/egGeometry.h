@@ -108,7 +108,9 @@ public:
 	Vec3f *getVertPosData() const { return _vertPosData; }
 	VertexDataTan *getVertTanData() const { return _vertTanData; }
 	VertexDataStatic *getVertStaticData() const { return _vertStaticData; }
+	const uint16 *getVertJointIndices() const { return _vertJointIndices.empty() ? 0x0 : &_vertJointIndices[0]; }
 	uint32 getGeometryInfo() const { return _geoObj; }
+	uint32 getInstancedGeometryInfo();
 	uint32 getPosVBuf() const { return _posVBuf; }
 	uint32 getTanVBuf() const { return _tanVBuf; }
 	uint32 getStaticVBuf() const { return _staticVBuf; }
@@ -120,12 +122,14 @@ public:
 
 private:
 	bool raiseError( const std::string &msg );
+	void updateJointIndices();
 
 private:
 	static int                  mappedWriteStream;
 	
 	uint32                      _indexBuf, _posVBuf, _tanVBuf, _staticVBuf;
 	uint32						_geoObj;
+	uint32                      _instGeoObj;  // Created on first use, see getInstancedGeometryInfo
 
 	uint32                      _indexCount, _vertCount;
 	bool                        _16BitIndices;
@@ -133,6 +137,7 @@ private:
 	Vec3f                       *_vertPosData;
 	VertexDataTan               *_vertTanData;
 	VertexDataStatic            *_vertStaticData;
+	std::vector< uint16 >       _vertJointIndices;  // Integer copy of joint stream for software skinning
 	
 	std::vector< Joint >        _joints;
 	BoundingBox                 _skelAABB;
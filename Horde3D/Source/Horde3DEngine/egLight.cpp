@@ -29,6 +29,8 @@ LightNode::LightNode( const LightNodeTpl &lightTpl ) :
 	_materialRes = lightTpl.matRes;
 	_lightingContext = lightTpl.lightingContext;
 	_shadowContext = lightTpl.shadowContext;
+	_lightingContextId = ShaderResource::getContextId( _lightingContext );
+	_shadowContextId = ShaderResource::getContextId( _shadowContext );
 	_radius = lightTpl.radius; _fov = lightTpl.fov;
 	_diffuseCol = Vec3f( lightTpl.col_R, lightTpl.col_G, lightTpl.col_B );
 	_diffuseColMult = lightTpl.colMult;
@@ -42,6 +44,8 @@ LightNode::~LightNode()
 {
 	RenderDeviceInterface *rdi = Modules::renderer().getRenderDevice();
 
+	Modules::renderer().releaseShadowMapCache( this );
+
 	for( uint32 i = 0; i < _occQueries.size(); ++i )
 	{
 		if( _occQueries[i] != 0 )
@@ -50,44 +54,31 @@ LightNode::~LightNode()
 }
 
 
-SceneNodeTpl *LightNode::parsingFunc( map< string, string > &attribs )
+SceneNodeTpl *LightNode::parsingFunc( const SceneNodeAttribs &attribs )
 {
 	bool result = true;
 	
-	map< string, string >::iterator itr;
 	LightNodeTpl *lightTpl = new LightNodeTpl( "", 0x0, "", "" );
+	string str;
+	int value;
 
-	itr = attribs.find( "material" );
-	if( itr != attribs.end() )
+	if( attribs.getString( "material", str ) )
 	{
-		uint32 res = Modules::resMan().addResource( ResourceTypes::Material, itr->second, 0, false );
+		uint32 res = Modules::resMan().addResource( ResourceTypes::Material, str, 0, false );
 		if( res != 0 )
 			lightTpl->matRes = (MaterialResource *)Modules::resMan().resolveResHandle( res );
 	}
-	itr = attribs.find( "lightingContext" );
-	if( itr != attribs.end() ) lightTpl->lightingContext = itr->second;
-	else result = false;
-	itr = attribs.find( "shadowContext" );
-	if( itr != attribs.end() ) lightTpl->shadowContext = itr->second;
-	else result = false;
-	itr = attribs.find( "radius" );
-	if( itr != attribs.end() ) lightTpl->radius = (float)atof( itr->second.c_str() );
-	itr = attribs.find( "fov" );
-	if( itr != attribs.end() ) lightTpl->fov = (float)atof( itr->second.c_str() );
-	itr = attribs.find( "col_R" );
-	if( itr != attribs.end() ) lightTpl->col_R = (float)atof( itr->second.c_str() );
-	itr = attribs.find( "col_G" );
-	if( itr != attribs.end() ) lightTpl->col_G = (float)atof( itr->second.c_str() );
-	itr = attribs.find( "col_B" );
-	if( itr != attribs.end() ) lightTpl->col_B = (float)atof( itr->second.c_str() );
-	itr = attribs.find( "colMult" );
-	if( itr != attribs.end() ) lightTpl->colMult = (float)atof( itr->second.c_str() );
-	itr = attribs.find( "shadowMapCount" );
-	if( itr != attribs.end() ) lightTpl->shadowMapCount = atoi( itr->second.c_str() );
-	itr = attribs.find( "shadowSplitLambda" );
-	if( itr != attribs.end() ) lightTpl->shadowSplitLambda = (float)atof( itr->second.c_str() );
-	itr = attribs.find( "shadowMapBias" );
-	if( itr != attribs.end() ) lightTpl->shadowMapBias = (float)atof( itr->second.c_str() );
+	if( !attribs.getString( "lightingContext", lightTpl->lightingContext ) ) result = false;
+	if( !attribs.getString( "shadowContext", lightTpl->shadowContext ) ) result = false;
+	attribs.getFloat( "radius", lightTpl->radius );
+	attribs.getFloat( "fov", lightTpl->fov );
+	attribs.getFloat( "col_R", lightTpl->col_R );
+	attribs.getFloat( "col_G", lightTpl->col_G );
+	attribs.getFloat( "col_B", lightTpl->col_B );
+	attribs.getFloat( "colMult", lightTpl->colMult );
+	if( attribs.getInt( "shadowMapCount", value ) ) lightTpl->shadowMapCount = value;
+	attribs.getFloat( "shadowSplitLambda", lightTpl->shadowSplitLambda );
+	attribs.getFloat( "shadowMapBias", lightTpl->shadowMapBias );
 	
 	if( !result )
 	{
@@ -223,9 +214,11 @@ void LightNode::setParamStr( int param, const char *value )
 	{
 	case LightNodeParams::LightingContextStr:
 		_lightingContext = value;
+		_lightingContextId = ShaderResource::getContextId( _lightingContext );
 		return;
 	case LightNodeParams::ShadowContextStr:
 		_shadowContext = value;
+		_shadowContextId = ShaderResource::getContextId( _shadowContext );
 		return;
 	}
 
@@ -68,7 +68,7 @@ struct LightNodeTpl : public SceneNodeTpl
 class LightNode : public SceneNode
 {
 public:
-	static SceneNodeTpl *parsingFunc( std::map<std::string, std::string > &attribs );
+	static SceneNodeTpl *parsingFunc( const SceneNodeAttribs &attribs );
 	static SceneNode *factoryFunc( const SceneNodeTpl &nodeTpl );
 	
 	int getParamI( int param ) const;
@@ -96,6 +96,7 @@ private:
 
 	PMaterialResource      _materialRes;
 	std::string            _lightingContext, _shadowContext;
+	uint32                 _lightingContextId, _shadowContextId;
 	float                  _radius, _fov;
 	Vec3f                  _diffuseCol;
 	float                  _diffuseColMult;
@@ -0,0 +1,280 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2016 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+#include "egLightClusters.h"
+
+#include "utDebug.h"
+#include <algorithm>
+
+#if defined( H3D_SIMD_SSE2 )
+#	include <emmintrin.h>
+#elif defined( H3D_SIMD_NEON )
+#	include <arm_neon.h>
+#endif
+
+
+namespace Horde3D {
+
+using namespace std;
+
+
+// *************************************************************************************************
+// LightClusterGrid
+// *************************************************************************************************
+
+// Bit i is set if distSq[i] <= maxDistSq
+static inline uint32 testClusters( const float *distSq, float maxDistSq )
+{
+#if defined( H3D_SIMD_SSE2 )
+	return (uint32)_mm_movemask_ps( _mm_cmple_ps( _mm_loadu_ps( distSq ), _mm_set1_ps( maxDistSq ) ) );
+#elif defined( H3D_SIMD_NEON )
+	static const uint32 bits[4] = { 1, 2, 4, 8 };
+	uint32x4_t mask = vandq_u32( vcleq_f32( vld1q_f32( distSq ), vdupq_n_f32( maxDistSq ) ), vld1q_u32( bits ) );
+	uint32x2_t sum = vpadd_u32( vget_low_u32( mask ), vget_high_u32( mask ) );
+	return vget_lane_u32( vpadd_u32( sum, sum ), 0 );
+#else
+	return (distSq[0] <= maxDistSq ? 1u : 0u) | (distSq[1] <= maxDistSq ? 2u : 0u) |
+	       (distSq[2] <= maxDistSq ? 4u : 0u) | (distSq[3] <= maxDistSq ? 8u : 0u);
+#endif
+}
+
+
+LightClusterGrid::LightClusterGrid() :
+	_tilesX( 0 ), _tilesY( 0 ), _slices( 0 ), _left( 0 ), _right( 0 ), _bottom( 0 ), _top( 0 ),
+	_near( 0 ), _far( 0 ), _orthographic( false ), _sliceScale( 0 ), _sliceBias( 0 ), _numPairs( 0 ),
+	_lightCount( 0 )
+{
+}
+
+
+void LightClusterGrid::setup( uint32 tilesX, uint32 tilesY, uint32 slices, float left, float right,
+                              float bottom, float top, float nearPlane, float farPlane, bool orthographic )
+{
+	ASSERT( tilesX > 0 && tilesY > 0 && slices > 0 );
+
+	// Cluster bounds only depend on the projection
+	if( tilesX == _tilesX && tilesY == _tilesY && slices == _slices && left == _left && right == _right &&
+	    bottom == _bottom && top == _top && nearPlane == _near && farPlane == _far &&
+	    orthographic == _orthographic )
+	{
+		return;
+	}
+
+	_tilesX = tilesX; _tilesY = tilesY; _slices = slices;
+	_left = left; _right = right; _bottom = bottom; _top = top;
+	_near = nearPlane; _far = farPlane;
+	_orthographic = orthographic;
+
+	// Slice boundaries
+	_sliceDepths.resize( slices + 1 );
+	if( orthographic )
+	{
+		_sliceScale = slices / (farPlane - nearPlane);
+		_sliceBias = -nearPlane * _sliceScale;
+		for( uint32 i = 0; i <= slices; ++i )
+			_sliceDepths[i] = nearPlane + (farPlane - nearPlane) * i / slices;
+	}
+	else
+	{
+		_sliceScale = slices / logf( farPlane / nearPlane );
+		_sliceBias = -logf( nearPlane ) * _sliceScale;
+		for( uint32 i = 0; i <= slices; ++i )
+			_sliceDepths[i] = nearPlane * powf( farPlane / nearPlane, (float)i / slices );
+	}
+
+	// Tile bounds; for perspective frustums the tile corners are given on the near plane and
+	// scale with the depth
+	_tileMinX.resize( slices * tilesX ); _tileMaxX.resize( slices * tilesX );
+	_tileMinY.resize( slices * tilesY ); _tileMaxY.resize( slices * tilesY );
+	// Rows are tested in groups of four clusters, the padding never intersects a light
+	_distSqX.assign( (tilesX + 3) & ~3u, Math::MaxFloat ); _distSqY.resize( tilesY );
+
+	for( uint32 z = 0; z < slices; ++z )
+	{
+		float s0 = orthographic ? 1.0f : _sliceDepths[z] / nearPlane;
+		float s1 = orthographic ? 1.0f : _sliceDepths[z + 1] / nearPlane;
+		
+		for( uint32 x = 0; x < tilesX; ++x )
+		{
+			float x0 = left + (right - left) * x / tilesX;
+			float x1 = left + (right - left) * (x + 1) / tilesX;
+			_tileMinX[z * tilesX + x] = minf( x0 * s0, x0 * s1 );
+			_tileMaxX[z * tilesX + x] = maxf( x1 * s0, x1 * s1 );
+		}
+		
+		for( uint32 y = 0; y < tilesY; ++y )
+		{
+			float y0 = bottom + (top - bottom) * y / tilesY;
+			float y1 = bottom + (top - bottom) * (y + 1) / tilesY;
+			_tileMinY[z * tilesY + y] = minf( y0 * s0, y0 * s1 );
+			_tileMaxY[z * tilesY + y] = maxf( y1 * s0, y1 * s1 );
+		}
+	}
+}
+
+
+void LightClusterGrid::beginBinning()
+{
+	_numPairs = 0;
+	_lightCount = 0;
+
+	// Lights are counted per cluster while binning; the padding of the last row is counted
+	// beyond the end
+	_offsets.assign( getClusterCount() + 4, 0 );
+}
+
+
+uint32 *LightClusterGrid::reservePairs( uint32 count )
+{
+	// Pairs are written unconditionally and only counted if the test passed, so the buffer
+	// needs room for all tested clusters
+	if( (_numPairs + count) * 2 > (uint32)_pairs.size() )
+		_pairs.resize( std::max( (size_t)(_numPairs + count) * 2, _pairs.size() * 2 ) );
+	
+	return &_pairs[_numPairs * 2];
+}
+
+
+void LightClusterGrid::addLight( const Vec3f &viewPos, float radius, uint32 lightIndex )
+{
+	++_lightCount;
+
+	// Depth range of the light volume
+	float depthMin = maxf( -viewPos.z - radius, _near );
+	float depthMax = minf( -viewPos.z + radius, _far );
+	if( depthMin > depthMax ) return;
+
+	float sliceMin = (_orthographic ? depthMin : logf( depthMin )) * _sliceScale + _sliceBias;
+	float sliceMax = (_orthographic ? depthMax : logf( depthMax )) * _sliceScale + _sliceBias;
+	uint32 z0 = (uint32)clamp( sliceMin, 0.0f, (float)(_slices - 1) );
+	uint32 z1 = (uint32)clamp( sliceMax, 0.0f, (float)(_slices - 1) );
+
+	// Tile range covered by the projected bounding box of the light volume
+	float xMin = viewPos.x - radius, xMax = viewPos.x + radius;
+	float yMin = viewPos.y - radius, yMax = viewPos.y + radius;
+	if( !_orthographic )
+	{
+		xMin = minf( xMin / depthMin, xMin / depthMax ) * _near;
+		xMax = maxf( xMax / depthMin, xMax / depthMax ) * _near;
+		yMin = minf( yMin / depthMin, yMin / depthMax ) * _near;
+		yMax = maxf( yMax / depthMin, yMax / depthMax ) * _near;
+	}
+
+	float u0 = (xMin - _left) / (_right - _left), u1 = (xMax - _left) / (_right - _left);
+	float v0 = (yMin - _bottom) / (_top - _bottom), v1 = (yMax - _bottom) / (_top - _bottom);
+	if( u1 < 0 || u0 > 1 || v1 < 0 || v0 > 1 ) return;
+
+	uint32 x0 = (uint32)clamp( u0 * _tilesX, 0.0f, (float)(_tilesX - 1) );
+	uint32 x1 = (uint32)clamp( u1 * _tilesX, 0.0f, (float)(_tilesX - 1) );
+	uint32 y0 = (uint32)clamp( v0 * _tilesY, 0.0f, (float)(_tilesY - 1) );
+	uint32 y1 = (uint32)clamp( v1 * _tilesY, 0.0f, (float)(_tilesY - 1) );
+
+	// Exact sphere test for the clusters in range; the squared distance between the sphere
+	// center and a cluster is the sum of the squared distances along the three axes
+	float radiusSq = radius * radius;
+	uint32 numX = x1 - x0 + 1, numY = y1 - y0 + 1;
+	uint32 numXPadded = (numX + 3) & ~3u;
+	float *distSqX = &_distSqX[0], *distSqY = &_distSqY[0];
+	
+	for( uint32 z = z0; z <= z1; ++z )
+	{
+		float dz = maxf( maxf( -_sliceDepths[z + 1] - viewPos.z, viewPos.z + _sliceDepths[z] ), 0 );
+		float remSq = radiusSq - dz * dz;
+		if( remSq < 0 ) continue;
+
+		calcDistancesSq( &_tileMinX[z * _tilesX + x0], &_tileMaxX[z * _tilesX + x0], numX, viewPos.x, distSqX );
+		calcDistancesSq( &_tileMinY[z * _tilesY + y0], &_tileMaxY[z * _tilesY + y0], numY, viewPos.y, distSqY );
+		for( uint32 x = numX; x < numXPadded; ++x ) distSqX[x] = Math::MaxFloat;
+		
+		for( uint32 y = 0; y < numY; ++y )
+		{
+			float rowRemSq = remSq - distSqY[y];
+			if( rowRemSq < 0 ) continue;
+
+			uint32 rowStart = (z * _tilesY + y0 + y) * _tilesX + x0;
+			uint32 *counts = &_offsets[rowStart + 1];
+			uint32 *pairs = reservePairs( numXPadded ), *pair = pairs;
+			
+			for( uint32 x = 0; x < numXPadded; x += 4 )
+			{
+				// Test four clusters at once and append the intersected ones without branches
+				uint32 hits = testClusters( &distSqX[x], rowRemSq );
+				for( uint32 i = 0; i < 4; ++i )
+				{
+					uint32 hit = (hits >> i) & 1;
+					pair[0] = rowStart + x + i;
+					pair[1] = lightIndex;
+					pair += hit * 2;
+					counts[x + i] += hit;
+				}
+			}
+			_numPairs += (uint32)(pair - pairs) / 2;
+		}
+	}
+}
+
+
+void LightClusterGrid::finishBinning()
+{
+	uint32 numClusters = getClusterCount();
+	uint32 numPairs = _numPairs;
+
+	// Convert the light counts of the clusters to offsets
+	for( uint32 i = 0; i < numClusters; ++i )
+		_offsets[i + 1] += _offsets[i];
+
+	// Scatter light indices; lights stay in the order they were added
+	_lightIndices.resize( numPairs );
+	for( uint32 i = 0; i < numPairs; ++i )
+		_lightIndices[_offsets[_pairs[i * 2]]++] = _pairs[i * 2 + 1];
+
+	// Scattering advanced each offset to the start of the next cluster
+	for( uint32 i = numClusters; i > 0; --i )
+		_offsets[i] = _offsets[i - 1];
+	_offsets[0] = 0;
+	_offsets.resize( numClusters + 1 );
+}
+
+
+void LightClusterGrid::calcDistancesSq( const float *mins, const float *maxs, uint32 count, float center,
+                                        float *distSq )
+{
+	// Squared distances between a coordinate and a run of intervals
+	uint32 i = 0;
+
+#if defined( H3D_SIMD_SSE2 )
+	__m128 c = _mm_set1_ps( center ), zero = _mm_setzero_ps();
+	for( ; i + 4 <= count; i += 4 )
+	{
+		__m128 d = _mm_max_ps( _mm_max_ps( _mm_sub_ps( _mm_loadu_ps( &mins[i] ), c ),
+		                                   _mm_sub_ps( c, _mm_loadu_ps( &maxs[i] ) ) ), zero );
+		_mm_storeu_ps( &distSq[i], _mm_mul_ps( d, d ) );
+	}
+#elif defined( H3D_SIMD_NEON )
+	float32x4_t c = vdupq_n_f32( center ), zero = vdupq_n_f32( 0 );
+	for( ; i + 4 <= count; i += 4 )
+	{
+		float32x4_t d = vmaxq_f32( vmaxq_f32( vsubq_f32( vld1q_f32( &mins[i] ), c ),
+		                                      vsubq_f32( c, vld1q_f32( &maxs[i] ) ) ), zero );
+		vst1q_f32( &distSq[i], vmulq_f32( d, d ) );
+	}
+#endif
+
+	// Scalar path for remaining intervals
+	for( ; i < count; ++i )
+	{
+		float d = maxf( maxf( mins[i] - center, center - maxs[i] ), 0 );
+		distSq[i] = d * d;
+	}
+}
+
+}  // namespace
@@ -0,0 +1,80 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2016 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+#ifndef _egLightClusters_H_
+#define _egLightClusters_H_
+
+#include "egPrerequisites.h"
+#include "utMath.h"
+#include <vector>
+
+
+namespace Horde3D {
+
+// =================================================================================================
+// Light Cluster Grid
+// =================================================================================================
+
+// Divides the view frustum into tilesX * tilesY screen tiles and into depth slices and assigns
+// light volumes to the resulting clusters; the slices are spaced exponentially for perspective
+// frustums and linearly for orthographic ones
+class LightClusterGrid
+{
+public:
+	LightClusterGrid();
+
+	void setup( uint32 tilesX, uint32 tilesY, uint32 slices, float left, float right, float bottom,
+	            float top, float nearPlane, float farPlane, bool orthographic );
+	void beginBinning();
+	void addLight( const Vec3f &viewPos, float radius, uint32 lightIndex );
+	void finishBinning();
+
+	uint32 getTilesX() const { return _tilesX; }
+	uint32 getTilesY() const { return _tilesY; }
+	uint32 getSlices() const { return _slices; }
+	uint32 getClusterCount() const { return _tilesX * _tilesY * _slices; }
+	bool isOrthographic() const { return _orthographic; }
+	// Slice index is floor( depth * scale + bias ), with depth being the log of the view depth
+	// for perspective frustums
+	float getSliceScale() const { return _sliceScale; }
+	float getSliceBias() const { return _sliceBias; }
+
+	// Lights of cluster i are lightIndices[offsets[i]] to lightIndices[offsets[i + 1] - 1]
+	const std::vector< uint32 > &getOffsets() const { return _offsets; }
+	const std::vector< uint32 > &getLightIndices() const { return _lightIndices; }
+	uint32 getLightCount() const { return _lightCount; }
+
+private:
+	static void calcDistancesSq( const float *mins, const float *maxs, uint32 count, float center, float *distSq );
+	uint32 *reservePairs( uint32 count );
+
+private:
+	uint32                 _tilesX, _tilesY, _slices;
+	float                  _left, _right, _bottom, _top, _near, _far;
+	bool                   _orthographic;
+	float                  _sliceScale, _sliceBias;
+
+	// View space bounds of the clusters; the bounds along each axis only depend on the slice
+	// and the tile coordinate along that axis
+	std::vector< float >   _tileMinX, _tileMaxX;  // Per slice and column
+	std::vector< float >   _tileMinY, _tileMaxY;  // Per slice and row
+	std::vector< float >   _sliceDepths;
+	std::vector< float >   _distSqX, _distSqY;  // Scratch buffers for addLight
+	std::vector< uint32 >  _pairs;  // Cluster and light index of each intersection
+	uint32                 _numPairs;  // Used part of _pairs; the buffer is only grown
+	std::vector< uint32 >  _offsets;  // Light counts while binning
+	std::vector< uint32 >  _lightIndices;
+	uint32                 _lightCount;
+};
+
+}
+#endif // _egLightClusters_H_
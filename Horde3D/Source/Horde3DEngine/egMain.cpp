@@ -21,6 +21,7 @@
 #include "egTexture.h"
 #include "egComputeBuffer.h"
 #include "egComputeNode.h"
+#include "egProfiler.h"
 #include <cstdlib>
 #include <cstring>
 #include <string>
@@ -196,6 +197,12 @@ DLLEXP float h3dGetStat( EngineStats::List param, bool reset )
 }
 
 
+DLLEXP const char *h3dGetProfilerTrace()
+{
+	return Modules::profiler().getTrace().c_str();
+}
+
+
 DLLEXP float h3dGetDeviceCapabilities( RenderDeviceCapabilities::List param )
 {
 	return getRenderDeviceCapabilities( param );
@@ -251,7 +258,7 @@ DLLEXP ResHandle h3dGetNextResource( int type, ResHandle start )
 
 DLLEXP ResHandle h3dFindResource( int type, const char *name )
 {
-	Resource *resObj = Modules::resMan().findResource( type, safeStr( name, 0 ) );
+	Resource *resObj = Modules::resMan().findResource( type, name != 0x0 ? name : emptyCString );
 	
 	return resObj != 0x0 ? resObj->getHandle() : 0;
 }
@@ -302,10 +309,54 @@ DLLEXP bool h3dLoadResource( ResHandle res, const char *data, int size )
     }
     else
         Modules::log().writeInfo( "Loading resource '%s'", resObj->getName().c_str() );
+
+	ProfileScope profileScope( "LoadResource", resObj->getName() );
 	return resObj->load( data, size );
 }
 
 
+DLLEXP bool h3dLoadDecodedResource( ResHandle res, const char *data, int size )
+{
+	Resource *resObj = Modules::resMan().resolveResHandle( res );
+	APIFUNC_VALIDATE_RES( resObj, "h3dLoadDecodedResource", false );
+	if( resObj->isLoaded() )
+	{
+		Modules::log().writeWarning( "Resource '%s' already loaded", resObj->getName().c_str() );
+		return false;
+	}
+	else
+		Modules::log().writeInfo( "Loading resource '%s'", resObj->getName().c_str() );
+
+	ProfileScope profileScope( "LoadResource", resObj->getName() );
+	return resObj->loadDecoded( data, size );
+}
+
+
+DLLEXP char *h3dDecodeResourceData( int type, const char *data, int size, int *decodedSize )
+{
+	int dummy;
+	int &outSize = decodedSize != 0x0 ? *decodedSize : dummy;
+	outSize = 0;
+
+	ProfileScope profileScope( "DecodeResourceData" );
+
+	// Only stateless decoders are allowed here since the function may be called from any thread
+	switch( type )
+	{
+	case ResourceTypes::Texture:
+		return TextureResource::decodeData( data, size, outSize );
+	default:
+		return 0x0;
+	}
+}
+
+
+DLLEXP void h3dReleaseDecodedResourceData( char *data )
+{
+	delete[] data;
+}
+
+
 DLLEXP void h3dUnloadResource( ResHandle res )
 {
 	Resource *resObj = Modules::resMan().resolveResHandle( res );
@@ -411,12 +462,56 @@ DLLEXP ResHandle h3dQueryUnloadedResource( int index )
 }
 
 
+DLLEXP ResHandle h3dQueryNextUnloadedResource( ResHandle start )
+{
+	return Modules::resMan().queryNextUnloadedResource( start );
+}
+
+
 DLLEXP void h3dReleaseUnusedResources()
 {
 	Modules::resMan().releaseUnusedResources();
 }
 
 
+DLLEXP int h3dWarmUpShaders( bool wait )
+{
+	ShaderResource::warmUpCombinations();
+	
+	int count = (int)ShaderResource::getPendingCombinationCount();
+	if( wait ) ShaderResource::processPendingCombinations( true );
+
+	return count;
+}
+
+
+DLLEXP bool h3dSetShaderCache( const char *path, int maxSize )
+{
+	ShaderCache &shaderCache = Modules::renderer().getShaderCache();
+	
+	if( path == 0x0 || *path == '\0' )
+	{
+		shaderCache.close();
+		return true;
+	}
+	if( maxSize <= 0 || maxSize >= 4096 )
+	{
+		Modules::setError( "Invalid size in h3dSetShaderCache" );
+		return false;
+	}
+	
+	if( !shaderCache.open( safeStr( path, 0 ), (uint32)maxSize * 1024 * 1024 ) )
+	{
+		Modules::log().writeError( "Shader cache: Failed to write to directory '%s'", path );
+		return false;
+	}
+
+	Modules::log().writeInfo( "Shader cache: Using directory '%s' with %i entries",
+	                          shaderCache.getPath().c_str(), (int)shaderCache.getEntryCount() );
+	return true;
+}
+
+
 DLLEXP ResHandle h3dCreateTexture( const char *name, int width, int height, int fmt, int flags )
 {
 	TextureResource *texRes = new TextureResource( safeStr( name, 0 ), (uint32)width,
@@ -845,6 +940,22 @@ DLLEXP void h3dUpdateModel( NodeHandle modelNode, int flags )
 }
 
 
+DLLEXP void h3dUpdateModels( const NodeHandle *modelNodes, int count, int flags )
+{
+	if( modelNodes == 0x0 || count <= 0 ) return;
+	
+	vector< ModelNode * > models( count );
+	for( int i = 0; i < count; ++i )
+	{
+		SceneNode *sn = Modules::sceneMan().resolveNodeHandle( modelNodes[i] );
+		APIFUNC_VALIDATE_NODE_TYPE( sn, SceneNodeTypes::Model, "h3dUpdateModels", APIFUNC_RET_VOID );
+		models[i] = (ModelNode *)sn;
+	}
+
+	ModelNode::updateModels( &models[0], (uint32)count, flags );
+}
+
+
 DLLEXP NodeHandle h3dAddMeshNode( NodeHandle parent, const char *name, ResHandle materialRes,
                                   int batchStart, int batchCount, int vertRStart, int vertREnd )
 {
@@ -973,6 +1084,22 @@ DLLEXP void h3dUpdateEmitter( NodeHandle emitterNode, float timeDelta )
 }
 
 
+DLLEXP void h3dAdvanceEmitterTimes( const NodeHandle *emitterNodes, int count, float timeDelta )
+{
+	if( emitterNodes == 0x0 || count <= 0 ) return;
+	
+	vector< EmitterNode * > emitters( count );
+	for( int i = 0; i < count; ++i )
+	{
+		SceneNode *sn = Modules::sceneMan().resolveNodeHandle( emitterNodes[i] );
+		APIFUNC_VALIDATE_NODE_TYPE( sn, SceneNodeTypes::Emitter, "h3dAdvanceEmitterTimes", APIFUNC_RET_VOID );
+		emitters[i] = (EmitterNode *)sn;
+	}
+
+	EmitterNode::updateEmitters( &emitters[0], (uint32)count, timeDelta );
+}
+
+
 DLLEXP bool h3dHasEmitterFinished( NodeHandle emitterNode )
 {
 	SceneNode *sn = Modules::sceneMan().resolveNodeHandle( emitterNode );
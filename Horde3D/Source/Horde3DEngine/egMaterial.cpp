@@ -24,6 +24,43 @@ namespace Horde3D {
 
 using namespace std;
 
+NameIdRegistry MaterialResource::_classNames;
+NameIdRegistry MaterialResource::_classFilters;
+vector< vector< bool > > MaterialResource::_classFilterMatches;
+
+
+uint32 MaterialResource::getClassId( const string &theClass )
+{
+	uint32 classId = _classNames.getId( theClass );
+	
+	if( classId >= _classFilterMatches.size() )
+	{
+		// Match new class against all known filters
+		_classFilterMatches.push_back( vector< bool >( _classFilters.getCount() ) );
+		for( uint32 i = 0; i < _classFilters.getCount(); ++i )
+			_classFilterMatches[classId][i] = matchClass( theClass, _classFilters.getName( i ) );
+	}
+
+	return classId;
+}
+
+
+uint32 MaterialResource::getClassFilterId( const string &classFilter )
+{
+	uint32 filterId = _classFilters.getId( classFilter );
+
+	// Match new filter against all known classes
+	for( uint32 i = 0; i < _classFilterMatches.size(); ++i )
+	{
+		vector< bool > &matches = _classFilterMatches[i];
+		while( matches.size() < _classFilters.getCount() )
+			matches.push_back( matchClass( _classNames.getName( i ), _classFilters.getName( (uint32)matches.size() ) ) );
+	}
+
+	return filterId;
+}
+
+
 MaterialResource::MaterialResource( const string &name, int flags ) :
 	Resource( ResourceTypes::Material, name, flags )
 {
@@ -53,6 +90,7 @@ void MaterialResource::initDefault()
 	_combMask = 0;
 	_matLink = 0x0;
 	_class = "";
+	_classId = getClassId( _class );
 }
 
 
@@ -67,6 +105,7 @@ void MaterialResource::release()
 	_samplers.clear();
 	_uniforms.clear();
 	_shaderFlags.clear();
+	_shaderBindings.clear();
 }
 
 
@@ -99,7 +138,8 @@ bool MaterialResource::load( const char *data, int size )
 		return raiseError( "Not a material resource file" );
 
 	// Class
-    _class = rootNode.getAttribute( "class", "" );
+	_class = rootNode.getAttribute( "class", "" );
+	_classId = getClassId( _class );
 
 	// Link
 	if( strcmp( rootNode.getAttribute( "link", "" ), "" ) != 0 )
@@ -162,6 +202,10 @@ bool MaterialResource::load( const char *data, int size )
 			_stricmp( node1.getAttribute( "sRGB", "0" ), "1" ) == 0 )
 			flags |= ResourceFlags::TexSRGB;
 
+		if( _stricmp( node1.getAttribute( "streaming", "true" ), "false" ) == 0 ||
+			_stricmp( node1.getAttribute( "streaming", "1" ), "0" ) == 0 )
+			flags |= ResourceFlags::TexNoStreaming;
+
 		texMap = Modules::resMan().addResource(
 			ResourceTypes::Texture, node1.getAttribute( "map" ), flags, false );
 
@@ -232,30 +276,28 @@ bool MaterialResource::setUniform( const string &name, float a, float b, float c
 }
 
 
-bool MaterialResource::isOfClass( const string &theClass ) const
+bool MaterialResource::matchClass( const string &theClass, const string &classFilter )
 {
-	static string theClass2;
-	
-	if( theClass != "" )
+	if( classFilter != "" )
 	{
-		if( theClass[0]	!= '~' )
+		if( classFilter[0] != '~' )
 		{
-			if( _class.find( theClass, 0 ) != 0 ) return false;
-			if( _class.length() > theClass.length() && _class[theClass.length()] != '.' ) return false;
+			if( theClass.find( classFilter, 0 ) != 0 ) return false;
+			if( theClass.length() > classFilter.length() && theClass[classFilter.length()] != '.' ) return false;
 		}
 		else	// Not operator
 		{
-			theClass2 = theClass.substr( 1, theClass.length() - 1);
+			string classFilter2 = classFilter.substr( 1, classFilter.length() - 1 );
 			
-			if( _class.find( theClass2, 0 ) == 0 )
+			if( theClass.find( classFilter2, 0 ) == 0 )
 			{
-				if( _class.length() == theClass2.length() )
+				if( theClass.length() == classFilter2.length() )
 				{
 					return false;
 				}
 				else
 				{
-					if( _class[theClass2.length()] == '.' ) return false;
+					if( theClass[classFilter2.length()] == '.' ) return false;
 				}
 			}
 		}
@@ -263,13 +305,76 @@ bool MaterialResource::isOfClass( const string &theClass ) const
 	else
 	{
 		// Special name which is hidden when drawing objects of "all classes"
-		if( _class == "_DEBUG_" ) return false;
+		if( theClass == "_DEBUG_" ) return false;
 	}
 
 	return true;
 }
 
 
+const MatShaderBinding &MaterialResource::getShaderBinding( ShaderResource *shaderRes )
+{
+	for( size_t i = 0, s = _shaderBindings.size(); i < s; ++i )
+	{
+		MatShaderBinding &binding = _shaderBindings[i];
+		if( binding.shaderRes == shaderRes )
+		{
+			if( binding.shaderLayoutStamp == shaderRes->getLayoutStamp() ) return binding;
+			
+			// Shader was reloaded since the binding was created
+			_shaderBindings.erase( _shaderBindings.begin() + i );
+			break;
+		}
+	}
+	
+	_shaderBindings.push_back( MatShaderBinding() );
+	MatShaderBinding &binding = _shaderBindings.back();
+	binding.shaderRes = shaderRes;
+	binding.shaderLayoutStamp = shaderRes->getLayoutStamp();
+
+	binding.samplers.resize( shaderRes->_samplers.size(), -1 );
+	for( size_t i = 0, si = shaderRes->_samplers.size(); i < si; ++i )
+	{
+		for( size_t j = 0, sj = _samplers.size(); j < sj; ++j )
+		{
+			if( _samplers[j].name == shaderRes->_samplers[i].id )
+			{
+				binding.samplers[i] = (int)j;
+				break;
+			}
+		}
+	}
+
+	binding.uniforms.resize( shaderRes->_uniforms.size(), -1 );
+	for( size_t i = 0, si = shaderRes->_uniforms.size(); i < si; ++i )
+	{
+		for( size_t j = 0, sj = _uniforms.size(); j < sj; ++j )
+		{
+			if( _uniforms[j].name == shaderRes->_uniforms[i].id )
+			{
+				binding.uniforms[i] = (int)j;
+				break;
+			}
+		}
+	}
+
+	binding.buffers.resize( shaderRes->_buffers.size(), -1 );
+	for( size_t i = 0, si = shaderRes->_buffers.size(); i < si; ++i )
+	{
+		for( size_t j = 0, sj = _buffers.size(); j < sj; ++j )
+		{
+			if( _buffers[j].name == shaderRes->_buffers[i].id )
+			{
+				binding.buffers[i] = (int)j;
+				break;
+			}
+		}
+	}
+
+	return binding;
+}
+
+
 int MaterialResource::getElemCount( int elem ) const
 {
 	switch( elem )
@@ -469,6 +574,7 @@ void MaterialResource::setElemParamStr( int elem, int elemIdx, int param, const
 		{
 		case MaterialResData::MatClassStr:
 			_class = value;
+			_classId = getClassId( _class );
 			return;
 		}
 		break;
@@ -70,6 +70,17 @@ struct MatUniform
 	}
 };
 
+// Maps the samplers, uniforms and buffers of a shader to the elements of a material that
+// provide their values, so that binding a material does not need to compare names
+struct MatShaderBinding
+{
+	ShaderResource      *shaderRes;  // Only used for comparison
+	uint32              shaderLayoutStamp;
+	std::vector< int >  samplers;  // Material sampler per shader sampler or -1 if not set by material
+	std::vector< int >  uniforms;  // Material uniform per shader uniform or -1 if not set by material
+	std::vector< int >  buffers;   // Material buffer per shader buffer or -1 if not set by material
+};
+
 // =================================================================================================
 
 class MaterialResource;
@@ -80,6 +91,8 @@ class MaterialResource : public Resource
 public:
 	static Resource *factoryFunc( const std::string &name, int flags )
 		{ return new MaterialResource( name, flags ); }
+	static uint32 getClassId( const std::string &theClass );
+	static uint32 getClassFilterId( const std::string &classFilter );
 	
 	MaterialResource( const std::string &name, int flags );
 	~MaterialResource();
@@ -89,7 +102,8 @@ public:
 	void release();
 	bool load( const char *data, int size );
 	bool setUniform( const std::string &name, float a, float b, float c, float d );
-	bool isOfClass( const std::string &theClass ) const;
+	bool isOfClass( uint32 classFilterId ) const { return _classFilterMatches[_classId][classFilterId]; }
+	const MatShaderBinding &getShaderBinding( ShaderResource *shaderRes );
 
 	int getElemCount( int elem ) const;
 	int getElemParamI( int elem, int elemIdx, int param ) const;
@@ -101,20 +115,29 @@ public:
 
 private:
 	bool raiseError( const std::string &msg, int line = -1 );
+	static bool matchClass( const std::string &theClass, const std::string &classFilter );
 
 private:
+	static NameIdRegistry                   _classNames;
+	static NameIdRegistry                   _classFilters;
+	static std::vector< std::vector< bool > >  _classFilterMatches;  // [class id][class filter id]
+
+
 	PShaderResource             _shaderRes;
 	uint32                      _combMask;
 	std::string                 _class;
+	uint32                      _classId;
 	std::vector< MatBuffer >	_buffers;
 	std::vector< MatSampler >   _samplers;
 	std::vector< MatUniform >   _uniforms;
 	std::vector< std::string >  _shaderFlags;
 	PMaterialResource           _matLink;
+	std::vector< MatShaderBinding >  _shaderBindings;
 
 	friend class ResourceManager;
 	friend class Renderer;
 	friend class MeshNode;
+	friend class ShaderResource;
 };
 
 }
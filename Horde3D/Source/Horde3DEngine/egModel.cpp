@@ -15,8 +15,16 @@
 #include "egModules.h"
 #include "egRenderer.h"
 #include "egCom.h"
+#include "egProfiler.h"
+#include "utThreadPool.h"
 #include <cstring>
 
+#if defined( H3D_SIMD_SSE2 )
+#	include <emmintrin.h>
+#elif defined( H3D_SIMD_NEON )
+#	include <arm_neon.h>
+#endif
+
 #include "utDebug.h"
 
 
@@ -30,7 +38,7 @@ ModelNode::ModelNode( const ModelNodeTpl &modelTpl ) :
 	_lodDist1( modelTpl.lodDist1 ), _lodDist2( modelTpl.lodDist2 ),
 	_lodDist3( modelTpl.lodDist3 ), _lodDist4( modelTpl.lodDist4 ),
 	_softwareSkinning( modelTpl.softwareSkinning ), _skinningDirty( false ),
-	_nodeListDirty( false ), _morpherUsed( false ), _morpherDirty( false )
+	_nodeListDirty( false ), _morpherUsed( false ), _morpherDirty( false ), _inUpdateBatch( false )
 {
 	if( _geometryRes != 0x0 )
 		setParamI( ModelNodeParams::GeoResI, _geometryRes->getHandle() );
@@ -44,37 +52,26 @@ ModelNode::~ModelNode()
 }
 
 
-SceneNodeTpl *ModelNode::parsingFunc( map< string, string > &attribs )
+SceneNodeTpl *ModelNode::parsingFunc( const SceneNodeAttribs &attribs )
 {
 	bool result = true;
 	
 	ModelNodeTpl *modelTpl = new ModelNodeTpl( "", 0x0 );
+	string str;
 	
-	map< string, string >::iterator itr = attribs.find( "geometry" );
-	if( itr != attribs.end() )
+	if( attribs.getString( "geometry", str ) )
 	{
-		uint32 res = Modules::resMan().addResource( ResourceTypes::Geometry, itr->second, 0, false );
+		uint32 res = Modules::resMan().addResource( ResourceTypes::Geometry, str, 0, false );
 		if( res != 0 )
 			modelTpl->geoRes = (GeometryResource *)Modules::resMan().resolveResHandle( res );
 	}
 	else result = false;
-	itr = attribs.find( "softwareSkinning" );
-	if( itr != attribs.end() ) 
-	{
-		if ( _stricmp( itr->second.c_str(), "true" ) == 0 || _stricmp( itr->second.c_str(), "1" ) == 0 )
-			modelTpl->softwareSkinning = true;
-		else
-			modelTpl->softwareSkinning = false;
-	}
+	attribs.getBool( "softwareSkinning", modelTpl->softwareSkinning );
 
-	itr = attribs.find( "lodDist1" );
-	if( itr != attribs.end() ) modelTpl->lodDist1 = (float)atof( itr->second.c_str() );
-	itr = attribs.find( "lodDist2" );
-	if( itr != attribs.end() ) modelTpl->lodDist2 = (float)atof( itr->second.c_str() );
-	itr = attribs.find( "lodDist3" );
-	if( itr != attribs.end() ) modelTpl->lodDist3 = (float)atof( itr->second.c_str() );
-	itr = attribs.find( "lodDist4" );
-	if( itr != attribs.end() ) modelTpl->lodDist4 = (float)atof( itr->second.c_str() );
+	attribs.getFloat( "lodDist1", modelTpl->lodDist1 );
+	attribs.getFloat( "lodDist2", modelTpl->lodDist2 );
+	attribs.getFloat( "lodDist3", modelTpl->lodDist3 );
+	attribs.getFloat( "lodDist4", modelTpl->lodDist4 );
 
 	if( !result )
 	{
@@ -99,6 +96,7 @@ void ModelNode::recreateNodeListRec( SceneNode *node, bool firstCall )
 	{
 		_meshList.push_back( (MeshNode *)node );
 		_animCtrl.registerNode( (MeshNode *)node );
+		((MeshNode *)node)->updateSortKey();
 	}
 	else if( node->getType() == SceneNodeTypes::Joint )
 	{
@@ -241,10 +239,15 @@ void ModelNode::setGeometryRes( GeometryResource &geoRes )
 		morpher.weight = 0;
 	}
 
+	Resource *clonedRes = 0x0;
 	if( !_morphers.empty() || _softwareSkinning )
 	{
-		Resource *clonedRes = Modules::resMan().resolveResHandle(
-			Modules::resMan().cloneResource( geoRes, "" ) );
+		// Cloning fails for geometry without CPU copy which is then rendered undeformed
+		clonedRes = Modules::resMan().resolveResHandle( Modules::resMan().cloneResource( geoRes, "" ) );
+	}
+	
+	if( clonedRes != 0x0 )
+	{
 		_geometryRes = (GeometryResource *)clonedRes;
 		_baseGeoRes = &geoRes;
 	}
@@ -256,6 +259,11 @@ void ModelNode::setGeometryRes( GeometryResource &geoRes )
 
 	_skinningDirty = true;
 	updateLocalMeshAABBs();
+
+	// Geometry is part of the render queue sort key of the meshes; if the node list is dirty
+	// the keys are updated when it is recreated
+	for( size_t i = 0, s = _meshList.size(); i < s; ++i )
+		_meshList[i]->updateSortKey();
 }
 
 
@@ -346,9 +354,16 @@ void ModelNode::setParamF( int param, int compIdx, float value )
 
 void ModelNode::update( int flags )
 {
+	ProfileScope profileScope( "UpdateModel", _name );
+
 	if( flags & ModelUpdateFlags::Animation )
 	{
-		if( _animCtrl.animate() )
+		Timer *timer = Modules::stats().getTimer( EngineStats::AnimationTime );
+		if( Modules::config().gatherTimeStats ) timer->setEnabled( true );
+		bool animated = _animCtrl.animate();
+		timer->setEnabled( false );
+		
+		if( animated )
 		{	
 			_skinningDirty = true;
 			markDirty();
@@ -364,7 +379,237 @@ void ModelNode::update( int flags )
 }
 
 
+struct ModelUpdateBatch
+{
+	std::vector< ModelNode * >  models;
+	std::vector< ModelNode * >  treeModels;  // Models whose subtrees can be updated in parallel
+	std::vector< char >         results;
+
+
+	static void animateModels( void *userData, uint32 begin, uint32 end )
+	{
+		ProfileScope profileScope( "AnimateModels" );
+		ModelUpdateBatch &batch = *(ModelUpdateBatch *)userData;
+		for( uint32 i = begin; i < end; ++i )
+			batch.results[i] = batch.models[i]->_animCtrl.animate();
+	}
+
+	static void updateModelTrees( void *userData, uint32 begin, uint32 end )
+	{
+		ProfileScope profileScope( "UpdateModelTrees" );
+		ModelUpdateBatch &batch = *(ModelUpdateBatch *)userData;
+		for( uint32 i = begin; i < end; ++i )
+			batch.treeModels[i]->SceneNode::updateTree();
+	}
+
+	static void calcModelGeometry( void *userData, uint32 begin, uint32 end )
+	{
+		ProfileScope profileScope( "SkinModels" );
+		ModelUpdateBatch &batch = *(ModelUpdateBatch *)userData;
+		for( uint32 i = begin; i < end; ++i )
+			batch.results[i] = batch.models[i]->calcGeometry( false );
+	}
+};
+
+
+void ModelNode::updateModels( ModelNode *const *models, uint32 count, int flags )
+{
+	ProfileScope profileScope( "UpdateModels" );
+	ThreadPool &threadPool = Modules::threadPool();
+	ModelUpdateBatch batch;
+	
+	// Remove duplicates
+	batch.models.reserve( count );
+	for( uint32 i = 0; i < count; ++i )
+	{
+		if( models[i]->_inUpdateBatch ) continue;
+		models[i]->_inUpdateBatch = true;
+		batch.models.push_back( models[i] );
+	}
+	batch.results.resize( batch.models.size() );
+	
+	if( flags & ModelUpdateFlags::Animation )
+	{
+		// Sample and blend animations in parallel; each controller only writes to its own nodes
+		Timer *timer = Modules::stats().getTimer( EngineStats::AnimationTime );
+		if( Modules::config().gatherTimeStats ) timer->setEnabled( true );
+		threadPool.parallelFor( (uint32)batch.models.size(), 1, ModelUpdateBatch::animateModels, &batch );
+		timer->setEnabled( false );
+
+		// Dirty flags of shared ancestors are set sequentially
+		std::vector< ModelNode * > nestedModels;
+		for( size_t i = 0, s = batch.models.size(); i < s; ++i )
+		{
+			if( !batch.results[i] ) continue;
+
+			ModelNode *model = batch.models[i];
+			model->_skinningDirty = true;
+			model->markDirty();
+
+			// Models attached below other models of the batch would be visited by two threads
+			bool nested = false;
+			for( SceneNode *node = model->getParent(); node != 0x0 && !nested; node = node->getParent() )
+			{
+				nested = node->getType() == SceneNodeTypes::Model && ((ModelNode *)node)->_inUpdateBatch;
+			}
+			if( nested ) nestedModels.push_back( model );
+			else batch.treeModels.push_back( model );
+		}
+
+		// Update transformations and skinning matrices of the model subtrees; spatial graph
+		// updates are sorted before they are processed, so the result is deterministic
+		threadPool.parallelFor( (uint32)batch.treeModels.size(), 1, ModelUpdateBatch::updateModelTrees, &batch );
+		for( size_t i = 0, s = nestedModels.size(); i < s; ++i )
+			nestedModels[i]->SceneNode::updateTree();
+	}
+
+	if( flags & ModelUpdateFlags::Geometry )
+	{
+		Timer *timer = Modules::stats().getTimer( EngineStats::GeoUpdateTime );
+		if( Modules::config().gatherTimeStats ) timer->setEnabled( true );
+		
+		// Skin models in parallel and upload the results sequentially; a single model is split
+		// into vertex ranges instead
+		if( batch.models.size() == 1 )
+			batch.results[0] = batch.models[0]->calcGeometry( true );
+		else
+			threadPool.parallelFor( (uint32)batch.models.size(), 1, ModelUpdateBatch::calcModelGeometry, &batch );
+		for( size_t i = 0, s = batch.models.size(); i < s; ++i )
+		{
+			if( batch.results[i] ) batch.models[i]->_geometryRes->updateDynamicVertData();
+		}
+
+		timer->setEnabled( false );
+	}
+
+	for( size_t i = 0, s = batch.models.size(); i < s; ++i )
+		batch.models[i]->_inUpdateBatch = false;
+}
+
+
+struct SkinningJob
+{
+	const Vec3f             *srcPos;
+	const VertexDataTan     *srcTan;
+	Vec3f                   *dstPos;
+	VertexDataTan           *dstTan;
+	const VertexDataStatic  *staticData;
+	const uint16            *joints;
+	const Vec4f             *rows;
+};
+
+
+static void skinVertices( void *userData, uint32 begin, uint32 end )
+{
+	ProfileScope profileScope( "SkinVertices" );
+
+	// Source and destination streams may be identical
+	const SkinningJob &job = *(const SkinningJob *)userData;
+	uint16 convJoints[4];
+	
+	for( uint32 i = begin; i < end; ++i )
+	{
+		const float *weights = job.staticData[i].weightVec;
+		const uint16 *joints = job.joints != 0x0 ? &job.joints[i * 4] : convJoints;
+		if( job.joints == 0x0 )
+		{
+			// No integer copy of the joint stream, convert the float indices
+			const float *jointVec = job.staticData[i].jointVec;
+			for( uint32 j = 0; j < 4; ++j ) convJoints[j] = (uint16)ftoi_r( jointVec[j] );
+		}
+
+		const Vec4f *row0 = &job.rows[joints[0] * 3];
+		const Vec4f *row1 = &job.rows[joints[1] * 3];
+		const Vec4f *row2 = &job.rows[joints[2] * 3];
+		const Vec4f *row3 = &job.rows[joints[3] * 3];
+		
+		const Vec3f pos = job.srcPos[i];
+		const Vec3f normal = job.srcTan[i].normal;
+		const Vec3f tangent = job.srcTan[i].tangent;
+		job.dstTan[i].handedness = job.srcTan[i].handedness;
+
+		// Blend the 3x4 joint matrices and transform position and tangent space basis
+		// Note: We skip the normalization of the tangent space basis for performance reasons;
+		//       the error is usually not huge and should be hardly noticable
+#if defined( H3D_SIMD_SSE2 )
+		__m128 w0 = _mm_set1_ps( weights[0] ), w1 = _mm_set1_ps( weights[1] );
+		__m128 w2 = _mm_set1_ps( weights[2] ), w3 = _mm_set1_ps( weights[3] );
+		__m128 r[4];
+		for( uint32 j = 0; j < 3; ++j )
+		{
+			r[j] = _mm_add_ps( _mm_add_ps( _mm_add_ps(
+				_mm_mul_ps( _mm_loadu_ps( &row0[j].x ), w0 ), _mm_mul_ps( _mm_loadu_ps( &row1[j].x ), w1 ) ),
+				_mm_mul_ps( _mm_loadu_ps( &row2[j].x ), w2 ) ), _mm_mul_ps( _mm_loadu_ps( &row3[j].x ), w3 ) );
+		}
+		r[3] = _mm_setzero_ps();
+		_MM_TRANSPOSE4_PS( r[0], r[1], r[2], r[3] );  // Rows to columns
+		
+		float result[4];
+		__m128 v = _mm_add_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( r[0], _mm_set1_ps( pos.x ) ),
+			_mm_mul_ps( r[1], _mm_set1_ps( pos.y ) ) ), _mm_mul_ps( r[2], _mm_set1_ps( pos.z ) ) ), r[3] );
+		_mm_storeu_ps( result, v );
+		job.dstPos[i] = Vec3f( result[0], result[1], result[2] );
+
+		v = _mm_add_ps( _mm_add_ps( _mm_mul_ps( r[0], _mm_set1_ps( normal.x ) ),
+			_mm_mul_ps( r[1], _mm_set1_ps( normal.y ) ) ), _mm_mul_ps( r[2], _mm_set1_ps( normal.z ) ) );
+		_mm_storeu_ps( result, v );
+		job.dstTan[i].normal = Vec3f( result[0], result[1], result[2] );
+
+		v = _mm_add_ps( _mm_add_ps( _mm_mul_ps( r[0], _mm_set1_ps( tangent.x ) ),
+			_mm_mul_ps( r[1], _mm_set1_ps( tangent.y ) ) ), _mm_mul_ps( r[2], _mm_set1_ps( tangent.z ) ) );
+		_mm_storeu_ps( result, v );
+		job.dstTan[i].tangent = Vec3f( result[0], result[1], result[2] );
+#else
+		float m[3][4];
+	#if defined( H3D_SIMD_NEON )
+		for( uint32 j = 0; j < 3; ++j )
+		{
+			float32x4_t row = vmulq_n_f32( vld1q_f32( &row0[j].x ), weights[0] );
+			row = vmlaq_n_f32( row, vld1q_f32( &row1[j].x ), weights[1] );
+			row = vmlaq_n_f32( row, vld1q_f32( &row2[j].x ), weights[2] );
+			row = vmlaq_n_f32( row, vld1q_f32( &row3[j].x ), weights[3] );
+			vst1q_f32( m[j], row );
+		}
+	#else
+		for( uint32 j = 0; j < 3; ++j )
+		{
+			m[j][0] = row0[j].x * weights[0] + row1[j].x * weights[1] + row2[j].x * weights[2] + row3[j].x * weights[3];
+			m[j][1] = row0[j].y * weights[0] + row1[j].y * weights[1] + row2[j].y * weights[2] + row3[j].y * weights[3];
+			m[j][2] = row0[j].z * weights[0] + row1[j].z * weights[1] + row2[j].z * weights[2] + row3[j].z * weights[3];
+			m[j][3] = row0[j].w * weights[0] + row1[j].w * weights[1] + row2[j].w * weights[2] + row3[j].w * weights[3];
+		}
+	#endif
+		job.dstPos[i] = Vec3f( pos.x * m[0][0] + pos.y * m[0][1] + pos.z * m[0][2] + m[0][3],
+		                       pos.x * m[1][0] + pos.y * m[1][1] + pos.z * m[1][2] + m[1][3],
+		                       pos.x * m[2][0] + pos.y * m[2][1] + pos.z * m[2][2] + m[2][3] );
+		job.dstTan[i].normal = Vec3f( normal.x * m[0][0] + normal.y * m[0][1] + normal.z * m[0][2],
+		                              normal.x * m[1][0] + normal.y * m[1][1] + normal.z * m[1][2],
+		                              normal.x * m[2][0] + normal.y * m[2][1] + normal.z * m[2][2] );
+		job.dstTan[i].tangent = Vec3f( tangent.x * m[0][0] + tangent.y * m[0][1] + tangent.z * m[0][2],
+		                               tangent.x * m[1][0] + tangent.y * m[1][1] + tangent.z * m[1][2],
+		                               tangent.x * m[2][0] + tangent.y * m[2][1] + tangent.z * m[2][2] );
+#endif
+	}
+}
+
+
 bool ModelNode::updateGeometry()
+{
+	Timer *timer = Modules::stats().getTimer( EngineStats::GeoUpdateTime );
+	if( Modules::config().gatherTimeStats ) timer->setEnabled( true );
+	
+	bool updated = calcGeometry( true );
+	
+	// Upload geometry
+	if( updated ) _geometryRes->updateDynamicVertData();
+
+	timer->setEnabled( false );
+
+	return updated;
+}
+
+
+bool ModelNode::calcGeometry( bool useWorkers )
 {
 	_skinningDirty |= _morpherDirty;
 	_skinningDirty &= _softwareSkinning;
@@ -376,18 +621,15 @@ bool ModelNode::updateGeometry()
 	if( _geometryRes == 0x0 || _geometryRes->getVertPosData() == 0x0 ||
 		_geometryRes->getVertTanData() == 0x0 || _geometryRes->getVertStaticData() == 0x0 ) return false;
 	
-	Timer *timer = Modules::stats().getTimer( EngineStats::GeoUpdateTime );
-	if( Modules::config().gatherTimeStats ) timer->setEnabled( true );
-	
-	// Reset vertices to base data
-	memcpy( _geometryRes->getVertPosData(), _baseGeoRes->getVertPosData(),
-	        _geometryRes->_vertCount * sizeof( Vec3f ) );
-	memcpy( _geometryRes->getVertTanData(), _baseGeoRes->getVertTanData(),
-	        _geometryRes->_vertCount * sizeof( VertexDataTan ) );
-
 	Vec3f *posData = _geometryRes->getVertPosData();
 	VertexDataTan *tanData = _geometryRes->getVertTanData();
-	VertexDataStatic *staticData = _geometryRes->getVertStaticData();
+
+	// Vertices are reset to base data, unless skinning reads the base data directly
+	if( _morpherUsed || !_skinningDirty )
+	{
+		memcpy( posData, _baseGeoRes->getVertPosData(), _geometryRes->_vertCount * sizeof( Vec3f ) );
+		memcpy( tanData, _baseGeoRes->getVertTanData(), _geometryRes->_vertCount * sizeof( VertexDataTan ) );
+	}
 
 	if( _morpherUsed )
 	{
@@ -413,40 +655,20 @@ bool ModelNode::updateGeometry()
 
 	if( _skinningDirty )
 	{
-		Matrix4f skinningMat;
-		Vec4f *rows = &_skinMatRows[0];
-
-		for( uint32 i = 0, s = _geometryRes->getVertCount(); i < s; ++i )
-		{
-			Vec4f *row0 = &rows[ftoi_r( staticData[i].jointVec[0] ) * 3];
-			Vec4f *row1 = &rows[ftoi_r( staticData[i].jointVec[1] ) * 3];
-			Vec4f *row2 = &rows[ftoi_r( staticData[i].jointVec[2] ) * 3];
-			Vec4f *row3 = &rows[ftoi_r( staticData[i].jointVec[3] ) * 3];
-
-			Vec4f weights = *((Vec4f *)&staticData[i].weightVec[0]);
-
-			skinningMat.x[0] = (row0)->x * weights.x + (row1)->x * weights.y + (row2)->x * weights.z + (row3)->x * weights.w;
-			skinningMat.x[1] = (row0+1)->x * weights.x + (row1+1)->x * weights.y + (row2+1)->x * weights.z + (row3+1)->x * weights.w;
-			skinningMat.x[2] = (row0+2)->x * weights.x + (row1+2)->x * weights.y + (row2+2)->x * weights.z + (row3+2)->x * weights.w;
-			skinningMat.x[4] = (row0)->y * weights.x + (row1)->y * weights.y + (row2)->y * weights.z + (row3)->y * weights.w;
-			skinningMat.x[5] = (row0+1)->y * weights.x + (row1+1)->y * weights.y + (row2+1)->y * weights.z + (row3+1)->y * weights.w;
-			skinningMat.x[6] = (row0+2)->y * weights.x + (row1+2)->y * weights.y + (row2+2)->y * weights.z + (row3+2)->y * weights.w;
-			skinningMat.x[8] = (row0)->z * weights.x + (row1)->z * weights.y + (row2)->z * weights.z + (row3)->z * weights.w;
-			skinningMat.x[9] = (row0+1)->z * weights.x + (row1+1)->z * weights.y + (row2 + 1)->z * weights.z + (row3+1)->z * weights.w;
-			skinningMat.x[10] = (row0+2)->z * weights.x + (row1+2)->z * weights.y + (row2+2)->z * weights.z + (row3+2)->z * weights.w;
-			skinningMat.x[12] = (row0)->w * weights.x + (row1)->w * weights.y + (row2)->w * weights.z + (row3)->w * weights.w;
-			skinningMat.x[13] = (row0+1)->w * weights.x + (row1+1)->w * weights.y + (row2+1)->w * weights.z + (row3+1)->w * weights.w;
-			skinningMat.x[14] = (row0+2)->w * weights.x + (row1+2)->w * weights.y + (row2+2)->w * weights.z + (row3+2)->w * weights.w;
-
-			// Skin position
-			posData[i] = skinningMat * posData[i];
-
-			// Skin tangent space basis
-			// Note: We skip the normalization of the tangent space basis for performance reasons;
-			//       the error is usually not huge and should be hardly noticable
-			tanData[i].normal = skinningMat.mult33Vec( tanData[i].normal ); //.normalized();
-			tanData[i].tangent = skinningMat.mult33Vec( tanData[i].tangent ); //.normalized();
-		}
+		SkinningJob job;
+		job.srcPos = _morpherUsed ? posData : _baseGeoRes->getVertPosData();
+		job.srcTan = _morpherUsed ? tanData : _baseGeoRes->getVertTanData();
+		job.dstPos = posData;
+		job.dstTan = tanData;
+		job.staticData = _geometryRes->getVertStaticData();
+		job.joints = _geometryRes->getVertJointIndices();
+		job.rows = &_skinMatRows[0];
+
+		// Large meshes are split into vertex ranges when the model is not skinned as part of a batch
+		if( useWorkers )
+			Modules::threadPool().parallelFor( _geometryRes->getVertCount(), 1024, skinVertices, &job );
+		else
+			skinVertices( &job, 0, _geometryRes->getVertCount() );
 	}
 	else if( _morpherUsed )
 	{
@@ -460,11 +682,6 @@ bool ModelNode::updateGeometry()
 
 	_morpherDirty = false;
 	_skinningDirty = false;
-	
-	// Upload geometry
-	_geometryRes->updateDynamicVertData();
-
-	timer->setEnabled( false );
 
 	return true;
 }
@@ -534,6 +751,7 @@ void ModelNode::onFinishedUpdate()
 			_meshList[i]->_bBox.min += dmin;
 			_meshList[i]->_bBox.max += dmax;
 			_meshList[i]->_bBox.transform( _meshList[i]->_absTrans );
+			Modules::sceneMan().updateSpatialNode( _meshList[i]->_sgHandle );
 		}
 	}
 
@@ -84,7 +84,7 @@ struct Morpher	// Morph modifier
 class ModelNode : public SceneNode
 {
 public:
-	static SceneNodeTpl *parsingFunc( std::map< std::string, std::string > &attribs );
+	static SceneNodeTpl *parsingFunc( const SceneNodeAttribs &attribs );
 	static SceneNode *factoryFunc( const SceneNodeTpl &nodeTpl );
 
 	~ModelNode();
@@ -102,6 +102,7 @@ public:
 	void setParamF( int param, int compIdx, float value );
 
 	void update( int flags );
+	static void updateModels( ModelNode *const *models, uint32 count, int flags );
 	uint32 calcLodLevel( const Vec3f &viewPoint ) const;
 
 	void setCustomInstData( float *data, uint32 count );
@@ -122,6 +123,7 @@ protected:
 	void setGeometryRes( GeometryResource &geoRes );
 
 	bool updateGeometry();
+	bool calcGeometry( bool useWorkers );
 
 	void onPostUpdate();
 	void onFinishedUpdate();
@@ -142,10 +144,12 @@ protected:
 	bool                          _softwareSkinning, _skinningDirty;
 	bool                          _nodeListDirty;  // An animatable node has been attached to model
 	bool                          _morpherUsed, _morpherDirty;
+	bool                          _inUpdateBatch;
 
 	friend class SceneManager;
 	friend class SceneNode;
 	friend class Renderer;
+	friend struct ModelUpdateBatch;
 };
 
 }
@@ -25,6 +25,8 @@
 #include "egExtensions.h"
 #include "egComputeBuffer.h"
 #include "egComputeNode.h"
+#include "egProfiler.h"
+#include "utThreadPool.h"
 
 
 // Extensions
@@ -52,6 +54,8 @@ SceneManager           *Modules::_sceneManager = 0x0;
 ResourceManager        *Modules::_resourceManager = 0x0;
 Renderer               *Modules::_renderer = 0x0;
 ExtensionManager       *Modules::_extensionManager = 0x0;
+ThreadPool             *Modules::_threadPool = 0x0;
+Profiler               *Modules::_profiler = 0x0;
 
 void Modules::installExtensions()
 {
@@ -75,6 +79,12 @@ bool Modules::init( int backendType )
 	if( _resourceManager == 0x0 ) _resourceManager = new ResourceManager();
 	if( _renderer == 0x0 ) _renderer = new Renderer();
 	if( _statManager == 0x0 ) _statManager = new StatManager();
+	if( _profiler == 0x0 ) _profiler = new Profiler();
+	if( _threadPool == 0x0 )
+	{
+		_threadPool = new ThreadPool();
+		_threadPool->setNumWorkers( ThreadPool::getDefaultNumWorkers() );
+	}
 
 	// Init modules
 	if ( !renderer().init( ( RenderBackendType::List ) backendType ) ) return false;
@@ -173,10 +183,12 @@ void Modules::release()
 	delete _extensionManager; _extensionManager = 0x0;
 	delete _sceneManager; _sceneManager = 0x0;
 	delete _resourceManager; _resourceManager = 0x0;
+	delete _profiler; _profiler = 0x0;  // Owns GPU timers
 	delete _renderer; _renderer = 0x0;
 	delete _statManager; _statManager = 0x0;
 	delete _engineLog; _engineLog = 0x0;
 	delete _engineConfig; _engineConfig = 0x0;
+	delete _threadPool; _threadPool = 0x0;
 }
 
 
@@ -26,6 +26,8 @@ class SceneManager;
 class ResourceManager;
 class Renderer;
 class ExtensionManager;
+class ThreadPool;
+class Profiler;
 
 
 // =================================================================================================
@@ -48,6 +50,8 @@ public:
 	static ResourceManager &resMan() { return *_resourceManager; }
 	static Renderer &renderer() { return *_renderer; }
 	static ExtensionManager &extMan() { return *_extensionManager; }
+	static ThreadPool &threadPool() { return *_threadPool; }
+	static Profiler &profiler() { return *_profiler; }
 
 public:
 	static const char *versionString;
@@ -65,6 +69,8 @@ private:
 	static ResourceManager        *_resourceManager;
 	static Renderer               *_renderer;
 	static ExtensionManager       *_extensionManager;
+	static ThreadPool             *_threadPool;
+	static Profiler               *_profiler;
 };
 
 // =================================================================================================
@@ -15,7 +15,14 @@
 #include "egModules.h"
 #include "egCom.h"
 #include "egRenderer.h"
+#include "egProfiler.h"
 #include "utXML.h"
+#include "utThreadPool.h"
+#include <cstdlib>
+
+#if defined( H3D_SIMD_SSE2 )
+#	include <emmintrin.h>
+#endif
 
 #include "utDebug.h"
 
@@ -311,10 +318,19 @@ EmitterNode::EmitterNode( const EmitterNodeTpl &emitterTpl ) :
 	_emissionAccum = 0;
 	_prevAbsTrans = _absTrans;
 
-	_particles = 0x0;
+	_parStreams = 0x0;
 	_parPositions = 0x0;
 	_parSizesANDRotations = 0x0;
 	_parColors = 0x0;
+	_inUpdateBatch = false;
+	_instanceGeo = 0;
+	_instanceBuf = 0;
+	_numInstances = 0;
+	_instanceDataDirty = true;
+
+	// Seed from rand() so that the application can still control the sequences
+	_randomState = (uint32)rand() * 2654435761u + 1;
+	if( _randomState == 0 ) _randomState = 1;
 
 	setMaxParticleCount( _particleCount );
 }
@@ -330,54 +346,46 @@ EmitterNode::~EmitterNode()
 			rdi->destroyQuery( _occQueries[i] );
 	}
 	
-	delete[] _particles;
+	releaseInstanceBuffer();
+	
+	delete[] _parStreams;
 	delete[] _parPositions;
 	delete[] _parSizesANDRotations;
 	delete[] _parColors;
 }
 
 
-SceneNodeTpl *EmitterNode::parsingFunc( map< string, string > &attribs )
+SceneNodeTpl *EmitterNode::parsingFunc( const SceneNodeAttribs &attribs )
 {
 	bool result = true;
 	
-	map< string, string >::iterator itr;
 	EmitterNodeTpl *emitterTpl = new EmitterNodeTpl( "", 0x0, 0x0, 0, 0 );
+	string str;
+	int value;
 
-	itr = attribs.find( "material" );
-	if( itr != attribs.end() )
+	if( attribs.getString( "material", str ) )
 	{
-		uint32 res = Modules::resMan().addResource( ResourceTypes::Material, itr->second, 0, false );
+		uint32 res = Modules::resMan().addResource( ResourceTypes::Material, str, 0, false );
 		if( res != 0 )
 			emitterTpl->matRes = (MaterialResource *)Modules::resMan().resolveResHandle( res );
 	}
 	else result = false;
-	itr = attribs.find( "particleEffect" );
-	if( itr != attribs.end() )
+	if( attribs.getString( "particleEffect", str ) )
 	{
-		uint32 res = Modules::resMan().addResource( ResourceTypes::ParticleEffect, itr->second, 0, false );
+		uint32 res = Modules::resMan().addResource( ResourceTypes::ParticleEffect, str, 0, false );
 		if( res != 0 )
 			emitterTpl->effectRes = (ParticleEffectResource *)Modules::resMan().resolveResHandle( res );
 	}
 	else result = false;
-	itr = attribs.find( "maxCount" );
-	if( itr != attribs.end() ) emitterTpl->maxParticleCount = atoi( itr->second.c_str() );
+	if( attribs.getInt( "maxCount", value ) ) emitterTpl->maxParticleCount = value;
 	else result = false;
-	itr = attribs.find( "respawnCount" );
-	if( itr != attribs.end() ) emitterTpl->respawnCount = atoi( itr->second.c_str() );
-	else result = false;
-	itr = attribs.find( "delay" );
-	if( itr != attribs.end() ) emitterTpl->delay = (float)atof( itr->second.c_str() );
-	itr = attribs.find( "emissionRate" );
-	if( itr != attribs.end() ) emitterTpl->emissionRate = (float)atof( itr->second.c_str() );
-	itr = attribs.find( "spreadAngle" );
-	if( itr != attribs.end() ) emitterTpl->spreadAngle = (float)atof( itr->second.c_str() );
-	itr = attribs.find( "forceX" );
-	if( itr != attribs.end() ) emitterTpl->fx = (float)atof( itr->second.c_str() );
-	itr = attribs.find( "forceY" );
-	if( itr != attribs.end() ) emitterTpl->fy = (float)atof( itr->second.c_str() );
-	itr = attribs.find( "forceZ" );
-	if( itr != attribs.end() ) emitterTpl->fz = (float)atof( itr->second.c_str() );
+	if( !attribs.getInt( "respawnCount", emitterTpl->respawnCount ) ) result = false;
+	attribs.getFloat( "delay", emitterTpl->delay );
+	attribs.getFloat( "emissionRate", emitterTpl->emissionRate );
+	attribs.getFloat( "spreadAngle", emitterTpl->spreadAngle );
+	attribs.getFloat( "forceX", emitterTpl->fx );
+	attribs.getFloat( "forceY", emitterTpl->fy );
+	attribs.getFloat( "forceZ", emitterTpl->fz );
 	
 	if( !result )
 	{
@@ -399,31 +407,103 @@ SceneNode *EmitterNode::factoryFunc( const SceneNodeTpl &nodeTpl )
 void EmitterNode::setMaxParticleCount( uint32 maxParticleCount )
 {
 	// Delete particles
-	delete[] _particles; _particles = 0x0;
+	delete[] _parStreams; _parStreams = 0x0;
 	delete[] _parPositions; _parPositions = 0x0;
 	delete[] _parSizesANDRotations; _parSizesANDRotations = 0x0;
 	delete[] _parColors; _parColors = 0x0;
 	
 	// Initialize particles
 	_particleCount = maxParticleCount;
-	_particles = new ParticleData[_particleCount];
+	_parStreams = new float[_particleCount * ParticleStreams::Count];
 	_parPositions = new float[_particleCount * 3];
 	_parSizesANDRotations = new float[_particleCount * 2];
 	_parColors = new float[_particleCount * 4];
+	memset( _parStreams, 0, _particleCount * ParticleStreams::Count * sizeof( float ) );
+	memset( _parPositions, 0, _particleCount * 3 * sizeof( float ) );
+	memset( _parSizesANDRotations, 0, _particleCount * 2 * sizeof( float ) );
+	memset( _parColors, 0, _particleCount * 4 * sizeof( float ) );
+	_parRespawnCounters.assign( _particleCount, 0 );
+
+	rebuildFreeList();
+	
+	// Instance buffer is recreated with the new size when the emitter is drawn the next time
+	releaseInstanceBuffer();
+}
+
+
+void EmitterNode::releaseInstanceBuffer()
+{
+	RenderDeviceInterface *rdi = Modules::renderer().getRenderDevice();
+	
+	if( _instanceGeo != 0 ) rdi->destroyGeometry( _instanceGeo, false );
+	if( _instanceBuf != 0 ) rdi->destroyBuffer( _instanceBuf );
+	_numInstances = 0;
+	_instanceDataDirty = true;
+}
+
+
+uint32 EmitterNode::uploadInstanceData()
+{
+	if( !_instanceDataDirty || _particleCount == 0 ) return _numInstances;
+	
+	RenderDeviceInterface *rdi = Modules::renderer().getRenderDevice();
+	uint32 bufSize = _particleCount * sizeof( ParticleInstanceData );
+	
+	if( _instanceGeo == 0 )
+	{
+		// The quad corners are shared by all emitters
+		_instanceBuf = rdi->createVertexBuffer( bufSize, 0x0 );
+		_instanceGeo = rdi->beginCreatingGeometry(
+			Modules::renderer().getDefaultVertexLayout( DefaultVertexLayouts::ParticleInstanced ) );
+		rdi->setGeomVertexParams( _instanceGeo, Modules::renderer().getParticleVBO(), 0, 0, sizeof( ParticleVert ) );
+		rdi->setGeomVertexParams( _instanceGeo, _instanceBuf, 1, 0, sizeof( ParticleInstanceData ) );
+		rdi->setGeomIndexParams( _instanceGeo, Modules::renderer().getQuadIdxBuf(), IDXFMT_16 );
+		rdi->finishCreatingGeometry( _instanceGeo );
+	}
+	
+	// Map the whole buffer so that the driver can discard the previous contents instead of
+	// waiting for the GPU, but only write the particles that are alive
+	ParticleInstanceData *instances = (ParticleInstanceData *)rdi->mapBuffer( _instanceGeo, _instanceBuf, 0, bufSize, Write );
+	if( instances == 0x0 ) return 0;
+
+	const float *life = getParticleStream( ParticleStreams::Life );
+	uint32 numInstances = 0;
 	for( uint32 i = 0; i < _particleCount; ++i )
 	{
-		_particles[i].life = 0;
-		_particles[i].respawnCounter = 0;
+		if( life[i] <= 0 ) continue;
 		
-		_parPositions[i*3+0] = 0.0f;
-		_parPositions[i*3+1] = 0.0f;
-		_parPositions[i*3+2] = 0.0f;
-		_parSizesANDRotations[i*2+0] = 0.0f;
-		_parSizesANDRotations[i*2+1] = 0.0f;
-		_parColors[i*4+0] = 0.0f;
-		_parColors[i*4+1] = 0.0f;
-		_parColors[i*4+2] = 0.0f;
-		_parColors[i*4+3] = 0.0f;
+		ParticleInstanceData &inst = instances[numInstances++];
+		inst.x = _parPositions[i * 3 + 0];
+		inst.y = _parPositions[i * 3 + 1];
+		inst.z = _parPositions[i * 3 + 2];
+		inst.size = _parSizesANDRotations[i * 2 + 0];
+		inst.rotation = _parSizesANDRotations[i * 2 + 1];
+		inst.r = _parColors[i * 4 + 0];
+		inst.g = _parColors[i * 4 + 1];
+		inst.b = _parColors[i * 4 + 2];
+		inst.a = _parColors[i * 4 + 3];
+	}
+	
+	rdi->unmapBuffer( _instanceGeo, _instanceBuf );
+	Modules::stats().incStat( EngineStats::ParticleUploadSize, (float)(numInstances * sizeof( ParticleInstanceData )) );
+
+	_numInstances = numInstances;
+	_instanceDataDirty = false;
+	
+	return _numInstances;
+}
+
+
+void EmitterNode::rebuildFreeList()
+{
+	_freeParticles.clear();
+	
+	// Reverse order so that particles are spawned from the front of the arrays
+	const float *life = getParticleStream( ParticleStreams::Life );
+	for( uint32 i = _particleCount; i-- > 0; )
+	{
+		if( life[i] <= 0 && ((int)_parRespawnCounters[i] < _respawnCount || _respawnCount < 0) )
+			_freeParticles.push_back( i );
 	}
 }
 
@@ -473,6 +553,7 @@ void EmitterNode::setParamI( int param, int value )
 		return;
 	case EmitterNodeParams::RespawnCountI:
 		_respawnCount = value;
+		rebuildFreeList();
 		return;
 	}
 
@@ -525,137 +606,320 @@ void EmitterNode::setParamF( int param, int compIdx, float value )
 }
 
 
-float randomF( float min, float max )
+float EmitterNode::randomF( float min, float max )
 {
-	return (rand() / (float)RAND_MAX) * (max - min) + min;
+	// Xorshift generator; much cheaper than rand() and safe to use on worker threads
+	_randomState ^= _randomState << 13;
+	_randomState ^= _randomState >> 17;
+	_randomState ^= _randomState << 5;
+	
+	return (_randomState >> 8) * (1.0f / 16777216.0f) * (max - min) + min;
 }
 
 
-void EmitterNode::update( float timeDelta )
+void EmitterNode::spawnParticles( float timeDelta, const Vec3f &motionVec )
 {
-	if( timeDelta == 0 || _effectRes == 0x0 ) return;
+	if( _emissionAccum < 1.0f || _freeParticles.empty() ) return;
 	
-	// Update absolute transformation
-	updateTree();
+	ParticleEffectResource &effect = *_effectRes;
 	
-	Timer *timer = Modules::stats().getTimer( EngineStats::ParticleSimTime );
-	if( Modules::config().gatherTimeStats ) timer->setEnabled( true );
+	// Particles are distributed along emitter's motion vector to avoid blobs when fps is low
+	float spawnCount = (float)std::min( (uint32)_freeParticles.size(), (uint32)ceilf( _emissionAccum ) );
+	float curStep = 0, stepWidth = 0.5f;
+	if( spawnCount > 2.0f ) stepWidth = motionVec.length() / spawnCount;
+
+	// The emitter rotation is the same for all particles, only the spread is random
+	float angle = degToRad( _spreadAngle / 2 );
+	Vec3f baseDir( -_absTrans.c[2][0], -_absTrans.c[2][1], -_absTrans.c[2][2] );
+	Vec3f dragVec = motionVec / timeDelta;
 	
-	Vec3f bBMin( Math::MaxFloat, Math::MaxFloat, Math::MaxFloat );
-	Vec3f bBMax( -Math::MaxFloat, -Math::MaxFloat, -Math::MaxFloat );
+	float *streams[ParticleStreams::Count];
+	for( uint32 i = 0; i < ParticleStreams::Count; ++i )
+		streams[i] = getParticleStream( (ParticleStreams::List)i );
 	
-	if( _delay <= 0 )
-		_emissionAccum += _emissionRate * timeDelta;
-	else
-		_delay -= timeDelta;
+	// Free particles are taken from the top of the stack; particles that are stillborn are kept
+	// directly above the remaining free ones so that they are not respawned again in this update
+	uint32 numFree = (uint32)_freeParticles.size(), numStillborn = 0;
+	while( _emissionAccum >= 1.0f && numFree > 0 )
+	{
+		uint32 i = _freeParticles[--numFree];
+		
+		// Respawn
+		float maxLife = randomF( effect._lifeMin, effect._lifeMax );
+		streams[ParticleStreams::Life][i] = maxLife;
+		streams[ParticleStreams::InvMaxLife][i] = maxLife > 0 ? 1.0f / maxLife : 0;
+		
+		float rx = randomF( -angle, angle ), ry = randomF( -angle, angle ), rz = randomF( -angle, angle );
+		Vec3f dir = (Matrix4f( Quaternion( rx, ry, rz ) ) * baseDir).normalized();
+		streams[ParticleStreams::DirX][i] = dir.x;
+		streams[ParticleStreams::DirY][i] = dir.y;
+		streams[ParticleStreams::DirZ][i] = dir.z;
+		streams[ParticleStreams::DragVecX][i] = dragVec.x;
+		streams[ParticleStreams::DragVecY][i] = dragVec.y;
+		streams[ParticleStreams::DragVecZ][i] = dragVec.z;
+		++_parRespawnCounters[i];
+
+		// Generate start values
+		streams[ParticleStreams::MoveVel0][i] = randomF( effect._moveVel.startMin, effect._moveVel.startMax );
+		streams[ParticleStreams::RotVel0][i] = randomF( effect._rotVel.startMin, effect._rotVel.startMax );
+		streams[ParticleStreams::Drag0][i] = randomF( effect._drag.startMin, effect._drag.startMax );
+		streams[ParticleStreams::Size0][i] = randomF( effect._size.startMin, effect._size.startMax );
+		streams[ParticleStreams::ColR0][i] = randomF( effect._colR.startMin, effect._colR.startMax );
+		streams[ParticleStreams::ColG0][i] = randomF( effect._colG.startMin, effect._colG.startMax );
+		streams[ParticleStreams::ColB0][i] = randomF( effect._colB.startMin, effect._colB.startMax );
+		streams[ParticleStreams::ColA0][i] = randomF( effect._colA.startMin, effect._colA.startMax );
+		
+		streams[ParticleStreams::PosX][i] = _absTrans.c[3][0] - motionVec.x * curStep;
+		streams[ParticleStreams::PosY][i] = _absTrans.c[3][1] - motionVec.y * curStep;
+		streams[ParticleStreams::PosZ][i] = _absTrans.c[3][2] - motionVec.z * curStep;
+		streams[ParticleStreams::Rotation][i] = randomF( 0, 360 );
 
-	Vec3f motionVec = _absTrans.getTrans() - _prevAbsTrans.getTrans();
+		// Update emitter
+		_emissionAccum -= 1.f;
+		if( _emissionAccum < 0 ) _emissionAccum = 0.f;
 
-	// Check how many particles will be spawned
-	float spawnCount = 0;
-	for( uint32 i = 0; i < _particleCount; ++i )
-	{
-		ParticleData &p = _particles[i];
-		if( p.life <= 0 && ((int)p.respawnCounter < _respawnCount || _respawnCount < 0) )
+		curStep += stepWidth;
+
+		// Particles without lifetime can be respawned in the next update
+		if( maxLife <= 0 && ((int)_parRespawnCounters[i] < _respawnCount || _respawnCount < 0) )
+		{
+			_freeParticles[numFree] = i;
+			++numStillborn;
+		}
+		else if( numStillborn > 0 )
 		{
-			spawnCount += 1.0f;
-			if( spawnCount >= _emissionAccum ) break;
+			_freeParticles[numFree] = _freeParticles[numFree + numStillborn];
 		}
 	}
 
-	// Particles are distributed along emitter's motion vector to avoid blobs when fps is low
-	float curStep = 0, stepWidth = 0.5f;
-	if( spawnCount > 2.0f ) stepWidth = motionVec.length() / spawnCount;
+	_freeParticles.resize( numFree + numStillborn );
+}
+
+
+struct ParticleSimParams
+{
+	float  *streams[ParticleStreams::Count];
+	float  *positions, *sizesAndRotations, *colors;
+	float  timeDelta;
+	float  force[3];
+	float  moveVelRate, rotVelRate, dragRate, sizeRate;  // End rate - 1
+	float  colRates[4];
+
+	const uint32           *respawnCounters;
+	int                    respawnCount;
+	std::vector< uint32 >  *freeParticles;
+};
+
+
+static inline void releaseParticle( const ParticleSimParams &sp, uint32 index )
+{
+	// Make dead particle available for respawning if it has not reached the respawn limit
+	if( (int)sp.respawnCounters[index] < sp.respawnCount || sp.respawnCount < 0 )
+		sp.freeParticles->push_back( index );
+}
+
+
+static void simulateParticles( const ParticleSimParams &sp, uint32 begin, uint32 end, Vec3f &bBMin, Vec3f &bBMax )
+{
+	float *const *s = sp.streams;
 	
-	for( uint32 i = 0; i < _particleCount; ++i )
+	for( uint32 i = begin; i < end; ++i )
 	{
-		ParticleData &p = _particles[i];
+		float life = s[ParticleStreams::Life][i];
+		if( life <= 0 ) continue;
 		
-		// Create particle
-		if( p.life <= 0 && ((int)p.respawnCounter < _respawnCount || _respawnCount < 0) )
+		// Interpolate data
+		float fac = 1.0f - life * s[ParticleStreams::InvMaxLife][i];
+		float moveVel = s[ParticleStreams::MoveVel0][i] * (1.0f + sp.moveVelRate * fac);
+		float rotVel = s[ParticleStreams::RotVel0][i] * (1.0f + sp.rotVelRate * fac);
+		float drag = s[ParticleStreams::Drag0][i] * (1.0f + sp.dragRate * fac);
+		
+		// Update particle position and rotation
+		float x = s[ParticleStreams::PosX][i] += (s[ParticleStreams::DirX][i] * moveVel +
+			s[ParticleStreams::DragVecX][i] * drag + sp.force[0]) * sp.timeDelta;
+		float y = s[ParticleStreams::PosY][i] += (s[ParticleStreams::DirY][i] * moveVel +
+			s[ParticleStreams::DragVecY][i] * drag + sp.force[1]) * sp.timeDelta;
+		float z = s[ParticleStreams::PosZ][i] += (s[ParticleStreams::DirZ][i] * moveVel +
+			s[ParticleStreams::DragVecZ][i] * drag + sp.force[2]) * sp.timeDelta;
+		float rot = s[ParticleStreams::Rotation][i] += degToRad( rotVel ) * sp.timeDelta;
+
+		// Decrease lifetime; dying particles are hidden by setting their size to zero
+		life = s[ParticleStreams::Life][i] = life - sp.timeDelta;
+		
+		// Size is doubled to keep compatibility with old particle vertex shader
+		sp.positions[i * 3 + 0] = x;
+		sp.positions[i * 3 + 1] = y;
+		sp.positions[i * 3 + 2] = z;
+		sp.sizesAndRotations[i * 2 + 0] = life > 0 ? s[ParticleStreams::Size0][i] * (1.0f + sp.sizeRate * fac) * 2 : 0;
+		sp.sizesAndRotations[i * 2 + 1] = rot;
+		sp.colors[i * 4 + 0] = s[ParticleStreams::ColR0][i] * (1.0f + sp.colRates[0] * fac);
+		sp.colors[i * 4 + 1] = s[ParticleStreams::ColG0][i] * (1.0f + sp.colRates[1] * fac);
+		sp.colors[i * 4 + 2] = s[ParticleStreams::ColB0][i] * (1.0f + sp.colRates[2] * fac);
+		sp.colors[i * 4 + 3] = s[ParticleStreams::ColA0][i] * (1.0f + sp.colRates[3] * fac);
+
+		if( life <= 0 ) releaseParticle( sp, i );
+
+		bBMin.x = std::min( bBMin.x, x ); bBMax.x = std::max( bBMax.x, x );
+		bBMin.y = std::min( bBMin.y, y ); bBMax.y = std::max( bBMax.y, y );
+		bBMin.z = std::min( bBMin.z, z ); bBMax.z = std::max( bBMax.z, z );
+	}
+}
+
+
+#if defined( H3D_SIMD_SSE2 )
+static inline __m128 interpolateSSE( const float *startValues, __m128 rate, __m128 fac )
+{
+	return _mm_mul_ps( _mm_loadu_ps( startValues ), _mm_add_ps( _mm_set1_ps( 1.0f ), _mm_mul_ps( rate, fac ) ) );
+}
+
+
+static uint32 simulateParticlesSSE( const ParticleSimParams &sp, uint32 count, Vec3f &bBMin, Vec3f &bBMax )
+{
+	// Processes four particles at a time; results of dead particles are masked out
+	float *const *s = sp.streams;
+	const __m128 zero = _mm_setzero_ps(), two = _mm_set1_ps( 2.0f );
+	const __m128 dt = _mm_set1_ps( sp.timeDelta ), rotDt = _mm_set1_ps( degToRad( 1.0f ) * sp.timeDelta );
+	const __m128 forceX = _mm_set1_ps( sp.force[0] ), forceY = _mm_set1_ps( sp.force[1] ), forceZ = _mm_set1_ps( sp.force[2] );
+	const __m128 moveVelRate = _mm_set1_ps( sp.moveVelRate ), rotVelRate = _mm_set1_ps( sp.rotVelRate );
+	const __m128 dragRate = _mm_set1_ps( sp.dragRate ), sizeRate = _mm_set1_ps( sp.sizeRate );
+	const __m128 colRateR = _mm_set1_ps( sp.colRates[0] ), colRateG = _mm_set1_ps( sp.colRates[1] );
+	const __m128 colRateB = _mm_set1_ps( sp.colRates[2] ), colRateA = _mm_set1_ps( sp.colRates[3] );
+	
+	__m128 minX = _mm_set1_ps( bBMin.x ), minY = _mm_set1_ps( bBMin.y ), minZ = _mm_set1_ps( bBMin.z );
+	__m128 maxX = _mm_set1_ps( bBMax.x ), maxY = _mm_set1_ps( bBMax.y ), maxZ = _mm_set1_ps( bBMax.z );
+	const __m128 maxFloat = _mm_set1_ps( Math::MaxFloat ), minFloat = _mm_set1_ps( -Math::MaxFloat );
+
+	uint32 i = 0;
+	for( ; i + 4 <= count; i += 4 )
+	{
+		__m128 life = _mm_loadu_ps( s[ParticleStreams::Life] + i );
+		__m128 alive = _mm_cmpgt_ps( life, zero );
+		if( _mm_movemask_ps( alive ) == 0 ) continue;
+
+		// Interpolate data
+		__m128 fac = _mm_sub_ps( _mm_set1_ps( 1.0f ), _mm_mul_ps( life, _mm_loadu_ps( s[ParticleStreams::InvMaxLife] + i ) ) );
+		__m128 moveVel = interpolateSSE( s[ParticleStreams::MoveVel0] + i, moveVelRate, fac );
+		__m128 rotVel = interpolateSSE( s[ParticleStreams::RotVel0] + i, rotVelRate, fac );
+		__m128 drag = interpolateSSE( s[ParticleStreams::Drag0] + i, dragRate, fac );
+
+		// Update particle position and rotation
+		__m128 vx = _mm_add_ps( _mm_add_ps( _mm_mul_ps( _mm_loadu_ps( s[ParticleStreams::DirX] + i ), moveVel ),
+			_mm_mul_ps( _mm_loadu_ps( s[ParticleStreams::DragVecX] + i ), drag ) ), forceX );
+		__m128 vy = _mm_add_ps( _mm_add_ps( _mm_mul_ps( _mm_loadu_ps( s[ParticleStreams::DirY] + i ), moveVel ),
+			_mm_mul_ps( _mm_loadu_ps( s[ParticleStreams::DragVecY] + i ), drag ) ), forceY );
+		__m128 vz = _mm_add_ps( _mm_add_ps( _mm_mul_ps( _mm_loadu_ps( s[ParticleStreams::DirZ] + i ), moveVel ),
+			_mm_mul_ps( _mm_loadu_ps( s[ParticleStreams::DragVecZ] + i ), drag ) ), forceZ );
+		__m128 x = _mm_add_ps( _mm_loadu_ps( s[ParticleStreams::PosX] + i ), _mm_and_ps( alive, _mm_mul_ps( vx, dt ) ) );
+		__m128 y = _mm_add_ps( _mm_loadu_ps( s[ParticleStreams::PosY] + i ), _mm_and_ps( alive, _mm_mul_ps( vy, dt ) ) );
+		__m128 z = _mm_add_ps( _mm_loadu_ps( s[ParticleStreams::PosZ] + i ), _mm_and_ps( alive, _mm_mul_ps( vz, dt ) ) );
+		__m128 rot = _mm_add_ps( _mm_loadu_ps( s[ParticleStreams::Rotation] + i ), _mm_and_ps( alive, _mm_mul_ps( rotVel, rotDt ) ) );
+		_mm_storeu_ps( s[ParticleStreams::PosX] + i, x );
+		_mm_storeu_ps( s[ParticleStreams::PosY] + i, y );
+		_mm_storeu_ps( s[ParticleStreams::PosZ] + i, z );
+		_mm_storeu_ps( s[ParticleStreams::Rotation] + i, rot );
+		
+		// Decrease lifetime; dead particles are hidden by a size of zero
+		__m128 newLife = _mm_sub_ps( life, _mm_and_ps( alive, dt ) );
+		_mm_storeu_ps( s[ParticleStreams::Life] + i, newLife );
+		__m128 aliveAfter = _mm_cmpgt_ps( newLife, zero );
+		__m128 size = _mm_and_ps( aliveAfter, _mm_mul_ps( interpolateSSE( s[ParticleStreams::Size0] + i, sizeRate, fac ), two ) );
+		
+		int dyingMask = _mm_movemask_ps( _mm_andnot_ps( aliveAfter, alive ) );
+		for( uint32 j = 0; dyingMask != 0; ++j, dyingMask >>= 1 )
 		{
-			if( _emissionAccum >= 1.0f )
-			{
-				// Respawn
-				p.maxLife = randomF( _effectRes->_lifeMin, _effectRes->_lifeMax );
-				p.life = p.maxLife;
-				float angle = degToRad( _spreadAngle / 2 );
-				Matrix4f m = _absTrans;
-				m.c[3][0] = 0; m.c[3][1] = 0; m.c[3][2] = 0;
-				m.rotate( randomF( -angle, angle ), randomF( -angle, angle ), randomF( -angle, angle ) );
-				p.dir = (m * Vec3f( 0, 0, -1 )).normalized();
-				p.dragVec = motionVec / timeDelta;
-				++p.respawnCounter;
-
-				// Generate start values
-				p.moveVel0 = randomF( _effectRes->_moveVel.startMin, _effectRes->_moveVel.startMax );
-				p.rotVel0 = randomF( _effectRes->_rotVel.startMin, _effectRes->_rotVel.startMax );
-				p.drag0 = randomF( _effectRes->_drag.startMin, _effectRes->_drag.startMax );
-				p.size0 = randomF( _effectRes->_size.startMin, _effectRes->_size.startMax );
-				p.r0 = randomF( _effectRes->_colR.startMin, _effectRes->_colR.startMax );
-				p.g0 = randomF( _effectRes->_colG.startMin, _effectRes->_colG.startMax );
-				p.b0 = randomF( _effectRes->_colB.startMin, _effectRes->_colB.startMax );
-				p.a0 = randomF( _effectRes->_colA.startMin, _effectRes->_colA.startMax );
-				
-				// Update arrays
-				_parPositions[i * 3 + 0] = _absTrans.c[3][0] - motionVec.x * curStep;
-				_parPositions[i * 3 + 1] = _absTrans.c[3][1] - motionVec.y * curStep;
-				_parPositions[i * 3 + 2] = _absTrans.c[3][2] - motionVec.z * curStep;
-				_parSizesANDRotations[i * 2 + 0] = p.size0;
-				_parSizesANDRotations[i * 2 + 1] = randomF( 0, 360 );
-				_parColors[i * 4 + 0] = p.r0;
-				_parColors[i * 4 + 1] = p.g0;
-				_parColors[i * 4 + 2] = p.b0;
-				_parColors[i * 4 + 3] = p.a0;
-
-				// Update emitter
-				_emissionAccum -= 1.f;
-				if( _emissionAccum < 0 ) _emissionAccum = 0.f;
-
-				curStep += stepWidth;
-			}
+			if( dyingMask & 1 ) releaseParticle( sp, i + j );
 		}
-		
-		// Update particle
-		if( p.life > 0 )
+
+		// Write interleaved render data; dead particles are invisible, so only their size matters
+		float xs[4], ys[4], zs[4];
+		_mm_storeu_ps( xs, x ); _mm_storeu_ps( ys, y ); _mm_storeu_ps( zs, z );
+		float *pos = sp.positions + i * 3;
+		for( uint32 j = 0; j < 4; ++j )
 		{
-			// Interpolate data
-			float fac = 1.0f - (p.life / p.maxLife);
-			
-			float moveVel = p.moveVel0 * (1.0f + (_effectRes->_moveVel.endRate - 1.0f) * fac);
-			float rotVel = p.rotVel0 * (1.0f + (_effectRes->_rotVel.endRate - 1.0f) * fac);
-			float drag = p.drag0 * (1.0f + (_effectRes->_drag.endRate - 1.0f) * fac);
-			_parSizesANDRotations[i * 2 + 0] = p.size0 * (1.0f + (_effectRes->_size.endRate - 1.0f) * fac);
-			_parSizesANDRotations[i * 2 + 0] *= 2;  // Keep compatibility with old particle vertex shader
-			_parColors[i * 4 + 0] = p.r0 * (1.0f + (_effectRes->_colR.endRate - 1.0f) * fac);
-			_parColors[i * 4 + 1] = p.g0 * (1.0f + (_effectRes->_colG.endRate - 1.0f) * fac);
-			_parColors[i * 4 + 2] = p.b0 * (1.0f + (_effectRes->_colB.endRate - 1.0f) * fac);
-			_parColors[i * 4 + 3] = p.a0 * (1.0f + (_effectRes->_colA.endRate - 1.0f) * fac);
-
-			// Update particle position and rotation
-			_parPositions[i * 3 + 0] += (p.dir.x * moveVel + p.dragVec.x * drag + _force.x) * timeDelta;
-			_parPositions[i * 3 + 1] += (p.dir.y * moveVel + p.dragVec.y * drag + _force.y) * timeDelta;
-			_parPositions[i * 3 + 2] += (p.dir.z * moveVel + p.dragVec.z * drag + _force.z) * timeDelta;
-			_parSizesANDRotations[i * 2 + 1] += degToRad( rotVel ) * timeDelta;
-
-			// Decrease lifetime
-			p.life -= timeDelta;
-			
-			// Check if particle is dying
-			if( p.life <= 0 )
-			{
-				_parSizesANDRotations[i * 2 + 0] = 0.0f;
-			}
+			pos[j * 3 + 0] = xs[j]; pos[j * 3 + 1] = ys[j]; pos[j * 3 + 2] = zs[j];
 		}
+		_mm_storeu_ps( sp.sizesAndRotations + i * 2, _mm_unpacklo_ps( size, rot ) );
+		_mm_storeu_ps( sp.sizesAndRotations + i * 2 + 4, _mm_unpackhi_ps( size, rot ) );
+		
+		__m128 r = interpolateSSE( s[ParticleStreams::ColR0] + i, colRateR, fac );
+		__m128 g = interpolateSSE( s[ParticleStreams::ColG0] + i, colRateG, fac );
+		__m128 b = interpolateSSE( s[ParticleStreams::ColB0] + i, colRateB, fac );
+		__m128 a = interpolateSSE( s[ParticleStreams::ColA0] + i, colRateA, fac );
+		_MM_TRANSPOSE4_PS( r, g, b, a );
+		_mm_storeu_ps( sp.colors + i * 4 + 0, r );
+		_mm_storeu_ps( sp.colors + i * 4 + 4, g );
+		_mm_storeu_ps( sp.colors + i * 4 + 8, b );
+		_mm_storeu_ps( sp.colors + i * 4 + 12, a );
+
+		// Update bounding box with particles that were alive
+		minX = _mm_min_ps( minX, _mm_or_ps( _mm_and_ps( alive, x ), _mm_andnot_ps( alive, maxFloat ) ) );
+		minY = _mm_min_ps( minY, _mm_or_ps( _mm_and_ps( alive, y ), _mm_andnot_ps( alive, maxFloat ) ) );
+		minZ = _mm_min_ps( minZ, _mm_or_ps( _mm_and_ps( alive, z ), _mm_andnot_ps( alive, maxFloat ) ) );
+		maxX = _mm_max_ps( maxX, _mm_or_ps( _mm_and_ps( alive, x ), _mm_andnot_ps( alive, minFloat ) ) );
+		maxY = _mm_max_ps( maxY, _mm_or_ps( _mm_and_ps( alive, y ), _mm_andnot_ps( alive, minFloat ) ) );
+		maxZ = _mm_max_ps( maxZ, _mm_or_ps( _mm_and_ps( alive, z ), _mm_andnot_ps( alive, minFloat ) ) );
+	}
+
+	float v[4];
+	_mm_storeu_ps( v, minX ); bBMin.x = std::min( std::min( v[0], v[1] ), std::min( v[2], v[3] ) );
+	_mm_storeu_ps( v, minY ); bBMin.y = std::min( std::min( v[0], v[1] ), std::min( v[2], v[3] ) );
+	_mm_storeu_ps( v, minZ ); bBMin.z = std::min( std::min( v[0], v[1] ), std::min( v[2], v[3] ) );
+	_mm_storeu_ps( v, maxX ); bBMax.x = std::max( std::max( v[0], v[1] ), std::max( v[2], v[3] ) );
+	_mm_storeu_ps( v, maxY ); bBMax.y = std::max( std::max( v[0], v[1] ), std::max( v[2], v[3] ) );
+	_mm_storeu_ps( v, maxZ ); bBMax.z = std::max( std::max( v[0], v[1] ), std::max( v[2], v[3] ) );
+
+	return i;
+}
+#endif
+
+
+void EmitterNode::simulate( float timeDelta )
+{
+	if( _delay <= 0 )
+		_emissionAccum += _emissionRate * timeDelta;
+	else
+		_delay -= timeDelta;
+
+	Vec3f motionVec = _absTrans.getTrans() - _prevAbsTrans.getTrans();
+
+	spawnParticles( timeDelta, motionVec );
+
+	ParticleSimParams sp;
+	for( uint32 i = 0; i < ParticleStreams::Count; ++i )
+		sp.streams[i] = getParticleStream( (ParticleStreams::List)i );
+	sp.positions = _parPositions;
+	sp.sizesAndRotations = _parSizesANDRotations;
+	sp.colors = _parColors;
+	sp.timeDelta = timeDelta;
+	sp.force[0] = _force.x; sp.force[1] = _force.y; sp.force[2] = _force.z;
+	sp.moveVelRate = _effectRes->_moveVel.endRate - 1.0f;
+	sp.rotVelRate = _effectRes->_rotVel.endRate - 1.0f;
+	sp.dragRate = _effectRes->_drag.endRate - 1.0f;
+	sp.sizeRate = _effectRes->_size.endRate - 1.0f;
+	sp.colRates[0] = _effectRes->_colR.endRate - 1.0f;
+	sp.colRates[1] = _effectRes->_colG.endRate - 1.0f;
+	sp.colRates[2] = _effectRes->_colB.endRate - 1.0f;
+	sp.colRates[3] = _effectRes->_colA.endRate - 1.0f;
+
+	sp.respawnCounters = _parRespawnCounters.empty() ? 0x0 : &_parRespawnCounters[0];
+	sp.respawnCount = _respawnCount;
+	sp.freeParticles = &_freeParticles;
+	
+	Vec3f bBMin( Math::MaxFloat, Math::MaxFloat, Math::MaxFloat );
+	Vec3f bBMax( -Math::MaxFloat, -Math::MaxFloat, -Math::MaxFloat );
+	uint32 first = 0;
+	
+#if defined( H3D_SIMD_SSE2 )
+	first = simulateParticlesSSE( sp, _particleCount, bBMin, bBMax );
+#endif
+	simulateParticles( sp, first, _particleCount, bBMin, bBMax );
+
 
-		// Update bounding box
-		Vec3f vertPos( _parPositions[i*3+0], _parPositions[i*3+1], _parPositions[i*3+2] );
-		if( vertPos.x < bBMin.x ) bBMin.x = vertPos.x;
-		if( vertPos.y < bBMin.y ) bBMin.y = vertPos.y;
-		if( vertPos.z < bBMin.z ) bBMin.z = vertPos.z;
-		if( vertPos.x > bBMax.x ) bBMax.x = vertPos.x;
-		if( vertPos.y > bBMax.y ) bBMax.y = vertPos.y;
-		if( vertPos.z > bBMax.z ) bBMax.z = vertPos.z;
+	if( bBMin.x > bBMax.x )
+	{
+		// No living particles
+		bBMin = _absTrans.getTrans();
+		bBMax = bBMin;
 	}
 
 	// Avoid zero box dimensions for planes
@@ -665,10 +929,76 @@ void EmitterNode::update( float timeDelta )
 	
 	_bBox.min = bBMin;
 	_bBox.max = bBMax;
+	Modules::sceneMan().updateSpatialNode( _sgHandle );
 
 	_prevAbsTrans = _absTrans;
+	_instanceDataDirty = true;
+}
+
+
+void EmitterNode::update( float timeDelta )
+{
+	if( timeDelta == 0 || _effectRes == 0x0 ) return;
+	
+	ProfileScope profileScope( "UpdateEmitter", _name );
+
+	// Update absolute transformation
+	updateTree();
+	
+	Timer *timer = Modules::stats().getTimer( EngineStats::ParticleSimTime );
+	if( Modules::config().gatherTimeStats ) timer->setEnabled( true );
+	
+	simulate( timeDelta );
+
+	timer->setEnabled( false );
+}
+
+
+struct EmitterUpdateBatch
+{
+	std::vector< EmitterNode * >  emitters;
+	float                         timeDelta;
+
+
+	static void simulateEmitters( void *userData, uint32 begin, uint32 end )
+	{
+		ProfileScope profileScope( "SimulateEmitters" );
+		EmitterUpdateBatch &batch = *(EmitterUpdateBatch *)userData;
+		for( uint32 i = begin; i < end; ++i )
+			batch.emitters[i]->simulate( batch.timeDelta );
+	}
+};
+
+
+void EmitterNode::updateEmitters( EmitterNode *const *emitters, uint32 count, float timeDelta )
+{
+	if( timeDelta == 0 ) return;
+	
+	ProfileScope profileScope( "UpdateEmitters" );
+	EmitterUpdateBatch batch;
+	batch.timeDelta = timeDelta;
+	
+	// Transformations are updated sequentially since emitters can share dirty ancestors
+	batch.emitters.reserve( count );
+	for( uint32 i = 0; i < count; ++i )
+	{
+		EmitterNode *emitter = emitters[i];
+		if( emitter->_inUpdateBatch || emitter->_effectRes == 0x0 ) continue;
+		
+		emitter->_inUpdateBatch = true;
+		emitter->updateTree();
+		batch.emitters.push_back( emitter );
+	}
+
+	Timer *timer = Modules::stats().getTimer( EngineStats::ParticleSimTime );
+	if( Modules::config().gatherTimeStats ) timer->setEnabled( true );
+	
+	Modules::threadPool().parallelFor( (uint32)batch.emitters.size(), 1, EmitterUpdateBatch::simulateEmitters, &batch );
 
 	timer->setEnabled( false );
+
+	for( size_t i = 0, s = batch.emitters.size(); i < s; ++i )
+		batch.emitters[i]->_inUpdateBatch = false;
 }
 
 
@@ -676,9 +1006,10 @@ bool EmitterNode::hasFinished() const
 {
 	if( _respawnCount < 0 ) return false;
 
+	const float *life = getParticleStream( ParticleStreams::Life );
 	for( uint32 i = 0; i < _particleCount; ++i )
 	{	
-		if( _particles[i].life > 0 || (int)_particles[i].respawnCounter < _respawnCount )
+		if( life[i] > 0 || (int)_parRespawnCounters[i] < _respawnCount )
 		{
 			return false;
 		}
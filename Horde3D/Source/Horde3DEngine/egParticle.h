@@ -137,16 +137,24 @@ struct EmitterNodeTpl : public SceneNodeTpl
 
 // =================================================================================================
 
-struct ParticleData
+struct ParticleStreams
 {
-	float   life, maxLife;
-	Vec3f   dir, dragVec;
-	uint32  respawnCounter;
-
-	// Start values
-	float  moveVel0, rotVel0, drag0;
-	float  size0;
-	float  r0, g0, b0, a0;
+	enum List
+	{
+		Life = 0,
+		InvMaxLife,
+		DirX, DirY, DirZ,
+		DragVecX, DragVecY, DragVecZ,
+		PosX, PosY, PosZ,
+		Rotation,
+
+		// Start values
+		MoveVel0, RotVel0, Drag0,
+		Size0,
+		ColR0, ColG0, ColB0, ColA0,
+
+		Count
+	};
 };
 
 // =================================================================================================
@@ -154,7 +162,7 @@ struct ParticleData
 class EmitterNode : public SceneNode
 {
 public:
-	static SceneNodeTpl *parsingFunc( std::map< std::string, std::string > &attribs );
+	static SceneNodeTpl *parsingFunc( const SceneNodeAttribs &attribs );
 	static SceneNode *factoryFunc( const SceneNodeTpl &nodeTpl );
 
 	~EmitterNode();
@@ -167,9 +175,20 @@ public:
 	void update( float timeDelta );
 	bool hasFinished() const;
 
+	static void updateEmitters( EmitterNode *const *emitters, uint32 count, float timeDelta );
+
+	float *getParticleStream( ParticleStreams::List stream ) const
+		{ return _parStreams + stream * _particleCount; }
+	uint32 uploadInstanceData();
+
 protected:
 	EmitterNode( const EmitterNodeTpl &emitterTpl );
 	void setMaxParticleCount( uint32 maxParticleCount );
+	void rebuildFreeList();
+	float randomF( float min, float max );
+	void spawnParticles( float timeDelta, const Vec3f &motionVec );
+	void simulate( float timeDelta );
+	void releaseInstanceBuffer();
 
 protected:
 	// Emitter data
@@ -184,17 +203,28 @@ protected:
 	float                    _delay, _emissionRate, _spreadAngle;
 	Vec3f                    _force;
 
-	// Particle data
-	ParticleData             *_particles;
+	// Particle data; the simulation state is stored in one stream per attribute while the
+	// remaining arrays hold the interleaved data that is used for rendering
+	float                    *_parStreams;
+	std::vector< uint32 >    _parRespawnCounters;
+	std::vector< uint32 >    _freeParticles;  // Dead particles that can be respawned
+	uint32                   _randomState;
+	bool                     _inUpdateBatch;
 	float                    *_parPositions;
 	float                    *_parSizesANDRotations;
 	float                    *_parColors;
 
+	// GPU instance data of living particles, updated at most once per simulation step
+	uint32                   _instanceGeo, _instanceBuf;
+	uint32                   _numInstances;
+	bool                     _instanceDataDirty;
+
 	std::vector< uint32 >    _occQueries;
 	std::vector< uint32 >    _lastVisited;
 
 	friend class SceneManager;
 	friend class Renderer;
+	friend struct EmitterUpdateBatch;
 };
 
 }
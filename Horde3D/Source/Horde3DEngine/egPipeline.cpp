@@ -179,10 +179,12 @@ const string PipelineResource::parseStage( XMLNode &node, PipelineStage &stage )
 			
 			stage.commands.push_back( PipelineCommand( PipelineCommands::DrawGeometry ) );
 			vector< PipeCmdParam > &params = stage.commands.back().params;
-			params.resize( 3 );			
+			params.resize( 5 );			
 			params[0].setString( node1.getAttribute( "context" ) );
 			params[1].setString( node1.getAttribute( "class", "" ) );
 			params[2].setInt( order );
+			params[3].setInt( (int)ShaderResource::getContextId( params[0].getString() ) );
+			params[4].setInt( (int)MaterialResource::getClassFilterId( params[1].getString() ) );
 		}
 		else if( strcmp( node1.getName(), "DrawOverlays" ) == 0 )
 		{
@@ -190,8 +192,9 @@ const string PipelineResource::parseStage( XMLNode &node, PipelineStage &stage )
 			
 			stage.commands.push_back( PipelineCommand( PipelineCommands::DrawOverlays ) );
 			vector< PipeCmdParam > &params = stage.commands.back().params;
-			params.resize( 1 );
+			params.resize( 2 );
 			params[0].setString( node1.getAttribute( "context" ) );
+			params[1].setInt( (int)ShaderResource::getContextId( params[0].getString() ) );
 		}
 		else if( strcmp( node1.getName(), "DrawQuad" ) == 0 )
 		{
@@ -203,9 +206,10 @@ const string PipelineResource::parseStage( XMLNode &node, PipelineStage &stage )
 			
 			stage.commands.push_back( PipelineCommand( PipelineCommands::DrawQuad ) );
 			vector< PipeCmdParam > &params = stage.commands.back().params;
-			params.resize( 2 );
+			params.resize( 3 );
 			params[0].setResource( Modules::resMan().resolveResHandle( matRes ) );
 			params[1].setString( node1.getAttribute( "context" ) );
+			params[2].setInt( (int)ShaderResource::getContextId( params[1].getString() ) );
 		}
 		else if( strcmp( node1.getName(), "DoForwardLightLoop" ) == 0 )
 		{
@@ -217,19 +221,60 @@ const string PipelineResource::parseStage( XMLNode &node, PipelineStage &stage )
 
 			stage.commands.push_back( PipelineCommand( PipelineCommands::DoForwardLightLoop ) );
 			vector< PipeCmdParam > &params = stage.commands.back().params;
-			params.resize( 4 );
+			params.resize( 6 );
 			params[0].setString( node1.getAttribute( "context", "" ) );
 			params[1].setString( node1.getAttribute( "class", "" ) );
 			params[2].setBool( _stricmp( node1.getAttribute( "noShadows", "false" ), "true" ) == 0 );
 			params[3].setInt( order );
+			params[4].setInt( (int)ShaderResource::getContextId( params[0].getString() ) );
+			params[5].setInt( (int)MaterialResource::getClassFilterId( params[1].getString() ) );
 		}
 		else if( strcmp( node1.getName(), "DoDeferredLightLoop" ) == 0 )
 		{
 			stage.commands.push_back( PipelineCommand( PipelineCommands::DoDeferredLightLoop ) );
 			vector< PipeCmdParam > &params = stage.commands.back().params;
-			params.resize( 2 );
+			params.resize( 3 );
 			params[0].setString( node1.getAttribute( "context", "" ) );
 			params[1].setBool( _stricmp( node1.getAttribute( "noShadows", "false" ), "true" ) == 0 );
+			params[2].setInt( (int)ShaderResource::getContextId( params[0].getString() ) );
+		}
+		else if( strcmp( node1.getName(), "DoClusteredLightLoop" ) == 0 )
+		{
+			if( !node1.getAttribute( "context" ) ) return "Missing DoClusteredLightLoop attribute 'context'";
+			
+			const char *orderStr = node1.getAttribute( "order", "" );
+			int order = RenderingOrder::StateChanges;
+			if( _stricmp( orderStr, "FRONT_TO_BACK" ) == 0 ) order = RenderingOrder::FrontToBack;
+			else if( _stricmp( orderStr, "BACK_TO_FRONT" ) == 0 ) order = RenderingOrder::BackToFront;
+			else if( _stricmp( orderStr, "NONE" ) == 0 ) order = RenderingOrder::None;
+
+			int tilesX = atoi( node1.getAttribute( "tilesX", "16" ) );
+			int tilesY = atoi( node1.getAttribute( "tilesY", "9" ) );
+			int slices = atoi( node1.getAttribute( "slices", "24" ) );
+			if( tilesX < 1 || tilesX > 64 || tilesY < 1 || tilesY > 64 || slices < 1 || slices > 64 )
+				return "DoClusteredLightLoop attributes 'tilesX', 'tilesY' and 'slices' must be in the range 1..64";
+
+			// With a material, a full-screen quad is drawn instead of the scene geometry
+			Resource *matRes = 0x0;
+			if( *node1.getAttribute( "material" ) != '\0' )
+			{
+				uint32 matHandle = Modules::resMan().addResource(
+					ResourceTypes::Material, node1.getAttribute( "material" ), 0, false );
+				matRes = Modules::resMan().resolveResHandle( matHandle );
+			}
+			
+			stage.commands.push_back( PipelineCommand( PipelineCommands::DoClusteredLightLoop ) );
+			vector< PipeCmdParam > &params = stage.commands.back().params;
+			params.resize( 9 );
+			params[0].setString( node1.getAttribute( "context" ) );
+			params[1].setString( node1.getAttribute( "class", "" ) );
+			params[2].setInt( order );
+			params[3].setInt( (int)ShaderResource::getContextId( params[0].getString() ) );
+			params[4].setInt( (int)MaterialResource::getClassFilterId( params[1].getString() ) );
+			params[5].setResource( matRes );
+			params[6].setInt( tilesX );
+			params[7].setInt( tilesY );
+			params[8].setInt( slices );
 		}
 // 		else if ( strcmp( node1.getName(), "DispatchComputeShader" ) == 0 )
 // 		{
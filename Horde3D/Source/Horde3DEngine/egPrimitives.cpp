@@ -14,6 +14,14 @@
 
 #include "utDebug.h"
 
+#if defined( H3D_SIMD_AVX2 )
+#	include <immintrin.h>
+#elif defined( H3D_SIMD_SSE2 )
+#	include <emmintrin.h>
+#elif defined( H3D_SIMD_NEON )
+#	include <arm_neon.h>
+#endif
+
 
 namespace Horde3D {
 
@@ -171,6 +179,159 @@ bool Frustum::cullBox( BoundingBox &b ) const
 }
 
 
+bool Frustum::cullBox( const BoundingBox &b, uint32 &planeMask ) const
+{
+	// Only planes with a set bit in planeMask are tested; bits of planes that contain the box
+	// completely are cleared so that children of the box can skip them
+	for( uint32 i = 0; i < 6; ++i )
+	{
+		const uint32 bit = 1 << i;
+		if( !(planeMask & bit) ) continue;
+		
+		const Vec3f &n = _planes[i].normal;
+		
+		Vec3f positive = b.min, negative = b.max;
+		if( n.x <= 0 ) { positive.x = b.max.x; negative.x = b.min.x; }
+		if( n.y <= 0 ) { positive.y = b.max.y; negative.y = b.min.y; }
+		if( n.z <= 0 ) { positive.z = b.max.z; negative.z = b.min.z; }
+
+		if( _planes[i].distToPoint( positive ) > 0 ) return true;
+		if( _planes[i].distToPoint( negative ) <= 0 ) planeMask &= ~bit;
+	}
+	
+	return false;
+}
+
+
+uint32 Frustum::cullBoxes( const BoundingBoxArray &boxes, const uint32 *indices, uint32 count, uint32 *visible ) const
+{
+	// Tests the boxes with the given indices against all planes and writes the indices of the
+	// boxes that are not culled to visible; visible may point to indices for in-place compaction
+	if( count == 0 ) return 0;
+	
+	const float *minX = &boxes.minX[0], *minY = &boxes.minY[0], *minZ = &boxes.minZ[0];
+	const float *maxX = &boxes.maxX[0], *maxY = &boxes.maxY[0], *maxZ = &boxes.maxZ[0];
+	uint32 numVisible = 0, i = 0;
+
+#if defined( H3D_SIMD_AVX2 )
+	for( ; i + 8 <= count; i += 8 )
+	{
+		__m256i idx = _mm256_loadu_si256( (const __m256i *)&indices[i] );
+		__m256 bMinX = _mm256_i32gather_ps( minX, idx, 4 ), bMaxX = _mm256_i32gather_ps( maxX, idx, 4 );
+		__m256 bMinY = _mm256_i32gather_ps( minY, idx, 4 ), bMaxY = _mm256_i32gather_ps( maxY, idx, 4 );
+		__m256 bMinZ = _mm256_i32gather_ps( minZ, idx, 4 ), bMaxZ = _mm256_i32gather_ps( maxZ, idx, 4 );
+		__m256 outside = _mm256_setzero_ps();
+
+		for( uint32 j = 0; j < 6; ++j )
+		{
+			const Vec3f &n = _planes[j].normal;
+			__m256 dist = _mm256_add_ps(
+				_mm256_add_ps( _mm256_mul_ps( _mm256_set1_ps( n.x ), n.x <= 0 ? bMaxX : bMinX ),
+				               _mm256_mul_ps( _mm256_set1_ps( n.y ), n.y <= 0 ? bMaxY : bMinY ) ),
+				_mm256_add_ps( _mm256_mul_ps( _mm256_set1_ps( n.z ), n.z <= 0 ? bMaxZ : bMinZ ),
+				               _mm256_set1_ps( _planes[j].dist ) ) );
+			outside = _mm256_or_ps( outside, _mm256_cmp_ps( dist, _mm256_setzero_ps(), _CMP_GT_OQ ) );
+		}
+
+		int mask = _mm256_movemask_ps( outside );
+		uint32 group[8];
+		for( uint32 k = 0; k < 8; ++k ) group[k] = indices[i + k];
+		for( uint32 k = 0; k < 8; ++k )
+		{
+			if( !(mask & (1 << k)) ) visible[numVisible++] = group[k];
+		}
+	}
+#endif
+
+#if defined( H3D_SIMD_SSE2 )
+	for( ; i + 4 <= count; i += 4 )
+	{
+		uint32 i0 = indices[i], i1 = indices[i + 1], i2 = indices[i + 2], i3 = indices[i + 3];
+		__m128 bMinX = _mm_set_ps( minX[i3], minX[i2], minX[i1], minX[i0] );
+		__m128 bMinY = _mm_set_ps( minY[i3], minY[i2], minY[i1], minY[i0] );
+		__m128 bMinZ = _mm_set_ps( minZ[i3], minZ[i2], minZ[i1], minZ[i0] );
+		__m128 bMaxX = _mm_set_ps( maxX[i3], maxX[i2], maxX[i1], maxX[i0] );
+		__m128 bMaxY = _mm_set_ps( maxY[i3], maxY[i2], maxY[i1], maxY[i0] );
+		__m128 bMaxZ = _mm_set_ps( maxZ[i3], maxZ[i2], maxZ[i1], maxZ[i0] );
+		__m128 outside = _mm_setzero_ps();
+
+		for( uint32 j = 0; j < 6; ++j )
+		{
+			const Vec3f &n = _planes[j].normal;
+			__m128 dist = _mm_add_ps(
+				_mm_add_ps( _mm_mul_ps( _mm_set1_ps( n.x ), n.x <= 0 ? bMaxX : bMinX ),
+				            _mm_mul_ps( _mm_set1_ps( n.y ), n.y <= 0 ? bMaxY : bMinY ) ),
+				_mm_add_ps( _mm_mul_ps( _mm_set1_ps( n.z ), n.z <= 0 ? bMaxZ : bMinZ ),
+				            _mm_set1_ps( _planes[j].dist ) ) );
+			outside = _mm_or_ps( outside, _mm_cmpgt_ps( dist, _mm_setzero_ps() ) );
+		}
+
+		int mask = _mm_movemask_ps( outside );
+		if( !(mask & 1) ) visible[numVisible++] = i0;
+		if( !(mask & 2) ) visible[numVisible++] = i1;
+		if( !(mask & 4) ) visible[numVisible++] = i2;
+		if( !(mask & 8) ) visible[numVisible++] = i3;
+	}
+#elif defined( H3D_SIMD_NEON )
+	for( ; i + 4 <= count; i += 4 )
+	{
+		uint32 i0 = indices[i], i1 = indices[i + 1], i2 = indices[i + 2], i3 = indices[i + 3];
+		float tmp[4];
+		tmp[0] = minX[i0]; tmp[1] = minX[i1]; tmp[2] = minX[i2]; tmp[3] = minX[i3];
+		float32x4_t bMinX = vld1q_f32( tmp );
+		tmp[0] = minY[i0]; tmp[1] = minY[i1]; tmp[2] = minY[i2]; tmp[3] = minY[i3];
+		float32x4_t bMinY = vld1q_f32( tmp );
+		tmp[0] = minZ[i0]; tmp[1] = minZ[i1]; tmp[2] = minZ[i2]; tmp[3] = minZ[i3];
+		float32x4_t bMinZ = vld1q_f32( tmp );
+		tmp[0] = maxX[i0]; tmp[1] = maxX[i1]; tmp[2] = maxX[i2]; tmp[3] = maxX[i3];
+		float32x4_t bMaxX = vld1q_f32( tmp );
+		tmp[0] = maxY[i0]; tmp[1] = maxY[i1]; tmp[2] = maxY[i2]; tmp[3] = maxY[i3];
+		float32x4_t bMaxY = vld1q_f32( tmp );
+		tmp[0] = maxZ[i0]; tmp[1] = maxZ[i1]; tmp[2] = maxZ[i2]; tmp[3] = maxZ[i3];
+		float32x4_t bMaxZ = vld1q_f32( tmp );
+		uint32x4_t outside = vdupq_n_u32( 0 );
+
+		for( uint32 j = 0; j < 6; ++j )
+		{
+			const Vec3f &n = _planes[j].normal;
+			float32x4_t dist = vdupq_n_f32( _planes[j].dist );
+			dist = vmlaq_n_f32( dist, n.x <= 0 ? bMaxX : bMinX, n.x );
+			dist = vmlaq_n_f32( dist, n.y <= 0 ? bMaxY : bMinY, n.y );
+			dist = vmlaq_n_f32( dist, n.z <= 0 ? bMaxZ : bMinZ, n.z );
+			outside = vorrq_u32( outside, vcgtq_f32( dist, vdupq_n_f32( 0 ) ) );
+		}
+
+		uint32 mask[4];
+		vst1q_u32( mask, outside );
+		if( !mask[0] ) visible[numVisible++] = i0;
+		if( !mask[1] ) visible[numVisible++] = i1;
+		if( !mask[2] ) visible[numVisible++] = i2;
+		if( !mask[3] ) visible[numVisible++] = i3;
+	}
+#endif
+
+	// Scalar path for remaining boxes
+	for( ; i < count; ++i )
+	{
+		uint32 index = indices[i];
+		bool outside = false;
+		
+		for( uint32 j = 0; j < 6; ++j )
+		{
+			const Vec3f &n = _planes[j].normal;
+			Vec3f positive( n.x <= 0 ? maxX[index] : minX[index],
+			                n.y <= 0 ? maxY[index] : minY[index],
+			                n.z <= 0 ? maxZ[index] : minZ[index] );
+			if( _planes[j].distToPoint( positive ) > 0 ) { outside = true; break; }
+		}
+
+		if( !outside ) visible[numVisible++] = index;
+	}
+
+	return numVisible;
+}
+
+
 bool Frustum::cullFrustum( const Frustum &frust ) const
 {
 	for( uint32 i = 0; i < 6; ++i )
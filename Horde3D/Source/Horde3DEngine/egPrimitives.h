@@ -15,6 +15,7 @@
 
 #include "egPrerequisites.h"
 #include "utMath.h"
+#include <vector>
 
 
 namespace Horde3D {
@@ -113,6 +114,27 @@ struct BoundingBox
 };
 
 
+// Bounding boxes stored as structure of arrays for batch culling
+struct BoundingBoxArray
+{
+	std::vector< float >  minX, minY, minZ;
+	std::vector< float >  maxX, maxY, maxZ;
+
+
+	void resize( size_t size )
+	{
+		minX.resize( size ); minY.resize( size ); minZ.resize( size );
+		maxX.resize( size ); maxY.resize( size ); maxZ.resize( size );
+	}
+
+	void set( size_t index, const BoundingBox &b )
+	{
+		minX[index] = b.min.x; minY[index] = b.min.y; minZ[index] = b.min.z;
+		maxX[index] = b.max.x; maxY[index] = b.max.y; maxZ[index] = b.max.z;
+	}
+};
+
+
 // =================================================================================================
 // Frustum
 // =================================================================================================
@@ -131,7 +153,9 @@ public:
 	                      float bottom, float top, float front, float back );
 	bool cullSphere( Vec3f pos, float rad ) const;
 	bool cullBox( BoundingBox &b ) const;
+	bool cullBox( const BoundingBox &b, uint32 &planeMask ) const;
 	bool cullFrustum( const Frustum &frust ) const;
+	uint32 cullBoxes( const BoundingBoxArray &boxes, const uint32 *indices, uint32 count, uint32 *visible ) const;
 
 	void calcAABB( Vec3f &mins, Vec3f &maxs ) const;
 
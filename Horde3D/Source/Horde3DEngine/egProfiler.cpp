@@ -0,0 +1,358 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2016 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+#include "egProfiler.h"
+#include "egModules.h"
+#include "egRenderer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+#include "utDebug.h"
+
+
+namespace Horde3D {
+
+using namespace std;
+
+
+// Buffer of the calling thread; the generation detects buffers of a released profiler
+static thread_local ProfilerThreadBuffer *tlsThreadBuffer = 0x0;
+static thread_local uint32 tlsGeneration = 0;
+
+
+static void appendJSONString( string &str, const char *value )
+{
+	str += '"';
+	for( const char *c = value; *c != '\0'; ++c )
+	{
+		if( *c == '"' || *c == '\\' )
+		{
+			str += '\\';
+			str += *c;
+		}
+		else if( (unsigned char)*c < 0x20 )
+		{
+			char buf[8];
+			snprintf( buf, sizeof( buf ), "\\u%04x", (unsigned char)*c );
+			str += buf;
+		}
+		else
+			str += *c;
+	}
+	str += '"';
+}
+
+
+// *************************************************************************************************
+// Class Profiler
+// *************************************************************************************************
+
+atomic< bool > Profiler::_enabled( false );
+atomic< uint32 > Profiler::_generation( 0 );
+
+
+Profiler::Profiler() :
+	_mainThread( 0 ), _epoch( 0 ), _frameStart( 0 ), _frameNum( 1 ), _gpuTimersUsed( 0 ),
+	_completeFrameNum( 0 ), _completeMainThread( 0 ), _lostEvents( 0 )
+{
+	_generationId = ++_generation;
+	_epoch = getTime();
+}
+
+
+Profiler::~Profiler()
+{
+	_enabled = false;
+
+	for( uint32 i = 0; i < FrameHistorySize; ++i )
+		releaseGPUTimers( _gpuTimers[i] );
+	for( size_t i = 0; i < _threadBuffers.size(); ++i )
+		delete _threadBuffers[i];
+}
+
+
+void Profiler::setEnabled( bool enabled )
+{
+	if( enabled && !_enabled )
+	{
+		// Drop what was recorded before profiling got disabled
+		for( size_t i = 0; i < _threadBuffers.size(); ++i )
+		{
+			lock_guard< mutex > lock( _threadBuffers[i]->mutex );
+			_threadBuffers[i]->readPos = _threadBuffers[i]->writePos;
+		}
+
+		for( uint32 i = 0; i < FrameHistorySize; ++i )
+		{
+			if( _frames[i].pending ) releaseGPUTimers( _gpuTimers[i] );
+			_frames[i].events.resize( 0 );
+			_frames[i].gpuScopes.resize( 0 );
+			_frames[i].pending = false;
+		}
+		_gpuTimersUsed = 0;
+		_frameStart = getTime();
+	}
+
+	_enabled = enabled;
+}
+
+
+const char *Profiler::internName( const string &name )
+{
+	lock_guard< mutex > lock( _mutex );
+
+	return _names.insert( name ).first->c_str();
+}
+
+
+int64 Profiler::getTime() const
+{
+	return (int64)chrono::duration_cast< chrono::nanoseconds >(
+		chrono::steady_clock::now().time_since_epoch() ).count() - _epoch;
+}
+
+
+ProfilerThreadBuffer *Profiler::getThreadBuffer()
+{
+	if( tlsThreadBuffer != 0x0 && tlsGeneration == _generationId ) return tlsThreadBuffer;
+
+	ProfilerThreadBuffer *buffer = new ProfilerThreadBuffer();
+	buffer->events.resize( ThreadBufferSize );
+	buffer->writePos = 0;
+	buffer->readPos = 0;
+
+	{
+		lock_guard< mutex > lock( _mutex );
+		buffer->index = (uint32)_threadBuffers.size();
+		_threadBuffers.push_back( buffer );
+	}
+
+	tlsThreadBuffer = buffer;
+	tlsGeneration = _generationId;
+	return buffer;
+}
+
+
+void Profiler::addEvent( const char *name, const char *detail, int64 start )
+{
+	int64 end = getTime();
+	ProfilerThreadBuffer *buffer = getThreadBuffer();
+
+	lock_guard< mutex > lock( buffer->mutex );
+	ProfilerEvent &event = buffer->events[buffer->writePos++ % ThreadBufferSize];
+	event.name = name;
+	event.detail = detail;
+	event.start = start;
+	event.end = end;
+	event.track = buffer->index;
+}
+
+
+uint32 Profiler::beginGPUScope( const char *name, const char *detail, int64 start )
+{
+	RenderDeviceInterface *rdi = Modules::renderer().getRenderDevice();
+	if( rdi == 0x0 ) return 0xFFFFFFFF;
+
+	uint32 slot = _frameNum % FrameHistorySize;
+	vector< GPUTimer * > &timers = _gpuTimers[slot];
+	if( _gpuTimersUsed == timers.size() ) timers.push_back( rdi->createGPUTimer() );
+
+	GPUTimer *timer = timers[_gpuTimersUsed++];
+	timer->beginQuery( _frameNum );
+
+	// The GPU event is placed at the time the commands were submitted
+	ProfilerFrame &frame = _frames[slot];
+	ProfilerEvent event = { name, detail, start, start, GPUTrack };
+	ProfilerGPUScope scope = { timer, (uint32)frame.events.size() };
+	frame.events.push_back( event );
+	frame.gpuScopes.push_back( scope );
+
+	return (uint32)frame.gpuScopes.size() - 1;
+}
+
+
+void Profiler::endGPUScope( uint32 scope )
+{
+	ProfilerFrame &frame = _frames[_frameNum % FrameHistorySize];
+	if( scope < frame.gpuScopes.size() ) frame.gpuScopes[scope].timer->endQuery();
+}
+
+
+void Profiler::releaseGPUTimers( vector< GPUTimer * > &timers )
+{
+	for( size_t i = 0; i < timers.size(); ++i )
+		delete timers[i];
+	timers.clear();
+}
+
+
+void Profiler::resolveFrames()
+{
+	for( uint32 i = 0; i < FrameHistorySize; ++i )
+	{
+		ProfilerFrame &frame = _frames[i];
+		if( !frame.pending ) continue;
+
+		bool available = true;
+		for( size_t j = 0; j < frame.gpuScopes.size() && available; ++j )
+			available = frame.gpuScopes[j].timer->updateResults();
+		if( !available ) continue;
+
+		for( size_t j = 0; j < frame.gpuScopes.size(); ++j )
+		{
+			ProfilerEvent &event = frame.events[frame.gpuScopes[j].eventIndex];
+			event.end = event.start + (int64)( (double)frame.gpuScopes[j].timer->getTimeMS() * 1000000.0 );
+		}
+		frame.pending = false;
+
+		if( frame.number > _completeFrameNum )
+		{
+			_completeFrame = frame.events;
+			_completeFrameNum = frame.number;
+			_completeMainThread = _mainThread;
+		}
+	}
+}
+
+
+void Profiler::endFrame()
+{
+	if( !_enabled ) return;
+
+	int64 now = getTime();
+	_mainThread = getThreadBuffer()->index;
+
+	uint32 slot = _frameNum % FrameHistorySize;
+	ProfilerFrame &frame = _frames[slot];
+	ProfilerEvent frameEvent = { "Frame", 0x0, _frameStart, now, _mainThread };
+	frame.events.push_back( frameEvent );
+
+	// Gather events of all threads
+	{
+		lock_guard< mutex > lock( _mutex );
+		for( size_t i = 0; i < _threadBuffers.size(); ++i )
+		{
+			ProfilerThreadBuffer &buffer = *_threadBuffers[i];
+			lock_guard< mutex > bufferLock( buffer.mutex );
+
+			if( buffer.writePos - buffer.readPos > ThreadBufferSize )
+			{
+				_lostEvents += (uint32)(buffer.writePos - buffer.readPos - ThreadBufferSize);
+				buffer.readPos = buffer.writePos - ThreadBufferSize;
+			}
+			for( ; buffer.readPos < buffer.writePos; ++buffer.readPos )
+				frame.events.push_back( buffer.events[buffer.readPos % ThreadBufferSize] );
+		}
+	}
+
+	frame.number = _frameNum;
+	frame.pending = true;
+	resolveFrames();
+
+	// Frames whose GPU results are still not available when their slot is needed again are dropped;
+	// the timers of such a frame may have queries in flight and cannot be reused
+	++_frameNum;
+	_frameStart = now;
+	_gpuTimersUsed = 0;
+
+	ProfilerFrame &nextFrame = _frames[_frameNum % FrameHistorySize];
+	if( nextFrame.pending ) releaseGPUTimers( _gpuTimers[_frameNum % FrameHistorySize] );
+	nextFrame.events.resize( 0 );
+	nextFrame.gpuScopes.resize( 0 );
+	nextFrame.pending = false;
+}
+
+
+const string &Profiler::getTrace()
+{
+	resolveFrames();
+
+	// Chrome trace event format; times are given in microseconds
+	_trace = "{\"traceEvents\":[\n";
+	_trace += "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"Horde3D\"}}";
+
+	vector< uint32 > tracks;
+	char buf[128];
+	for( size_t i = 0; i < _completeFrame.size(); ++i )
+	{
+		const ProfilerEvent &event = _completeFrame[i];
+		uint32 tid = event.track == GPUTrack ? 0 : event.track + 1;
+
+		_trace += ",\n{\"name\":";
+		appendJSONString( _trace, event.name );
+		snprintf( buf, sizeof( buf ), ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u",
+		          event.track == GPUTrack ? "gpu" : "cpu", event.start / 1000.0, (event.end - event.start) / 1000.0, tid );
+		_trace += buf;
+		if( event.detail != 0x0 )
+		{
+			_trace += ",\"args\":{\"detail\":";
+			appendJSONString( _trace, event.detail );
+			_trace += "}";
+		}
+		_trace += "}";
+
+		if( find( tracks.begin(), tracks.end(), tid ) == tracks.end() ) tracks.push_back( tid );
+	}
+
+	for( size_t i = 0; i < tracks.size(); ++i )
+	{
+		if( tracks[i] == 0 )
+			snprintf( buf, sizeof( buf ), "GPU" );
+		else if( tracks[i] == _completeMainThread + 1 )
+			snprintf( buf, sizeof( buf ), "Main thread" );
+		else
+			snprintf( buf, sizeof( buf ), "Thread %u", tracks[i] );
+
+		_trace += ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":";
+		_trace += to_string( tracks[i] ) + ",\"args\":{\"name\":\"" + buf + "\"}}";
+	}
+
+	snprintf( buf, sizeof( buf ), "\n],\n\"otherData\":{\"frame\":%u,\"lostEvents\":%u}}\n",
+	          _completeFrameNum, _lostEvents );
+	_trace += buf;
+
+	return _trace;
+}
+
+
+// *************************************************************************************************
+// Class ProfileScope
+// *************************************************************************************************
+
+const char *ProfileScope::intern( const string &str )
+{
+	return Modules::profiler().internName( str );
+}
+
+
+void ProfileScope::begin( const char *name, const char *detail, bool gpu )
+{
+	Profiler &profiler = Modules::profiler();
+
+	_name = name;
+	_detail = detail;
+	_start = profiler.getTime();
+	_gpuScope = gpu ? profiler.beginGPUScope( name, detail, _start ) : 0xFFFFFFFF;
+	_active = true;
+}
+
+
+void ProfileScope::end()
+{
+	Profiler &profiler = Modules::profiler();
+
+	if( _gpuScope != 0xFFFFFFFF ) profiler.endGPUScope( _gpuScope );
+	profiler.addEvent( _name, _detail, _start );
+}
+
+}  // namespace
@@ -0,0 +1,168 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2016 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+#ifndef _egProfiler_H_
+#define _egProfiler_H_
+
+#include "egPrerequisites.h"
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+
+namespace Horde3D {
+
+class GPUTimer;
+
+
+// =================================================================================================
+// Profiler
+// =================================================================================================
+
+struct ProfilerEvent
+{
+	const char  *name;
+	const char  *detail;
+	int64       start, end;  // Nanoseconds since profiler creation
+	uint32      track;  // Thread index or GPUTrack
+};
+
+// -------------------------------------------------------------------------------------------------
+
+struct ProfilerThreadBuffer
+{
+	std::mutex                    mutex;
+	std::vector< ProfilerEvent >  events;  // Ring buffer
+	uint64                        writePos, readPos;
+	uint32                        index;
+};
+
+// -------------------------------------------------------------------------------------------------
+
+struct ProfilerGPUScope
+{
+	GPUTimer  *timer;
+	uint32    eventIndex;
+};
+
+struct ProfilerFrame
+{
+	std::vector< ProfilerEvent >     events;
+	std::vector< ProfilerGPUScope >  gpuScopes;
+	uint32                           number;
+	bool                             pending;  // Waiting for GPU results
+
+	ProfilerFrame() : number( 0 ), pending( false ) {}
+};
+
+// -------------------------------------------------------------------------------------------------
+
+// Records nested CPU scopes of all threads and GPU scopes of the render thread; the scopes that
+// end between two calls of endFrame form a frame. Since GPU results arrive with a delay, the last
+// few frames are kept until their GPU scopes are resolved.
+class Profiler
+{
+public:
+	static const uint32 ThreadBufferSize = 16384;
+	static const uint32 FrameHistorySize = 4;
+	static const uint32 GPUTrack = 0xFFFFFFFF;
+
+	Profiler();
+	~Profiler();
+
+	static bool isEnabled() { return _enabled.load( std::memory_order_relaxed ); }
+	void setEnabled( bool enabled );
+
+	// Returns a copy of the name that stays valid for the lifetime of the profiler
+	const char *internName( const std::string &name );
+
+	int64 getTime() const;
+	void addEvent( const char *name, const char *detail, int64 start );
+	// GPU scopes may only be used on the thread that calls endFrame
+	uint32 beginGPUScope( const char *name, const char *detail, int64 start );
+	void endGPUScope( uint32 scope );
+
+	void endFrame();
+	const std::string &getTrace();
+
+protected:
+	ProfilerThreadBuffer *getThreadBuffer();
+	void resolveFrames();
+	void releaseGPUTimers( std::vector< GPUTimer * > &timers );
+
+protected:
+	static std::atomic< bool >            _enabled;
+	static std::atomic< uint32 >          _generation;
+
+	std::mutex                            _mutex;
+	std::vector< ProfilerThreadBuffer * > _threadBuffers;
+	uint32                                _mainThread;
+	uint32                                _generationId;
+	std::set< std::string >               _names;
+
+	int64                                 _epoch;
+	int64                                 _frameStart;
+	uint32                                _frameNum;
+	ProfilerFrame                         _frames[FrameHistorySize];
+	std::vector< GPUTimer * >             _gpuTimers[FrameHistorySize];
+	uint32                                _gpuTimersUsed;
+	std::vector< ProfilerEvent >          _completeFrame;
+	uint32                                _completeFrameNum;
+	uint32                                _completeMainThread;
+	uint32                                _lostEvents;
+	std::string                           _trace;
+};
+
+// -------------------------------------------------------------------------------------------------
+
+// Measures the enclosing block; the names need to stay valid until the end of the frame, so
+// names that are not string literals are passed as std::string and copied by the profiler.
+// When profiling is disabled, a scope costs a single flag test.
+class ProfileScope
+{
+public:
+	ProfileScope( const char *name, bool gpu = false ) : _active( false )
+	{
+		if( Profiler::isEnabled() ) begin( name, 0x0, gpu );
+	}
+
+	ProfileScope( const char *name, const std::string &detail, bool gpu = false ) : _active( false )
+	{
+		if( Profiler::isEnabled() ) begin( name, intern( detail ), gpu );
+	}
+
+	ProfileScope( const std::string &name, bool gpu = false ) : _active( false )
+	{
+		if( Profiler::isEnabled() ) begin( intern( name ), 0x0, gpu );
+	}
+
+	~ProfileScope()
+	{
+		if( _active ) end();
+	}
+
+private:
+	static const char *intern( const std::string &str );
+	void begin( const char *name, const char *detail, bool gpu );
+	void end();
+
+private:
+	const char  *_name, *_detail;
+	int64       _start;
+	uint32      _gpuScope;
+	bool        _active;
+};
+
+}
+#endif // _egProfiler_H_
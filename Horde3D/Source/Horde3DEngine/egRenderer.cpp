@@ -17,8 +17,10 @@
 #include "egModules.h"
 #include "egRendererBaseGL2.h"
 #include "egRendererBaseGL4.h"
+#include "egRendererBaseNull.h"
 #include "egCom.h"
 #include "egComputeNode.h"
+#include "egProfiler.h"
 #include <cstring>
 
 #include "utDebug.h"
@@ -28,6 +30,12 @@ namespace Horde3D {
 
 using namespace std;
 
+// Scope names of the pipeline commands, in the order of PipelineCommands::List
+static const char *pipeCommandNames[] = {
+	"SwitchTarget", "BindBuffer", "UnbindBuffers", "ClearTarget", "DrawGeometry", "DrawOverlays", "DrawQuad",
+	"DoForwardLightLoop", "DoDeferredLightLoop", "DoClusteredLightLoop", "SetUniform"
+};
+
 Renderer::Renderer()
 {
 	_scratchBuf = 0x0;
@@ -37,25 +45,40 @@ Renderer::Renderer()
 	_defShadowMap = 0;
 	_quadIdxBuf = 0;
 	_particleVBO = 0;
+	_meshInstanceBuf = 0;
 	_curCamera = 0x0;
 	_curLight = 0x0;
 	_curShader = 0x0;
 	_curRenderTarget = 0x0;
 	_curShaderUpdateStamp = 1;
+	_texStreamRequestSize = Math::MaxFloat;
 	_curStageMatLink = 0;
 	_maxAnisoMask = 0;
 	_smSize = 0;
 	_shadowRB = 0;
+	_curShadowRB = 0;
+	_clusterLightMap = 0;
+	_clusterItemMap = 0;
+	_clusterLightMapHeight = 0;
+	_clusterItemMapHeight = 0;
+	memset( _clusterGridSize, 0, sizeof( _clusterGridSize ) );
+	memset( _clusterDepthParams, 0, sizeof( _clusterDepthParams ) );
 	_vlPosOnly = 0;
 	_vlOverlay = 0;
 	_vlModel = 0;
 	_vlParticle = 0;
+	_vlParticleInstanced = 0;
+	_vlModelInstanced = 0;
 
 	_particleGeo = 0;
 	_cubeGeo = 0;
 	_sphereGeo = 0;
 	_coneGeo = 0;
 	_overlayGeo = 0;
+	_overlayVB = 0;
+	_overlayRingOffset = 0;
+	_overlayUploadCount = 0;
+	_overlayVertsChanged = false;
 	_FSPolyGeo = 0;
 
 	// reserve memory for occlusion culling proxies
@@ -72,7 +95,10 @@ Renderer::~Renderer()
 	{
 		releaseShadowRB();
 		_renderDevice->destroyTexture( _defShadowMap );
+		_renderDevice->destroyTexture( _clusterLightMap );
+		_renderDevice->destroyTexture( _clusterItemMap );
 		// 	_renderDevice->destroyBuffer( _particleVBO );
+		_renderDevice->destroyBuffer( _meshInstanceBuf );
 		releaseShaderComb( _defColorShader );
 
 		_renderDevice->destroyGeometry( _particleGeo );
@@ -103,6 +129,12 @@ void Renderer::registerRenderFunc( int nodeType, RenderFunc rf )
 }
 
 
+void Renderer::registerCameraUpdateFunc( CameraUpdateFunc uf )
+{
+	_cameraUpdateFuncs.push_back( uf );
+}
+
+
 unsigned char * Renderer::useScratchBuf( uint32 minSize, uint32 alignment )
 {
 	if( _scratchBufSize < minSize )
@@ -187,6 +219,30 @@ bool Renderer::init( RenderBackendType::List type )
 		{"parIdx", 0, 1, 8}
 	};
 	_vlParticle = _renderDevice->registerVertexLayout( 2, attribsParticle );
+
+	// Corners of the quad come from the particle VBO, the remaining data from the emitter's instance buffer
+	VertexLayoutAttrib attribsParticleInstanced[4] = {
+		{"texCoords0", 0, 2, 0},
+		{"parPos", 1, 3, 0, 1},
+		{"parSizeAndRot", 1, 2, 12, 1},
+		{"parColor", 1, 4, 20, 1}
+	};
+	_vlParticleInstanced = _renderDevice->registerVertexLayout( 4, attribsParticleInstanced );
+
+	// Model streams plus the upper three rows of the world transformation from the mesh instance buffer
+	VertexLayoutAttrib attribsModelInstanced[10] = {
+		{"vertPos", 0, 3, 0},
+		{"normal", 1, 3, 0},
+		{"tangent", 2, 4, 0},
+		{"joints", 3, 4, 8},
+		{"weights", 3, 4, 24},
+		{"texCoords0", 3, 2, 0},
+		{"texCoords1", 3, 2, 40},
+		{"instWorldRow0", 4, 4, 0, 1},
+		{"instWorldRow1", 4, 4, 16, 1},
+		{"instWorldRow2", 4, 4, 32, 1}
+	};
+	_vlModelInstanced = _renderDevice->registerVertexLayout( 10, attribsModelInstanced );
 	
 	// Upload default shaders
 	if ( !createShaderComb( _defColorShader, _renderDevice->getDefaultVSCode(), _renderDevice->getDefaultFSCode(), 0, 0, 0, 0 ) )
@@ -224,7 +280,7 @@ bool Renderer::init( RenderBackendType::List type )
 	
 	_overlayBatches.reserve( 64 );
 	_overlayVerts = new OverlayVert[ MaxNumOverlayVerts ];
-	_overlayVB = _renderDevice->createVertexBuffer( MaxNumOverlayVerts * sizeof( OverlayVert ), 0x0 );
+	_overlayVB = _renderDevice->createVertexBuffer( OverlayRingSize * sizeof( OverlayVert ), 0x0 );
 
 	_renderDevice->setGeomVertexParams( _overlayGeo, _overlayVB, 0, 0, sizeof( OverlayVert ) );
 	_renderDevice->setGeomIndexParams( _overlayGeo, _quadIdxBuf, IDXFMT_16 );
@@ -254,6 +310,9 @@ bool Renderer::init( RenderBackendType::List type )
 
 	delete[] parVerts; parVerts = 0x0;
 
+	// Create instance buffer for meshes, it is shared by the instanced geometry of all geometry resources
+	_meshInstanceBuf = _renderDevice->createVertexBuffer( MeshInstancesPerBatch * sizeof( MeshInstanceData ), 0x0 );
+
 	// Create unit primitives
 	createPrimitives();
 
@@ -292,6 +351,10 @@ RenderDeviceInterface *Renderer::createRenderDevice( int type )
 		{
 			return new RDI_GL2::RenderDeviceGL2();
 		}
+		case RenderBackendType::Null :
+		{
+			return new RDI_Null::RenderDeviceNull();
+		}
 		default:
 			Modules::log().writeError( "Incorrect render interface type or type not specified. Renderer cannot be initialized." );
 			break;
@@ -339,6 +402,12 @@ uint32 Renderer::getDefaultVertexLayout( DefaultVertexLayouts::List vl ) const
 		case DefaultVertexLayouts::Overlay:
 			return _vlOverlay;
 			break;
+		case DefaultVertexLayouts::ParticleInstanced:
+			return _vlParticleInstanced;
+			break;
+		case DefaultVertexLayouts::ModelInstanced:
+			return _vlModelInstanced;
+			break;
 		default:
 			break;
 	}
@@ -493,8 +562,48 @@ void Renderer::drawCone( float height, float radius, const Matrix4f &transMat )
 bool Renderer::createShaderComb( ShaderCombination &sc, const char *vertexShader, const char *fragmentShader, const char *geometryShader,
 								 const char *tessControlShader, const char *tessEvaluationShader, const char *computeShader )
 {
-	// Create shader program
-	uint32 shdObj = _renderDevice->createShader( vertexShader, fragmentShader, geometryShader, tessControlShader, tessEvaluationShader, computeShader );
+	// Create shader program, preferably from a program binary of a previous run
+	uint32 shdObj = 0;
+	if( _shaderCache.isOpen() && _renderDevice->getCaps().shaderBinaries )
+	{
+		const char *sources[6] = { vertexShader, fragmentShader, geometryShader, tessControlShader, tessEvaluationShader, computeShader };
+		uint64 hash = ShaderCache::calcHash( sources, 6, _renderDevice->getDeviceId() );
+		uint32 format;
+
+		ShaderCacheResults::List result = _shaderCache.load( hash, format, _shaderBinary );
+		if( result == ShaderCacheResults::Failed )
+		{
+			Modules::log().writeWarning( "Shader cache: Discarding invalid entry %s",
+			                             _shaderCache.getEntryFileName( hash ).c_str() );
+		}
+		else if( result == ShaderCacheResults::Ok )
+		{
+			shdObj = _renderDevice->createShaderFromBinary( format, &_shaderBinary[0], (uint32)_shaderBinary.size() );
+			
+			// The driver rejects binaries that it cannot use anymore, e.g. after an update
+			if( shdObj == 0 ) _shaderCache.invalidate( hash );
+		}
+
+		if( shdObj != 0 )
+		{
+			Modules::stats().incStat( EngineStats::ShaderCacheHits, 1 );
+		}
+		else
+		{
+			shdObj = _renderDevice->createShader( vertexShader, fragmentShader, geometryShader, tessControlShader, tessEvaluationShader, computeShader );
+			if( shdObj != 0 && _renderDevice->getShaderBinary( shdObj, format, _shaderBinary ) &&
+			    _shaderCache.store( hash, format, &_shaderBinary[0], (uint32)_shaderBinary.size() ) == ShaderCacheResults::Failed )
+			{
+				Modules::log().writeWarning( "Shader cache: Failed to write entry %s",
+				                             _shaderCache.getEntryFileName( hash ).c_str() );
+			}
+			Modules::stats().incStat( EngineStats::ShaderCacheMisses, 1 );
+		}
+	}
+	else
+	{
+		shdObj = _renderDevice->createShader( vertexShader, fragmentShader, geometryShader, tessControlShader, tessEvaluationShader, computeShader );
+	}
 	if( shdObj == 0 ) return false;
 	
 	sc.shaderObj = shdObj;
@@ -503,6 +612,10 @@ bool Renderer::createShaderComb( ShaderCombination &sc, const char *vertexShader
 	// Set standard uniforms
 	int loc =_renderDevice-> getShaderSamplerLoc( shdObj, "shadowMap" );
 	if( loc >= 0 ) _renderDevice->setShaderSampler( loc, 12 );
+	loc = _renderDevice->getShaderSamplerLoc( shdObj, "clusterLightMap" );
+	if( loc >= 0 ) _renderDevice->setShaderSampler( loc, 13 );
+	loc = _renderDevice->getShaderSamplerLoc( shdObj, "clusterItemMap" );
+	if( loc >= 0 ) _renderDevice->setShaderSampler( loc, 14 );
 
 	// Misc general uniforms
 	sc.uni_frameBufSize = _renderDevice->getShaderConstLoc( shdObj, "frameBufSize" );
@@ -531,6 +644,11 @@ bool Renderer::createShaderComb( ShaderCombination &sc, const char *vertexShader
 	sc.uni_shadowMapSize = _renderDevice->getShaderConstLoc( shdObj, "shadowMapSize" );
 	sc.uni_shadowBias = _renderDevice->getShaderConstLoc( shdObj, "shadowBias" );
 	
+	// Clustered lighting uniforms
+	sc.uni_clusterGridSize = _renderDevice->getShaderConstLoc( shdObj, "clusterGridSize" );
+	sc.uni_clusterDepthParams = _renderDevice->getShaderConstLoc( shdObj, "clusterDepthParams" );
+	sc.uni_clusterProjMat = _renderDevice->getShaderConstLoc( shdObj, "clusterProjMat" );
+	
 	// Particle-specific uniforms
 	sc.uni_parPosArray = _renderDevice->getShaderConstLoc( shdObj, "parPosArray" );
 	sc.uni_parSizeAndRotArray = _renderDevice->getShaderConstLoc( shdObj, "parSizeAndRotArray" );
@@ -629,12 +747,22 @@ void Renderer::commitGeneralUniforms()
 				_renderDevice->setShaderConst( _curShader->uni_shadowBias, CONST_FLOAT, &_curLight->_shadowMapBias );
 		}
 
+		// Clustered lighting params
+		if( _curShader->uni_clusterGridSize >= 0 )
+			_renderDevice->setShaderConst( _curShader->uni_clusterGridSize, CONST_FLOAT4, _clusterGridSize );
+
+		if( _curShader->uni_clusterDepthParams >= 0 )
+			_renderDevice->setShaderConst( _curShader->uni_clusterDepthParams, CONST_FLOAT4, _clusterDepthParams );
+
+		if( _curShader->uni_clusterProjMat >= 0 )
+			_renderDevice->setShaderConst( _curShader->uni_clusterProjMat, CONST_FLOAT44, _clusterProjMat.x );
+
 		_curShader->lastUpdateStamp = _curShaderUpdateStamp;
 	}
 }
 
 
-bool Renderer::setMaterialRec( MaterialResource *materialRes, const string &shaderContext,
+bool Renderer::setMaterialRec( MaterialResource *materialRes, uint32 shaderContext,
                                ShaderResource *shaderRes )
 {
 	if( materialRes == 0x0 ) return false;
@@ -683,6 +811,8 @@ bool Renderer::setMaterialRec( MaterialResource *materialRes, const string &shad
 		if ( context->tessVerticesInPatchCount > 1 ) _renderDevice->setTessPatchVertices( context->tessVerticesInPatchCount );
 	}
 
+	const MatShaderBinding &binding = materialRes->getShaderBinding( shaderRes );
+	
 	// Setup texture samplers
 	for( size_t i = 0, si = shaderRes->_samplers.size(); i < si; ++i )
 	{
@@ -694,15 +824,12 @@ bool Renderer::setMaterialRec( MaterialResource *materialRes, const string &shad
 		// Use default texture
 		if( firstRec) texRes = sampler.defTex;
 		
-		// Find sampler in material
-		for( size_t j = 0, sj = materialRes->_samplers.size(); j < sj; ++j )
+		// Use sampler of material
+		if( binding.samplers[i] >= 0 )
 		{
-			if( materialRes->_samplers[j].name == sampler.id )
-			{
-                if( materialRes->_samplers[j].texRes && materialRes->_samplers[j].texRes->isLoaded() )
-					texRes = materialRes->_samplers[j].texRes;
-				break;
-			}
+			MatSampler &matSampler = materialRes->_samplers[binding.samplers[i]];
+			if( matSampler.texRes && matSampler.texRes->isLoaded() )
+				texRes = matSampler.texRes;
 		}
 
 		uint32 sampState = shaderRes->_samplers[i].sampState;
@@ -718,6 +845,7 @@ bool Renderer::setMaterialRec( MaterialResource *materialRes, const string &shad
 		if( texRes != 0x0 )
 		{
 			if( texRes->getTexType() != sampler.type ) break;  // Wrong type
+			if( texRes->isStreamed() ) texRes->requestStreamedSize( _texStreamRequestSize );
 			
 			if( texRes->getTexType() == TextureTypes::Tex2D )
 			{
@@ -764,17 +892,9 @@ bool Renderer::setMaterialRec( MaterialResource *materialRes, const string &shad
 		
 		float *unifData = 0x0;
 
-		// Find uniform in material
-		for( size_t j = 0, sj = materialRes->_uniforms.size(); j < sj; ++j )
-		{
-			MatUniform &matUniform = materialRes->_uniforms[j];
-			
-			if( matUniform.name == shaderRes->_uniforms[i].id )
-			{
-				unifData = matUniform.values;
-				break;
-			}
-		}
+		// Use uniform of material
+		if( binding.uniforms[i] >= 0 )
+			unifData = materialRes->_uniforms[binding.uniforms[i]].values;
 
 		// Use default values if not found
 		if( unifData == 0x0 && firstRec )
@@ -801,17 +921,9 @@ bool Renderer::setMaterialRec( MaterialResource *materialRes, const string &shad
 		
 		ComputeBufferResource *buf = 0;
 
-		// Find buffer in material
-		for ( size_t j = 0; j < materialRes->_buffers.size(); ++j )
-		{
-			MatBuffer &matBuffer = materialRes->_buffers[ j ];
-
-			if ( matBuffer.name == shaderRes->_buffers[ i ].id )
-			{
-				buf = matBuffer.compBufRes;
-				break;
-			}
-		}
+		// Use buffer of material
+		if ( binding.buffers[ i ] >= 0 )
+			buf = materialRes->_buffers[ binding.buffers[ i ] ].compBufRes;
 
 		if ( buf )
 		{
@@ -838,7 +950,7 @@ bool Renderer::setMaterialRec( MaterialResource *materialRes, const string &shad
 }
 
 
-bool Renderer::setMaterial( MaterialResource *materialRes, const string &shaderContext )
+bool Renderer::setMaterial( MaterialResource *materialRes, uint32 shaderContext )
 {
 	if( materialRes == 0x0 )
 	{	
@@ -861,6 +973,33 @@ bool Renderer::setMaterial( MaterialResource *materialRes, const string &shaderC
 }
 
 
+float Renderer::calcScreenSize( const BoundingBox &bbox ) const
+{
+	// Approximate size in pixels of the bounding sphere of the box on the current camera's viewport
+	if( _curCamera == 0x0 ) return Math::MaxFloat;
+	
+	float diameter = (bbox.max - bbox.min).length();
+	float pixelsPerUnit = _curCamera->getProjMat().x[5] * _curCamera->_vpHeight * 0.5f;
+	if( _curCamera->_orthographic ) return diameter * pixelsPerUnit;
+
+	float dist = nearestDistToAABB( _curCamera->getAbsPos(), bbox.min, bbox.max );
+	return diameter * pixelsPerUnit / std::max( dist, _curCamera->_frustNear );
+}
+
+
+void Renderer::requestStreamedTextures( MaterialResource *materialRes, float screenSize )
+{
+	for( size_t i = 0, s = materialRes->_samplers.size(); i < s; ++i )
+	{
+		TextureResource *texRes = materialRes->_samplers[i].texRes;
+		if( texRes != 0x0 && texRes->isStreamed() ) texRes->requestStreamedSize( screenSize );
+	}
+
+	if( materialRes->_matLink != 0x0 )
+		requestStreamedTextures( materialRes->_matLink, screenSize );
+}
+
+
 // =================================================================================================
 // Shadowing
 // =================================================================================================
@@ -868,6 +1007,7 @@ bool Renderer::setMaterial( MaterialResource *materialRes, const string &shaderC
 bool Renderer::createShadowRB( uint32 width, uint32 height )
 {
 	_shadowRB = _renderDevice->createRenderBuffer( width, height, TextureFormats::BGRA8, true, 0, 0 );
+	_curShadowRB = _shadowRB;
 	
 	return _shadowRB != 0;
 }
@@ -875,7 +1015,101 @@ bool Renderer::createShadowRB( uint32 width, uint32 height )
 
 void Renderer::releaseShadowRB()
 {
+	// Cached shadow maps have the same size as the shadow buffer
+	releaseShadowMapCache( 0x0 );
+	
 	if( _shadowRB ) _renderDevice->destroyRenderBuffer( _shadowRB );
+	_shadowRB = 0;
+	_curShadowRB = 0;
+}
+
+
+void Renderer::releaseShadowMapCache( LightNode *light )
+{
+	for( size_t i = 0; i < _shadowMapCache.size(); )
+	{
+		if( light == 0x0 || _shadowMapCache[i].light == light )
+		{
+			if( _curShadowRB == _shadowMapCache[i].renderBuffer ) _curShadowRB = _shadowRB;
+			_renderDevice->destroyRenderBuffer( _shadowMapCache[i].renderBuffer );
+			
+			_shadowMapCache[i] = _shadowMapCache.back();
+			_shadowMapCache.pop_back();
+		}
+		else ++i;
+	}
+}
+
+
+void Renderer::invalidateShadowMapCache()
+{
+	// Maps are rendered again the next time they are used
+	for( size_t i = 0; i < _shadowMapCache.size(); ++i )
+		_shadowMapCache[i].mapCount = 0;
+}
+
+
+ShadowMapCacheEntry *Renderer::findShadowMapCacheEntry( LightNode *light, bool allocate )
+{
+	ShadowMapCacheEntry *lruEntry = 0x0;
+	
+	for( size_t i = 0; i < _shadowMapCache.size(); ++i )
+	{
+		if( _shadowMapCache[i].light == light ) return &_shadowMapCache[i];
+		if( lruEntry == 0x0 || _shadowMapCache[i].lastUsedFrame < lruEntry->lastUsedFrame )
+			lruEntry = &_shadowMapCache[i];
+	}
+	
+	if( !allocate || Modules::config().shadowMapCacheSize == 0 ) return 0x0;
+
+	if( (int)_shadowMapCache.size() < Modules::config().shadowMapCacheSize )
+	{
+		int width, height;
+		_renderDevice->getRenderBufferDimensions( _shadowRB, &width, &height );
+		uint32 rb = _renderDevice->createRenderBuffer( width, height, TextureFormats::BGRA8, true, 0, 0 );
+		if( rb == 0 ) return 0x0;
+		
+		_shadowMapCache.push_back( ShadowMapCacheEntry() );
+		lruEntry = &_shadowMapCache.back();
+		lruEntry->renderBuffer = rb;
+	}
+
+	// Evict least recently used shadow map
+	lruEntry->light = light;
+	lruEntry->camera = 0;
+	lruEntry->mapCount = 0;
+	lruEntry->casters.resize( 0 );
+	
+	return lruEntry;
+}
+
+
+bool Renderer::isShadowMapCacheValid( const ShadowMapCacheEntry &entry )
+{
+	if( entry.mapCount == 0 || entry.mapCount != _curLight->_shadowMapCount ||
+	    entry.shadowContext != _curLight->_shadowContextId ) return false;
+
+	// Split planes and crop matrices depend on the view frustum
+	if( entry.camera != _curCamera->getHandle() || entry.splitLambda != _curLight->_shadowSplitLambda ||
+	    memcmp( entry.camTrans.x, _curCamera->getAbsTrans().x, sizeof( entry.camTrans.x ) ) != 0 ||
+	    memcmp( entry.camProjMat.x, _curCamera->getProjMat().x, sizeof( entry.camProjMat.x ) ) != 0 )
+		return false;
+
+	// Light and casters must not have been updated since the map was rendered; casters that left
+	// the light frustum or were removed change the set. The culling order is not stable when the
+	// spatial tree changes, so the cached casters are sorted.
+	SceneManager &sceneMan = Modules::sceneMan();
+	if( sceneMan.getNodeStamp( *_curLight ) > entry.changeStamp ) return false;
+	if( entry.casters.size() != _shadowCasters.size() ) return false;
+	
+	for( size_t i = 0, s = _shadowCasters.size(); i < s; ++i )
+	{
+		SceneNode *node = _shadowCasters[i].node;
+		if( sceneMan.getNodeStamp( *node ) > entry.changeStamp ||
+		    !std::binary_search( entry.casters.begin(), entry.casters.end(), node ) ) return false;
+	}
+
+	return true;
 }
 
 
@@ -886,7 +1120,7 @@ void Renderer::setupShadowMap( bool noShadows )
 	// Bind shadow map
 	if( !noShadows && _curLight->_shadowMapCount > 0 )
 	{
-		_renderDevice->setTexture( 12, _renderDevice->getRenderBufferTex( _shadowRB, 32 ), sampState, TextureUsage::Texture );
+		_renderDevice->setTexture( 12, _renderDevice->getRenderBufferTex( _curShadowRB, 32 ), sampState, TextureUsage::Texture );
 		_smSize = (float)Modules::config().shadowMapSize;
 	}
 	else
@@ -906,14 +1140,11 @@ Matrix4f Renderer::calcCropMatrix( const Frustum &frustSlice, const Vec3f lightP
 	float frustMaxY = -Math::MaxFloat, bbMaxY = -Math::MaxFloat;
 	float frustMaxZ = -Math::MaxFloat, bbMaxZ = -Math::MaxFloat;
 	
-	// Find post-projective space AABB of all objects in frustum
-	Modules::sceneMan().updateQueues( frustSlice, 0x0, RenderingOrder::None,
-		SceneNodeFlags::NoDraw | SceneNodeFlags::NoCastShadow, false, true );
-	RenderQueue &renderQueue = Modules::sceneMan().getRenderQueue();
-	
-	for( size_t i = 0, s = renderQueue.size(); i < s; ++i )
+	// Find post-projective space AABB of all shadow casters in frustum
+	for( size_t i = 0, s = _shadowCasters.size(); i < s; ++i )
 	{
-		const BoundingBox &aabb = renderQueue[i].node->getBBox();
+		BoundingBox &aabb = _shadowCasters[i].node->getBBox();
+		if( frustSlice.cullBox( aabb ) ) continue;
 		
 		// Check if light is inside AABB
 		if( lightPos.x >= aabb.min.x && lightPos.y >= aabb.min.y && lightPos.z >= aabb.min.z &&
@@ -994,15 +1225,43 @@ Matrix4f Renderer::calcCropMatrix( const Frustum &frustSlice, const Vec3f lightP
 void Renderer::updateShadowMap()
 {
 	if( _curLight == 0x0 ) return;
+
+	ProfileScope profileScope( "UpdateShadowMap", _curLight->_name, true );
+
+	// Shadow casters are culled once per light and reused for all splits
+	Modules::sceneMan().updateQueues( _curLight->getFrustum(), 0x0, RenderingOrder::None,
+		SceneNodeFlags::NoDraw | SceneNodeFlags::NoCastShadow, false, true );
+	_shadowCasters = Modules::sceneMan().getRenderQueue();
+
+	// Keep shadow map if nothing has changed since it was rendered
+	ShadowMapCacheEntry *cacheEntry = findShadowMapCacheEntry( _curLight, true );
+	if( cacheEntry != 0x0 )
+	{
+		cacheEntry->lastUsedFrame = _frameID;
+		_curShadowRB = cacheEntry->renderBuffer;
+		
+		if( isShadowMapCacheValid( *cacheEntry ) )
+		{
+			memcpy( _splitPlanes, cacheEntry->splitPlanes, sizeof( _splitPlanes ) );
+			for( uint32 i = 0; i < 4; ++i ) _lightMats[i] = cacheEntry->lightMats[i];
+			
+			Modules::stats().incStat( EngineStats::ShadowMapsSkipped, 1 );
+			return;
+		}
+	}
+	else
+	{
+		_curShadowRB = _shadowRB;
+	}
 	
 	uint32 prevRendBuf = _renderDevice->_curRendBuf;
 	int prevVPX = _renderDevice->_vpX, prevVPY = _renderDevice->_vpY, prevVPWidth = _renderDevice->_vpWidth, prevVPHeight = _renderDevice->_vpHeight;
 	
 	int shadowRTWidth, shadowRTHeight;
-	_renderDevice->getRenderBufferDimensions( _shadowRB, &shadowRTWidth, &shadowRTHeight );
+	_renderDevice->getRenderBufferDimensions( _curShadowRB, &shadowRTWidth, &shadowRTHeight );
 
 	_renderDevice->setViewport( 0, 0, shadowRTWidth, shadowRTHeight );
-	_renderDevice->setRenderBuffer( _shadowRB );
+	_renderDevice->setRenderBuffer( _curShadowRB );
 	
 	_renderDevice->setColorWriteMask( false );
 	_renderDevice->setDepthMask( true );
@@ -1014,11 +1273,10 @@ void Renderer::updateShadowMap()
 	
 	// Find AABB of lit geometry
 	BoundingBox aabb;
-	Modules::sceneMan().updateQueues( _curCamera->getFrustum(), &_curLight->getFrustum(),
-		RenderingOrder::None, SceneNodeFlags::NoDraw | SceneNodeFlags::NoCastShadow, false, true );
-	for( size_t j = 0, s = Modules::sceneMan().getRenderQueue().size(); j < s; ++j )
+	for( size_t j = 0, s = _shadowCasters.size(); j < s; ++j )
 	{
-		aabb.makeUnion( Modules::sceneMan().getRenderQueue()[j].node->getBBox() );
+		BoundingBox &casterBox = _shadowCasters[j].node->getBBox();
+		if( !_curCamera->getFrustum().cullBox( casterBox ) ) aabb.makeUnion( casterBox );
 	}
 
 	// Find depth range of lit geometry
@@ -1051,7 +1309,7 @@ void Renderer::updateShadowMap()
 		
 		_splitPlanes[i] = (1 - lambda) * uniformDist + lambda * logDist;  // Lerp
 	}
-	
+
 	// Prepare shadow map rendering
 	_renderDevice->setDepthTest( true );
 	//_renderDevice->setCullMode( RS_CULL_FRONT );	// Front face culling reduces artefacts but produces more "peter-panning"
@@ -1089,8 +1347,12 @@ void Renderer::updateShadowMap()
 		
 		// Generate render queue with shadow casters for current slice
 		frustum.buildViewFrustum( _curLight->getViewMat(), lightProjMat );
-		Modules::sceneMan().updateQueues( frustum, 0x0, RenderingOrder::None,
-			SceneNodeFlags::NoDraw | SceneNodeFlags::NoCastShadow, false, true );
+		RenderQueue &renderQueue = Modules::sceneMan().getRenderQueue();
+		renderQueue.resize( 0 );
+		for( size_t j = 0, s = _shadowCasters.size(); j < s; ++j )
+		{
+			if( !frustum.cullBox( _shadowCasters[j].node->getBBox() ) ) renderQueue.push_back( _shadowCasters[j] );
+		}
 		
 		// Create texture atlas if several splits are enabled
 		if( numMaps > 1 )
@@ -1111,7 +1373,7 @@ void Renderer::updateShadowMap()
 		setupViewMatrices( _curLight->getViewMat(), lightProjMat );
 		
 		// Render
-		drawRenderables( _curLight->_shadowContext, "", false, &frustum, 0x0, RenderingOrder::None, -1 );
+		drawRenderables( _curLight->_shadowContextId, 0, false, &frustum, 0x0, RenderingOrder::None, -1 );
 	}
 
 	// Map from post-projective space [-1,1] to texture space [0,1]
@@ -1121,6 +1383,24 @@ void Renderer::updateShadowMap()
 		_lightMats[i].translate( 0.5f, 0.5f, 0.0f );
 	}
 
+	if( cacheEntry != 0x0 )
+	{
+		cacheEntry->camera = _curCamera->getHandle();
+		cacheEntry->camTrans = _curCamera->getAbsTrans();
+		cacheEntry->camProjMat = _curCamera->getProjMat();
+		cacheEntry->mapCount = numMaps;
+		cacheEntry->splitLambda = _curLight->_shadowSplitLambda;
+		cacheEntry->shadowContext = _curLight->_shadowContextId;
+		cacheEntry->changeStamp = Modules::sceneMan().getChangeStamp();
+		memcpy( cacheEntry->splitPlanes, _splitPlanes, sizeof( _splitPlanes ) );
+		for( uint32 i = 0; i < 4; ++i ) cacheEntry->lightMats[i] = _lightMats[i];
+		
+		cacheEntry->casters.resize( _shadowCasters.size() );
+		for( size_t i = 0, s = _shadowCasters.size(); i < s; ++i ) cacheEntry->casters[i] = _shadowCasters[i].node;
+		std::sort( cacheEntry->casters.begin(), cacheEntry->casters.end() );
+	}
+	Modules::stats().incStat( EngineStats::ShadowMapsRendered, 1 );
+
 	// ********************************************************************************************
 
 	_renderDevice->setCullMode( RS_CULL_BACK );
@@ -1167,7 +1447,7 @@ void Renderer::drawOccProxies( uint32 list )
 	_renderDevice->getColorWriteMask( prevColorMask );
 	_renderDevice->getDepthMask( prevDepthMask );
 	
-	setMaterial( 0x0, "" );
+	setMaterial( 0x0, 0 );
 	_renderDevice->setColorWriteMask( false );
 	_renderDevice->setDepthMask( false );
 	
@@ -1216,7 +1496,12 @@ void Renderer::showOverlays( const float *verts, uint32 vertCount, float *colRGB
 	
 	if( numOverlayVerts + vertCount > MaxNumOverlayVerts ) return;
 
-	memcpy( &_overlayVerts[numOverlayVerts], verts, vertCount * sizeof( OverlayVert ) );
+	// Overlays that are identical to the last frame do not need to be uploaded again
+	if( memcmp( &_overlayVerts[numOverlayVerts], verts, vertCount * sizeof( OverlayVert ) ) != 0 )
+	{
+		memcpy( &_overlayVerts[numOverlayVerts], verts, vertCount * sizeof( OverlayVert ) );
+		_overlayVertsChanged = true;
+	}
 	
 	// Check if previous batch can be extended
 	if( !_overlayBatches.empty() )
@@ -1241,7 +1526,7 @@ void Renderer::clearOverlays()
 }
 
 
-void Renderer::drawOverlays( const string &shaderContext )
+void Renderer::drawOverlays( uint32 shaderContext )
 {
 	uint32 numOverlayVerts = 0;
 	if( !_overlayBatches.empty() )
@@ -1249,13 +1534,35 @@ void Renderer::drawOverlays( const string &shaderContext )
 	
 	if( numOverlayVerts == 0 ) return;
 	
-	// Upload overlay vertices
-	_renderDevice->updateBufferData( _overlayGeo, _overlayVB, 0, MaxNumOverlayVerts * sizeof( OverlayVert ), _overlayVerts );
+	if( _overlayVertsChanged || numOverlayVerts != _overlayUploadCount )
+	{
+		// Upload used range of overlay vertices behind the previous range of the ring buffer, so that the
+		// driver does not need to wait for pending draw calls; the whole buffer is discarded when wrapping
+		uint32 offset = _overlayRingOffset + _overlayUploadCount;
+		RDIBufferMappingTypes mapType = WriteNoOverwrite;
+		if( offset + numOverlayVerts > OverlayRingSize )
+		{
+			offset = 0;
+			mapType = Write;
+		}
+
+		uint32 mapOffset = mapType == Write ? 0 : offset;
+		uint32 mapSize = mapType == Write ? OverlayRingSize : numOverlayVerts;
+		void *data = _renderDevice->mapBuffer( _overlayGeo, _overlayVB, mapOffset * sizeof( OverlayVert ),
+		                                       mapSize * sizeof( OverlayVert ), mapType );
+		if( data == 0x0 ) return;
+		memcpy( data, _overlayVerts, numOverlayVerts * sizeof( OverlayVert ) );
+		_renderDevice->unmapBuffer( _overlayGeo, _overlayVB );
+
+		_overlayRingOffset = offset;
+		_overlayUploadCount = numOverlayVerts;
+		_overlayVertsChanged = false;
+	}
 
 // 	_renderDevice->setVertexBuffer( 0, _overlayVB, 0, sizeof( OverlayVert ) );
 // 	_renderDevice->setIndexBuffer( _quadIdxBuf, IDXFMT_16 );
 	_renderDevice->setGeometry( _overlayGeo );
-	ASSERT( QuadIndexBufCount >= MaxNumOverlayVerts * 6 );
+	ASSERT( QuadIndexBufCount >= OverlayRingSize * 6/4 );
 
 	float aspect = (float)_curCamera->_vpWidth / (float)_curCamera->_vpHeight;
 	setupViewMatrices( Matrix4f(), Matrix4f::OrthoMat( 0, aspect, 1, 0, -1, 1 ) );
@@ -1282,7 +1589,8 @@ void Renderer::drawOverlays( const string &shaderContext )
 			_renderDevice->setShaderConst( _curShader->uni_olayColor, CONST_FLOAT4, ob.colRGBA );
 		
 		// Draw batch
-		_renderDevice->drawIndexed( PRIM_TRILIST, ob.firstVert * 6/4, ob.vertCount * 6/4, ob.firstVert, ob.vertCount );
+		uint32 firstVert = _overlayRingOffset + ob.firstVert;
+		_renderDevice->drawIndexed( PRIM_TRILIST, firstVert * 6/4, ob.vertCount * 6/4, firstVert, ob.vertCount );
 	}
 }
 
@@ -1356,7 +1664,7 @@ void Renderer::clear( bool depth, bool buf0, bool buf1, bool buf2, bool buf3,
 }
 
 
-void Renderer::drawFSQuad( Resource *matRes, const string &shaderContext )
+void Renderer::drawFSQuad( Resource *matRes, uint32 shaderContext )
 {
 	if( matRes == 0x0 || matRes->getType() != ResourceTypes::Material ) return;
 
@@ -1373,18 +1681,18 @@ void Renderer::drawFSQuad( Resource *matRes, const string &shaderContext )
 }
 
 
-void Renderer::drawGeometry( const string &shaderContext, const string &theClass,
+void Renderer::drawGeometry( uint32 shaderContext, uint32 classFilter,
                              RenderingOrder::List order, int occSet )
 {
 	Modules::sceneMan().updateQueues( _curCamera->getFrustum(), 0x0, order,
 	                                  SceneNodeFlags::NoDraw , false, true );
 	
 	setupViewMatrices( _curCamera->getViewMat(), _curCamera->getProjMat() );
-	drawRenderables( shaderContext, theClass, false, &_curCamera->getFrustum(), 0x0, order, occSet );
+	drawRenderables( shaderContext, classFilter, false, &_curCamera->getFrustum(), 0x0, order, occSet );
 }
 
 
-void Renderer::drawLightGeometry( const string &shaderContext, const string &theClass,
+void Renderer::drawLightGeometry( uint32 shaderContext, uint32 classFilter,
                                   bool noShadows, RenderingOrder::List order, int occSet )
 {
 	Modules::sceneMan().updateQueues( _curCamera->getFrustum(), 0x0, RenderingOrder::None,
@@ -1437,6 +1745,8 @@ void Renderer::drawLightGeometry( const string &shaderContext, const string &the
 			}
 		}
 	
+		ProfileScope lightScope( "Light", _curLight->_name, true );
+
 		// Update shadow map
 		if( !noShadows && _curLight->_shadowMapCount > 0 )
 		{
@@ -1472,8 +1782,8 @@ void Renderer::drawLightGeometry( const string &shaderContext, const string &the
 		Modules::sceneMan().updateQueues( _curCamera->getFrustum(), &_curLight->getFrustum(),
 		                                  order, SceneNodeFlags::NoDraw, false, true );
 		setupViewMatrices( _curCamera->getViewMat(), _curCamera->getProjMat() );
-		drawRenderables( shaderContext.empty() ? _curLight->_lightingContext : shaderContext,
-		                 theClass, false, &_curCamera->getFrustum(),
+		drawRenderables( shaderContext == 0 ? _curLight->_lightingContextId : shaderContext,
+		                 classFilter, false, &_curCamera->getFrustum(),
 		                 &_curLight->getFrustum(), order, occSet );
 		Modules().stats().incStat( EngineStats::LightPassCount, 1 );
 
@@ -1494,7 +1804,7 @@ void Renderer::drawLightGeometry( const string &shaderContext, const string &the
 }
 
 
-void Renderer::drawLightShapes( const string &shaderContext, bool noShadows, int occSet )
+void Renderer::drawLightShapes( uint32 shaderContext, bool noShadows, int occSet )
 {
 	MaterialResource *curMatRes = 0x0;
 	
@@ -1548,6 +1858,8 @@ void Renderer::drawLightShapes( const string &shaderContext, bool noShadows, int
 			}
 		}
 		
+		ProfileScope lightScope( "Light", _curLight->_name, true );
+
 		// Update shadow map
 		if( !noShadows && _curLight->_shadowMapCount > 0 )
 		{	
@@ -1572,7 +1884,7 @@ void Renderer::drawLightShapes( const string &shaderContext, bool noShadows, int
 		if( curMatRes != _curLight->_materialRes )
 		{
 			if( !setMaterial( _curLight->_materialRes,
-				              shaderContext.empty() ? _curLight->_lightingContext : shaderContext ) )
+				              shaderContext == 0 ? _curLight->_lightingContextId : shaderContext ) )
 			{
 				continue;
 			}
@@ -1615,9 +1927,162 @@ void Renderer::drawLightShapes( const string &shaderContext, bool noShadows, int
 	}
 }
 
+
+void Renderer::buildLightClusters( uint32 tilesX, uint32 tilesY, uint32 slices )
+{
+	const Frustum &camFrustum = _curCamera->getFrustum();
+	const Matrix4f &viewMat = _curCamera->getViewMat();
+	
+	_lightClusters.setup( tilesX, tilesY, slices, _curCamera->_frustLeft, _curCamera->_frustRight,
+	                      _curCamera->_frustBottom, _curCamera->_frustTop, _curCamera->_frustNear,
+	                      _curCamera->_frustFar, _curCamera->_orthographic );
+	_lightClusters.beginBinning();
+	_clusterLightData.resize( 0 );
+
+	uint32 numLights = 0;
+	for( size_t i = 0, s = Modules::sceneMan().getLightQueue().size(); i < s && numLights < MaxClusteredLights; ++i )
+	{
+		LightNode *light = (LightNode *)Modules::sceneMan().getLightQueue()[i];
+		if( camFrustum.cullFrustum( light->getFrustum() ) ) continue;
+
+		// Bounding sphere of the light volume; cones of spot lights get a tighter sphere
+		float halfFov = degToRad( light->_fov / 2 );
+		Vec3f center = light->_absPos;
+		float radius = light->_radius;
+		if( halfFov <= Math::Pi / 4 )
+		{
+			radius = light->_radius / (2 * cosf( halfFov ));
+			center += light->_spotDir * radius;
+		}
+		else if( halfFov < Math::Pi / 2 )
+		{
+			center += light->_spotDir * (light->_radius * cosf( halfFov ));
+			radius = light->_radius * sinf( halfFov );
+		}
+		_lightClusters.addLight( viewMat * center, radius, numLights++ );
+
+		// Light parameters, one row of four texels per light
+		Vec3f col = light->_diffuseCol * light->_diffuseColMult;
+		float data[16] = {
+			light->_absPos.x, light->_absPos.y, light->_absPos.z, light->_radius,
+			light->_spotDir.x, light->_spotDir.y, light->_spotDir.z, cosf( halfFov ),
+			col.x, col.y, col.z, 0,
+			0, 0, 0, 0 };
+		_clusterLightData.insert( _clusterLightData.end(), data, data + 16 );
+	}
+
+	_lightClusters.finishBinning();
+
+	_clusterGridSize[0] = (float)tilesX;
+	_clusterGridSize[1] = (float)tilesY;
+	_clusterGridSize[2] = (float)slices;
+	_clusterGridSize[3] = (float)numLights;
+	_clusterDepthParams[0] = _lightClusters.getSliceScale();
+	_clusterDepthParams[1] = _lightClusters.getSliceBias();
+	_clusterDepthParams[2] = _lightClusters.isOrthographic() ? 0.0f : 1.0f;
+	_clusterProjMat = _curCamera->getProjMat();
+	++_curShaderUpdateStamp;
+}
+
+
+void Renderer::uploadLightClusters()
+{
+	const std::vector< uint32 > &offsets = _lightClusters.getOffsets();
+	const std::vector< uint32 > &indices = _lightClusters.getLightIndices();
+	uint32 numClusters = _lightClusters.getClusterCount();
+	uint32 sampState = SS_FILTER_POINT | SS_ANISO1 | SS_ADDR_CLAMP;
+
+	// Light map; the textures grow in powers of two and are never shrunk
+	uint32 height = 16;
+	while( height < _lightClusters.getLightCount() ) height *= 2;
+	if( height > _clusterLightMapHeight )
+	{
+		_renderDevice->destroyTexture( _clusterLightMap );
+		_clusterLightMap = _renderDevice->createTexture( TextureTypes::Tex2D, 4, height, 1,
+			TextureFormats::RGBA32F, false, false, false, false );
+		_clusterLightMapHeight = height;
+	}
+	_clusterLightData.resize( _clusterLightMapHeight * 16 );
+	_renderDevice->updateTextureData( _clusterLightMap, 0, 0, &_clusterLightData[0] );
+
+	// Item map: one texel per cluster holding the position of the first light index and the
+	// number of lights, followed by the light indices of all clusters packed into four channels
+	uint32 numTexels = numClusters + ((uint32)indices.size() + 3) / 4;
+	height = 1;
+	while( height * ClusterItemMapWidth < numTexels ) height *= 2;
+	if( height > _clusterItemMapHeight )
+	{
+		_renderDevice->destroyTexture( _clusterItemMap );
+		_clusterItemMap = _renderDevice->createTexture( TextureTypes::Tex2D, ClusterItemMapWidth, height, 1,
+			TextureFormats::RGBA32F, false, false, false, false );
+		_clusterItemMapHeight = height;
+	}
+	_clusterItemData.resize( _clusterItemMapHeight * ClusterItemMapWidth * 4 );
+	
+	float *items = &_clusterItemData[0];
+	for( uint32 i = 0; i < numClusters; ++i )
+	{
+		items[i * 4 + 0] = (float)(numClusters * 4 + offsets[i]);
+		items[i * 4 + 1] = (float)(offsets[i + 1] - offsets[i]);
+	}
+	for( uint32 i = 0, s = (uint32)indices.size(); i < s; ++i )
+		items[numClusters * 4 + i] = (float)indices[i];
+	_renderDevice->updateTextureData( _clusterItemMap, 0, 0, items );
+
+	_renderDevice->setTexture( 13, _clusterLightMap, sampState, TextureUsage::Texture );
+	_renderDevice->setTexture( 14, _clusterItemMap, sampState, TextureUsage::Texture );
+}
+
+
+void Renderer::drawClusteredLights( uint32 shaderContext, uint32 classFilter, RenderingOrder::List order,
+                                    Resource *quadMatRes, uint32 tilesX, uint32 tilesY, uint32 slices, int occSet )
+{
+	// The light lists are passed to the shaders in float textures, use the light loops otherwise
+	if( !_renderDevice->getCaps().texFloat )
+	{
+		if( quadMatRes != 0x0 ) drawLightShapes( 0, false, occSet );
+		else drawLightGeometry( 0, classFilter, false, order, occSet );
+		return;
+	}
+	
+	Modules::sceneMan().updateQueues( _curCamera->getFrustum(), 0x0, RenderingOrder::None,
+	                                  SceneNodeFlags::NoDraw, true, false );
+
+	Timer *timer = Modules::stats().getTimer( EngineStats::LightClusterTime );
+	if( Modules::config().gatherTimeStats ) timer->setEnabled( true );
+	
+	buildLightClusters( tilesX, tilesY, slices );
+	
+	timer->setEnabled( false );
+
+	if( _lightClusters.getLightCount() == 0 ) return;
+
+	GPUTimer *gpuTimer = Modules::stats().getGPUTimer(
+		quadMatRes != 0x0 ? EngineStats::DefLightsGPUTime : EngineStats::FwdLightsGPUTime );
+	if( Modules::config().gatherTimeStats ) gpuTimer->beginQuery( _frameID );
+
+	uploadLightClusters();
+	
+	// All lights are applied in a single pass
+	if( quadMatRes != 0x0 )
+	{
+		drawFSQuad( quadMatRes, shaderContext );
+	}
+	else
+	{
+		Modules::sceneMan().updateQueues( _curCamera->getFrustum(), 0x0, order,
+		                                  SceneNodeFlags::NoDraw, false, true );
+		setupViewMatrices( _curCamera->getViewMat(), _curCamera->getProjMat() );
+		drawRenderables( shaderContext, classFilter, false, &_curCamera->getFrustum(), 0x0, order, occSet );
+	}
+	Modules().stats().incStat( EngineStats::LightPassCount, 1 );
+
+	gpuTimer->endQuery();
+}
+
 void Renderer::dispatchCompute( MaterialResource *materialRes, const std::string &context, uint32 groups_x, uint32 groups_y, uint32 groups_z )
 {
-	if ( !setMaterial( materialRes, context ) ) return;
+	if ( !setMaterial( materialRes, ShaderResource::findContextId( context ) ) ) return;
 
 	ShaderCombination *curShader = Modules::renderer().getCurShader();
 
@@ -1633,7 +2098,7 @@ void Renderer::dispatchCompute( MaterialResource *materialRes, const std::string
 // Scene Node Rendering Functions
 // =================================================================================================
 
-void Renderer::drawRenderables( const string &shaderContext, const string &theClass, bool debugView,
+void Renderer::drawRenderables( uint32 shaderContext, uint32 classFilter, bool debugView,
                                 const Frustum *frust1, const Frustum *frust2, RenderingOrder::List order,
                                 int occSet )
 {
@@ -1665,7 +2130,7 @@ void Renderer::drawRenderables( const string &shaderContext, const string &theCl
 			if( _renderFuncRegistry[i].nodeType == renderQueue[firstItem].type )
 			{
 				_renderFuncRegistry[i].renderFunc(
-					firstItem, lastItem, shaderContext, theClass, debugView, frust1, frust2, order, occSet );
+					firstItem, lastItem, shaderContext, classFilter, debugView, frust1, frust2, order, occSet );
 				break;
 			}
 		}
@@ -1681,7 +2146,7 @@ void Renderer::drawRenderables( const string &shaderContext, const string &theCl
 }
 
 
-void Renderer::drawMeshes( uint32 firstItem, uint32 lastItem, const string &shaderContext, const string &theClass,
+void Renderer::drawMeshes( uint32 firstItem, uint32 lastItem, uint32 shaderContext, uint32 classFilter,
                            bool debugView, const Frustum *frust1, const Frustum *frust2, RenderingOrder::List order,
                            int occSet )
 {
@@ -1694,6 +2159,8 @@ void Renderer::drawMeshes( uint32 firstItem, uint32 lastItem, const string &shad
 	MaterialResource *curMatRes = 0x0;
 
 	bool tessellationSupported = rdi->getCaps().tesselation;
+	bool instancingSupported = rdi->getCaps().instancing;
+	bool texStreaming = TextureResource::getStreamedCount() > 0;
 
 	// Loop over mesh queue
 	for( size_t i = firstItem; i <= lastItem; ++i )
@@ -1776,7 +2243,15 @@ void Renderer::drawMeshes( uint32 firstItem, uint32 lastItem, const string &shad
 
 		if( !debugView )
 		{
-			if( !meshNode->getMaterialRes()->isOfClass( theClass ) ) continue;
+			if( !meshNode->getMaterialRes()->isOfClass( classFilter ) ) continue;
+
+			// Request texture mips that match the screen size of the mesh
+			if( texStreaming )
+			{
+				float screenSize = Modules::renderer().calcScreenSize( meshNode->getBBox() );
+				Modules::renderer()._texStreamRequestSize = screenSize;
+				Modules::renderer().requestStreamedTextures( meshNode->getMaterialRes(), screenSize );
+			}
 			
 			// Set material
 			if( curMatRes != meshNode->getMaterialRes() )
@@ -1828,6 +2303,98 @@ void Renderer::drawMeshes( uint32 firstItem, uint32 lastItem, const string &shad
 			modelChanged = false;
 		}
 
+		// Instanced rendering: shaders that read the world transformation from the instance buffer
+		// (see INSTANCING in vertCommon.glsl) have no worldMat uniform
+		if( curShader->uni_worldMat < 0 && instancingSupported )
+		{
+			Renderer &renderer = Modules::renderer();
+			uint32 instGeo = curGeoRes->getInstancedGeometryInfo();
+			uint32 numInstances = 0;
+			
+			// Map the whole buffer so that the driver can discard the contents of the previous batch
+			MeshInstanceData *instances = (MeshInstanceData *)rdi->mapBuffer( instGeo, renderer._meshInstanceBuf, 0,
+				MeshInstancesPerBatch * sizeof( MeshInstanceData ), Write );
+			if( instances == 0x0 ) continue;
+			
+			// Consecutive meshes that only differ in their transformation can share a single draw call
+			// (the queue is sorted by material and geometry). Meshes with per-node uniforms, skinning
+			// or occlusion queries are always drawn as a single instance.
+			bool canBatch = queryObj == 0 && occSet < 0 && curShader->uni_nodeId < 0 &&
+			                curShader->uni_customInstData < 0 &&
+			                (curShader->uni_skinMatRows < 0 || modelNode->_skinMatRows.empty());
+			
+			for( ;; )
+			{
+				MeshNode *instNode = (MeshNode *)renderQueue[i].node;
+				
+				if( texStreaming && !debugView && instNode != meshNode )
+				{
+					renderer.requestStreamedTextures( instNode->getMaterialRes(),
+					                                  renderer.calcScreenSize( instNode->getBBox() ) );
+				}
+				
+				// The normal matrix is derived in the shader
+				const Matrix4f &absTrans = instNode->_absTrans;
+				MeshInstanceData &inst = instances[numInstances++];
+				for( uint32 row = 0; row < 3; ++row )
+				{
+					inst.worldRows[row][0] = absTrans.c[0][row];
+					inst.worldRows[row][1] = absTrans.c[1][row];
+					inst.worldRows[row][2] = absTrans.c[2][row];
+					inst.worldRows[row][3] = absTrans.c[3][row];
+				}
+
+				if( !canBatch || i >= lastItem || numInstances == MeshInstancesPerBatch ) break;
+
+				// Check if next mesh is compatible
+				MeshNode *nextNode = (MeshNode *)renderQueue[i + 1].node;
+				ModelNode *nextModel = nextNode->getParentModel();
+				if( nextModel->getGeometryResource() != curGeoRes ||
+				    nextNode->getMaterialRes() != meshNode->getMaterialRes() ||
+				    nextNode->getBatchStart() != meshNode->getBatchStart() ||
+				    nextNode->getBatchCount() != meshNode->getBatchCount() ||
+				    nextNode->getVertRStart() != meshNode->getVertRStart() ||
+				    nextNode->getVertREnd() != meshNode->getVertREnd() ||
+				    nextNode->getTessellationStatus() != meshNode->getTessellationStatus() ||
+				    (curShader->uni_skinMatRows >= 0 && !nextModel->_skinMatRows.empty()) )
+					break;
+
+				++i;
+			}
+
+			rdi->unmapBuffer( instGeo, renderer._meshInstanceBuf );
+			
+			if( curShader->uni_nodeId >= 0 )
+			{
+				float id = (float)meshNode->getHandle();
+				rdi->setShaderConst( curShader->uni_nodeId, CONST_FLOAT, &id );
+			}
+			if( curShader->uni_customInstData >= 0 )
+			{
+				rdi->setShaderConst( curShader->uni_customInstData, CONST_FLOAT4,
+				                     &modelNode->_customInstData[0].x, ModelCustomVecCount );
+			}
+
+			if( queryObj )
+				rdi->beginQuery( queryObj );
+
+			rdi->setGeometry( instGeo );
+			rdi->drawIndexedInstanced( drawType, meshNode->getBatchStart(), meshNode->getBatchCount(),
+			                           meshNode->getVertRStart(), meshNode->getVertREnd() - meshNode->getVertRStart() + 1,
+			                           numInstances );
+			Modules::stats().incStat( EngineStats::BatchCount, 1 );
+			Modules::stats().incStat( EngineStats::InstancedBatchCount, 1 );
+			Modules::stats().incStat( EngineStats::DrawCallsSaved, (float)(numInstances - 1) );
+			Modules::stats().incStat( EngineStats::TriCount, meshNode->getBatchCount() / 3.0f * numInstances );
+
+			if( queryObj )
+				rdi->endQuery( queryObj );
+
+			// Rebind the regular geometry for the next mesh
+			curGeoRes = 0x0;
+			continue;
+		}
+
 		// World transformation
 		if( curShader->uni_worldMat >= 0 )
 		{
@@ -1866,6 +2433,9 @@ void Renderer::drawMeshes( uint32 firstItem, uint32 lastItem, const string &shad
 			rdi->endQuery( queryObj );
 	}
 
+	// Textures bound outside of mesh drawing get all of their mips
+	Modules::renderer()._texStreamRequestSize = Math::MaxFloat;
+
 	// Draw occlusion proxies
 	if( occSet >= 0 )
 		Modules::renderer().drawOccProxies( OCCPROXYLIST_RENDERABLES );
@@ -1874,7 +2444,7 @@ void Renderer::drawMeshes( uint32 firstItem, uint32 lastItem, const string &shad
 }
 
 
-void Renderer::drawParticles( uint32 firstItem, uint32 lastItem, const string &shaderContext, const string &theClass,
+void Renderer::drawParticles( uint32 firstItem, uint32 lastItem, uint32 shaderContext, uint32 classFilter,
                               bool debugView, const Frustum *frust1, const Frustum * /*frust2*/, RenderingOrder::List /*order*/,
                               int occSet )
 {
@@ -1889,10 +2459,9 @@ void Renderer::drawParticles( uint32 firstItem, uint32 lastItem, const string &s
 	GPUTimer *timer = Modules::stats().getGPUTimer( EngineStats::ParticleGPUTime );
 	if( Modules::config().gatherTimeStats ) timer->beginQuery( Modules::renderer().getFrameID() );
 
-	// Bind particle geometry
-// 	rdi->setVertexBuffer( 0, Modules::renderer().getParticleVBO(), 0, sizeof( ParticleVert ) );
-// 	rdi->setIndexBuffer( Modules::renderer().getQuadIdxBuf(), IDXFMT_16 );
-	rdi->setGeometry( Modules::renderer().getParticleGeometry() );
+	// Particles are drawn with one instanced call per emitter if the shader reads the particle data
+	// from vertex attributes; shaders with the uniform arrays are served in batches
+	bool instancingSupported = rdi->getCaps().instancing;
 	ASSERT( QuadIndexBufCount >= ParticlesPerBatch * 6 );
 
 	// Loop through emitter queue
@@ -1901,7 +2470,7 @@ void Renderer::drawParticles( uint32 firstItem, uint32 lastItem, const string &s
 		EmitterNode *emitter = (EmitterNode *)renderQueue[i].node;
 		
 		if( emitter->_particleCount == 0 ) continue;
-		if( !emitter->_materialRes->isOfClass( theClass ) ) continue;
+		if( !emitter->_materialRes->isOfClass( classFilter ) ) continue;
 		
 		// Occlusion culling
 		uint32 queryObj = 0;
@@ -1960,69 +2529,88 @@ void Renderer::drawParticles( uint32 firstItem, uint32 lastItem, const string &s
 			rdi->setShaderConst( curShader->uni_nodeId, CONST_FLOAT, &id );
 		}
 
-		// Divide particles in batches and render them
-		for( uint32 j = 0; j < emitter->_particleCount / ParticlesPerBatch; ++j )
+		if( curShader->uni_parPosArray < 0 && instancingSupported )
 		{
-			// Check if batch needs to be rendered
-			bool allDead = true;
-			for( uint32 k = 0; k < ParticlesPerBatch; ++k )
+			uint32 numInstances = emitter->uploadInstanceData();
+			if( numInstances > 0 )
 			{
-				if( emitter->_particles[j*ParticlesPerBatch + k].life > 0 )
-				{
-					allDead = false;
-					break;
-				}
+				rdi->setGeometry( emitter->_instanceGeo );
+				rdi->drawIndexedInstanced( PRIM_TRILIST, 0, 6, 0, 4, numInstances );
+				Modules::stats().incStat( EngineStats::BatchCount, 1 );
+				Modules::stats().incStat( EngineStats::ParticleDrawCalls, 1 );
+				Modules::stats().incStat( EngineStats::TriCount, numInstances * 2.0f );
 			}
-			if( allDead ) continue;
-
-			// Render batch
-			if( curShader->uni_parPosArray >= 0 )
-				rdi->setShaderConst( curShader->uni_parPosArray, CONST_FLOAT3,
-				                      (float *)emitter->_parPositions + j*ParticlesPerBatch*3, ParticlesPerBatch );
-			if( curShader->uni_parSizeAndRotArray >= 0 )
-				rdi->setShaderConst( curShader->uni_parSizeAndRotArray, CONST_FLOAT2,
-				                      (float *)emitter->_parSizesANDRotations + j*ParticlesPerBatch*2, ParticlesPerBatch );
-			if( curShader->uni_parColorArray >= 0 )
-				rdi->setShaderConst( curShader->uni_parColorArray, CONST_FLOAT4,
-				                      (float *)emitter->_parColors + j*ParticlesPerBatch*4, ParticlesPerBatch );
-
-			rdi->drawIndexed( PRIM_TRILIST, 0, ParticlesPerBatch * 6, 0, ParticlesPerBatch * 4 );
-			Modules::stats().incStat( EngineStats::BatchCount, 1 );
-			Modules::stats().incStat( EngineStats::TriCount, ParticlesPerBatch * 2.0f );
 		}
-
-		uint32 count = emitter->_particleCount % ParticlesPerBatch;
-		if( count > 0 )
+		else
 		{
-			uint32 offset = (emitter->_particleCount / ParticlesPerBatch) * ParticlesPerBatch;
+			rdi->setGeometry( Modules::renderer().getParticleGeometry() );
 			
-			// Check if batch needs to be rendered
-			bool allDead = true;
-			for( uint32 k = 0; k < count; ++k )
+			// Divide particles in batches and render them
+			for( uint32 j = 0; j < emitter->_particleCount / ParticlesPerBatch; ++j )
 			{
-				if( emitter->_particles[offset + k].life > 0 )
+				// Check if batch needs to be rendered
+				bool allDead = true;
+				for( uint32 k = 0; k < ParticlesPerBatch; ++k )
 				{
-					allDead = false;
-					break;
+					if( emitter->getParticleStream( ParticleStreams::Life )[j*ParticlesPerBatch + k] > 0 )
+					{
+						allDead = false;
+						break;
+					}
 				}
-			}
-			
-			if( !allDead )
-			{
+				if( allDead ) continue;
+
 				// Render batch
 				if( curShader->uni_parPosArray >= 0 )
 					rdi->setShaderConst( curShader->uni_parPosArray, CONST_FLOAT3,
-					                      (float *)emitter->_parPositions + offset*3, count );
+					                      (float *)emitter->_parPositions + j*ParticlesPerBatch*3, ParticlesPerBatch );
 				if( curShader->uni_parSizeAndRotArray >= 0 )
 					rdi->setShaderConst( curShader->uni_parSizeAndRotArray, CONST_FLOAT2,
-					                      (float *)emitter->_parSizesANDRotations + offset*2, count );
+					                      (float *)emitter->_parSizesANDRotations + j*ParticlesPerBatch*2, ParticlesPerBatch );
 				if( curShader->uni_parColorArray >= 0 )
 					rdi->setShaderConst( curShader->uni_parColorArray, CONST_FLOAT4,
-					                      (float *)emitter->_parColors + offset*4, count );
-				
-				rdi->drawIndexed( PRIM_TRILIST, 0, count * 6, 0, count * 4 );
+					                      (float *)emitter->_parColors + j*ParticlesPerBatch*4, ParticlesPerBatch );
+
+				rdi->drawIndexed( PRIM_TRILIST, 0, ParticlesPerBatch * 6, 0, ParticlesPerBatch * 4 );
 				Modules::stats().incStat( EngineStats::BatchCount, 1 );
-				Modules::stats().incStat( EngineStats::TriCount, count * 2.0f );
+				Modules::stats().incStat( EngineStats::ParticleDrawCalls, 1 );
+				Modules::stats().incStat( EngineStats::TriCount, ParticlesPerBatch * 2.0f );
+			}
+
+			uint32 count = emitter->_particleCount % ParticlesPerBatch;
+			if( count > 0 )
+			{
+				uint32 offset = (emitter->_particleCount / ParticlesPerBatch) * ParticlesPerBatch;
+			
+				// Check if batch needs to be rendered
+				bool allDead = true;
+				for( uint32 k = 0; k < count; ++k )
+				{
+					if( emitter->getParticleStream( ParticleStreams::Life )[offset + k] > 0 )
+					{
+						allDead = false;
+						break;
+					}
+				}
+			
+				if( !allDead )
+				{
+					// Render batch
+					if( curShader->uni_parPosArray >= 0 )
+						rdi->setShaderConst( curShader->uni_parPosArray, CONST_FLOAT3,
+						                      (float *)emitter->_parPositions + offset*3, count );
+					if( curShader->uni_parSizeAndRotArray >= 0 )
+						rdi->setShaderConst( curShader->uni_parSizeAndRotArray, CONST_FLOAT2,
+						                      (float *)emitter->_parSizesANDRotations + offset*2, count );
+					if( curShader->uni_parColorArray >= 0 )
+						rdi->setShaderConst( curShader->uni_parColorArray, CONST_FLOAT4,
+						                      (float *)emitter->_parColors + offset*4, count );
+				
+					rdi->drawIndexed( PRIM_TRILIST, 0, count * 6, 0, count * 4 );
+					Modules::stats().incStat( EngineStats::BatchCount, 1 );
+					Modules::stats().incStat( EngineStats::ParticleDrawCalls, 1 );
+					Modules::stats().incStat( EngineStats::TriCount, count * 2.0f );
+				}
 			}
 		}
 
@@ -2040,7 +2628,7 @@ void Renderer::drawParticles( uint32 firstItem, uint32 lastItem, const string &s
 }
 
 
-void Renderer::drawComputeResults( uint32 firstItem, uint32 lastItem, const string &shaderContext, const string &theClass,
+void Renderer::drawComputeResults( uint32 firstItem, uint32 lastItem, uint32 shaderContext, uint32 classFilter,
 								   bool debugView, const Frustum *frust1, const Frustum * /*frust2*/, RenderingOrder::List /*order*/,
 								   int occSet )
 {
@@ -2064,7 +2652,7 @@ void Renderer::drawComputeResults( uint32 firstItem, uint32 lastItem, const stri
 
 		// Sanity check
 		if ( !compNode->_compBufferRes->_useAsVertexBuf || !compNode->_compBufferRes->_geometryParamsSet || 
-			 compNode->_elementsCount == 0 || !compNode->_materialRes->isOfClass( theClass ) )
+			 compNode->_elementsCount == 0 || !compNode->_materialRes->isOfClass( classFilter ) )
 			continue;
 
 		if ( debugView )
@@ -2144,6 +2732,16 @@ void Renderer::render( CameraNode *camNode )
 	_curCamera = camNode;
 	if( _curCamera == 0x0 ) return;
 
+	ProfileScope profileScope( "Render", _curCamera->_name, true );
+
+	// Update step of node types that depend on the camera, so that drawing does not change their state
+	if( !_cameraUpdateFuncs.empty() )
+	{
+		Modules::sceneMan().updateNodes();
+		for( size_t i = 0; i < _cameraUpdateFuncs.size(); ++i )
+			(*_cameraUpdateFuncs[i])( *_curCamera );
+	}
+
 	// Build sampler anisotropy mask from anisotropy value
 	int maxAniso = Modules::config().maxAnisotropy;
 	if( maxAniso <= 1 ) _maxAnisoMask = SS_ANISO1;
@@ -2173,11 +2771,13 @@ void Renderer::render( CameraNode *camNode )
 		PipelineStage &stage = _curCamera->_pipelineRes->_stages[i];
 		if( !stage.enabled ) continue;
 		_curStageMatLink = stage.matLink;
+		ProfileScope stageScope( stage.id, true );
 		
 		for( uint32 j = 0; j < stage.commands.size(); ++j )
 		{
 			PipelineCommand &pc = stage.commands[j];
 			RenderTarget *rt;
+			ProfileScope commandScope( pipeCommandNames[pc.command], true );
 
 			switch( pc.command )
 			{
@@ -2221,26 +2821,33 @@ void Renderer::render( CameraNode *camNode )
 				break;
 
 			case PipelineCommands::DrawGeometry:
-				drawGeometry( pc.params[0].getString(), pc.params[1].getString(),
+				drawGeometry( (uint32)pc.params[3].getInt(), (uint32)pc.params[4].getInt(),
 				              (RenderingOrder::List)pc.params[2].getInt(), _curCamera->_occSet );
 				break;
 
 			case PipelineCommands::DrawOverlays:
-				drawOverlays( pc.params[0].getString() );
+				drawOverlays( (uint32)pc.params[1].getInt() );
 				break;
 
 			case PipelineCommands::DrawQuad:
-				drawFSQuad( pc.params[0].getResource(), pc.params[1].getString() );
+				drawFSQuad( pc.params[0].getResource(), (uint32)pc.params[2].getInt() );
 			break;
 
 			case PipelineCommands::DoForwardLightLoop:
-				drawLightGeometry( pc.params[0].getString(), pc.params[1].getString(),
+				drawLightGeometry( (uint32)pc.params[4].getInt(), (uint32)pc.params[5].getInt(),
 				                   pc.params[2].getBool(), (RenderingOrder::List)pc.params[3].getInt(),
 								   _curCamera->_occSet );
 				break;
 
 			case PipelineCommands::DoDeferredLightLoop:
-				drawLightShapes( pc.params[0].getString(), pc.params[1].getBool(), _curCamera->_occSet );
+				drawLightShapes( (uint32)pc.params[2].getInt(), pc.params[1].getBool(), _curCamera->_occSet );
+				break;
+
+			case PipelineCommands::DoClusteredLightLoop:
+				drawClusteredLights( (uint32)pc.params[3].getInt(), (uint32)pc.params[4].getInt(),
+				                     (RenderingOrder::List)pc.params[2].getInt(), pc.params[5].getResource(),
+				                     (uint32)pc.params[6].getInt(), (uint32)pc.params[7].getInt(),
+				                     (uint32)pc.params[8].getInt(), _curCamera->_occSet );
 				break;
 
 			case PipelineCommands::SetUniform:
@@ -2261,6 +2868,9 @@ void Renderer::render( CameraNode *camNode )
 
 void Renderer::finalizeFrame()
 {
+	Modules::profiler().endFrame();
+	TextureResource::updateStreaming();
+	ShaderResource::processPendingCombinations( false );
 	++_frameID;
 	
 	// Reset frame timer
@@ -2281,7 +2891,7 @@ void Renderer::renderDebugView()
 		_renderDevice->setRenderBuffer( _curCamera->_outputTex->getRBObject() );
 	else 
 		_renderDevice->setRenderBuffer( 0 );
-	setMaterial( 0x0, "" );
+	setMaterial( 0x0, 0 );
 	_renderDevice->setFillMode( RS_FILL_WIREFRAME );
 
 	_renderDevice->clear( CLR_DEPTH | CLR_COLOR_RT0 );
@@ -2291,11 +2901,11 @@ void Renderer::renderDebugView()
 
 	// Draw renderable nodes as wireframe
 	setupViewMatrices( _curCamera->getViewMat(), _curCamera->getProjMat() );
-	drawRenderables( "", "", true, &_curCamera->getFrustum(), 0x0, RenderingOrder::None, -1 );
+	drawRenderables( 0, 0, true, &_curCamera->getFrustum(), 0x0, RenderingOrder::None, -1 );
 
 	// Draw bounding boxes
 	_renderDevice->setCullMode( RS_CULL_NONE );
-	setMaterial( 0x0, "" );
+	setMaterial( 0x0, 0 );
 	setShaderComb( &_defColorShader );
 	commitGeneralUniforms();
 
@@ -2339,7 +2949,7 @@ void Renderer::renderDebugView()
 void Renderer::finishRendering()
 {
 	_renderDevice->setRenderBuffer( 0 );
-	setMaterial( 0x0, "" );
+	setMaterial( 0x0, 0 );
 	_renderDevice->resetStates();
 }
 
@@ -17,6 +17,8 @@
 #include "egRendererBase.h"
 #include "egPrimitives.h"
 #include "egModel.h"
+#include "egLightClusters.h"
+#include "egShaderCache.h"
 #include <vector>
 #include <algorithm>
 
@@ -28,9 +30,13 @@ class LightNode;
 class CameraNode;
 struct ShaderContext;
 
-const uint32 MaxNumOverlayVerts = 2048;
+const uint32 MaxNumOverlayVerts = 16384;
+const uint32 OverlayRingSize = MaxNumOverlayVerts * 4;  // Must be addressable with 16 bit indices
 const uint32 ParticlesPerBatch = 64;	// Warning: The GPU must have enough registers
-const uint32 QuadIndexBufCount = MaxNumOverlayVerts * 6;
+const uint32 MeshInstancesPerBatch = 256;	// Capacity of the mesh instance buffer
+const uint32 QuadIndexBufCount = OverlayRingSize / 4 * 6;
+const uint32 MaxClusteredLights = 4096;  // Height limit of the cluster light map
+const uint32 ClusterItemMapWidth = 1024;  // Must match the constant in the clustered lighting shaders
 
 #define OCCPROXYLIST_RENDERABLES 0
 #define OCCPROXYLIST_LIGHTS 1
@@ -43,8 +49,10 @@ extern const char *fsOccBox;
 // Renderer
 // =================================================================================================
 
-typedef void (*RenderFunc)( uint32 firstItem, uint32 lastItem, const std::string &shaderContext,
-                            const std::string &theClass, bool debugView, const Frustum *frust1,
+// Shader contexts and class filters are passed as interned ids, see ShaderResource::getContextId
+// and MaterialResource::getClassFilterId
+typedef void (*RenderFunc)( uint32 firstItem, uint32 lastItem, uint32 shaderContext,
+                            uint32 classFilter, bool debugView, const Frustum *frust1,
                             const Frustum *frust2, RenderingOrder::List order, int occSet );
 
 struct RenderFuncListItem
@@ -53,13 +61,17 @@ struct RenderFuncListItem
 	RenderFunc  renderFunc;
 };
 
+// Called before the pipeline of a camera is executed, e.g. to stream in data around the camera
+typedef void (*CameraUpdateFunc)( CameraNode &camera );
+
 struct RenderBackendType
 {
 	enum List
 	{
 		OpenGL2 = 2,
 		OpenGL4 = 4,
-		OpenGLES = 8
+		OpenGLES = 8,
+		Null = 16
 	};
 };
 
@@ -101,6 +113,19 @@ struct ParticleVert
 	}
 };
 
+
+struct ParticleInstanceData
+{
+	float  x, y, z;          // Position
+	float  size, rotation;
+	float  r, g, b, a;       // Color
+};
+
+struct MeshInstanceData
+{
+	float  worldRows[3][4];  // Upper three rows of the world transformation
+};
+
 // =================================================================================================
 
 struct OccProxy
@@ -115,6 +140,29 @@ struct OccProxy
 	}
 };
 
+// Shadow map of a light that is kept as long as the camera, the light and the shadow casters do
+// not change; the maps are cropped to the view frustum, so they depend on the camera
+struct ShadowMapCacheEntry
+{
+	LightNode                   *light;  // 0x0 if entry is unused
+	NodeHandle                  camera;
+	uint32                      renderBuffer;
+	uint32                      lastUsedFrame;
+	uint32                      changeStamp;  // Spatial graph stamp when the map was rendered
+	Matrix4f                    camTrans, camProjMat;
+	uint32                      mapCount, shadowContext;  // mapCount is 0 until a map is rendered
+	float                       splitLambda;
+	float                       splitPlanes[5];
+	Matrix4f                    lightMats[4];
+	std::vector< SceneNode * >  casters;
+
+	ShadowMapCacheEntry() : light( 0x0 ), camera( 0 ), renderBuffer( 0 ), lastUsedFrame( 0 ),
+		changeStamp( 0 ), mapCount( 0 ), shadowContext( 0 ), splitLambda( 0 )
+	{
+		for( uint32 i = 0; i < 5; ++i ) splitPlanes[i] = 0;
+	}
+};
+
 struct PipeSamplerBinding
 {
 	char    sampler[64];
@@ -129,7 +177,9 @@ struct DefaultVertexLayouts
 		Position = 0,
 		Particle,
 		Model,
-		Overlay
+		Overlay,
+		ParticleInstanced,
+		ModelInstanced
 	};
 };
 
@@ -140,8 +190,10 @@ public:
 	~Renderer();
 
 	void registerRenderFunc( int nodeType, RenderFunc rf );
+	void registerCameraUpdateFunc( CameraUpdateFunc uf );
 
 	inline RenderDeviceInterface *getRenderDevice() const { return _renderDevice; }
+	ShaderCache &getShaderCache() { return _shaderCache; }
 
 	unsigned char *useScratchBuf( uint32 minSize, uint32 alignment );
 	
@@ -157,10 +209,14 @@ public:
 	void releaseShaderComb( ShaderCombination &sc );
 	void setShaderComb( ShaderCombination *sc );
 	void commitGeneralUniforms();
-	bool setMaterial( MaterialResource *materialRes, const std::string &shaderContext );
+	bool setMaterial( MaterialResource *materialRes, uint32 shaderContext );
+	float calcScreenSize( const BoundingBox &bbox ) const;
+	void requestStreamedTextures( MaterialResource *materialRes, float screenSize );
 	
 	bool createShadowRB( uint32 width, uint32 height );
 	void releaseShadowRB();
+	void releaseShadowMapCache( LightNode *light );  // Releases all entries if light is 0x0
+	void invalidateShadowMapCache();
 
 	int registerOccSet();
 	void unregisterOccSet( int occSet );
@@ -172,11 +228,11 @@ public:
 	                   MaterialResource *matRes, int flags );
 	void clearOverlays();
 	
-	static void drawMeshes( uint32 firstItem, uint32 lastItem, const std::string &shaderContext, const std::string &theClass,
+	static void drawMeshes( uint32 firstItem, uint32 lastItem, uint32 shaderContext, uint32 classFilter,
 		bool debugView, const Frustum *frust1, const Frustum *frust2, RenderingOrder::List order, int occSet );
-	static void drawParticles( uint32 firstItem, uint32 lastItem, const std::string &shaderContext, const std::string &theClass,
+	static void drawParticles( uint32 firstItem, uint32 lastItem, uint32 shaderContext, uint32 classFilter,
 		bool debugView, const Frustum *frust1, const Frustum *frust2, RenderingOrder::List order, int occSet );
-	static void drawComputeResults( uint32 firstItem, uint32 lastItem, const std::string &shaderContext, const std::string &theClass, 
+	static void drawComputeResults( uint32 firstItem, uint32 lastItem, uint32 shaderContext, uint32 classFilter, 
 									bool debugView, const Frustum *frust1, const Frustum *frust2, RenderingOrder::List order, int occSet );
 
 	void render( CameraNode *camNode );
@@ -189,6 +245,7 @@ public:
 	CameraNode *getCurCamera() const { return _curCamera; }
 	uint32 getQuadIdxBuf() const { return _quadIdxBuf; }
 	uint32 getParticleVBO() const { return _particleVBO; }
+	uint32 getMeshInstanceBuf() const { return _meshInstanceBuf; }
 	uint32 getParticleGeometry() const { return _particleGeo; }
 	uint32 getDefaultVertexLayout( DefaultVertexLayouts::List vl ) const;
 
@@ -199,24 +256,30 @@ protected:
 	
 	void createPrimitives();
 	
-	bool setMaterialRec( MaterialResource *materialRes, const std::string &shaderContext, ShaderResource *shaderRes );
+	bool setMaterialRec( MaterialResource *materialRes, uint32 shaderContext, ShaderResource *shaderRes );
 	
 	void setupShadowMap( bool noShadows );
 	Matrix4f calcCropMatrix( const Frustum &frustSlice, const Vec3f lightPos, const Matrix4f &lightViewProjMat );
+	ShadowMapCacheEntry *findShadowMapCacheEntry( LightNode *light, bool allocate );
+	bool isShadowMapCacheValid( const ShadowMapCacheEntry &entry );
 	void updateShadowMap();
 
-	void drawOverlays( const std::string &shaderContext );
+	void drawOverlays( uint32 shaderContext );
 
 	void bindPipeBuffer( uint32 rbObj, const std::string &sampler, uint32 bufIndex );
 	void clear( bool depth, bool buf0, bool buf1, bool buf2, bool buf3, float r, float g, float b, float a );
-	void drawFSQuad( Resource *matRes, const std::string &shaderContext );
-	void drawGeometry( const std::string &shaderContext, const std::string &theClass,
+	void drawFSQuad( Resource *matRes, uint32 shaderContext );
+	void drawGeometry( uint32 shaderContext, uint32 classFilter,
 	                   RenderingOrder::List order, int occSet );
-	void drawLightGeometry( const std::string &shaderContext, const std::string &theClass,
+	void drawLightGeometry( uint32 shaderContext, uint32 classFilter,
 	                        bool noShadows, RenderingOrder::List order, int occSet );
-	void drawLightShapes( const std::string &shaderContext, bool noShadows, int occSet );
+	void drawLightShapes( uint32 shaderContext, bool noShadows, int occSet );
+	void buildLightClusters( uint32 tilesX, uint32 tilesY, uint32 slices );
+	void uploadLightClusters();
+	void drawClusteredLights( uint32 shaderContext, uint32 classFilter, RenderingOrder::List order,
+	                          Resource *quadMatRes, uint32 tilesX, uint32 tilesY, uint32 slices, int occSet );
 	
-	void drawRenderables( const std::string &shaderContext, const std::string &theClass, bool debugView,
+	void drawRenderables( uint32 shaderContext, uint32 classFilter, bool debugView,
 		const Frustum *frust1, const Frustum *frust2, RenderingOrder::List order, int occSet );
 	
 	void renderDebugView();
@@ -230,6 +293,7 @@ protected:
 	RenderDeviceInterface		       *_renderDevice;
 
 	std::vector< RenderFuncListItem >  _renderFuncRegistry;
+	std::vector< CameraUpdateFunc >    _cameraUpdateFuncs;
 	
 	unsigned char                      *_scratchBuf;
 	uint32                             _scratchBufSize;
@@ -243,7 +307,10 @@ protected:
 	std::vector< OverlayBatch >        _overlayBatches;
 	OverlayVert                        *_overlayVerts;
 	uint32							   _overlayGeo;
-	uint32                             _overlayVB;
+	uint32                             _overlayVB;  // Ring buffer with OverlayRingSize vertices
+	uint32                             _overlayRingOffset;  // First vertex of last uploaded range
+	uint32                             _overlayUploadCount;  // Vertices in last uploaded range
+	bool                               _overlayVertsChanged;  // Vertex data differs from last uploaded range
 	
 	// standard geometry
 	uint32								_particleGeo;
@@ -253,23 +320,39 @@ protected:
 	uint32								_FSPolyGeo;
 
 	uint32                             _shadowRB;
+	uint32                             _curShadowRB;  // Shadow map of current light
+	std::vector< ShadowMapCacheEntry > _shadowMapCache;
+	RenderQueue                        _shadowCasters;  // Casters of current light
 	uint32                             _frameID;
 	uint32                             _defShadowMap;
 	uint32                             _quadIdxBuf;
 	uint32                             _particleVBO;
+	uint32                             _meshInstanceBuf;
 	MaterialResource                   *_curStageMatLink;
 	CameraNode                         *_curCamera;
 	LightNode                          *_curLight;
 	ShaderCombination                  *_curShader;
 	RenderTarget                       *_curRenderTarget;
 	uint32                             _curShaderUpdateStamp;
+	float                              _texStreamRequestSize;  // Screen size used for textures bound by setMaterial
 	
 	uint32                             _maxAnisoMask;
 	float                              _smSize;
 	float                              _splitPlanes[5];
 	Matrix4f                           _lightMats[4];
 
-	uint32                             _vlPosOnly, _vlOverlay, _vlModel, _vlParticle;
+	LightClusterGrid                   _lightClusters;
+	std::vector< float >               _clusterLightData, _clusterItemData;
+	uint32                             _clusterLightMap, _clusterItemMap;  // RGBA32F textures
+	uint32                             _clusterLightMapHeight, _clusterItemMapHeight;
+	float                              _clusterGridSize[4], _clusterDepthParams[4];
+	Matrix4f                           _clusterProjMat;
+
+	ShaderCache                        _shaderCache;
+	std::vector< uint8 >               _shaderBinary;  // Scratch buffer for shader cache entries
+
+	uint32                             _vlPosOnly, _vlOverlay, _vlModel, _vlParticle, _vlParticleInstanced,
+	                                   _vlModelInstanced;
 	ShaderCombination                  _defColorShader;
 	int                                _defColShader_color;  // Uniform location
 	
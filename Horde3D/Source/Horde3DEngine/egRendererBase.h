@@ -233,11 +233,14 @@ struct DeviceCaps
 	uint16	maxTexUnitCount;
 	bool	texFloat;
 	bool	texNPOT;
+	bool	texRGTC;  // BC4 and BC5
+	bool	texBPTC;  // BC7
 	bool	rtMultisampling;
 	bool	geometryShaders;
 	bool	tesselation;
 	bool	computeShaders;
 	bool	instancing;
+	bool	shaderBinaries;  // Program binaries can be retrieved and loaded, see getShaderBinary
 };
 
 
@@ -251,6 +254,7 @@ struct VertexLayoutAttrib
 	uint32       vbSlot;
 	uint32       size;
 	uint32       offset;
+	uint32       divisor;  // 0 for per-vertex data, otherwise attribute advances once per divisor instances
 };
 
 struct RDIVertexLayout
@@ -277,7 +281,8 @@ enum RDIBufferMappingTypes
 {
 	Read = 0,
 	Write,
-	ReadWrite
+	ReadWrite,
+	WriteNoOverwrite  // Caller guarantees that the range is not used by pending draw calls
 };
 
 // ---------------------------------------------------------
@@ -305,6 +310,9 @@ struct TextureFormats
 		DXT5,
 		RGBA16F,
 		RGBA32F,
+		BC4,
+		BC5,
+		BC7,
 		DEPTH,
 		R32,
 		RG32
@@ -545,8 +553,11 @@ private:
 	CreateMemberFunctionChecker( destroyTexture );
 	CreateMemberFunctionChecker( updateTextureData );
 	CreateMemberFunctionChecker( getTextureData );
+	CreateMemberFunctionChecker( setTextureBaseLevel );
 
 	CreateMemberFunctionChecker( createShader );
+	CreateMemberFunctionChecker( createShaderFromBinary );
+	CreateMemberFunctionChecker( getShaderBinary );
 	CreateMemberFunctionChecker( destroyShader );
 	CreateMemberFunctionChecker( bindShader );
 	CreateMemberFunctionChecker( getShaderConstLoc );
@@ -578,6 +589,7 @@ private:
 	CreateMemberFunctionChecker( clear );
 	CreateMemberFunctionChecker( draw );
 	CreateMemberFunctionChecker( drawIndexed );
+	CreateMemberFunctionChecker( drawIndexedInstanced );
 
 	CreateMemberFunctionChecker( setStorageBuffer );
 
@@ -610,10 +622,13 @@ private:
     typedef void( *PFN_DESTROYTEXTURE )( void* const, uint32& texObj );
 	typedef void( *PFN_UPDATETEXTUREDATA )( void* const, uint32 texObj, int slice, int mipLevel, const void *pixels );
 	typedef bool( *PFN_GETTEXTUREDATA )( void* const, uint32 texObj, int slice, int mipLevel, void *buffer );
+	typedef void( *PFN_SETTEXTUREBASELEVEL )( void* const, uint32 texObj, int baseLevel );
     typedef void( *PFN_BINDIMAGETOTEXTURE )( void* const, uint32 texObj, void* eglImage );
 	
 	typedef uint32( *PFN_CREATESHADER )( void* const, const char *vertexShaderSrc, const char *fragmentShaderSrc, const char *geometryShaderSrc,
 										 const char *tessControlShaderSrc, const char *tessEvaluationShaderSrc, const char *computeShaderSrc );
+	typedef uint32( *PFN_CREATESHADERFROMBINARY )( void* const, uint32 format, const uint8 *data, uint32 size );
+	typedef bool( *PFN_GETSHADERBINARY )( void* const, uint32 shaderId, uint32 &format, std::vector< uint8 > &data );
     typedef void( *PFN_DESTROYSHADER )( void* const, uint32& shaderId );
 	typedef void( *PFN_BINDSHADER )( void* const, uint32 shaderId );
 	typedef int( *PFN_GETSHADERCONSTLOC )( void* const, uint32 shaderId, const char *name );
@@ -648,6 +663,7 @@ private:
 	typedef void( *PFN_CLEAR )( void* const, uint32 flags, float *colorRGBA, float depth );
 	typedef void( *PFN_DRAW )( void* const, RDIPrimType primType, uint32 firstVert, uint32 numVerts );
 	typedef void( *PFN_DRAWINDEXED )( void* const, RDIPrimType primType, uint32 firstIndex, uint32 numIndices, uint32 firstVert, uint32 numVerts );
+	typedef void( *PFN_DRAWINDEXEDINSTANCED )( void* const, RDIPrimType primType, uint32 firstIndex, uint32 numIndices, uint32 firstVert, uint32 numVerts, uint32 numInstances );
 
 	typedef bool( *PFN_SETSTORAGEBUFFER )( void* const, uint8 slot, uint32 bufObj  );
 
@@ -681,10 +697,13 @@ private:
 	PFN_DESTROYTEXTURE			_pfnDestroyTexture;
 	PFN_UPDATETEXTUREDATA		_pfnUpdateTextureData;
 	PFN_GETTEXTUREDATA			_pfnGetTextureData;
+	PFN_SETTEXTUREBASELEVEL		_pfnSetTextureBaseLevel;
     PFN_BINDIMAGETOTEXTURE      _pfnBindImageToTexture;
 
 	// shaders
 	PFN_CREATESHADER			_pfnCreateShader;
+	PFN_CREATESHADERFROMBINARY	_pfnCreateShaderFromBinary;
+	PFN_GETSHADERBINARY			_pfnGetShaderBinary;
 	PFN_DESTROYSHADER			_pfnDestroyShader;
 	PFN_BINDSHADER				_pfnBindShader;
 	PFN_GETSHADERCONSTLOC		_pfnGetShaderConstLoc;
@@ -721,6 +740,7 @@ private:
 	// drawing
 	PFN_DRAW					_pfnDraw;
 	PFN_DRAWINDEXED				_pfnDrawIndexed;
+	PFN_DRAWINDEXEDINSTANCED	_pfnDrawIndexedInstanced;
 	
 	// commands
 	PFN_SETSTORAGEBUFFER		_pfnSetStorageBuffer;
@@ -877,6 +897,12 @@ private:
 		return static_cast< T* >( pObj )->getTextureData( texObj, slice, mipLevel, buffer );
 	}
 
+	template<typename T>
+	static void              setTextureBaseLevel_Invoker( void* const pObj, uint32 texObj, int baseLevel )
+	{
+		static_cast< T* >( pObj )->setTextureBaseLevel( texObj, baseLevel );
+	}
+
     template<typename T>
     static void              bindImageToTexture_Invoker( void* const pObj, uint32 texObj, void* eglImage )
     {
@@ -891,6 +917,18 @@ private:
 		return static_cast< T* >( pObj )->createShader( vertexShaderSrc, fragmentShaderSrc, geometryShaderSrc, tessControlShaderSrc, tessEvaluationShaderSrc, computeShaderSrc );
 	}
 
+	template<typename T>
+	static uint32            createShaderFromBinary_Invoker( void* const pObj, uint32 format, const uint8 *data, uint32 size )
+	{
+		return static_cast< T* >( pObj )->createShaderFromBinary( format, data, size );
+	}
+
+	template<typename T>
+	static bool              getShaderBinary_Invoker( void* const pObj, uint32 shaderId, uint32 &format, std::vector< uint8 > &data )
+	{
+		return static_cast< T* >( pObj )->getShaderBinary( shaderId, format, data );
+	}
+
 	template<typename T>
     static void				 destroyShader_Invoker( void* const pObj, uint32& shaderId )
 	{
@@ -1062,6 +1100,13 @@ private:
 		static_cast< T* >( pObj )->drawIndexed( primType, firstIndex, numIndices, firstVert, numVerts );
 	}
 
+	template<typename T>
+	static void				 drawIndexedInstanced_Invoker( void* const pObj, RDIPrimType primType, uint32 firstIndex, uint32 numIndices,
+														   uint32 firstVert, uint32 numVerts, uint32 numInstances )
+	{
+		static_cast< T* >( pObj )->drawIndexedInstanced( primType, firstIndex, numIndices, firstVert, numVerts, numInstances );
+	}
+
 	template<typename T>
 	static void				 setStorageBuffer_Invoker( void* const pObj, uint8 slot, uint32 bufObj )
 	{
@@ -1099,8 +1144,11 @@ protected:
         CheckMemberFunction( destroyTexture, void( T::* )( uint32& ) );
 		CheckMemberFunction( updateTextureData, void( T::* )( uint32, int, int, const void * ) );
 		CheckMemberFunction( getTextureData, bool( T::* )( uint32, int, int, void * ) );
+		CheckMemberFunction( setTextureBaseLevel, void( T::* )( uint32, int ) );
 	
 		CheckMemberFunction( createShader, uint32( T::* )( const char *, const char *, const char *, const char *, const char *, const char * ) );
+		CheckMemberFunction( createShaderFromBinary, uint32( T::* )( uint32, const uint8 *, uint32 ) );
+		CheckMemberFunction( getShaderBinary, bool( T::* )( uint32, uint32 &, std::vector< uint8 > & ) );
         CheckMemberFunction( destroyShader, void( T::* )( uint32& ) );
 		CheckMemberFunction( bindShader, void( T::* )( uint32 ) );
 		CheckMemberFunction( getShaderConstLoc, int( T::* )( uint32, const char * ) );
@@ -1132,6 +1180,7 @@ protected:
 		CheckMemberFunction( clear, void( T::* )( uint32, float *, float ) );
 		CheckMemberFunction( draw, void( T::* )( RDIPrimType, uint32, uint32 ) );
 		CheckMemberFunction( drawIndexed, void( T::* )( RDIPrimType, uint32, uint32, uint32, uint32 ) );
+		CheckMemberFunction( drawIndexedInstanced, void( T::* )( RDIPrimType, uint32, uint32, uint32, uint32, uint32 ) );
 
 		CheckMemberFunction( setStorageBuffer, void( T::* )( uint8, uint32 ) );
 
@@ -1162,9 +1211,12 @@ protected:
 		_pfnDestroyTexture = ( PFN_DESTROYTEXTURE ) &destroyTexture_Invoker < T >;
 		_pfnUpdateTextureData = ( PFN_UPDATETEXTUREDATA ) &updateTextureData_Invoker < T >;
 		_pfnGetTextureData = ( PFN_GETTEXTUREDATA ) &getTextureData_Invoker < T >;
+		_pfnSetTextureBaseLevel = ( PFN_SETTEXTUREBASELEVEL ) &setTextureBaseLevel_Invoker < T >;
         _pfnBindImageToTexture = (PFN_BINDIMAGETOTEXTURE ) &bindImageToTexture_Invoker < T >;
 
 		_pfnCreateShader = ( PFN_CREATESHADER ) &createShader_Invoker < T >;
+		_pfnCreateShaderFromBinary = ( PFN_CREATESHADERFROMBINARY ) &createShaderFromBinary_Invoker < T >;
+		_pfnGetShaderBinary = ( PFN_GETSHADERBINARY ) &getShaderBinary_Invoker < T >;
 		_pfnDestroyShader = ( PFN_DESTROYSHADER ) &destroyShader_Invoker < T > ;
 		_pfnBindShader = ( PFN_BINDSHADER ) &bindShader_Invoker < T > ;
 		_pfnGetShaderConstLoc = ( PFN_GETSHADERCONSTLOC ) &getShaderConstLoc_Invoker < T > ;
@@ -1196,6 +1248,7 @@ protected:
 		_pfnClear = ( PFN_CLEAR ) &clear_Invoker < T > ;
 		_pfnDraw = ( PFN_DRAW ) &draw_Invoker < T > ;
 		_pfnDrawIndexed = ( PFN_DRAWINDEXED ) &drawIndexed_Invoker < T > ;
+		_pfnDrawIndexedInstanced = ( PFN_DRAWINDEXEDINSTANCED ) &drawIndexedInstanced_Invoker < T > ;
 
 		_pfnSetStorageBuffer = ( PFN_SETSTORAGEBUFFER ) &setStorageBuffer_Invoker< T >;
 	}
@@ -1205,7 +1258,7 @@ protected:
 // -----------------------------------------------------------------------------
 public:
 
-	RenderDeviceInterface()
+	RenderDeviceInterface() : _shaderBindCount( 0 ), _geometryBindCount( 0 )
 	{
 
 	}
@@ -1302,6 +1355,12 @@ public:
 		return _bufferMem;
 	}
 
+	// Number of times a different shader or geometry was bound; used for the engine statistics
+	uint32 getShaderBindCount() const { return _shaderBindCount; }
+	uint32 getGeometryBindCount() const { return _geometryBindCount; }
+	void resetShaderBindCount() { _shaderBindCount = 0; }
+	void resetGeometryBindCount() { _geometryBindCount = 0; }
+
 	// Textures
 	uint32 calcTextureSize( TextureFormats::List format, int width, int height, int depth ) 
 	{ 
@@ -1328,6 +1387,11 @@ public:
 	{
 		return ( *_pfnGetTextureData )( this, texObj, slice, mipLevel, buffer ); 
 	}
+	// Mips below the base level are not sampled and their memory is released; 2D textures only
+	void setTextureBaseLevel( uint32 texObj, int baseLevel )
+	{
+		( *_pfnSetTextureBaseLevel )( this, texObj, baseLevel );
+	}
 	uint32 getTextureMem() const 
 	{
 		return _textureMem; 
@@ -1344,12 +1408,22 @@ public:
 		return ( *_pfnCreateShader )( this, vertexShaderSrc, fragmentShaderSrc, geometryShaderSrc, 
 									  tessControlShaderSrc, tessEvaluationShaderSrc, computeShaderSrc );
 	}
+	// Creates a shader from data returned by getShaderBinary; fails if the driver does not accept the binary anymore
+	uint32 createShaderFromBinary( uint32 format, const uint8 *data, uint32 size )
+	{
+		return ( *_pfnCreateShaderFromBinary )( this, format, data, size );
+	}
+	bool getShaderBinary( uint32 shaderId, uint32 &format, std::vector< uint8 > &data )
+	{
+		return ( *_pfnGetShaderBinary )( this, shaderId, format, data );
+	}
     void destroyShader( uint32& shaderId )
 	{
 		( *_pfnDestroyShader )( this, shaderId ); 
 	}
 	void bindShader( uint32 shaderId ) 
 	{ 
+		if( shaderId != _curShaderId ) ++_shaderBindCount;
 		( *_pfnBindShader )( this, shaderId ); 
 	}
 	std::string getShaderLog() const 
@@ -1454,7 +1528,8 @@ public:
 	void setScissorRect( int x, int y, int width, int height )
 		{ _scX = x; _scY = y; _scWidth = width; _scHeight = height; _pendingMask |= PM_SCISSOR; }
 	void setGeometry( uint32 geoIndex )
-		{ _curGeometryIndex = geoIndex;  _pendingMask |= PM_GEOMETRY; }
+		{ if( geoIndex != _curGeometryIndex ) ++_geometryBindCount;
+		  _curGeometryIndex = geoIndex;  _pendingMask |= PM_GEOMETRY; }
 	void setTexture( uint32 slot, uint32 texObj, uint16 samplerState, uint16 usage )
 		{ ASSERT( slot < 16/*_maxTexSlots*/ ); _texSlots[slot] = RDITexSlot( texObj, samplerState, usage );
 	      _pendingMask |= PM_TEXTURES; }
@@ -1534,12 +1609,18 @@ public:
 	{ 
 		( *_pfnDrawIndexed )( this, primType, firstIndex, numIndices, firstVert, numVerts );
 	}
+	void drawIndexedInstanced( RDIPrimType primType, uint32 firstIndex, uint32 numIndices,
+	                           uint32 firstVert, uint32 numVerts, uint32 numInstances )
+	{ 
+		( *_pfnDrawIndexedInstanced )( this, primType, firstIndex, numIndices, firstVert, numVerts, numInstances );
+	}
 
 // -----------------------------------------------------------------------------
 // Getters
 // -----------------------------------------------------------------------------
 
 	const DeviceCaps &getCaps() const { return _caps; }
+	const std::string &getDeviceId() const { return _deviceId; }
 
 	friend class Renderer;
 
@@ -1562,6 +1643,7 @@ protected:
 protected:
 
 	DeviceCaps					_caps;
+	std::string					_deviceId;  // Identifies backend and driver
 
 	RDITexSlot					_texSlots[ 16 ];
 	// 	std::vector< RDITexSlot >	_texSlots;
@@ -1586,6 +1668,7 @@ protected:
 	uint32						_prevShaderId, _curShaderId;
 	uint32						_pendingMask;
 	uint32						_curGeometryIndex;
+	uint32						_shaderBindCount, _geometryBindCount;
 //	uint32						_curTextureBuf;
  	uint32						_maxTexSlots; // specified in inherited render devices
 
@@ -47,7 +47,7 @@ static const uint32 primitiveTypes[ 5 ] = { GL_TRIANGLES, GL_TRIANGLE_STRIP, GL_
 
 static const uint32 textureTypes[ 3 ] = { GL_TEXTURE_2D, GL_TEXTURE_3D, GL_TEXTURE_CUBE_MAP };
 
-static const uint32 bufferMappingTypes[ 3 ] = { GL_READ_ONLY, GL_WRITE_ONLY, GL_READ_WRITE };
+static const uint32 bufferMappingTypes[ 4 ] = { GL_READ_ONLY, GL_WRITE_ONLY, GL_READ_WRITE, GL_WRITE_ONLY };
 
 // =================================================================================================
 // GPUTimer
@@ -266,6 +266,8 @@ bool RenderDeviceGL2::init()
 	// Get capabilities
 	_caps.texFloat = glExt::ARB_texture_float ? 1 : 0;
 	_caps.texNPOT = glExt::ARB_texture_non_power_of_two ? 1 : 0;
+	_caps.texRGTC = glExt::ARB_texture_compression_rgtc ? 1 : 0;
+	_caps.texBPTC = glExt::ARB_texture_compression_bptc ? 1 : 0;
 	_caps.rtMultisampling = glExt::EXT_framebuffer_multisample ? 1 : 0;
 	_caps.geometryShaders = false;
 	_caps.tesselation = false;
@@ -273,6 +275,8 @@ bool RenderDeviceGL2::init()
 	_caps.instancing = false;
 	_caps.maxJointCount = 75;
 	_caps.maxTexUnitCount = 16;
+	_caps.shaderBinaries = false;
+	_deviceId = std::string( "GL2|" ) + vendor + "|" + renderer + "|" + version;
 
 	// Init states before creating test render buffer, to
 	// ensure binding the current FBO again
@@ -546,7 +550,21 @@ void * RenderDeviceGL2::mapBuffer( uint32 geoObj, uint32 bufObj, uint32 offset,
 
 	glBindBuffer( buf.type, buf.glObj );
 
-	return glMapBuffer( buf.type, bufferMappingTypes[ mapType ] );
+	if( glExt::majorVersion >= 3 && mapType == WriteNoOverwrite )
+	{
+		return glMapBufferRange( buf.type, offset, size,
+		                         GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT );
+	}
+
+	if( offset == 0 && size == buf.size && mapType == Write )
+	{
+		// Orphan the old storage so that the driver does not need to wait until it is not used anymore
+		glBufferData( buf.type, buf.size, 0x0, GL_DYNAMIC_DRAW );
+	}
+
+	// glMapBuffer always maps the whole buffer
+	uint8 *data = (uint8 *)glMapBuffer( buf.type, bufferMappingTypes[ mapType ] );
+	return data != 0x0 ? data + offset : 0x0;
 }
 
 
@@ -571,12 +589,18 @@ uint32 RenderDeviceGL2::calcTextureSize( TextureFormats::List format, int width,
 	{
 	case TextureFormats::BGRA8:
 		return width * height * depth * 4;
+	// Block compressed formats store a whole 4x4 block for partial blocks at the border
 	case TextureFormats::DXT1:
-		return std::max( width / 4, 1 ) * std::max( height / 4, 1 ) * depth * 8;
+		return ((width + 3) / 4) * ((height + 3) / 4) * depth * 8;
 	case TextureFormats::DXT3:
-		return std::max( width / 4, 1 ) * std::max( height / 4, 1 ) * depth * 16;
+		return ((width + 3) / 4) * ((height + 3) / 4) * depth * 16;
 	case TextureFormats::DXT5:
-		return std::max( width / 4, 1 ) * std::max( height / 4, 1 ) * depth * 16;
+		return ((width + 3) / 4) * ((height + 3) / 4) * depth * 16;
+	case TextureFormats::BC4:
+		return ((width + 3) / 4) * ((height + 3) / 4) * depth * 8;
+	case TextureFormats::BC5:
+	case TextureFormats::BC7:
+		return ((width + 3) / 4) * ((height + 3) / 4) * depth * 16;
 	case TextureFormats::RGBA16F:
 		return width * height * depth * 8;
 	case TextureFormats::RGBA32F:
@@ -624,6 +648,15 @@ uint32 RenderDeviceGL2::createTexture( TextureTypes::List type, int width, int h
 	case TextureFormats::DXT5:
 		tex.glFmt = tex.sRGB ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
 		break;
+	case TextureFormats::BC4:
+		tex.glFmt = GL_COMPRESSED_RED_RGTC1;
+		break;
+	case TextureFormats::BC5:
+		tex.glFmt = GL_COMPRESSED_RG_RGTC2;
+		break;
+	case TextureFormats::BC7:
+		tex.glFmt = tex.sRGB ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+		break;
 	case TextureFormats::RGBA16F:
 		tex.glFmt = GL_RGBA16F_ARB;
 		break;
@@ -672,7 +705,8 @@ void RenderDeviceGL2::uploadTextureData( uint32 texObj, int slice, int mipLevel,
 	
 	int inputFormat = GL_BGRA, inputType = GL_UNSIGNED_BYTE;
 	bool compressed = (format == TextureFormats::DXT1) || (format == TextureFormats::DXT3) ||
-	                  (format == TextureFormats::DXT5);
+	                  (format == TextureFormats::DXT5) || (format == TextureFormats::BC4) ||
+	                  (format == TextureFormats::BC5) || (format == TextureFormats::BC7);
 	
 	switch( format )
 	{
@@ -687,6 +721,9 @@ void RenderDeviceGL2::uploadTextureData( uint32 texObj, int slice, int mipLevel,
 	case TextureFormats::DEPTH:
 		inputFormat = GL_DEPTH_COMPONENT;
 		inputType = GL_FLOAT;
+		break;
+	default:
+		break;
 	};
 	
 	// Calculate size of next mipmap using "floor" convention
@@ -769,6 +806,9 @@ bool RenderDeviceGL2::getTextureData( uint32 texObj, int slice, int mipLevel, vo
 	case TextureFormats::DXT1:
 	case TextureFormats::DXT3:
 	case TextureFormats::DXT5:
+	case TextureFormats::BC4:
+	case TextureFormats::BC5:
+	case TextureFormats::BC7:
 		compressed = 1;
 		break;
 	case TextureFormats::RGBA16F:
@@ -792,6 +832,42 @@ bool RenderDeviceGL2::getTextureData( uint32 texObj, int slice, int mipLevel, vo
 	return true;
 }
 
+
+void RenderDeviceGL2::setTextureBaseLevel( uint32 texObj, int baseLevel )
+{
+	RDITextureGL2 &tex = _textures.getRef( texObj );
+	ASSERT( tex.type == textureTypes[ TextureTypes::Tex2D ] );
+	
+	bool compressed = (tex.format == TextureFormats::DXT1) || (tex.format == TextureFormats::DXT3) ||
+	                  (tex.format == TextureFormats::DXT5) || (tex.format == TextureFormats::BC4) ||
+	                  (tex.format == TextureFormats::BC5) || (tex.format == TextureFormats::BC7);
+	
+	glActiveTexture( GL_TEXTURE15 );
+	glBindTexture( tex.type, tex.glObj );
+	
+	glTexParameteri( tex.type, GL_TEXTURE_BASE_LEVEL, baseLevel );
+	glTexParameterf( tex.type, GL_TEXTURE_MIN_LOD, (float)baseLevel );
+
+	// Release the storage of the unused mips by making them empty
+	for( int i = 0; i < baseLevel; ++i )
+	{
+		if( compressed )
+			glCompressedTexImage2D( GL_TEXTURE_2D, i, tex.glFmt, 0, 0, 0, 0, 0x0 );
+		else
+			glTexImage2D( GL_TEXTURE_2D, i, tex.glFmt, 0, 0, 0, GL_BGRA, GL_UNSIGNED_BYTE, 0x0 );
+	}
+
+	glBindTexture( tex.type, 0 );
+	if( _texSlots[15].texObj )
+		glBindTexture( _textures.getRef( _texSlots[15].texObj ).type, _textures.getRef( _texSlots[15].texObj ).glObj );
+
+	// Calculate memory requirements of the remaining mips
+	_textureMem -= tex.memSize;
+	tex.memSize = calcTextureSize( tex.format, std::max( tex.width >> baseLevel, 1 ), std::max( tex.height >> baseLevel, 1 ), 1 );
+	if( tex.hasMips || tex.genMips ) tex.memSize += ftoi_r( tex.memSize * 1.0f / 3.0f );
+	_textureMem += tex.memSize;
+}
+
 void RenderDeviceGL2::bindImageToTexture(uint32 texObj, void *eglImage)
 {
 	if( !glExt::OES_EGL_image )
@@ -958,6 +1034,27 @@ uint32 RenderDeviceGL2::createShader( const char *vertexShaderSrc, const char *f
 }
 
 
+uint32 RenderDeviceGL2::createShaderFromBinary( uint32 format, const uint8 *data, uint32 size )
+{
+	H3D_UNUSED_VAR( format );
+	H3D_UNUSED_VAR( data );
+	H3D_UNUSED_VAR( size );
+
+	// Program binaries are not supported by OpenGL 2.1
+	return 0;
+}
+
+
+bool RenderDeviceGL2::getShaderBinary( uint32 shaderId, uint32 &format, std::vector< uint8 > &data )
+{
+	H3D_UNUSED_VAR( shaderId );
+	H3D_UNUSED_VAR( format );
+	H3D_UNUSED_VAR( data );
+
+	return false;
+}
+
+
 void RenderDeviceGL2::destroyShader( uint32& shaderId )
 {
 	if( shaderId == 0 )
@@ -1492,6 +1589,9 @@ bool RenderDeviceGL2::applyVertexLayout( const RDIGeometryInfoGL2 &geo )
 				ASSERT( _buffers.getRef( geo.vertexBufInfo[ attrib.vbSlot ].vbObj ).glObj != 0 &&
 						_buffers.getRef( geo.vertexBufInfo[ attrib.vbSlot ].vbObj ).type == GL_ARRAY_BUFFER );
 				
+				// Per-instance attributes require instancing (see DeviceCaps::instancing)
+				ASSERT( attrib.divisor == 0 );
+				
 				glBindBuffer( GL_ARRAY_BUFFER, _buffers.getRef( geo.vertexBufInfo[ attrib.vbSlot ].vbObj ).glObj );
 				glVertexAttribPointer( attribIndex, attrib.size, GL_FLOAT, GL_FALSE,
 									   vbSlot.stride, (char *)0 + vbSlot.offset + attrib.offset );
@@ -1844,5 +1944,17 @@ void RenderDeviceGL2::drawIndexed( RDIPrimType primType, uint32 firstIndex, uint
 	CHECK_GL_ERROR
 }
 
+
+void RenderDeviceGL2::drawIndexedInstanced( RDIPrimType primType, uint32 firstIndex, uint32 numIndices,
+                                            uint32 firstVert, uint32 numVerts, uint32 numInstances )
+{
+	// Instancing is not supported by this backend (see DeviceCaps::instancing), so the
+	// renderer never submits more than a single instance
+	ASSERT( numInstances <= 1 );
+	
+	if( numInstances > 0 )
+		drawIndexed( primType, firstIndex, numIndices, firstVert, numVerts );
+}
+
 }  // namespace RDI_GL2
 }  // namespace Horde3D
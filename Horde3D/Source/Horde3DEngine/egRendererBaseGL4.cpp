@@ -53,7 +53,8 @@ static const uint32 textureTypes[ 3 ] = { GL_TEXTURE_2D, GL_TEXTURE_3D, GL_TEXTU
 
 static const uint32 memoryBarrierType[ 3 ] = { GL_BUFFER_UPDATE_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT, GL_ELEMENT_ARRAY_BARRIER_BIT, GL_SHADER_IMAGE_ACCESS_BARRIER_BIT };
 
-static const uint32 bufferMappingTypes[ 3 ] = { GL_MAP_READ_BIT, GL_MAP_WRITE_BIT, GL_MAP_READ_BIT | GL_MAP_WRITE_BIT };
+static const uint32 bufferMappingTypes[ 4 ] = { GL_MAP_READ_BIT, GL_MAP_WRITE_BIT, GL_MAP_READ_BIT | GL_MAP_WRITE_BIT,
+                                                GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT };
 
 // =================================================================================================
 // GPUTimer
@@ -264,6 +265,9 @@ bool RenderDeviceGL4::init()
 	// Set capabilities
 	_caps.texFloat = true;
 	_caps.texNPOT = true;
+	_caps.texRGTC = true;
+	_caps.texBPTC = glExt::majorVersion > 4 || ( glExt::majorVersion == 4 && glExt::minorVersion >= 2 ) ||
+					glExt::ARB_texture_compression_bptc;
 	_caps.rtMultisampling = true;
 	_caps.geometryShaders = true;
 	_caps.tesselation = glExt::majorVersion >= 4 && glExt::minorVersion >= 1;
@@ -272,6 +276,16 @@ bool RenderDeviceGL4::init()
 	_caps.maxJointCount = 330;
 	_caps.maxTexUnitCount = 96; // for most modern hardware it is 192 (GeForce 400+, Radeon 7000+, Intel 4000+). Although 96 should probably be enough.
 
+	// Program binaries need OpenGL 4.1 and a driver that supports at least one binary format
+	_caps.shaderBinaries = false;
+	if( glExt::majorVersion > 4 || ( glExt::majorVersion == 4 && glExt::minorVersion >= 1 ) )
+	{
+		int binaryFormatCount = 0;
+		glGetIntegerv( GL_NUM_PROGRAM_BINARY_FORMATS, &binaryFormatCount );
+		_caps.shaderBinaries = binaryFormatCount > 0;
+	}
+	_deviceId = std::string( "GL4|" ) + vendor + "|" + renderer + "|" + version;
+
 	// Find maximum number of storage buffers in compute shader
 	glGetIntegerv( GL_MAX_COMPUTE_SHADER_STORAGE_BLOCKS, (GLint *) &_maxComputeBufferAttachments );
 	// Init states before creating test render buffer, to
@@ -372,6 +386,7 @@ void RenderDeviceGL4::finishCreatingGeometry( uint32 geoObj )
 			glBindBuffer( GL_ARRAY_BUFFER, buf.glObj );
 			glVertexAttribPointer( i, attrib.size, GL_FLOAT, GL_FALSE,
 								   vbSlot.stride, ( char * ) 0 + vbSlot.offset + attrib.offset );
+			glVertexAttribDivisor( i, attrib.divisor );
 
 			newVertexAttribMask |= 1 << i;
 		}
@@ -633,12 +648,18 @@ uint32 RenderDeviceGL4::calcTextureSize( TextureFormats::List format, int width,
 	{
 	case TextureFormats::BGRA8:
 		return width * height * depth * 4;
+	// Block compressed formats store a whole 4x4 block for partial blocks at the border
 	case TextureFormats::DXT1:
-		return std::max( width / 4, 1 ) * std::max( height / 4, 1 ) * depth * 8;
+		return ((width + 3) / 4) * ((height + 3) / 4) * depth * 8;
 	case TextureFormats::DXT3:
-		return std::max( width / 4, 1 ) * std::max( height / 4, 1 ) * depth * 16;
+		return ((width + 3) / 4) * ((height + 3) / 4) * depth * 16;
 	case TextureFormats::DXT5:
-		return std::max( width / 4, 1 ) * std::max( height / 4, 1 ) * depth * 16;
+		return ((width + 3) / 4) * ((height + 3) / 4) * depth * 16;
+	case TextureFormats::BC4:
+		return ((width + 3) / 4) * ((height + 3) / 4) * depth * 8;
+	case TextureFormats::BC5:
+	case TextureFormats::BC7:
+		return ((width + 3) / 4) * ((height + 3) / 4) * depth * 16;
 	case TextureFormats::RGBA16F:
 		return width * height * depth * 8;
 	case TextureFormats::RGBA32F:
@@ -686,6 +707,15 @@ uint32 RenderDeviceGL4::createTexture( TextureTypes::List type, int width, int h
 	case TextureFormats::DXT5:
 		tex.glFmt = tex.sRGB ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
 		break;
+	case TextureFormats::BC4:
+		tex.glFmt = GL_COMPRESSED_RED_RGTC1;
+		break;
+	case TextureFormats::BC5:
+		tex.glFmt = GL_COMPRESSED_RG_RGTC2;
+		break;
+	case TextureFormats::BC7:
+		tex.glFmt = tex.sRGB ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+		break;
 	case TextureFormats::RGBA16F:
 		tex.glFmt = GL_RGBA16F;
 		break;
@@ -734,7 +764,8 @@ void RenderDeviceGL4::uploadTextureData( uint32 texObj, int slice, int mipLevel,
 	
 	int inputFormat = GL_BGRA, inputType = GL_UNSIGNED_BYTE;
 	bool compressed = (format == TextureFormats::DXT1) || (format == TextureFormats::DXT3) ||
-					  (format == TextureFormats::DXT5);
+					  (format == TextureFormats::DXT5) || (format == TextureFormats::BC4) ||
+					  (format == TextureFormats::BC5) || (format == TextureFormats::BC7);
 	
 	switch( format )
 	{
@@ -749,6 +780,9 @@ void RenderDeviceGL4::uploadTextureData( uint32 texObj, int slice, int mipLevel,
 	case TextureFormats::DEPTH:
 		inputFormat = GL_DEPTH_COMPONENT;
 		inputType = GL_FLOAT;
+		break;
+	default:
+		break;
 	};
 	
 	// Calculate size of next mipmap using "floor" convention
@@ -831,6 +865,9 @@ bool RenderDeviceGL4::getTextureData( uint32 texObj, int slice, int mipLevel, vo
 	case TextureFormats::DXT1:
 	case TextureFormats::DXT3:
 	case TextureFormats::DXT5:
+	case TextureFormats::BC4:
+	case TextureFormats::BC5:
+	case TextureFormats::BC7:
 		compressed = 1;
 		break;
 	case TextureFormats::RGBA16F:
@@ -854,6 +891,42 @@ bool RenderDeviceGL4::getTextureData( uint32 texObj, int slice, int mipLevel, vo
 	return true;
 }
 
+
+void RenderDeviceGL4::setTextureBaseLevel( uint32 texObj, int baseLevel )
+{
+	RDITextureGL4 &tex = _textures.getRef( texObj );
+	ASSERT( tex.type == textureTypes[ TextureTypes::Tex2D ] );
+	
+	bool compressed = (tex.format == TextureFormats::DXT1) || (tex.format == TextureFormats::DXT3) ||
+	                  (tex.format == TextureFormats::DXT5) || (tex.format == TextureFormats::BC4) ||
+	                  (tex.format == TextureFormats::BC5) || (tex.format == TextureFormats::BC7);
+	
+	glActiveTexture( GL_TEXTURE15 );
+	glBindTexture( tex.type, tex.glObj );
+	
+	glTexParameteri( tex.type, GL_TEXTURE_BASE_LEVEL, baseLevel );
+	glTexParameterf( tex.type, GL_TEXTURE_MIN_LOD, (float)baseLevel );
+
+	// Release the storage of the unused mips by making them empty
+	for( int i = 0; i < baseLevel; ++i )
+	{
+		if( compressed )
+			glCompressedTexImage2D( GL_TEXTURE_2D, i, tex.glFmt, 0, 0, 0, 0, 0x0 );
+		else
+			glTexImage2D( GL_TEXTURE_2D, i, tex.glFmt, 0, 0, 0, GL_BGRA, GL_UNSIGNED_BYTE, 0x0 );
+	}
+
+	glBindTexture( tex.type, 0 );
+	if( _texSlots[15].texObj )
+		glBindTexture( _textures.getRef( _texSlots[15].texObj ).type, _textures.getRef( _texSlots[15].texObj ).glObj );
+
+	// Calculate memory requirements of the remaining mips
+	_textureMem -= tex.memSize;
+	tex.memSize = calcTextureSize( tex.format, std::max( tex.width >> baseLevel, 1 ), std::max( tex.height >> baseLevel, 1 ), 1 );
+	if( tex.hasMips || tex.genMips ) tex.memSize += ftoi_r( tex.memSize * 1.0f / 3.0f );
+	_textureMem += tex.memSize;
+}
+
 void RenderDeviceGL4::bindImageToTexture(uint32 texObj, void *eglImage)
 {
 	if( !glExt::OES_EGL_image )
@@ -1088,6 +1161,7 @@ bool RenderDeviceGL4::linkShaderProgram( uint32 programObj )
 
 	_shaderLog = "";
 	
+	if( _caps.shaderBinaries ) glProgramParameteri( programObj, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE );
 	glLinkProgram( programObj );
 	glGetProgramiv( programObj, GL_INFO_LOG_LENGTH, &infologLength );
 	if( infologLength > 1 )
@@ -1115,6 +1189,50 @@ uint32 RenderDeviceGL4::createShader( const char *vertexShaderSrc, const char *f
 
 //	int loc = glGetFragDataLocation( programObj, "fragColor" );
 
+	return registerShaderProgram( programObj );
+}
+
+
+uint32 RenderDeviceGL4::createShaderFromBinary( uint32 format, const uint8 *data, uint32 size )
+{
+	_shaderLog = "";
+	if( !_caps.shaderBinaries ) return 0;
+
+	uint32 programObj = glCreateProgram();
+	glProgramBinary( programObj, format, data, size );
+
+	// Binaries are rejected when the driver or hardware has changed
+	int status;
+	glGetProgramiv( programObj, GL_LINK_STATUS, &status );
+	if( !status )
+	{
+		glDeleteProgram( programObj );
+		return 0;
+	}
+
+	return registerShaderProgram( programObj );
+}
+
+
+bool RenderDeviceGL4::getShaderBinary( uint32 shaderId, uint32 &format, std::vector< uint8 > &data )
+{
+	if( !_caps.shaderBinaries ) return false;
+
+	RDIShaderGL4 &shader = _shaders.getRef( shaderId );
+	int size = 0;
+	glGetProgramiv( shader.oglProgramObj, GL_PROGRAM_BINARY_LENGTH, &size );
+	if( size <= 0 ) return false;
+
+	data.resize( size );
+	glGetProgramBinary( shader.oglProgramObj, size, &size, &format, &data[0] );
+	data.resize( size );
+
+	return size > 0;
+}
+
+
+uint32 RenderDeviceGL4::registerShaderProgram( uint32 programObj )
+{
 	uint32 shaderId = _shaders.add( RDIShaderGL4() );
 	RDIShaderGL4 &shader = _shaders.getRef( shaderId );
 	shader.oglProgramObj = programObj;
@@ -1701,6 +1819,7 @@ bool RenderDeviceGL4::applyVertexLayout( RDIGeometryInfoGL4 &geo )
 			glBindBuffer( GL_ARRAY_BUFFER, _buffers.getRef( geo.vertexBufInfo[ attrib.vbSlot ].vbObj ).glObj );
 			glVertexAttribPointer( attribIndex, attrib.size, GL_FLOAT, GL_FALSE,
 									vbSlot.stride, (char *)0 + vbSlot.offset + attrib.offset );
+			glVertexAttribDivisor( attribIndex, attrib.divisor );
 
 			newVertexAttribMask |= 1 << attribIndex;
 		}
@@ -2090,5 +2209,20 @@ void RenderDeviceGL4::drawIndexed( RDIPrimType primType, uint32 firstIndex, uint
 	CHECK_GL_ERROR
 }
 
+
+void RenderDeviceGL4::drawIndexedInstanced( RDIPrimType primType, uint32 firstIndex, uint32 numIndices,
+											uint32 /*firstVert*/, uint32 /*numVerts*/, uint32 numInstances )
+{
+	if( commitStates() )
+	{
+		firstIndex *= (_indexFormat == IDXFMT_16) ? sizeof( short ) : sizeof( int );
+
+		glDrawElementsInstanced( RDI_GL4::primitiveTypes[ ( uint32 ) primType ], numIndices,
+								 RDI_GL4::indexFormats[ _indexFormat ], ( char * ) 0 + firstIndex, numInstances );
+	}
+
+	CHECK_GL_ERROR
+}
+
 } // namespace RDI_GL4
 }  // namespace
@@ -238,12 +238,15 @@ public:
 	void destroyTexture( uint32 &texObj );
 	void updateTextureData( uint32 texObj, int slice, int mipLevel, const void *pixels );
 	bool getTextureData( uint32 texObj, int slice, int mipLevel, void *buffer );
+	void setTextureBaseLevel( uint32 texObj, int baseLevel );
 	uint32 getTextureMem() const { return _textureMem; }
 	void bindImageToTexture( uint32 texObj, void* eglImage );
 
 	// Shaders
 	uint32 createShader( const char *vertexShaderSrc, const char *fragmentShaderSrc, const char *geometryShaderSrc,
 						 const char *tessControlShaderSrc, const char *tessEvaluationShaderSrc, const char *computeShaderSrc );
+	uint32 createShaderFromBinary( uint32 format, const uint8 *data, uint32 size );
+	bool getShaderBinary( uint32 shaderId, uint32 &format, std::vector< uint8 > &data );
 	void destroyShader(uint32 &shaderId );
 	void bindShader( uint32 shaderId );
 	std::string getShaderLog() const { return _shaderLog; }
@@ -292,6 +295,8 @@ public:
 	void draw( RDIPrimType primType, uint32 firstVert, uint32 numVerts );
 	void drawIndexed( RDIPrimType primType, uint32 firstIndex, uint32 numIndices,
 	                  uint32 firstVert, uint32 numVerts );
+	void drawIndexedInstanced( RDIPrimType primType, uint32 firstIndex, uint32 numIndices,
+	                           uint32 firstVert, uint32 numVerts, uint32 numInstances );
 
 // -----------------------------------------------------------------------------
 // Getters
@@ -321,6 +326,7 @@ protected:
 	uint32 createShaderProgram( const char *vertexShaderSrc, const char *fragmentShaderSrc, const char *geometryShaderSrc, 
 								const char *tessControlShaderSrc, const char *tessEvalShaderSrc, const char *computeShaderSrc );
 	bool linkShaderProgram( uint32 programObj );
+	uint32 registerShaderProgram( uint32 programObj );
 	void resolveRenderBuffer( uint32 rbObj );
 
 	void checkError();
@@ -0,0 +1,994 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2016 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+#include "egRendererBaseNull.h"
+#include "egModules.h"
+#include "egRenderer.h"
+#include "egCom.h"
+#include <cctype>
+#include <set>
+#include <sstream>
+
+#include "utDebug.h"
+
+namespace Horde3D {
+namespace RDI_Null {
+
+// Debug shaders (never compiled, only scanned for uniform names)
+static const char *defaultShaderVS =
+	"uniform mat4 viewProjMat;\n"
+	"uniform mat4 worldMat;\n"
+	"in vec3 vertPos;\n"
+	"void main() {\n"
+	"	gl_Position = viewProjMat * worldMat * vec4( vertPos, 1.0 );\n"
+	"}\n";
+
+static const char *defaultShaderFS =
+	"out vec4 fragColor;\n"
+	"uniform vec4 color;\n"
+	"void main() {\n"
+	"	fragColor = color;\n"
+	"}\n";
+
+// =================================================================================================
+// GPUTimer
+// =================================================================================================
+
+GPUTimerNull::GPUTimerNull()
+{
+	GPUTimer::initFunctions< GPUTimerNull >();
+	reset();
+}
+
+
+GPUTimerNull::~GPUTimerNull()
+{
+}
+
+
+void GPUTimerNull::beginQuery( uint32 /*frameID*/ )
+{
+}
+
+
+void GPUTimerNull::endQuery()
+{
+}
+
+
+bool GPUTimerNull::updateResults()
+{
+	_time = 0;
+	return true;
+}
+
+
+void GPUTimerNull::reset()
+{
+	_time = 0.f;
+}
+
+
+// =================================================================================================
+// RenderDevice
+// =================================================================================================
+
+RenderDeviceNull::RenderDeviceNull()
+{
+	RenderDeviceInterface::initRDIFunctions< RenderDeviceNull >();
+
+	_numVertexLayouts = 0;
+
+	_vpX = 0; _vpY = 0; _vpWidth = 320; _vpHeight = 240;
+	_scX = 0; _scY = 0; _scWidth = 320; _scHeight = 240;
+	_fbWidth = 320; _fbHeight = 240;
+	_prevShaderId = _curShaderId = 0;
+	_curRendBuf = 0; _outputBufferIndex = 0;
+	_textureMem = 0; _bufferMem = 0;
+	_curRasterState.hash = _newRasterState.hash = 0;
+	_curBlendState.hash = _newBlendState.hash = 0;
+	_curDepthStencilState.hash = _newDepthStencilState.hash = 0;
+	_curGeometryIndex = 1;
+	_defaultFBO = 0;
+	_defaultFBOMultisampled = false;
+	_depthFormat = 0;
+	_pendingMask = 0;
+	_tessPatchVerts = 0;
+	_memBarriers = NotSet;
+	_maxTexSlots = 32;
+
+	_logFrameID = 0;
+	_commandLogEnabled = true;
+	_numQueries = 0;
+	clearCommandLog();
+
+	// Add default geometry for resetting
+	_geometries.add( RDIGeometryInfoNull() );
+}
+
+
+RenderDeviceNull::~RenderDeviceNull()
+{
+}
+
+
+void RenderDeviceNull::initStates()
+{
+}
+
+
+bool RenderDeviceNull::init()
+{
+	Modules::log().writeInfo( "Initializing Null backend (no rendering output)" );
+
+	// Report the feature set of the GL4 backend so that all renderer code paths are used
+	_caps.texFloat = true;
+	_caps.texNPOT = true;
+	_caps.texRGTC = true;
+	_caps.texBPTC = true;
+	_caps.rtMultisampling = true;
+	_caps.geometryShaders = true;
+	_caps.tesselation = true;
+	_caps.computeShaders = true;
+	_caps.instancing = true;
+	_caps.maxJointCount = 330;
+	_caps.maxTexUnitCount = 96;
+	_caps.shaderBinaries = true;
+	_deviceId = "Null";
+
+	resetStates();
+
+	return true;
+}
+
+
+// =================================================================================================
+// Vertex layouts
+// =================================================================================================
+
+uint32 RenderDeviceNull::registerVertexLayout( uint32 numAttribs, VertexLayoutAttrib *attribs )
+{
+	if( _numVertexLayouts == MaxNumVertexLayouts )
+		return 0;
+
+	_vertexLayouts[_numVertexLayouts].numAttribs = numAttribs;
+
+	for( uint32 i = 0; i < numAttribs; ++i )
+		_vertexLayouts[_numVertexLayouts].attribs[i] = attribs[i];
+
+	return ++_numVertexLayouts;
+}
+
+
+// =================================================================================================
+// Buffers
+// =================================================================================================
+
+void RenderDeviceNull::beginRendering()
+{
+	// Keep commands of all cameras rendered in the same frame
+	if( _logFrameID != Modules::renderer().getFrameID() )
+	{
+		clearCommandLog();
+		_logFrameID = Modules::renderer().getFrameID();
+	}
+
+	resetStates();
+}
+
+
+uint32 RenderDeviceNull::beginCreatingGeometry( uint32 vlObj )
+{
+	RDIGeometryInfoNull geo;
+	geo.layout = vlObj;
+
+	return _geometries.add( geo );
+}
+
+
+void RenderDeviceNull::finishCreatingGeometry( uint32 geoObj )
+{
+	ASSERT( geoObj > 0 );
+}
+
+
+void RenderDeviceNull::setGeomVertexParams( uint32 geoObj, uint32 vbo, uint32 vbSlot, uint32 /*offset*/, uint32 /*stride*/ )
+{
+	RDIGeometryInfoNull &geo = _geometries.getRef( geoObj );
+	ASSERT( vbSlot < 16 );
+
+	if( vbo != 0 ) _buffers.getRef( vbo ).geometryRefCount++;
+	geo.vertexBufs[vbSlot] = vbo;
+}
+
+
+void RenderDeviceNull::setGeomIndexParams( uint32 geoObj, uint32 indBuf, RDIIndexFormat format )
+{
+	RDIGeometryInfoNull &geo = _geometries.getRef( geoObj );
+
+	if( indBuf != 0 ) _buffers.getRef( indBuf ).geometryRefCount++;
+	geo.indexBuf = indBuf;
+	geo.indexBuf32Bit = ( format == IDXFMT_32 );
+}
+
+
+void RenderDeviceNull::destroyGeometry( uint32 &geoObj, bool destroyBindedBuffers )
+{
+	if( geoObj == 0 )
+		return;
+
+	RDIGeometryInfoNull &geo = _geometries.getRef( geoObj );
+
+	// Copy buffer handles since the geometry object is removed below
+	uint32 indexBuf = geo.indexBuf;
+	uint32 vertexBufs[16];
+	memcpy( vertexBufs, geo.vertexBufs, sizeof( vertexBufs ) );
+
+	_geometries.remove( geoObj );
+	geoObj = 0;
+
+	if( indexBuf != 0 )
+	{
+		_buffers.getRef( indexBuf ).geometryRefCount--;
+		if( destroyBindedBuffers ) destroyBuffer( indexBuf );
+	}
+
+	for( uint32 i = 0; i < 16; ++i )
+	{
+		if( vertexBufs[i] == 0 ) continue;
+
+		_buffers.getRef( vertexBufs[i] ).geometryRefCount--;
+		if( destroyBindedBuffers ) destroyBuffer( vertexBufs[i] );
+	}
+}
+
+
+uint32 RenderDeviceNull::createBuffer( uint32 size )
+{
+	RDIBufferNull buf;
+	buf.size = size;
+
+	_bufferMem += size;
+	return _buffers.add( buf );
+}
+
+
+uint32 RenderDeviceNull::createVertexBuffer( uint32 size, const void * /*data*/ )
+{
+	return createBuffer( size );
+}
+
+
+uint32 RenderDeviceNull::createIndexBuffer( uint32 size, const void * /*data*/ )
+{
+	return createBuffer( size );
+}
+
+
+uint32 RenderDeviceNull::createTextureBuffer( TextureFormats::List /*format*/, uint32 bufSize, const void * /*data*/ )
+{
+	RDITextureBufferNull buf;
+	buf.bufObj = createBuffer( bufSize );
+
+	return _textureBuffs.add( buf );
+}
+
+
+uint32 RenderDeviceNull::createShaderStorageBuffer( uint32 size, const void * /*data*/ )
+{
+	return createBuffer( size );
+}
+
+
+void RenderDeviceNull::destroyBuffer( uint32 &bufObj )
+{
+	if( bufObj == 0 )
+		return;
+
+	RDIBufferNull &buf = _buffers.getRef( bufObj );
+
+	if( buf.geometryRefCount < 1 )
+	{
+		_bufferMem -= buf.size;
+		_buffers.remove( bufObj );
+		bufObj = 0;
+	}
+}
+
+
+void RenderDeviceNull::destroyTextureBuffer( uint32 &bufObj )
+{
+	if( bufObj == 0 )
+		return;
+
+	RDITextureBufferNull &buf = _textureBuffs.getRef( bufObj );
+	destroyBuffer( buf.bufObj );
+
+	_textureBuffs.remove( bufObj );
+	bufObj = 0;
+}
+
+
+void RenderDeviceNull::updateBufferData( uint32 /*geoObj*/, uint32 bufObj, uint32 offset, uint32 size, void * /*data*/ )
+{
+	ASSERT( offset + size <= _buffers.getRef( bufObj ).size );
+
+	recordCommand( RDICommandNull( RDICommandTypes::UpdateBuffer, bufObj, offset, size ) );
+}
+
+
+void *RenderDeviceNull::mapBuffer( uint32 /*geoObj*/, uint32 bufObj, uint32 offset, uint32 size,
+                                   RDIBufferMappingTypes /*mapType*/ )
+{
+	RDIBufferNull &buf = _buffers.getRef( bufObj );
+	ASSERT( offset + size <= buf.size );
+
+	// Mapped data is discarded but the caller needs valid memory to write to
+	if( buf.mapData.size() < buf.size ) buf.mapData.resize( buf.size );
+	buf.mapOffset = offset;
+	buf.mapSize = size;
+
+	return &buf.mapData[offset];
+}
+
+
+void RenderDeviceNull::unmapBuffer( uint32 /*geoObj*/, uint32 bufObj )
+{
+	const RDIBufferNull &buf = _buffers.getRef( bufObj );
+
+	recordCommand( RDICommandNull( RDICommandTypes::UpdateBuffer, bufObj, buf.mapOffset, buf.mapSize ) );
+}
+
+
+// =================================================================================================
+// Textures
+// =================================================================================================
+
+uint32 RenderDeviceNull::calcTextureSize( TextureFormats::List format, int width, int height, int depth )
+{
+	switch( format )
+	{
+	case TextureFormats::BGRA8:
+		return width * height * depth * 4;
+	// Block compressed formats store a whole 4x4 block for partial blocks at the border
+	case TextureFormats::DXT1:
+		return ((width + 3) / 4) * ((height + 3) / 4) * depth * 8;
+	case TextureFormats::DXT3:
+		return ((width + 3) / 4) * ((height + 3) / 4) * depth * 16;
+	case TextureFormats::DXT5:
+		return ((width + 3) / 4) * ((height + 3) / 4) * depth * 16;
+	case TextureFormats::BC4:
+		return ((width + 3) / 4) * ((height + 3) / 4) * depth * 8;
+	case TextureFormats::BC5:
+	case TextureFormats::BC7:
+		return ((width + 3) / 4) * ((height + 3) / 4) * depth * 16;
+	case TextureFormats::RGBA16F:
+		return width * height * depth * 8;
+	case TextureFormats::RGBA32F:
+		return width * height * depth * 16;
+	case TextureFormats::DEPTH:
+	case TextureFormats::R32:
+		return width * height * depth * 4;
+	case TextureFormats::RG32:
+		return width * height * depth * 8;
+	default:
+		return 0;
+	}
+}
+
+
+uint32 RenderDeviceNull::createTexture( TextureTypes::List type, int width, int height, int depth,
+                                        TextureFormats::List format,
+                                        bool hasMips, bool genMips, bool /*compress*/, bool /*sRGB*/ )
+{
+	ASSERT( depth > 0 );
+
+	RDITextureNull tex;
+	tex.type = type;
+	tex.format = format;
+	tex.width = width;
+	tex.height = height;
+	tex.depth = depth;
+	tex.genMips = genMips;
+	tex.hasMips = hasMips;
+
+	// Calculate memory requirements
+	tex.memSize = calcTextureSize( format, width, height, depth );
+	if( hasMips || genMips ) tex.memSize += ftoi_r( tex.memSize * 1.0f / 3.0f );
+	if( type == TextureTypes::TexCube ) tex.memSize *= 6;
+	_textureMem += tex.memSize;
+
+	return _textures.add( tex );
+}
+
+
+void RenderDeviceNull::uploadTextureData( uint32 texObj, int slice, int mipLevel, const void * /*pixels*/ )
+{
+	recordCommand( RDICommandNull( RDICommandTypes::UploadTexture, texObj, (uint32)slice, (uint32)mipLevel ) );
+}
+
+
+void RenderDeviceNull::destroyTexture( uint32 &texObj )
+{
+	if( texObj == 0 )
+		return;
+
+	const RDITextureNull &tex = _textures.getRef( texObj );
+
+	_textureMem -= tex.memSize;
+	_textures.remove( texObj );
+	texObj = 0;
+}
+
+
+void RenderDeviceNull::updateTextureData( uint32 texObj, int slice, int mipLevel, const void *pixels )
+{
+	uploadTextureData( texObj, slice, mipLevel, pixels );
+}
+
+
+bool RenderDeviceNull::getTextureData( uint32 texObj, int /*slice*/, int mipLevel, void *buffer )
+{
+	const RDITextureNull &tex = _textures.getRef( texObj );
+
+	// Texture contents are not stored, return black image
+	int width = std::max( tex.width >> mipLevel, 1 ), height = std::max( tex.height >> mipLevel, 1 );
+	int depth = tex.type == TextureTypes::Tex3D ? std::max( tex.depth >> mipLevel, 1 ) : 1;
+	memset( buffer, 0, calcTextureSize( tex.format, width, height, depth ) );
+
+	return true;
+}
+
+
+void RenderDeviceNull::setTextureBaseLevel( uint32 texObj, int baseLevel )
+{
+	RDITextureNull &tex = _textures.getRef( texObj );
+
+	// Only the mips from the base level on are kept
+	_textureMem -= tex.memSize;
+	tex.memSize = calcTextureSize( tex.format, std::max( tex.width >> baseLevel, 1 ), std::max( tex.height >> baseLevel, 1 ), 1 );
+	if( tex.hasMips || tex.genMips ) tex.memSize += ftoi_r( tex.memSize * 1.0f / 3.0f );
+	_textureMem += tex.memSize;
+}
+
+
+void RenderDeviceNull::bindImageToTexture( uint32 /*texObj*/, void * /*eglImage*/ )
+{
+	Modules::log().writeError( "bindImageToTexture is not supported by the Null backend" );
+}
+
+
+// =================================================================================================
+// Shaders
+// =================================================================================================
+
+// Removes code in inactive #ifdef/#ifndef branches so that the name scan only sees what a GLSL
+// compiler would see. #if expressions are not evaluated and are treated as true.
+static void stripInactiveCode( const char *src, std::string &out )
+{
+	struct Branch { bool active, taken; };
+	
+	std::set< std::string > defines;
+	std::vector< Branch > branches;
+	std::istringstream stream( src );
+	std::string line;
+
+	while( std::getline( stream, line ) )
+	{
+		bool active = branches.empty() || branches.back().active;
+		
+		size_t start = line.find_first_not_of( " \t" );
+		if( start == std::string::npos || line[start] != '#' )
+		{
+			if( active ) out.append( line ).append( "\n" );
+			continue;
+		}
+
+		std::istringstream directive( line.substr( start + 1 ) );
+		std::string cmd, ident;
+		directive >> cmd >> ident;
+		bool parentActive = branches.size() < 2 || branches[branches.size() - 2].active;
+
+		if( cmd == "ifdef" || cmd == "ifndef" || cmd == "if" )
+		{
+			bool cond = true;
+			if( cmd == "ifdef" ) cond = defines.count( ident ) > 0;
+			else if( cmd == "ifndef" ) cond = defines.count( ident ) == 0;
+			Branch b = { active && cond, cond };
+			branches.push_back( b );
+		}
+		else if( cmd == "elif" && !branches.empty() )
+		{
+			Branch &b = branches.back();
+			b.active = parentActive && !b.taken;
+			b.taken = true;
+		}
+		else if( cmd == "else" && !branches.empty() )
+		{
+			Branch &b = branches.back();
+			b.active = parentActive && !b.taken;
+			b.taken = true;
+		}
+		else if( cmd == "endif" && !branches.empty() )
+		{
+			branches.pop_back();
+		}
+		else if( active )
+		{
+			if( cmd == "define" ) defines.insert( ident );
+			else if( cmd == "undef" ) defines.erase( ident );
+			out.append( line ).append( "\n" );
+		}
+	}
+}
+
+
+uint32 RenderDeviceNull::createShader( const char *vertexShaderSrc, const char *fragmentShaderSrc, const char *geometryShaderSrc,
+                                       const char *tessControlShaderSrc, const char *tessEvaluationShaderSrc, const char *computeShaderSrc )
+{
+	_shaderLog = "";
+
+	RDIShaderNull shader;
+	const char *sources[6] = { vertexShaderSrc, fragmentShaderSrc, geometryShaderSrc,
+	                           tessControlShaderSrc, tessEvaluationShaderSrc, computeShaderSrc };
+	for( uint32 i = 0; i < 6; ++i )
+	{
+		if( sources[i] != 0x0 ) stripInactiveCode( sources[i], shader.source );
+	}
+
+	return _shaders.add( shader );
+}
+
+
+// The binary of a shader is its stripped source, so that shader caching can be tested without a GPU
+static const uint32 NullShaderBinaryFormat = 0x4C4C554E;  // 'NULL'
+
+uint32 RenderDeviceNull::createShaderFromBinary( uint32 format, const uint8 *data, uint32 size )
+{
+	_shaderLog = "";
+	if( format != NullShaderBinaryFormat || data == 0x0 ) return 0;
+
+	RDIShaderNull shader;
+	shader.source.assign( (const char *)data, size );
+
+	return _shaders.add( shader );
+}
+
+
+bool RenderDeviceNull::getShaderBinary( uint32 shaderId, uint32 &format, std::vector< uint8 > &data )
+{
+	RDIShaderNull &shader = _shaders.getRef( shaderId );
+	if( shader.source.empty() ) return false;
+
+	format = NullShaderBinaryFormat;
+	data.assign( shader.source.begin(), shader.source.end() );
+
+	return true;
+}
+
+
+void RenderDeviceNull::destroyShader( uint32 &shaderId )
+{
+	if( shaderId == 0 )
+		return;
+
+	_shaders.remove( shaderId );
+	shaderId = 0;
+}
+
+
+void RenderDeviceNull::bindShader( uint32 shaderId )
+{
+	_curShaderId = shaderId;
+	_pendingMask |= PM_GEOMETRY;
+
+	recordCommand( RDICommandNull( RDICommandTypes::BindShader, shaderId ) );
+}
+
+
+int RenderDeviceNull::findShaderName( uint32 shaderId, const char *name )
+{
+	RDIShaderNull &shader = _shaders.getRef( shaderId );
+
+	// Array uniforms are queried with the index of the first element
+	std::string baseName( name );
+	size_t bracket = baseName.find( '[' );
+	if( bracket != std::string::npos ) baseName.erase( bracket );
+	if( baseName.empty() ) return -1;
+
+	for( size_t i = 0; i < shader.constNames.size(); ++i )
+	{
+		if( shader.constNames[i] == baseName ) return (int)i;
+	}
+
+	// Look for the name as a complete identifier
+	const std::string &src = shader.source;
+	size_t pos = src.find( baseName );
+	while( pos != std::string::npos )
+	{
+		size_t end = pos + baseName.length();
+		bool startOk = pos == 0 || !(isalnum( (unsigned char)src[pos - 1] ) || src[pos - 1] == '_');
+		bool endOk = end == src.length() || !(isalnum( (unsigned char)src[end] ) || src[end] == '_');
+
+		if( startOk && endOk )
+		{
+			shader.constNames.push_back( baseName );
+			return (int)shader.constNames.size() - 1;
+		}
+
+		pos = src.find( baseName, pos + 1 );
+	}
+
+	return -1;
+}
+
+
+int RenderDeviceNull::getShaderConstLoc( uint32 shaderId, const char *name )
+{
+	return findShaderName( shaderId, name );
+}
+
+
+int RenderDeviceNull::getShaderSamplerLoc( uint32 shaderId, const char *name )
+{
+	return findShaderName( shaderId, name );
+}
+
+
+int RenderDeviceNull::getShaderBufferLoc( uint32 shaderId, const char *name )
+{
+	return findShaderName( shaderId, name );
+}
+
+
+void RenderDeviceNull::setShaderConst( int loc, RDIShaderConstType type, void * /*values*/, uint32 count )
+{
+	recordCommand( RDICommandNull( RDICommandTypes::SetShaderConst, (uint32)loc, (uint32)type, count ) );
+}
+
+
+void RenderDeviceNull::setShaderSampler( int loc, uint32 texUnit )
+{
+	recordCommand( RDICommandNull( RDICommandTypes::SetShaderSampler, (uint32)loc, texUnit ) );
+}
+
+
+const char *RenderDeviceNull::getDefaultVSCode()
+{
+	return defaultShaderVS;
+}
+
+
+const char *RenderDeviceNull::getDefaultFSCode()
+{
+	return defaultShaderFS;
+}
+
+
+void RenderDeviceNull::runComputeShader( uint32 shaderId, uint32 xDim, uint32 yDim, uint32 zDim )
+{
+	bindShader( shaderId );
+
+	if( commitStates( ~PM_GEOMETRY ) )
+		recordCommand( RDICommandNull( RDICommandTypes::RunComputeShader, shaderId, xDim, yDim, zDim ) );
+}
+
+
+// =================================================================================================
+// Renderbuffers
+// =================================================================================================
+
+uint32 RenderDeviceNull::createRenderBuffer( uint32 width, uint32 height, TextureFormats::List format,
+                                             bool depth, uint32 numColBufs, uint32 samples )
+{
+	if( numColBufs > RDIRenderBufferNull::MaxColorAttachmentCount ) return 0;
+
+	RDIRenderBufferNull rb;
+	rb.width = width;
+	rb.height = height;
+	rb.samples = samples;
+
+	for( uint32 j = 0; j < numColBufs; ++j )
+		rb.colTexs[j] = createTexture( TextureTypes::Tex2D, rb.width, rb.height, 1, format, false, false, false, false );
+
+	if( depth )
+		rb.depthTex = createTexture( TextureTypes::Tex2D, rb.width, rb.height, 1, TextureFormats::DEPTH, false, false, false, false );
+
+	return _rendBufs.add( rb );
+}
+
+
+void RenderDeviceNull::destroyRenderBuffer( uint32 &rbObj )
+{
+	RDIRenderBufferNull &rb = _rendBufs.getRef( rbObj );
+
+	if( rb.depthTex != 0 ) destroyTexture( rb.depthTex );
+
+	for( uint32 i = 0; i < RDIRenderBufferNull::MaxColorAttachmentCount; ++i )
+	{
+		if( rb.colTexs[i] != 0 ) destroyTexture( rb.colTexs[i] );
+	}
+
+	_rendBufs.remove( rbObj );
+	rbObj = 0;
+}
+
+
+void RenderDeviceNull::getRenderBufferDimensions( uint32 rbObj, int *width, int *height )
+{
+	RDIRenderBufferNull &rb = _rendBufs.getRef( rbObj );
+
+	*width = rb.width;
+	*height = rb.height;
+}
+
+
+uint32 RenderDeviceNull::getRenderBufferTex( uint32 rbObj, uint32 bufIndex )
+{
+	RDIRenderBufferNull &rb = _rendBufs.getRef( rbObj );
+
+	if( bufIndex < RDIRenderBufferNull::MaxColorAttachmentCount ) return rb.colTexs[bufIndex];
+	else if( bufIndex == 32 ) return rb.depthTex;
+	else return 0;
+}
+
+
+void RenderDeviceNull::setRenderBuffer( uint32 rbObj )
+{
+	_curRendBuf = rbObj;
+
+	if( rbObj == 0 )
+	{
+		_fbWidth = _vpWidth + _vpX;
+		_fbHeight = _vpHeight + _vpY;
+	}
+	else
+	{
+		// Unbind all textures to make sure that no render buffer attachment is bound any more
+		for( uint32 i = 0; i < 16; ++i ) setTexture( i, 0, 0, 0 );
+		commitStates( PM_TEXTURES );
+
+		RDIRenderBufferNull &rb = _rendBufs.getRef( rbObj );
+		_fbWidth = rb.width;
+		_fbHeight = rb.height;
+	}
+
+	recordCommand( RDICommandNull( RDICommandTypes::SetRenderBuffer, rbObj ) );
+}
+
+
+bool RenderDeviceNull::getRenderBufferData( uint32 rbObj, int bufIndex, int *width, int *height,
+                                            int *compCount, void *dataBuffer, int bufferSize )
+{
+	int w, h;
+
+	if( rbObj == 0 )
+	{
+		if( bufIndex != 32 && bufIndex != 0 ) return false;
+		w = _vpWidth; h = _vpHeight;
+	}
+	else
+	{
+		RDIRenderBufferNull &rb = _rendBufs.getRef( rbObj );
+
+		if( bufIndex == 32 && rb.depthTex == 0 ) return false;
+		if( bufIndex != 32 )
+		{
+			if( (unsigned)bufIndex >= RDIRenderBufferNull::MaxColorAttachmentCount || rb.colTexs[bufIndex] == 0 )
+				return false;
+		}
+		w = rb.width; h = rb.height;
+	}
+
+	if( width != 0x0 ) *width = w;
+	if( height != 0x0 ) *height = h;
+
+	int comps = (bufIndex == 32 ? 1 : 4);
+	if( compCount != 0x0 ) *compCount = comps;
+
+	// Data is returned as float; nothing was rendered so the buffer is cleared
+	if( dataBuffer != 0x0 && bufferSize >= w * h * comps * 4 )
+	{
+		memset( dataBuffer, 0, w * h * comps * 4 );
+		return true;
+	}
+
+	return false;
+}
+
+
+// =================================================================================================
+// Queries
+// =================================================================================================
+
+uint32 RenderDeviceNull::createOcclusionQuery()
+{
+	return ++_numQueries;
+}
+
+
+void RenderDeviceNull::destroyQuery( uint32 /*queryObj*/ )
+{
+}
+
+
+void RenderDeviceNull::beginQuery( uint32 queryObj )
+{
+	recordCommand( RDICommandNull( RDICommandTypes::BeginQuery, queryObj ) );
+}
+
+
+void RenderDeviceNull::endQuery( uint32 queryObj )
+{
+	recordCommand( RDICommandNull( RDICommandTypes::EndQuery, queryObj ) );
+}
+
+
+uint32 RenderDeviceNull::getQueryResult( uint32 /*queryObj*/ )
+{
+	// Report everything as visible so that occlusion culling does not depend on timing
+	return 1;
+}
+
+
+// =================================================================================================
+// Internal state management
+// =================================================================================================
+
+void RenderDeviceNull::setStorageBuffer( uint8 slot, uint32 bufObj )
+{
+	recordCommand( RDICommandNull( RDICommandTypes::SetStorageBuffer, slot, bufObj ) );
+}
+
+
+bool RenderDeviceNull::commitStates( uint32 filter )
+{
+	if( _pendingMask & filter )
+	{
+		uint32 mask = _pendingMask & filter;
+
+		if( mask & PM_VIEWPORT )
+		{
+			recordCommand( RDICommandNull( RDICommandTypes::SetViewport, _vpX, _vpY, _vpWidth, _vpHeight ) );
+			_pendingMask &= ~PM_VIEWPORT;
+		}
+
+		if( mask & PM_RENDERSTATES )
+		{
+			if( _newRasterState.hash != _curRasterState.hash || _newBlendState.hash != _curBlendState.hash ||
+			    _newDepthStencilState.hash != _curDepthStencilState.hash )
+			{
+				recordCommand( RDICommandNull( RDICommandTypes::SetRenderStates, _newRasterState.hash,
+				                               _newBlendState.hash, _newDepthStencilState.hash, _tessPatchVerts ) );
+				_curRasterState.hash = _newRasterState.hash;
+				_curBlendState.hash = _newBlendState.hash;
+				_curDepthStencilState.hash = _newDepthStencilState.hash;
+			}
+			_pendingMask &= ~PM_RENDERSTATES;
+		}
+
+		if( mask & PM_SCISSOR )
+		{
+			recordCommand( RDICommandNull( RDICommandTypes::SetScissorRect, _scX, _scY, _scWidth, _scHeight ) );
+			_pendingMask &= ~PM_SCISSOR;
+		}
+
+		if( mask & PM_TEXTURES )
+		{
+			for( uint32 i = 0; i < 16; ++i )
+			{
+				if( _texSlots[i].texObj != 0 )
+				{
+					recordCommand( RDICommandNull( RDICommandTypes::SetTexture, i, _texSlots[i].texObj,
+					                               _texSlots[i].samplerState, _texSlots[i].usage ) );
+				}
+			}
+			_pendingMask &= ~PM_TEXTURES;
+		}
+
+		if( mask & PM_GEOMETRY )
+		{
+			recordCommand( RDICommandNull( RDICommandTypes::SetGeometry, _curGeometryIndex ) );
+			_prevShaderId = _curShaderId;
+			_pendingMask &= ~PM_GEOMETRY;
+		}
+
+		if( mask & PM_BARRIER )
+		{
+			if( _memBarriers != NotSet )
+				recordCommand( RDICommandNull( RDICommandTypes::SetMemoryBarrier, (uint32)_memBarriers ) );
+			_pendingMask &= ~PM_BARRIER;
+		}
+
+		_pendingMask &= ~PM_COMPUTE;
+	}
+
+	return true;
+}
+
+
+void RenderDeviceNull::resetStates()
+{
+	_curGeometryIndex = 1;
+	_curRasterState.hash = 0xFFFFFFFF; _newRasterState.hash = 0;
+	_curBlendState.hash = 0xFFFFFFFF; _newBlendState.hash = 0;
+	_curDepthStencilState.hash = 0xFFFFFFFF; _newDepthStencilState.hash = 0;
+
+	_memBarriers = NotSet;
+
+	for( uint32 i = 0; i < 16; ++i )
+		setTexture( i, 0, 0, 0 );
+
+	setColorWriteMask( true );
+	_pendingMask = 0xFFFFFFFF;
+	commitStates();
+}
+
+
+// =================================================================================================
+// Draw calls and clears
+// =================================================================================================
+
+void RenderDeviceNull::clear( uint32 flags, float * /*colorRGBA*/, float /*depth*/ )
+{
+	commitStates( PM_VIEWPORT | PM_SCISSOR | PM_RENDERSTATES );
+
+	recordCommand( RDICommandNull( RDICommandTypes::Clear, flags, _curRendBuf ) );
+}
+
+
+void RenderDeviceNull::draw( RDIPrimType primType, uint32 firstVert, uint32 numVerts )
+{
+	if( commitStates() )
+		recordCommand( RDICommandNull( RDICommandTypes::Draw, (uint32)primType, firstVert, numVerts ) );
+}
+
+
+void RenderDeviceNull::drawIndexed( RDIPrimType primType, uint32 firstIndex, uint32 numIndices,
+                                    uint32 /*firstVert*/, uint32 /*numVerts*/ )
+{
+	if( commitStates() )
+		recordCommand( RDICommandNull( RDICommandTypes::DrawIndexed, (uint32)primType, firstIndex, numIndices ) );
+}
+
+
+void RenderDeviceNull::drawIndexedInstanced( RDIPrimType primType, uint32 firstIndex, uint32 numIndices,
+                                             uint32 /*firstVert*/, uint32 /*numVerts*/, uint32 numInstances )
+{
+	if( commitStates() )
+	{
+		recordCommand( RDICommandNull( RDICommandTypes::DrawIndexedInstanced, (uint32)primType, firstIndex,
+		                               numIndices, numInstances ) );
+	}
+}
+
+
+// =================================================================================================
+// Command log
+// =================================================================================================
+
+void RenderDeviceNull::recordCommand( const RDICommandNull &cmd )
+{
+	++_commandCounts[cmd.type];
+	if( _commandLogEnabled ) _commandLog.push_back( cmd );
+}
+
+
+void RenderDeviceNull::clearCommandLog()
+{
+	_commandLog.clear();
+	for( uint32 i = 0; i < RDICommandTypes::Count; ++i )
+		_commandCounts[i] = 0;
+}
+
+} // namespace RDI_Null
+} // namespace Horde3D
@@ -85,6 +85,14 @@ bool Resource::load( const char *data, int size )
 }
 
 
+bool Resource::loadDecoded( const char *data, int size )
+{
+	// Only types that have a decoding step accept decoded data
+	Modules::log().writeError( "Resource '%s' of type %i: Type has no decoded data", _name.c_str(), _type );
+	return false;
+}
+
+
 void Resource::unload()
 {
 	release();
@@ -185,6 +193,37 @@ void Resource::unmapStream()
 }
 
 
+// **********************************************************************************
+// Class NameIdRegistry
+// **********************************************************************************
+
+NameIdRegistry::NameIdRegistry()
+{
+	getId( "" );
+}
+
+
+uint32 NameIdRegistry::getId( const string &name )
+{
+	map< string, uint32 >::iterator itr = _ids.find( name );
+	if( itr != _ids.end() ) return itr->second;
+
+	uint32 id = (uint32)_names.size();
+	_names.push_back( name );
+	_ids[name] = id;
+
+	return id;
+}
+
+
+uint32 NameIdRegistry::findId( const string &name ) const
+{
+	map< string, uint32 >::const_iterator itr = _ids.find( name );
+	
+	return itr != _ids.end() ? itr->second : (uint32)_names.size();
+}
+
+
 // **********************************************************************************
 // Class ResourceManager
 // **********************************************************************************
@@ -226,17 +265,31 @@ void ResourceManager::registerResType( int resType, const string &typeString, Re
 }
 
 
-Resource *ResourceManager::findResource( int type, const string &name ) const
+Resource *ResourceManager::findResource( int type, const char *name ) const
+{
+	return findResourceByKey( ResourceKey( type, name, strlen( name ) ) );
+}
+
+
+Resource *ResourceManager::findResourceByKey( const ResourceKey &key ) const
 {
-	for( size_t i = 0, s = _resources.size(); i < s; ++i )
+	unordered_map< ResourceKey, ResHandle, ResourceKeyHash >::const_iterator itr = _resIndex.find( key );
+	
+	return itr != _resIndex.end() ? _resources[itr->second - 1] : 0x0;
+}
+
+
+bool ResourceManager::isNameUsed( const string &name ) const
+{
+	// Names are unique per type, so only one lookup per registered type is required
+	map< int, ResourceRegEntry >::const_iterator itr = _registry.begin();
+	while( itr != _registry.end() )
 	{
-		if( _resources[i] != 0x0 && _resources[i]->_type == type && _resources[i]->_name == name )
-		{
-			return _resources[i];
-		}
+		if( _resIndex.find( ResourceKey( itr->first, name ) ) != _resIndex.end() ) return true;
+		++itr;
 	}
-	
-	return 0x0;
+
+	return false;
 }
 
 
@@ -258,19 +311,23 @@ Resource *ResourceManager::getNextResource( int type, ResHandle start ) const
 ResHandle ResourceManager::addResource( Resource &resource )
 {
 	// Try to insert resource in free slot
-	for( uint32 i = 0; i < _resources.size(); ++i )
+	if( !_freeList.empty() )
 	{
-		if( _resources[i] == 0x0 )
-		{
-			resource._handle = i + 1;
-			_resources[i] = &resource;
-			return i + 1;
-		}
+		uint32 slot = _freeList.back();
+		ASSERT( _resources[slot] == 0x0 );
+		_freeList.pop_back();
+
+		resource._handle = slot + 1;
+		_resources[slot] = &resource;
 	}
-	
-	// If there is no free slot, add resource to end
-	resource._handle = (ResHandle)_resources.size() + 1;
-	_resources.push_back( &resource );
+	else
+	{
+		// If there is no free slot, add resource to end
+		resource._handle = (ResHandle)_resources.size() + 1;
+		_resources.push_back( &resource );
+	}
+
+	_resIndex[ResourceKey( resource._type, resource._name )] = resource._handle;
 	return resource._handle;
 }
 
@@ -284,16 +341,11 @@ ResHandle ResourceManager::addResource( int type, const string &name, int flags,
 	}
 	
 	// Check if resource is already in list and return index
-	for( uint32 i = 0; i < _resources.size(); ++i )
+	Resource *existingRes = findResource( type, name );
+	if( existingRes != 0x0 )
 	{
-		if( _resources[i] != 0x0 && _resources[i]->_name == name )
-		{
-			if( _resources[i]->_type == type )
-			{
-				if( userCall ) ++_resources[i]->_userRefCount;
-				return i + 1;
-			}
-		}
+		if( userCall ) ++existingRes->_userRefCount;
+		return existingRes->_handle;
 	}
 	
 	// Create resource
@@ -315,10 +367,7 @@ ResHandle ResourceManager::addNonExistingResource( Resource &resource, bool user
 	if( resource._name == "" ) return 0;
 
 	// Check that name does not yet exist
-	for( uint32 i = 0; i < _resources.size(); ++i )
-	{
-		if( _resources[i] != 0x0 && _resources[i]->_name == resource._name ) return 0;
-	}
+	if( isNameUsed( resource._name ) ) return 0;
 
 	if( userCall ) resource._userRefCount += 1;
 	return addResource( resource );
@@ -328,16 +377,10 @@ ResHandle ResourceManager::addNonExistingResource( Resource &resource, bool user
 ResHandle ResourceManager::cloneResource( Resource &sourceRes, const string &name )
 {
 	// Check that name does not yet exist
-	if( name != "" )
+	if( name != "" && isNameUsed( name ) )
 	{
-		for( uint32 i = 0; i < _resources.size(); ++i )
-		{
-			if( _resources[i] != 0x0 && _resources[i]->_name == name )
-			{	
-				Modules::log().writeDebugInfo( "Name '%s' used for h3dCloneResource already exists", name.c_str() );
-				return 0;
-			}
-		}
+		Modules::log().writeDebugInfo( "Name '%s' used for h3dCloneResource already exists", name.c_str() );
+		return 0;
 	}
 
 	Resource *newRes = sourceRes.clone();
@@ -352,7 +395,14 @@ ResHandle ResourceManager::cloneResource( Resource &sourceRes, const string &nam
 	{
 		stringstream ss;
 		ss << sourceRes._name << "|" << handle;
+		
+		// Re-index resource under its final name
+		unordered_map< ResourceKey, ResHandle, ResourceKeyHash >::iterator itr =
+			_resIndex.find( ResourceKey( newRes->_type, newRes->_name ) );
+		if( itr != _resIndex.end() && itr->second == handle ) _resIndex.erase( itr );
+		
 		newRes->_name = ss.str();
+		_resIndex[ResourceKey( newRes->_type, newRes->_name )] = handle;
 	}
 
 	return handle;
@@ -384,6 +434,12 @@ void ResourceManager::clear()
 			delete _resources[i]; _resources[i] = 0x0;
 		}
 	}
+
+	// All slots are free now; lowest slots are reused first
+	_resIndex.clear();
+	_freeList.clear();
+	for( uint32 i = (uint32)_resources.size(); i > 0; --i )
+		_freeList.push_back( i - 1 );
 }
 
 
@@ -404,6 +460,18 @@ ResHandle ResourceManager::queryUnloadedResource( int index ) const
 }
 
 
+ResHandle ResourceManager::queryNextUnloadedResource( ResHandle start ) const
+{
+	for( size_t i = start, s = _resources.size(); i < s; ++i )
+	{
+		if( _resources[i] != 0x0 && !_resources[i]->_loaded && !_resources[i]->_noQuery )
+			return _resources[i]->_handle;
+	}
+
+	return 0;
+}
+
+
 void ResourceManager::releaseUnusedResources()
 {
 	vector< uint32 > killList;
@@ -423,8 +491,11 @@ void ResourceManager::releaseUnusedResources()
 	// Delete unused resources
 	for( uint32 i = 0; i < killList.size(); ++i )
 	{
-		Modules::log().writeInfo( "Removed resource '%s'", _resources[killList[i]]->_name.c_str() );
-		delete _resources[killList[i]]; _resources[killList[i]] = 0x0;
+		Resource *res = _resources[killList[i]];
+		Modules::log().writeInfo( "Removed resource '%s'", res->_name.c_str() );
+		_resIndex.erase( ResourceKey( res->_type, res->_name ) );
+		delete res; _resources[killList[i]] = 0x0;
+		_freeList.push_back( killList[i] );
 	}
 
 	// Releasing a resource can remove dependencies from other resources which can also be released
@@ -15,9 +15,11 @@
 
 #include "egPrerequisites.h"
 #include "utMath.h"
+#include <cstring>
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_map>
 
 
 namespace Horde3D {
@@ -54,7 +56,10 @@ struct ResourceFlags
 		TexCubemap = 8,
 		TexDynamic = 16,
 		TexRenderable = 32,
-		TexSRGB = 64
+		TexSRGB = 64,
+		AnimCompression = 128,
+		GeoNoCPUCopy = 256,
+		TexNoStreaming = 512
 	};
 };
 
@@ -70,6 +75,7 @@ public:
 	virtual void initDefault();
 	virtual void release();
 	virtual bool load( const char *data, int size );
+	virtual bool loadDecoded( const char *data, int size );
 	void unload();
 	
 	int findElem( int elem, int param, const char *value ) const;
@@ -140,6 +146,29 @@ private:
 typedef SmartResPtr< Resource > PResource;
 
 
+// =================================================================================================
+// Name ID Registry
+// =================================================================================================
+
+// Interns strings which are compared on the draw path, like shader context names and material
+// classes, into small integer IDs. ID 0 is always the empty string. IDs are never released, so they
+// stay valid when resources are reloaded.
+class NameIdRegistry
+{
+public:
+	NameIdRegistry();
+
+	uint32 getId( const std::string &name );  // Registers name if it is unknown
+	uint32 findId( const std::string &name ) const;  // Returns getCount() if name is unknown
+	const std::string &getName( uint32 id ) const { return _names[id]; }
+	uint32 getCount() const { return (uint32)_names.size(); }
+
+private:
+	std::map< std::string, uint32 >  _ids;
+	std::vector< std::string >       _names;
+};
+
+
 // =================================================================================================
 // Resource Manager
 // =================================================================================================
@@ -148,6 +177,33 @@ typedef void (*ResTypeInitializationFunc)();
 typedef void (*ResTypeReleaseFunc)();
 typedef Resource *(*ResTypeFactoryFunc)( const std::string &name, int flags );
 
+// Does not own the name; keys in the index point to the name of their resource, so lookups
+// don't need to copy the name
+struct ResourceKey
+{
+	int          type;
+	const char   *name;
+	size_t       length;
+	size_t       hash;
+
+	ResourceKey( int type, const char *name, size_t length ) :
+		type( type ), name( name ), length( length ), hash( 2166136261u ^ ((size_t)type * 0x9e3779b9u) )
+	{
+		// FNV-1a
+		for( size_t i = 0; i < length; ++i ) hash = (hash ^ (unsigned char)name[i]) * 16777619u;
+	}
+	ResourceKey( int type, const std::string &name ) : ResourceKey( type, name.c_str(), name.length() ) {}
+	
+	bool operator==( const ResourceKey &other ) const
+		{ return hash == other.hash && type == other.type && length == other.length &&
+		         memcmp( name, other.name, length ) == 0; }
+};
+
+struct ResourceKeyHash
+{
+	size_t operator()( const ResourceKey &key ) const { return key.hash; }
+};
+
 struct ResourceRegEntry
 {
 	std::string                typeString;
@@ -168,13 +224,16 @@ public:
 	                      ResTypeReleaseFunc rf, ResTypeFactoryFunc ff );
 	
 	Resource *getNextResource( int type, ResHandle start ) const;
-	Resource *findResource( int type, const std::string &name ) const;
+	Resource *findResource( int type, const char *name ) const;
+	Resource *findResource( int type, const std::string &name ) const
+		{ return findResourceByKey( ResourceKey( type, name ) ); }
 	ResHandle addResource( int type, const std::string &name, int flags, bool userCall );
 	ResHandle addNonExistingResource( Resource &resource, bool userCall );
 	ResHandle cloneResource( Resource &sourceRes, const std::string &name );
 	int removeResource( Resource &resource, bool userCall );
 	void clear();
 	ResHandle queryUnloadedResource( int index ) const;
+	ResHandle queryNextUnloadedResource( ResHandle start ) const;
 	void releaseUnusedResources();
 
 	Resource *resolveResHandle( ResHandle handle ) const
@@ -184,9 +243,13 @@ public:
 
 protected:
 	ResHandle addResource( Resource &res );
+	Resource *findResourceByKey( const ResourceKey &key ) const;
+	bool isNameUsed( const std::string &name ) const;
 
 protected:
 	std::vector < Resource * >         _resources;
+	std::vector< uint32 >              _freeList;  // List of free slots
+	std::unordered_map< ResourceKey, ResHandle, ResourceKeyHash >  _resIndex;  // Lookup by type and name
 	std::map< int, ResourceRegEntry >  _registry;  // Registry of resource types
 };
 
@@ -18,6 +18,7 @@
 #include "egModules.h"
 #include "egCom.h"
 #include "egRenderer.h"
+#include "egProfiler.h"
 
 #include "utDebug.h"
 
@@ -106,6 +107,7 @@ void SceneNode::getTransMatrices( const float **relMat, const float **absMat ) c
 void SceneNode::setFlags( int flags, bool recursive )
 {
 	_flags = flags;
+	Modules::sceneMan().updateSpatialNode( _sgHandle );
 
 	if( recursive )
 	{
@@ -260,9 +262,8 @@ GroupNode::GroupNode( const GroupNodeTpl &groupTpl ) :
 }
 
 
-SceneNodeTpl *GroupNode::parsingFunc( map< string, string > &attribs )
+SceneNodeTpl *GroupNode::parsingFunc( const SceneNodeAttribs &attribs )
 {
-	map< string, string >::iterator itr;
 	GroupNodeTpl *groupTpl = new GroupNodeTpl( "" );
 	
 	return groupTpl;
@@ -281,10 +282,337 @@ SceneNode *GroupNode::factoryFunc( const SceneNodeTpl &nodeTpl )
 // Class SpatialGraph
 // =================================================================================================
 
-SpatialGraph::SpatialGraph()
+namespace {
+	// Relative and absolute margin by which leaf boxes are enlarged, so that slightly moving
+	// nodes do not need to be reinserted into the tree
+	const float TreeBoxMarginRel = 0.1f;
+	const float TreeBoxMarginAbs = 0.1f;
+
+	void mergeBoxes( const BoundingBox &a, const BoundingBox &b, BoundingBox &result )
+	{
+		result.min = Vec3f( minf( a.min.x, b.min.x ), minf( a.min.y, b.min.y ), minf( a.min.z, b.min.z ) );
+		result.max = Vec3f( maxf( a.max.x, b.max.x ), maxf( a.max.y, b.max.y ), maxf( a.max.z, b.max.z ) );
+	}
+
+	float boxArea( const BoundingBox &b )
+	{
+		Vec3f d = b.max - b.min;
+		return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+	}
+
+	bool boxContains( const BoundingBox &outer, const BoundingBox &inner )
+	{
+		return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && outer.min.z <= inner.min.z &&
+		       outer.max.x >= inner.max.x && outer.max.y >= inner.max.y && outer.max.z >= inner.max.z;
+	}
+
+	void enlargeBox( const BoundingBox &b, BoundingBox &result )
+	{
+		Vec3f margin = (b.max - b.min) * TreeBoxMarginRel + Vec3f( TreeBoxMarginAbs, TreeBoxMarginAbs, TreeBoxMarginAbs );
+		result.min = b.min - margin;
+		result.max = b.max + margin;
+	}
+}
+
+
+SpatialGraph::SpatialGraph() :
+	_treeRoot( -1 ), _treeFreeList( -1 ), _changeStamp( 0 )
 {
 	_lightQueue.reserve( 20 );
 	_renderQueue.reserve( 500 );
+	_traversalStack.reserve( 128 );
+}
+
+
+int SpatialGraph::allocTreeNode()
+{
+	int index;
+	
+	if( _treeFreeList >= 0 )
+	{
+		index = _treeFreeList;
+		_treeFreeList = _treeNodes[index].parent;
+	}
+	else
+	{
+		index = (int)_treeNodes.size();
+		_treeNodes.push_back( SpatialTreeNode() );
+	}
+
+	SpatialTreeNode &tn = _treeNodes[index];
+	tn.bBox.clear();
+	tn.slot = -1;
+	tn.parent = -1;
+	tn.child1 = -1;
+	tn.child2 = -1;
+	tn.height = 0;
+	tn.dirty = false;
+
+	return index;
+}
+
+
+void SpatialGraph::freeTreeNode( int index )
+{
+	SpatialTreeNode &tn = _treeNodes[index];
+	tn.slot = -1;
+	tn.parent = _treeFreeList;
+	tn.height = -1;
+	tn.dirty = false;
+	_treeFreeList = index;
+}
+
+
+void SpatialGraph::insertLeaf( int leaf )
+{
+	if( _treeRoot < 0 )
+	{
+		_treeRoot = leaf;
+		_treeNodes[leaf].parent = -1;
+		return;
+	}
+
+	// Find best sibling using the surface area heuristic
+	BoundingBox leafBox = _treeNodes[leaf].bBox, combined, tmp;
+	int index = _treeRoot;
+	
+	while( !_treeNodes[index].isLeaf() )
+	{
+		const SpatialTreeNode &tn = _treeNodes[index];
+		
+		mergeBoxes( tn.bBox, leafBox, combined );
+		float area = boxArea( tn.bBox );
+		float combinedArea = boxArea( combined );
+
+		// Cost of creating a new parent for this node and the new leaf
+		float cost = 2.0f * combinedArea;
+		// Minimum cost of pushing the leaf further down the tree
+		float inheritanceCost = 2.0f * (combinedArea - area);
+
+		float childCosts[2];
+		for( int i = 0; i < 2; ++i )
+		{
+			const SpatialTreeNode &child = _treeNodes[i == 0 ? tn.child1 : tn.child2];
+			mergeBoxes( child.bBox, leafBox, tmp );
+			childCosts[i] = boxArea( tmp ) + inheritanceCost;
+			if( !child.isLeaf() ) childCosts[i] -= boxArea( child.bBox );
+		}
+
+		if( cost < childCosts[0] && cost < childCosts[1] ) break;
+
+		index = childCosts[0] < childCosts[1] ? tn.child1 : tn.child2;
+	}
+
+	// Create new parent for sibling and leaf
+	int sibling = index;
+	int newParent = allocTreeNode();  // Invalidates references to tree nodes
+	int oldParent = _treeNodes[sibling].parent;
+	
+	SpatialTreeNode &np = _treeNodes[newParent];
+	np.parent = oldParent;
+	mergeBoxes( leafBox, _treeNodes[sibling].bBox, np.bBox );
+	np.height = _treeNodes[sibling].height + 1;
+	np.child1 = sibling;
+	np.child2 = leaf;
+
+	if( oldParent >= 0 )
+	{
+		if( _treeNodes[oldParent].child1 == sibling ) _treeNodes[oldParent].child1 = newParent;
+		else _treeNodes[oldParent].child2 = newParent;
+	}
+	else
+	{
+		_treeRoot = newParent;
+	}
+	_treeNodes[sibling].parent = newParent;
+	_treeNodes[leaf].parent = newParent;
+
+	// Walk back up the tree fixing heights and boxes
+	index = newParent;
+	while( index >= 0 )
+	{
+		index = balance( index );
+
+		SpatialTreeNode &tn = _treeNodes[index];
+		tn.height = 1 + std::max( _treeNodes[tn.child1].height, _treeNodes[tn.child2].height );
+		mergeBoxes( _treeNodes[tn.child1].bBox, _treeNodes[tn.child2].bBox, tn.bBox );
+
+		index = tn.parent;
+	}
+}
+
+
+void SpatialGraph::removeLeaf( int leaf )
+{
+	if( leaf == _treeRoot )
+	{
+		_treeRoot = -1;
+		return;
+	}
+
+	int parent = _treeNodes[leaf].parent;
+	int grandParent = _treeNodes[parent].parent;
+	int sibling = _treeNodes[parent].child1 == leaf ? _treeNodes[parent].child2 : _treeNodes[parent].child1;
+
+	if( grandParent >= 0 )
+	{
+		// Replace parent with sibling
+		if( _treeNodes[grandParent].child1 == parent ) _treeNodes[grandParent].child1 = sibling;
+		else _treeNodes[grandParent].child2 = sibling;
+		_treeNodes[sibling].parent = grandParent;
+		freeTreeNode( parent );
+
+		int index = grandParent;
+		while( index >= 0 )
+		{
+			index = balance( index );
+
+			SpatialTreeNode &tn = _treeNodes[index];
+			tn.height = 1 + std::max( _treeNodes[tn.child1].height, _treeNodes[tn.child2].height );
+			mergeBoxes( _treeNodes[tn.child1].bBox, _treeNodes[tn.child2].bBox, tn.bBox );
+
+			index = tn.parent;
+		}
+	}
+	else
+	{
+		_treeRoot = sibling;
+		_treeNodes[sibling].parent = -1;
+		freeTreeNode( parent );
+	}
+}
+
+
+int SpatialGraph::balance( int iA )
+{
+	// Performs a left or right rotation if node A is imbalanced and returns the new subtree root
+	SpatialTreeNode *a = &_treeNodes[iA];
+	if( a->isLeaf() || a->height < 2 ) return iA;
+
+	int iB = a->child1, iC = a->child2;
+	SpatialTreeNode *b = &_treeNodes[iB];
+	SpatialTreeNode *c = &_treeNodes[iC];
+
+	int diff = c->height - b->height;
+
+	if( diff > 1 )
+	{
+		// Rotate C up
+		int iF = c->child1, iG = c->child2;
+		SpatialTreeNode *f = &_treeNodes[iF];
+		SpatialTreeNode *g = &_treeNodes[iG];
+
+		c->child1 = iA;
+		c->parent = a->parent;
+		a->parent = iC;
+
+		if( c->parent >= 0 )
+		{
+			if( _treeNodes[c->parent].child1 == iA ) _treeNodes[c->parent].child1 = iC;
+			else _treeNodes[c->parent].child2 = iC;
+		}
+		else _treeRoot = iC;
+
+		if( f->height > g->height )
+		{
+			c->child2 = iF;
+			a->child2 = iG;
+			g->parent = iA;
+			mergeBoxes( b->bBox, g->bBox, a->bBox );
+			mergeBoxes( a->bBox, f->bBox, c->bBox );
+			a->height = 1 + std::max( b->height, g->height );
+			c->height = 1 + std::max( a->height, f->height );
+		}
+		else
+		{
+			c->child2 = iG;
+			a->child2 = iF;
+			f->parent = iA;
+			mergeBoxes( b->bBox, f->bBox, a->bBox );
+			mergeBoxes( a->bBox, g->bBox, c->bBox );
+			a->height = 1 + std::max( b->height, f->height );
+			c->height = 1 + std::max( a->height, g->height );
+		}
+
+		return iC;
+	}
+	
+	if( diff < -1 )
+	{
+		// Rotate B up
+		int iD = b->child1, iE = b->child2;
+		SpatialTreeNode *d = &_treeNodes[iD];
+		SpatialTreeNode *e = &_treeNodes[iE];
+
+		b->child1 = iA;
+		b->parent = a->parent;
+		a->parent = iB;
+
+		if( b->parent >= 0 )
+		{
+			if( _treeNodes[b->parent].child1 == iA ) _treeNodes[b->parent].child1 = iB;
+			else _treeNodes[b->parent].child2 = iB;
+		}
+		else _treeRoot = iB;
+
+		if( d->height > e->height )
+		{
+			b->child2 = iD;
+			a->child1 = iE;
+			e->parent = iA;
+			mergeBoxes( c->bBox, e->bBox, a->bBox );
+			mergeBoxes( a->bBox, d->bBox, b->bBox );
+			a->height = 1 + std::max( c->height, e->height );
+			b->height = 1 + std::max( a->height, d->height );
+		}
+		else
+		{
+			b->child2 = iE;
+			a->child1 = iD;
+			d->parent = iA;
+			mergeBoxes( c->bBox, d->bBox, a->bBox );
+			mergeBoxes( a->bBox, e->bBox, b->bBox );
+			a->height = 1 + std::max( c->height, d->height );
+			b->height = 1 + std::max( a->height, e->height );
+		}
+
+		return iB;
+	}
+
+	return iA;
+}
+
+
+void SpatialGraph::refitDirtyLeaves()
+{
+	BoundingBox enlarged;
+
+	// Order of refitting affects tree layout; sort so that it does not depend on update order
+	std::sort( _dirtyLeafs.begin(), _dirtyLeafs.end() );
+	
+	for( size_t i = 0, s = _dirtyLeafs.size(); i < s; ++i )
+	{
+		int leaf = _dirtyLeafs[i];
+		SpatialTreeNode &tn = _treeNodes[leaf];
+		if( tn.height != 0 || !tn.dirty ) continue;  // Leaf was removed in the meantime
+		tn.dirty = false;
+
+		SceneNode *node = _nodes[tn.slot];
+		const BoundingBox &b = node->_bBox;
+		_nodeBoxes.set( tn.slot, b );
+		_nodeFlags[tn.slot] = node->_flags;
+		
+		enlargeBox( b, enlarged );
+		
+		// Reinsert leaf if node has left its box or if box has become much too large
+		if( boxContains( tn.bBox, b ) && boxArea( tn.bBox ) <= 4.0f * boxArea( enlarged ) ) continue;
+
+		removeLeaf( leaf );
+		_treeNodes[leaf].bBox = enlarged;
+		insertLeaf( leaf );
+	}
+
+	_dirtyLeafs.resize( 0 );
 }
 
 
@@ -292,19 +620,50 @@ void SpatialGraph::addNode( SceneNode &sceneNode )
 {	
 	if( !sceneNode._renderable && sceneNode._type != SceneNodeTypes::Light ) return;
 	
+	uint32 slot;
+	
 	if( !_freeList.empty() )
 	{
-		uint32 slot = _freeList.back();
+		slot = _freeList.back();
 		ASSERT( _nodes[slot] == 0x0 );
 		_freeList.pop_back();
 
-		sceneNode._sgHandle = slot + 1;
 		_nodes[slot] = &sceneNode;
 	}
 	else
 	{
+		slot = (uint32)_nodes.size();
 		_nodes.push_back( &sceneNode );
-		sceneNode._sgHandle = (uint32)_nodes.size();
+		_nodeLeafs.push_back( -1 );
+		_nodeFlags.push_back( 0 );
+		_nodeTypes.push_back( 0 );
+		_nodeStamps.push_back( 0 );
+		_nodeBoxes.resize( _nodes.size() );
+	}
+	sceneNode._sgHandle = slot + 1;
+	_nodeBoxes.set( slot, sceneNode._bBox );
+	_nodeFlags[slot] = sceneNode._flags;
+	_nodeTypes[slot] = sceneNode._type;
+	_nodeStamps[slot] = ++_changeStamp;
+
+	if( sceneNode._renderable )
+	{
+		int leaf = allocTreeNode();
+		SpatialTreeNode &tn = _treeNodes[leaf];
+		tn.slot = (int)slot;
+		enlargeBox( sceneNode._bBox, tn.bBox );
+		
+		// Box is usually not yet valid, so refit leaf before the next query
+		tn.dirty = true;
+		_dirtyLeafs.push_back( leaf );
+		
+		insertLeaf( leaf );
+		_nodeLeafs[slot] = leaf;
+	}
+	else
+	{
+		_lights.push_back( &sceneNode );
+		_nodeLeafs[slot] = -1;
 	}
 }
 
@@ -316,31 +675,82 @@ void SpatialGraph::removeNode( uint32 sgHandle )
 	// Reset queues
 	_lightQueue.resize( 0 );
 	_renderQueue.resize( 0 );
+
+	uint32 slot = sgHandle - 1;
+	int leaf = _nodeLeafs[slot];
+	if( leaf >= 0 )
+	{
+		removeLeaf( leaf );
+		freeTreeNode( leaf );
+		_nodeLeafs[slot] = -1;
+	}
+	else
+	{
+		std::vector< SceneNode * >::iterator itr = std::find( _lights.begin(), _lights.end(), _nodes[slot] );
+		if( itr != _lights.end() ) _lights.erase( itr );
+	}
 	
-	_nodes[sgHandle - 1]->_sgHandle = 0;
-	_nodes[sgHandle - 1] = 0x0;
-	_freeList.push_back( sgHandle - 1 );
+	_nodes[slot]->_sgHandle = 0;
+	_nodes[slot] = 0x0;
+	_freeList.push_back( slot );
 }
 
 
 void SpatialGraph::updateNode( uint32 sgHandle )
 {
-	// Since the spatial graph is just a flat list of objects,
-	// there is nothing to do at the moment
+	// The bounding box is usually not final when this is called, so the leaf is just
+	// marked and gets refitted lazily before the next query
+	if( sgHandle == 0 ) return;
+	
+	std::lock_guard< std::mutex > lock( _dirtyLeafsMutex );
+	_nodeStamps[sgHandle - 1] = ++_changeStamp;
+	
+	int leaf = _nodeLeafs[sgHandle - 1];
+	if( leaf < 0 ) return;
+	if( _treeNodes[leaf].dirty ) return;
+	
+	_treeNodes[leaf].dirty = true;
+	_dirtyLeafs.push_back( leaf );
 }
 
 
-struct RenderQueueItemCompFunc
+void SpatialGraph::addToRenderQueue( uint32 slot, const Vec3f &camPos, const Vec3f &viewerPos,
+                                     RenderingOrder::List order )
 {
-	bool operator()( const RenderQueueItem &a, const RenderQueueItem &b ) const
-		{ return a.sortKey < b.sortKey; }
-};
+	SceneNode *node = _nodes[slot];
+	
+	if( node->_lodSupported )
+	{
+		uint32 curLod = node->calcLodLevel( camPos );
+		if ( !node->checkLodCorrectness( curLod ) ) return;
+	}
+	
+	uint64 sortKey = 0;
+
+	switch( order )
+	{
+	case RenderingOrder::StateChanges:
+		// Within the same state, nodes are drawn front to back
+		sortKey = RenderSortKey::fromStateAndDepth( _nodeTypes[slot], node->_sortKey,
+			nearestDistToAABB( viewerPos, node->_bBox.min, node->_bBox.max ) );
+		break;
+	case RenderingOrder::FrontToBack:
+		sortKey = RenderSortKey::fromDistance( nearestDistToAABB( viewerPos, node->_bBox.min, node->_bBox.max ) );
+		break;
+	case RenderingOrder::BackToFront:
+		sortKey = ~RenderSortKey::fromDistance( nearestDistToAABB( viewerPos, node->_bBox.min, node->_bBox.max ) );
+		break;
+	}
+	
+	_renderQueue.push_back( RenderQueueItem( _nodeTypes[slot], sortKey, node ) );
+}
 
 
 void SpatialGraph::updateQueues( const Frustum &frustum1, const Frustum *frustum2, RenderingOrder::List order,
                                  uint32 filterIgnore, bool lightQueue, bool renderQueue )
 {
 	Modules::sceneMan().updateNodes();
+	refitDirtyLeaves();
 	
 	Vec3f camPos( frustum1.getOrigin() );
 	if( Modules::renderer().getCurCamera() != 0x0 )
@@ -350,50 +760,137 @@ void SpatialGraph::updateQueues( const Frustum &frustum1, const Frustum *frustum
 	if( lightQueue ) _lightQueue.resize( 0 );
 	if( renderQueue ) _renderQueue.resize( 0 );
 
-	// Culling
-	for( size_t i = 0, s = _nodes.size(); i < s; ++i )
+	// Lights are not culled
+	if( lightQueue )
 	{
-		SceneNode *node = _nodes[i];
-		if( node == 0x0 || (node->_flags & filterIgnore) ) continue;
+		for( size_t i = 0, s = _lights.size(); i < s; ++i )
+		{
+			if( !(_lights[i]->_flags & filterIgnore) ) _lightQueue.push_back( _lights[i] );
+		}
+	}
 
-		if( renderQueue && node->_renderable )
+	// Hierarchical culling
+	if( renderQueue && _treeRoot >= 0 )
+	{
+		// The stack holds pairs of tree node index and the planes of both frustums that still need
+		// to be tested (6 bits for each frustum); subtrees completely inside are not tested anymore
+		const uint32 allPlanes = 0x3F;
+		uint32 numTests = 0;
+		
+		_cullCandidates.resize( 0 );
+		_traversalStack.resize( 0 );
+		_traversalStack.push_back( (uint32)_treeRoot );
+		_traversalStack.push_back( allPlanes | (frustum2 != 0x0 ? allPlanes << 6 : 0) );
+
+		while( !_traversalStack.empty() )
 		{
-			if( !frustum1.cullBox( node->_bBox ) &&
-				(frustum2 == 0x0 || !frustum2->cullBox( node->_bBox )) )
+			uint32 planeMasks = _traversalStack.back(); _traversalStack.pop_back();
+			const SpatialTreeNode &tn = _treeNodes[_traversalStack.back()]; _traversalStack.pop_back();
+			
+			uint32 mask1 = planeMasks & allPlanes, mask2 = planeMasks >> 6;
+			if( planeMasks != 0 ) ++numTests;
+			if( mask1 != 0 && frustum1.cullBox( tn.bBox, mask1 ) ) continue;
+			if( mask2 != 0 && frustum2->cullBox( tn.bBox, mask2 ) ) continue;
+
+			if( tn.isLeaf() )
 			{
-				if( node->_lodSupported )
-				{
-					uint32 curLod = node->calcLodLevel( camPos );
-					if ( !node->checkLodCorrectness( curLod ) ) continue;
-				}
-				
-				float sortKey = 0;
-
-				switch( order )
-				{
-				case RenderingOrder::StateChanges:
-					sortKey = node->_sortKey;
-					break;
-				case RenderingOrder::FrontToBack:
-					sortKey = nearestDistToAABB( frustum1.getOrigin(), node->_bBox.min, node->_bBox.max );
-					break;
-				case RenderingOrder::BackToFront:
-					sortKey = -nearestDistToAABB( frustum1.getOrigin(), node->_bBox.min, node->_bBox.max );
-					break;
-				}
-				
-				_renderQueue.push_back( RenderQueueItem( node->_type, sortKey, node ) );
+				if( _nodeFlags[tn.slot] & filterIgnore ) continue;
+
+				// Leaf box is enlarged, so the node box itself is tested in a batch afterwards
+				// unless the leaf is completely inside
+				if( mask1 != 0 || mask2 != 0 )
+					_cullCandidates.push_back( (uint32)tn.slot );
+				else
+					addToRenderQueue( tn.slot, camPos, frustum1.getOrigin(), order );
+			}
+			else
+			{
+				planeMasks = mask1 | (mask2 << 6);
+				_traversalStack.push_back( (uint32)tn.child1 );
+				_traversalStack.push_back( planeMasks );
+				_traversalStack.push_back( (uint32)tn.child2 );
+				_traversalStack.push_back( planeMasks );
 			}
 		}
-		else if( lightQueue && node->_type == SceneNodeTypes::Light )
+
+		// Batch test of node boxes
+		uint32 numCandidates = (uint32)_cullCandidates.size();
+		if( numCandidates > 0 )
 		{
-			_lightQueue.push_back( node );
+			uint32 *candidates = &_cullCandidates[0];
+			numTests += numCandidates;
+			numCandidates = frustum1.cullBoxes( _nodeBoxes, candidates, numCandidates, candidates );
+			if( frustum2 != 0x0 )
+				numCandidates = frustum2->cullBoxes( _nodeBoxes, candidates, numCandidates, candidates );
+			
+			for( uint32 i = 0; i < numCandidates; ++i )
+				addToRenderQueue( candidates[i], camPos, frustum1.getOrigin(), order );
 		}
+
+		Modules::stats().incStat( EngineStats::CullingNodeTests, (float)numTests );
 	}
 
 	// Sort
 	if( order != RenderingOrder::None )
-		std::sort( _renderQueue.begin(), _renderQueue.end(), RenderQueueItemCompFunc() );
+		sortRenderQueue();
+}
+
+
+void SpatialGraph::sortRenderQueue()
+{
+	// LSD radix sort with 8 bit digits; digits that are the same for all items are skipped, so the
+	// 32 bit depth keys need at most four passes
+	uint32 count = (uint32)_renderQueue.size();
+	if( count < 2 ) return;
+
+	uint32 histograms[8][256];
+	memset( histograms, 0, sizeof( histograms ) );
+	for( uint32 i = 0; i < count; ++i )
+	{
+		uint64 key = _renderQueue[i].sortKey;
+		for( uint32 j = 0; j < 8; ++j )
+			++histograms[j][(key >> (j * 8)) & 0xFF];
+	}
+
+	_sortedRenderQueue.resize( count );
+	RenderQueueItem *src = &_renderQueue[0], *dst = &_sortedRenderQueue[0];
+	
+	for( uint32 j = 0; j < 8; ++j )
+	{
+		uint32 *histogram = histograms[j];
+		uint32 shift = j * 8;
+		if( histogram[(src[0].sortKey >> shift) & 0xFF] == count ) continue;
+
+		// Convert counts to start offsets
+		uint32 offset = 0;
+		for( uint32 k = 0; k < 256; ++k )
+		{
+			uint32 c = histogram[k];
+			histogram[k] = offset;
+			offset += c;
+		}
+
+		for( uint32 i = 0; i < count; ++i )
+			dst[histogram[(src[i].sortKey >> shift) & 0xFF]++] = src[i];
+		
+		std::swap( src, dst );
+	}
+
+	if( src != &_renderQueue[0] ) _renderQueue.swap( _sortedRenderQueue );
+}
+
+
+// *************************************************************************************************
+// Class SceneNodeAttribs
+// *************************************************************************************************
+
+bool SceneNodeAttribs::getBool( const char *name, bool &value ) const
+{
+	string str;
+	if( !getString( name, str ) ) return false;
+
+	value = _stricmp( str.c_str(), "true" ) == 0 || _stricmp( str.c_str(), "1" ) == 0;
+	return true;
 }
 
 
@@ -466,6 +963,8 @@ void SceneManager::updateNodes()
 void SceneManager::updateQueues( const Frustum &frustum1, const Frustum *frustum2, RenderingOrder::List order,
                                  uint32 filterIgnore, bool lightQueue, bool renderableQueue )
 {
+	ProfileScope profileScope( "Culling" );
+
 	_spatialGraph->updateQueues( frustum1, frustum2, order, filterIgnore, lightQueue, renderableQueue );
 }
 
@@ -18,6 +18,7 @@
 #include "egPrimitives.h"
 #include "egPipeline.h"
 #include <map>
+#include <mutex>
 
 
 namespace Horde3D {
@@ -91,6 +92,19 @@ struct SceneNodeTpl
 	}
 };
 
+// Custom attributes of a node in a scene graph resource; implemented by the XML and the binary
+// scene graph formats, the getters return false if the attribute does not exist
+class SceneNodeAttribs
+{
+public:
+	virtual ~SceneNodeAttribs() {}
+
+	virtual bool getString( const char *name, std::string &value ) const = 0;
+	virtual bool getFloat( const char *name, float &value ) const = 0;
+	virtual bool getInt( const char *name, int &value ) const = 0;
+	bool getBool( const char *name, bool &value ) const;
+};
+
 // =================================================================================================
 
 class SceneNode
@@ -159,7 +173,7 @@ protected:
 	NodeHandle                  _handle;
 	uint32                      _sgHandle;  // Spatial graph handle
 	uint32                      _flags;
-	float                       _sortKey;
+	uint64                      _sortKey;  // State part of render queue key (see RenderSortKey)
 	bool                        _dirty;  // Does the node need to be updated?
 	bool                        _transformed;
 	bool                        _renderable;
@@ -189,7 +203,7 @@ struct GroupNodeTpl : public SceneNodeTpl
 class GroupNode : public SceneNode
 {
 public:
-	static SceneNodeTpl *parsingFunc( std::map< std::string, std::string > &attribs );
+	static SceneNodeTpl *parsingFunc( const SceneNodeAttribs &attribs );
 	static SceneNode *factoryFunc( const SceneNodeTpl &nodeTpl );
 
 	friend class Renderer;
@@ -204,20 +218,77 @@ protected:
 // Spatial Graph
 // =================================================================================================
 
+struct RenderSortKey
+{
+	// For RenderingOrder::StateChanges the key is composed of the following fields, from the most to
+	// the least significant bits; the depth based orders use the bit pattern of the view distance
+	enum Layout
+	{
+		DepthBits = 12,
+		GeometryBits = 16,
+		MaterialBits = 16,
+		ShaderBits = 12,
+		TypeBits = 8,
+
+		DepthShift = 0,
+		GeometryShift = DepthShift + DepthBits,
+		MaterialShift = GeometryShift + GeometryBits,
+		ShaderShift = MaterialShift + MaterialBits,
+		TypeShift = ShaderShift + ShaderBits
+	};
+
+	static uint64 fromState( uint32 shader, uint32 material, uint32 geometry )
+	{
+		// Handles are truncated; collisions only make the ordering less optimal
+		return ((uint64)(shader & ((1 << ShaderBits) - 1)) << ShaderShift) |
+		       ((uint64)(material & ((1 << MaterialBits) - 1)) << MaterialShift) |
+		       ((uint64)(geometry & ((1 << GeometryBits) - 1)) << GeometryShift);
+	}
+
+	static uint32 fromDistance( float dist )
+	{
+		// The bit pattern of non-negative floats increases monotonically with their value
+		union { float f; uint32 u; } bits;
+		bits.f = dist > 0 ? dist : 0;
+		return bits.u;
+	}
+
+	static uint64 fromStateAndDepth( int type, uint64 stateKey, float dist )
+	{
+		// Exponent and four mantissa bits of the distance give a logarithmic depth quantization
+		return ((uint64)(type & ((1 << TypeBits) - 1)) << TypeShift) | stateKey |
+		       (fromDistance( dist ) >> (31 - DepthBits));
+	}
+};
+
+
 struct RenderQueueItem
 {
 	SceneNode  *node;
 	int        type;  // Type is stored explicitly for better cache efficiency when iterating over list
-	float      sortKey;
+	uint64     sortKey;
 
 	RenderQueueItem() {}
-	RenderQueueItem( int type, float sortKey, SceneNode *node )
+	RenderQueueItem( int type, uint64 sortKey, SceneNode *node )
 		: node( node ), type( type ), sortKey( sortKey ) {}
 };
 
 typedef std::vector< RenderQueueItem > RenderQueue;
 
 
+struct SpatialTreeNode
+{
+	BoundingBox  bBox;       // Enlarged box for leaves, union of children for inner nodes
+	int          slot;       // Spatial graph slot of leaf, -1 for inner nodes
+	int          parent;     // Parent node or next free node when in free list
+	int          child1, child2;
+	int          height;     // 0 for leaves, -1 for unused nodes
+	bool         dirty;      // Leaf needs to be refitted before next query
+
+	bool isLeaf() const { return child1 < 0; }
+};
+
+
 class SpatialGraph
 {
 public:
@@ -233,11 +304,45 @@ public:
 	std::vector< SceneNode * > &getLightQueue() { return _lightQueue; }
 	RenderQueue &getRenderQueue() { return _renderQueue; }
 
+	// Stamps increase whenever a node is added or updated and can be used to detect changes
+	uint32 getNodeStamp( uint32 sgHandle ) const { return sgHandle != 0 ? _nodeStamps[sgHandle - 1] : 0; }
+	uint32 getChangeStamp() const { return _changeStamp; }
+
+protected:
+	int allocTreeNode();
+	void freeTreeNode( int index );
+	void insertLeaf( int leaf );
+	void removeLeaf( int leaf );
+	int balance( int index );
+	void refitDirtyLeaves();
+	void addToRenderQueue( uint32 slot, const Vec3f &camPos, const Vec3f &viewerPos, RenderingOrder::List order );
+	void sortRenderQueue();
+
 protected:
 	std::vector< SceneNode * >     _nodes;		// Renderable nodes and lights
 	std::vector< uint32 >          _freeList;
+	std::vector< int >             _nodeLeafs;  // Tree leaf for each slot in _nodes, -1 for lights
+	std::vector< SceneNode * >     _lights;
+
+	// Copies of culling relevant node data per slot for cache efficient batch culling
+	BoundingBoxArray               _nodeBoxes;
+	std::vector< uint32 >          _nodeFlags;
+	std::vector< int >             _nodeTypes;
+	std::vector< uint32 >          _nodeStamps;
+	std::vector< uint32 >          _cullCandidates;
+	
+	// Dynamic AABB tree over the renderable nodes
+	std::vector< SpatialTreeNode > _treeNodes;
+	int                            _treeRoot;
+	int                            _treeFreeList;
+	std::vector< int >             _dirtyLeafs;
+	std::mutex                     _dirtyLeafsMutex;  // Nodes can be updated from worker threads
+	uint32                         _changeStamp;
+	std::vector< uint32 >          _traversalStack;
+	
 	std::vector< SceneNode * >     _lightQueue;
 	RenderQueue                    _renderQueue;
+	RenderQueue                    _sortedRenderQueue;  // Scratch buffer for sorting
 };
 
 
@@ -245,7 +350,7 @@ protected:
 // Scene Manager
 // =================================================================================================
 
-typedef SceneNodeTpl *(*NodeTypeParsingFunc)( std::map< std::string, std::string > &attribs );
+typedef SceneNodeTpl *(*NodeTypeParsingFunc)( const SceneNodeAttribs &attribs );
 typedef SceneNode *(*NodeTypeFactoryFunc)( const SceneNodeTpl &tpl );
 
 struct NodeRegEntry
@@ -298,6 +403,8 @@ public:
 	SceneNode &getDefCamNode() const { return *_nodes[1]; }
 	std::vector< SceneNode * > &getLightQueue() const { return _spatialGraph->getLightQueue(); }
 	RenderQueue &getRenderQueue() const { return _spatialGraph->getRenderQueue(); }
+	uint32 getNodeStamp( const SceneNode &node ) const { return _spatialGraph->getNodeStamp( node._sgHandle ); }
+	uint32 getChangeStamp() const { return _spatialGraph->getChangeStamp(); }
 	
 	SceneNode *resolveNodeHandle( NodeHandle handle ) const
 		{ return (handle != 0 && (unsigned)(handle - 1) < _nodes.size()) ? _nodes[handle - 1] : 0x0; }
@@ -10,6 +10,7 @@
 //
 // *************************************************************************************************
 
+#include "utEndian.h"
 #include "egSceneGraphRes.h"
 #include "egModules.h"
 #include "egCom.h"
@@ -25,6 +26,190 @@ namespace Horde3D {
 using namespace std;
 
 
+// Binary scene graph format (all values little endian):
+//   header:        'H3DS', uint32 version (1)
+//   string table:  uint32 stringCount, uint32 dataSize, stringCount null-terminated strings
+//   type table:    uint32 typeCount, typeCount uint32 string indices of the node type names
+//   nodes:         node records in depth-first order, starting with the root node
+// Node record:
+//   uint32 type index, uint32 name string, float tx, ty, tz, rx, ry, rz, sx, sy, sz,
+//   uint32 attachment string (0xFFFFFFFF if none), uint32 attribCount, uint32 childCount,
+//   attribCount * { uint32 name string, uint32 value type (0: float, 1: int, 2: string), 4 byte value }
+
+static const uint32 SceneGraphBinaryVersion = 1;
+static const uint32 SceneGraphNoString = 0xFFFFFFFF;
+static const uint32 SceneGraphMaxDepth = 256;  // Deeper node hierarchies are rejected as corrupt
+static const size_t SceneGraphAttribRecordSize = 3 * sizeof( uint32 );
+
+struct SceneGraphAttribTypes
+{
+	enum List
+	{
+		Float = 0,
+		Int,
+		String
+	};
+};
+
+struct SceneGraphBinaryAttrib
+{
+	const char  *name;
+	uint32      type;
+	union
+	{
+		float   floatValue;
+		int32   intValue;
+		uint32  stringValue;
+	};
+};
+
+struct SceneGraphBinaryData
+{
+	const char                        *pData, *dataEnd;
+	std::vector< const char * >       strings;
+	std::vector< uint32 >             typeNames;
+	std::vector< NodeRegEntry * >     types;  // 0x0 for unknown types
+	uint32                            referenceType;
+	uint32                            depth;  // Nesting level of the current node
+	std::vector< SceneGraphBinaryAttrib >  attribs;  // Attributes of the current node
+};
+
+
+template< class T > static bool readBinary( SceneGraphBinaryData &binData, T *values, uint32 count )
+{
+	if( (size_t)(binData.dataEnd - binData.pData) < sizeof( T ) * count ) return false;
+	binData.pData = elemcpy_le( values, (T *)binData.pData, count );
+	return true;
+}
+
+
+static bool hasRecords( const SceneGraphBinaryData &binData, uint32 count, size_t recordSize )
+{
+	// Counts are validated against the remaining data before anything is allocated for them
+	return (size_t)(binData.dataEnd - binData.pData) / recordSize >= count;
+}
+
+
+// =================================================================================================
+// Node attribute accessors
+// =================================================================================================
+
+class XMLSceneNodeAttribs : public SceneNodeAttribs
+{
+public:
+	XMLSceneNodeAttribs( XMLNode &xmlNode ) : _xmlNode( xmlNode ) {}
+
+	bool getString( const char *name, string &value ) const
+	{
+		const char *str = findAttrib( name );
+		if( str == 0x0 ) return false;
+		value = str;
+		return true;
+	}
+
+	bool getFloat( const char *name, float &value ) const
+	{
+		const char *str = findAttrib( name );
+		if( str == 0x0 ) return false;
+		value = (float)atof( str );
+		return true;
+	}
+
+	bool getInt( const char *name, int &value ) const
+	{
+		const char *str = findAttrib( name );
+		if( str == 0x0 ) return false;
+		value = atoi( str );
+		return true;
+	}
+
+private:
+	const char *findAttrib( const char *name ) const
+	{
+		rapidxml::xml_attribute<> *attrib = _xmlNode.getRapidXMLNode()->first_attribute( name );
+		return attrib != 0x0 ? attrib->value() : 0x0;
+	}
+
+private:
+	XMLNode  &_xmlNode;
+};
+
+
+class BinarySceneNodeAttribs : public SceneNodeAttribs
+{
+public:
+	BinarySceneNodeAttribs( SceneGraphBinaryData &binData ) : _binData( binData ) {}
+
+	bool getString( const char *name, string &value ) const
+	{
+		const SceneGraphBinaryAttrib *attrib = findAttrib( name );
+		if( attrib == 0x0 ) return false;
+
+		char buf[32];
+		switch( attrib->type )
+		{
+		case SceneGraphAttribTypes::Float:
+			snprintf( buf, sizeof( buf ), "%.9g", attrib->floatValue );
+			value = buf;
+			break;
+		case SceneGraphAttribTypes::Int:
+			snprintf( buf, sizeof( buf ), "%i", attrib->intValue );
+			value = buf;
+			break;
+		default:
+			value = _binData.strings[attrib->stringValue];
+			break;
+		}
+		return true;
+	}
+
+	bool getFloat( const char *name, float &value ) const
+	{
+		const SceneGraphBinaryAttrib *attrib = findAttrib( name );
+		if( attrib == 0x0 ) return false;
+
+		switch( attrib->type )
+		{
+		case SceneGraphAttribTypes::Float: value = attrib->floatValue; break;
+		case SceneGraphAttribTypes::Int: value = (float)attrib->intValue; break;
+		default: value = (float)atof( _binData.strings[attrib->stringValue] ); break;
+		}
+		return true;
+	}
+
+	bool getInt( const char *name, int &value ) const
+	{
+		const SceneGraphBinaryAttrib *attrib = findAttrib( name );
+		if( attrib == 0x0 ) return false;
+
+		switch( attrib->type )
+		{
+		case SceneGraphAttribTypes::Float: value = (int)attrib->floatValue; break;
+		case SceneGraphAttribTypes::Int: value = attrib->intValue; break;
+		default: value = atoi( _binData.strings[attrib->stringValue] ); break;
+		}
+		return true;
+	}
+
+private:
+	const SceneGraphBinaryAttrib *findAttrib( const char *name ) const
+	{
+		for( size_t i = 0, s = _binData.attribs.size(); i < s; ++i )
+		{
+			if( strcmp( _binData.attribs[i].name, name ) == 0 ) return &_binData.attribs[i];
+		}
+		return 0x0;
+	}
+
+private:
+	SceneGraphBinaryData  &_binData;
+};
+
+
+// =================================================================================================
+// Class SceneGraphResource
+// =================================================================================================
+
 SceneGraphResource::SceneGraphResource( const string &name, int flags ) :
 	Resource( ResourceTypes::SceneGraph, name, flags )
 {
@@ -51,6 +236,18 @@ void SceneGraphResource::release()
 }
 
 
+bool SceneGraphResource::raiseError( const string &msg )
+{
+	// Reset
+	release();
+	initDefault();
+
+	Modules::log().writeError( "SceneGraph resource '%s': %s", _name.c_str(), msg.c_str() );
+
+	return false;
+}
+
+
 void SceneGraphResource::parseBaseAttributes( XMLNode &xmlNode, SceneNodeTpl &nodeTpl )
 {
 	nodeTpl.name = xmlNode.getAttribute( "name", "" );
@@ -93,29 +290,8 @@ void SceneGraphResource::parseNode( XMLNode &xmlNode, SceneNodeTpl *parentTpl )
 			NodeRegEntry *entry = Modules::sceneMan().findType( xmlNode.getName() );
 			if( entry != 0x0 )
 			{
-				map< string, string > attribs;
-				
-				// Parse custom attributes
-				XMLAttribute attrib = xmlNode.getFirstAttrib();
-				while( !attrib.isEmpty() )
-				{
-					if( strcmp( attrib.getName(), "name" ) != 0 &&
-						strcmp( attrib.getName(), "tx" ) != 0 &&
-						strcmp( attrib.getName(), "ty" ) != 0 &&
-						strcmp( attrib.getName(), "tz" ) != 0 &&
-						strcmp( attrib.getName(), "rx" ) != 0 &&
-						strcmp( attrib.getName(), "ry" ) != 0 &&
-						strcmp( attrib.getName(), "rz" ) != 0 &&
-						strcmp( attrib.getName(), "sx" ) != 0 &&
-						strcmp( attrib.getName(), "sy" ) != 0 &&
-						strcmp( attrib.getName(), "sz" ) != 0 )
-					{
-						attribs[attrib.getName()] = attrib.getValue();
-					}
-					attrib = attrib.getNextAttrib();
-				}
-
-				// Call function pointer
+				// Call function pointer; custom attributes are read directly from the XML node
+				XMLSceneNodeAttribs attribs( xmlNode );
 				nodeTpl = (*entry->parsingFunc)( attribs );
 			}
 		}
@@ -156,9 +332,168 @@ void SceneGraphResource::parseNode( XMLNode &xmlNode, SceneNodeTpl *parentTpl )
 }
 
 
+bool SceneGraphResource::parseBinaryNode( SceneGraphBinaryData &binData, SceneNodeTpl *parentTpl, bool skip )
+{
+	uint32 typeIndex, nameIndex, attachmentIndex, attribCount, childCount;
+	float transform[9];
+	
+	if( !readBinary( binData, &typeIndex, 1 ) || !readBinary( binData, &nameIndex, 1 ) ||
+	    !readBinary( binData, transform, 9 ) || !readBinary( binData, &attachmentIndex, 1 ) ||
+	    !readBinary( binData, &attribCount, 1 ) || !readBinary( binData, &childCount, 1 ) )
+	{
+		return raiseError( "Unexpected end of data" );
+	}
+	if( typeIndex >= binData.types.size() || nameIndex >= binData.strings.size() ||
+	    (attachmentIndex != SceneGraphNoString && attachmentIndex >= binData.strings.size()) )
+	{
+		return raiseError( "Invalid node record" );
+	}
+	if( !hasRecords( binData, attribCount, SceneGraphAttribRecordSize ) )
+		return raiseError( "Unexpected end of data" );
+
+	// Custom attributes
+	binData.attribs.resize( attribCount );
+	for( uint32 i = 0; i < attribCount; ++i )
+	{
+		SceneGraphBinaryAttrib &attrib = binData.attribs[i];
+		uint32 attribName;
+
+		if( !readBinary( binData, &attribName, 1 ) || !readBinary( binData, &attrib.type, 1 ) ||
+		    !readBinary( binData, &attrib.stringValue, 1 ) )
+		{
+			return raiseError( "Unexpected end of data" );
+		}
+		if( attribName >= binData.strings.size() || attrib.type > SceneGraphAttribTypes::String ||
+		    (attrib.type == SceneGraphAttribTypes::String && attrib.stringValue >= binData.strings.size()) )
+		{
+			return raiseError( "Invalid node attribute" );
+		}
+		attrib.name = binData.strings[attribName];
+	}
+
+	SceneNodeTpl *nodeTpl = 0x0;
+
+	if( !skip )
+	{
+		BinarySceneNodeAttribs attribs( binData );
+		
+		if( typeIndex == binData.referenceType )
+		{
+			string sgName;
+			if( attribs.getString( "sceneGraph", sgName ) && !sgName.empty() )
+			{
+				Resource *res = Modules::resMan().resolveResHandle( Modules::resMan().addResource(
+					ResourceTypes::SceneGraph, sgName, 0, false ) );
+				if( res != 0x0 ) nodeTpl = new ReferenceNodeTpl( "", (SceneGraphResource *)res );
+			}
+		}
+		else if( binData.types[typeIndex] != 0x0 )
+		{
+			nodeTpl = (*binData.types[typeIndex]->parsingFunc)( attribs );
+		}
+
+		if( nodeTpl != 0x0 )
+		{
+			nodeTpl->name = binData.strings[nameIndex];
+			nodeTpl->trans = Vec3f( transform[0], transform[1], transform[2] );
+			nodeTpl->rot = Vec3f( transform[3], transform[4], transform[5] );
+			nodeTpl->scale = Vec3f( transform[6], transform[7], transform[8] );
+			if( attachmentIndex != SceneGraphNoString )
+				nodeTpl->attachmentString = binData.strings[attachmentIndex];
+
+			// Add to parent
+			if( parentTpl != 0x0 )
+			{
+				parentTpl->children.push_back( nodeTpl );
+			}
+			else
+			{	
+				delete _rootNode;	// Delete default root
+				_rootNode = nodeTpl;
+			}
+		}
+		else
+		{
+			Modules::log().writeWarning( "SceneGraph resource '%s': Unknown node type or missing attribute for '%s'",
+			                             _name.c_str(), binData.strings[binData.typeNames[typeIndex]] );
+		}
+	}
+
+	// Parse children; the subtree of an invalid node is skipped like for XML files
+	if( childCount > 0 && ++binData.depth > SceneGraphMaxDepth )
+		return raiseError( "Node hierarchy too deep" );
+	
+	for( uint32 i = 0; i < childCount; ++i )
+	{
+		if( !parseBinaryNode( binData, nodeTpl, nodeTpl == 0x0 ) ) return false;
+	}
+	if( childCount > 0 ) --binData.depth;
+
+	return true;
+}
+
+
+bool SceneGraphResource::loadBinary( const char *data, int size )
+{
+	SceneGraphBinaryData binData;
+	binData.pData = data + 4;
+	binData.dataEnd = data + size;
+
+	uint32 version;
+	if( !readBinary( binData, &version, 1 ) ) return raiseError( "Invalid binary scene graph" );
+	if( version != SceneGraphBinaryVersion ) return raiseError( "Unsupported version of binary scene graph" );
+
+	// String table
+	uint32 count, dataSize;
+	if( !readBinary( binData, &count, 1 ) || !readBinary( binData, &dataSize, 1 ) ||
+	    (size_t)(binData.dataEnd - binData.pData) < dataSize || count > dataSize )
+	{
+		return raiseError( "Invalid string table" );
+	}
+	
+	const char *strData = binData.pData, *strEnd = binData.pData + dataSize;
+	binData.strings.reserve( count );
+	for( uint32 i = 0; i < count; ++i )
+	{
+		const char *str = strData;
+		while( strData != strEnd && *strData != '\0' ) ++strData;
+		if( strData == strEnd ) return raiseError( "Invalid string table" );
+		binData.strings.push_back( str );
+		++strData;
+	}
+	binData.pData = strEnd;
+
+	// Node types are resolved once per file
+	if( !readBinary( binData, &count, 1 ) || !hasRecords( binData, count, sizeof( uint32 ) ) )
+		return raiseError( "Invalid type table" );
+	binData.typeNames.resize( count );
+	if( count > 0 && !readBinary( binData, &binData.typeNames[0], count ) )
+		return raiseError( "Invalid type table" );
+
+	binData.types.resize( count );
+	binData.referenceType = SceneGraphNoString;
+	binData.depth = 0;
+	for( uint32 i = 0; i < count; ++i )
+	{
+		if( binData.typeNames[i] >= binData.strings.size() ) return raiseError( "Invalid type table" );
+		
+		const char *typeName = binData.strings[binData.typeNames[i]];
+		if( strcmp( typeName, "Reference" ) == 0 ) binData.referenceType = i;
+		binData.types[i] = Modules::sceneMan().findType( typeName );
+	}
+
+	// Parse scene nodes and load resources
+	return parseBinaryNode( binData, 0x0, false );
+}
+
+
 bool SceneGraphResource::load( const char *data, int size )
 {
 	if( !Resource::load( data, size ) ) return false;
+
+	// Binary scene graphs are identified by their magic number, everything else is parsed as XML
+	if( size >= 4 && memcmp( data, "H3DS", 4 ) == 0 )
+		return loadBinary( data, size );
 	
 	XMLDoc doc;
 	doc.parseBuffer( data, size );
@@ -22,6 +22,7 @@
 namespace Horde3D {
 
 class XMLNode;
+struct SceneGraphBinaryData;
 
 
 // =================================================================================================
@@ -44,8 +45,11 @@ public:
 	SceneNodeTpl *getRootNode() const { return _rootNode; }
 
 private:
+	bool raiseError( const std::string &msg );
 	void parseBaseAttributes( XMLNode &xmlNode, SceneNodeTpl &nodeTpl );
 	void parseNode( XMLNode &xmlNode, SceneNodeTpl *parentTpl );
+	bool loadBinary( const char *data, int size );
+	bool parseBinaryNode( SceneGraphBinaryData &binData, SceneNodeTpl *parentTpl, bool skip );
 
 private:
 	SceneNodeTpl	*_rootNode;
@@ -14,6 +14,9 @@
 #include "egModules.h"
 #include "egCom.h"
 #include "egRenderer.h"
+#include "egMaterial.h"
+#include "utThreadPool.h"
+#include "utTimer.h"
 #include <fstream>
 #include <cstring>
 
@@ -389,6 +392,12 @@ string ShaderResource::_tessCtlPreamble = "";
 string ShaderResource::_tessEvalPreamble = "";
 string ShaderResource::_computePreamble = "";
 bool ShaderResource::_defaultPreambleSet = false;
+NameIdRegistry ShaderResource::_contextNames;
+uint32 ShaderResource::_layoutStampCounter = 0;
+std::vector< ShaderResource::PendingCombination > ShaderResource::_pendingCombs;
+
+// Time in ms per frame for compiling pending combinations; at least one combination is compiled per frame
+static const float PendingCombinationBudget = 2.0f;
 
 string ShaderResource::_tmpCodeVS = "";
 string ShaderResource::_tmpCodeFS = "";
@@ -401,6 +410,7 @@ string ShaderResource::_tmpCodeTSEval = "";
 ShaderResource::ShaderResource( const string &name, int flags ) :
 	Resource( ResourceTypes::Shader, name, flags )
 {
+	_layoutStamp = ++_layoutStampCounter;
 	initDefault();
 }
 
@@ -411,10 +421,18 @@ ShaderResource::~ShaderResource()
 }
 
 
+// The null backend does not compile shaders and uses the code written for the GL4 backend
+static int getShaderBackendType()
+{
+	int type = Modules::renderer().getRenderDeviceType();
+	return type == RenderBackendType::Null ? (int)RenderBackendType::OpenGL4 : type;
+}
+
+
 void ShaderResource::initializationFunc()
 {
 	// specify default version preamble for shaders
-	switch ( Modules::renderer().getRenderDeviceType() )
+	switch ( getShaderBackendType() )
 	{
 		case RenderBackendType::OpenGL4:
 			_vertPreamble = "#version 330\r\n";
@@ -442,6 +460,8 @@ void ShaderResource::release()
 {
 	RenderDeviceInterface *rdi = Modules::renderer().getRenderDevice();
 
+	removePendingCombinations( -1 );
+
 	for( uint32 i = 0; i < _contexts.size(); ++i )
 	{
 		for( uint32 j = 0; j < _contexts[i].shaderCombs.size(); ++j )
@@ -453,8 +473,10 @@ void ShaderResource::release()
 	_contexts.clear();
 	_samplers.clear();
 	_uniforms.clear();
+	_buffers.clear();
 	//_preLoadList.clear();
 	_codeSections.clear();
+	_layoutStamp = ++_layoutStampCounter;
 }
 
 
@@ -750,6 +772,7 @@ bool ShaderResource::parseFXSectionContext( Tokenizer &tok, const char * identif
 
 	context.id = tok.getToken( identifier );
 	if ( context.id == "" ) return raiseError( "FX: Invalid identifier", tok.getLine() );
+	context.nameId = getContextId( context.id );
 
 	// Skip annotations
 	if ( tok.checkToken( "<" ) )
@@ -983,7 +1006,7 @@ bool ShaderResource::parseFXSectionContext( Tokenizer &tok, const char * identif
 	}
 
 	// Skip contexts that are intended for other render interfaces
-	if ( Modules::renderer().getRenderDeviceType() == targetRenderBackend )
+	if ( getShaderBackendType() == targetRenderBackend )
 	{
 		_contexts.push_back( context );
  	}
@@ -995,6 +1018,8 @@ bool ShaderResource::load( const char *data, int size )
 {
 	if( !Resource::load( data, size ) ) return false;
 	
+	_layoutStamp = ++_layoutStampCounter;
+
 	// Parse sections
 	const char *pData = data;
 	const char *eof = data + size;
@@ -1099,109 +1124,60 @@ void ShaderResource::preLoadCombination( uint32 combMask )
 }
 
 
-bool ShaderResource::compileCombination( ShaderContext &context, ShaderCombination &sc )
+void ShaderResource::assembleCombination( const ShaderContext &context, uint32 combMask, std::string *code ) const
 {
-	uint32 combMask = sc.combMask;
+	// Only reads the preambles and code sections, so combinations can be assembled on worker threads
+	const std::string *preambles[6] = { &_vertPreamble, &_fragPreamble, &_geomPreamble,
+	                                    &_tessCtlPreamble, &_tessEvalPreamble, &_computePreamble };
+	int codeIdx[6] = { context.vertCodeIdx, context.fragCodeIdx, context.geomCodeIdx,
+	                   context.tessCtlCodeIdx, context.tessEvalCodeIdx, context.computeCodeIdx };
 	
-	// Add preamble
-	_tmpCodeVS = _vertPreamble;
-	_tmpCodeFS = _fragPreamble;
-	_tmpCodeGS = _geomPreamble;
-	_tmpCodeCS = _computePreamble;
-	_tmpCodeTSCtl = _tessCtlPreamble;
-	_tmpCodeTSEval = _tessEvalPreamble;
-
 	// Insert defines for flags
+	std::string flagDefines;
 	if( combMask != 0 )
 	{
-		_tmpCodeVS += "\r\n// ---- Flags ----\r\n";
-		_tmpCodeFS += "\r\n// ---- Flags ----\r\n";
-		_tmpCodeGS += "\r\n// ---- Flags ----\r\n";
-		_tmpCodeTSCtl += "\r\n// ---- Flags ----\r\n";
-		_tmpCodeTSEval += "\r\n// ---- Flags ----\r\n";
-		_tmpCodeCS += "\r\n// ---- Flags ----\r\n";
+		flagDefines = "\r\n// ---- Flags ----\r\n";
 
 		for( uint32 i = 1; i <= 32; ++i )
 		{
 			if( combMask & (1 << (i-1)) )
 			{
-				_tmpCodeVS += "#define _F";
-				_tmpCodeVS += ( char ) ( 48 + i / 10 );
-				_tmpCodeVS += ( char ) ( 48 + i % 10 );
-				_tmpCodeVS += "_\r\n";
-
-				_tmpCodeFS += "#define _F";
-				_tmpCodeFS += ( char ) ( 48 + i / 10 );
-				_tmpCodeFS += ( char ) ( 48 + i % 10 );
-				_tmpCodeFS += "_\r\n";
-				
-				// geometry
-				_tmpCodeGS += "#define _F";
-				_tmpCodeGS += ( char ) ( 48 + i / 10 );
-				_tmpCodeGS += ( char ) ( 48 + i % 10 );
-				_tmpCodeGS += "_\r\n";
-
-				// tessellation
-				_tmpCodeTSCtl += "#define _F";
-				_tmpCodeTSCtl += ( char ) ( 48 + i / 10 );
-				_tmpCodeTSCtl += ( char ) ( 48 + i % 10 );
-				_tmpCodeTSCtl += "_\r\n";
-
-				_tmpCodeTSEval += "#define _F";
-				_tmpCodeTSEval += ( char ) ( 48 + i / 10 );
-				_tmpCodeTSEval += ( char ) ( 48 + i % 10 );
-				_tmpCodeTSEval += "_\r\n";
-
-				// compute
-				_tmpCodeCS += "#define _F";
-				_tmpCodeCS += ( char ) ( 48 + i / 10 );
-				_tmpCodeCS += ( char ) ( 48 + i % 10 );
-				_tmpCodeCS += "_\r\n";
+				flagDefines += "#define _F";
+				flagDefines += ( char ) ( 48 + i / 10 );
+				flagDefines += ( char ) ( 48 + i % 10 );
+				flagDefines += "_\r\n";
 			}
 		}
 
-		_tmpCodeVS += "// ---------------\r\n";
-		_tmpCodeFS += "// ---------------\r\n";
-		_tmpCodeGS += "// ---------------\r\n";
-		_tmpCodeTSCtl += "// ---------------\r\n";
-		_tmpCodeTSEval += "// ---------------\r\n";
-		_tmpCodeCS += "// ---------------\r\n";
+		flagDefines += "// ---------------\r\n";
 	}
 
-	// Add actual shader code
-	bool vsAvailable, fsAvailable, csAvailable, gsAvailable, tscAvailable, tseAvailable;
-	vsAvailable = fsAvailable = csAvailable = gsAvailable = tscAvailable = tseAvailable = false;
-
-	if ( context.vertCodeIdx >= 0 )
+	// Add preamble and actual shader code
+	for( int i = 0; i < 6; ++i )
 	{
-		_tmpCodeVS += getCode( context.vertCodeIdx )->assembleCode();
-		vsAvailable = true;
-	}
-	if ( context.fragCodeIdx >= 0 )
-	{
-		_tmpCodeFS += getCode( context.fragCodeIdx )->assembleCode();
-		fsAvailable = true;
-	}
-	if ( context.geomCodeIdx >= 0 )
-	{
-		_tmpCodeGS += getCode( context.geomCodeIdx )->assembleCode();
-		gsAvailable = true;
-	}
-	if ( context.tessCtlCodeIdx >= 0 )
-	{
-		_tmpCodeTSCtl += getCode( context.tessCtlCodeIdx )->assembleCode();
-		tscAvailable = true;
-	}
-	if ( context.tessEvalCodeIdx >= 0 )
-	{
-		_tmpCodeTSEval += getCode( context.tessEvalCodeIdx )->assembleCode();
-		tseAvailable = true;
-	}
-	if ( context.computeCodeIdx >= 0 )
-	{
-		_tmpCodeCS += getCode( context.computeCodeIdx )->assembleCode();
-		csAvailable = true;
+		code[i].clear();
+		if( codeIdx[i] < 0 ) continue;
+
+		code[i] = *preambles[i];
+		code[i] += flagDefines;
+		code[i] += _codeSections[codeIdx[i]].assembleCode();
 	}
+}
+
+
+bool ShaderResource::compileCombination( ShaderContext &context, ShaderCombination &sc )
+{
+	std::string code[6];
+	assembleCombination( context, sc.combMask, code );
+
+	return compileCombination( context, sc, code );
+}
+
+
+bool ShaderResource::compileCombination( ShaderContext &context, ShaderCombination &sc, const std::string *code )
+{
+	bool vsAvailable = !code[0].empty(), fsAvailable = !code[1].empty(), gsAvailable = !code[2].empty();
+	bool tscAvailable = !code[3].empty(), tseAvailable = !code[4].empty(), csAvailable = !code[5].empty();
 
 	Modules::log().writeInfo( "---- C O M P I L I N G  . S H A D E R . %s@%s[%i] ----",
 		_name.c_str(), context.id.c_str(), sc.combMask );
@@ -1217,12 +1193,12 @@ bool ShaderResource::compileCombination( ShaderContext &context, ShaderCombinati
 	
 	// Compile shader
 	bool compiled = Modules::renderer().createShaderComb( sc, 
-														  vsAvailable ? _tmpCodeVS.c_str() : 0,
-														  fsAvailable ? _tmpCodeFS.c_str() : 0,  
-														  gsAvailable ? _tmpCodeGS.c_str() : 0,
-														  tscAvailable ? _tmpCodeTSCtl.c_str() : 0,
-														  tseAvailable ? _tmpCodeTSEval.c_str() : 0,
-														  csAvailable ? _tmpCodeCS.c_str() : 0
+														  vsAvailable ? code[0].c_str() : 0,
+														  fsAvailable ? code[1].c_str() : 0,  
+														  gsAvailable ? code[2].c_str() : 0,
+														  tscAvailable ? code[3].c_str() : 0,
+														  tseAvailable ? code[4].c_str() : 0,
+														  csAvailable ? code[5].c_str() : 0
 														  );
 	if( !compiled )
 	{
@@ -1233,7 +1209,7 @@ bool ShaderResource::compileCombination( ShaderContext &context, ShaderCombinati
 		{
 			bool shaderAvailability[ 6 ] = { vsAvailable, fsAvailable, gsAvailable, tscAvailable, tseAvailable, csAvailable };
 			std::string dumpFileName;
-			std::string *output;
+			const std::string *output;
 
 			for ( size_t i = 0; i < 6; ++i )
 			{
@@ -1242,17 +1218,17 @@ bool ShaderResource::compileCombination( ShaderContext &context, ShaderCombinati
 					switch ( i )
 					{
 						case 0: // vertex shader
-							dumpFileName = "shdDumpVS.txt"; output = &_tmpCodeVS; break;
+							dumpFileName = "shdDumpVS.txt"; output = &code[ 0 ]; break;
 						case 1:  // fragment shader
-							dumpFileName = "shdDumpFS.txt"; output = &_tmpCodeFS; break;
+							dumpFileName = "shdDumpFS.txt"; output = &code[ 1 ]; break;
 						case 2:  // geometry shader
-							dumpFileName = "shdDumpGS.txt"; output = &_tmpCodeGS; break;
+							dumpFileName = "shdDumpGS.txt"; output = &code[ 2 ]; break;
 						case 3:  // tessellation control shader
-							dumpFileName = "shdDumpTSC.txt"; output = &_tmpCodeTSCtl; break;
+							dumpFileName = "shdDumpTSC.txt"; output = &code[ 3 ]; break;
 						case 4:  // tessellation evaluation shader
-							dumpFileName = "shdDumpTSE.txt"; output = &_tmpCodeTSEval; break;
+							dumpFileName = "shdDumpTSE.txt"; output = &code[ 4 ]; break;
 						case 5:  // compute shader
-							dumpFileName = "shdDumpCS.txt"; output = &_tmpCodeCS; break;
+							dumpFileName = "shdDumpCS.txt"; output = &code[ 5 ]; break;
 						default:
 							break;
 					}
@@ -1329,6 +1305,9 @@ void ShaderResource::compileContexts()
 			continue;
 		}
 
+		// Pending combinations may have been assembled from outdated code
+		removePendingCombinations( (int)i );
+
 		// Add preloaded combinations
 		for( std::set< uint32 >::iterator itr = _preLoadList.begin(); itr != _preLoadList.end(); ++itr )
 		{
@@ -1377,6 +1356,16 @@ ShaderCombination *ShaderResource::getCombination( ShaderContext &context, uint3
 		if( combs[i].combMask == combMask ) return &combs[i];
 	}
 
+	// Compiling the combination here would stall the frame, so it is compiled in the background
+	// and the caller skips drawing until it is available
+	if( Modules::config().asyncShaderCompilation )
+	{
+		if( queueCombination( context, combMask ) )
+			Modules::stats().incStat( EngineStats::ShaderHitchesAvoided, 1 );
+		
+		return 0x0;
+	}
+
 	// Add combination
 	combs.push_back( ShaderCombination() );
 	combs.back().combMask = combMask;
@@ -1386,6 +1375,145 @@ ShaderCombination *ShaderResource::getCombination( ShaderContext &context, uint3
 }
 
 
+bool ShaderResource::queueCombination( ShaderContext &context, uint32 combMask )
+{
+	uint32 contextIdx = (uint32)(&context - &_contexts[0]);
+	
+	for( size_t i = 0, s = _pendingCombs.size(); i < s; ++i )
+	{
+		PendingCombination &pc = _pendingCombs[i];
+		if( pc.shaderRes == this && pc.contextIdx == contextIdx && pc.combMask == combMask ) return false;
+	}
+
+	_pendingCombs.push_back( PendingCombination() );
+	PendingCombination &pc = _pendingCombs.back();
+	pc.shaderRes = this;
+	pc.contextIdx = contextIdx;
+	pc.combMask = combMask;
+	pc.assembled = false;
+
+	return true;
+}
+
+
+void ShaderResource::removePendingCombinations( int contextIdx )
+{
+	for( size_t i = 0; i < _pendingCombs.size(); )
+	{
+		PendingCombination &pc = _pendingCombs[i];
+		if( pc.shaderRes == this && (contextIdx < 0 || pc.contextIdx == (uint32)contextIdx) )
+			_pendingCombs.erase( _pendingCombs.begin() + i );
+		else
+			++i;
+	}
+}
+
+
+void ShaderResource::assemblePendingFunc( void *userData, uint32 begin, uint32 end )
+{
+	PendingCombination *pendingCombs = (PendingCombination *)userData;
+	
+	for( uint32 i = begin; i < end; ++i )
+	{
+		PendingCombination &pc = pendingCombs[i];
+		pc.shaderRes->assembleCombination( pc.shaderRes->_contexts[pc.contextIdx], pc.combMask, pc.code );
+		pc.assembled = true;
+	}
+}
+
+
+void ShaderResource::warmUpCombinations()
+{
+	std::vector< Resource * > &resources = Modules::resMan().getResources();
+
+	for( size_t i = 0, s = resources.size(); i < s; ++i )
+	{
+		if( resources[i] == 0x0 || resources[i]->getType() != ResourceTypes::Material ) continue;
+
+		MaterialResource *matRes = (MaterialResource *)resources[i];
+		ShaderResource *shaderRes = matRes->_shaderRes;
+		if( shaderRes == 0x0 || !shaderRes->isLoaded() ) continue;
+
+		for( size_t j = 0; j < shaderRes->_contexts.size(); ++j )
+		{
+			ShaderContext &context = shaderRes->_contexts[j];
+			if( !context.compiled ) continue;
+
+			uint32 combMask = matRes->_combMask & context.flagMask;
+
+			bool found = false;
+			for( size_t k = 0; k < context.shaderCombs.size(); ++k )
+			{
+				if( context.shaderCombs[k].combMask == combMask )
+				{
+					found = true;
+					break;
+				}
+			}
+
+			if( !found ) shaderRes->queueCombination( context, combMask );
+		}
+	}
+}
+
+
+void ShaderResource::processPendingCombinations( bool all )
+{
+	if( _pendingCombs.empty() ) return;
+
+	// Assemble the code of newly queued combinations on the worker threads; combinations are
+	// queued at the back and assembled together, so the assembled ones form a prefix
+	size_t first = 0;
+	while( first < _pendingCombs.size() && _pendingCombs[first].assembled ) ++first;
+	if( first < _pendingCombs.size() )
+	{
+		Modules::threadPool().parallelFor( (uint32)(_pendingCombs.size() - first), 1,
+		                                   assemblePendingFunc, &_pendingCombs[first] );
+	}
+
+	// Shader objects can only be created on the render thread, so compiling is limited by
+	// a time budget to spread the cost of many new combinations over several frames
+	Timer timer;
+	timer.setEnabled( true );
+	
+	size_t count = 0;
+	bool compiled = false;
+	while( count < _pendingCombs.size() )
+	{
+		PendingCombination &pc = _pendingCombs[count++];
+		ShaderContext &context = pc.shaderRes->_contexts[pc.contextIdx];
+		
+		bool found = false;
+		for( size_t i = 0; i < context.shaderCombs.size(); ++i )
+		{
+			if( context.shaderCombs[i].combMask == pc.combMask )
+			{
+				found = true;
+				break;
+			}
+		}
+
+		if( !found )
+		{
+			context.shaderCombs.push_back( ShaderCombination() );
+			context.shaderCombs.back().combMask = pc.combMask;
+			pc.shaderRes->compileCombination( context, context.shaderCombs.back(), pc.code );
+			compiled = true;
+		}
+
+		if( !all && timer.getElapsedTimeMS() >= PendingCombinationBudget ) break;
+	}
+
+	_pendingCombs.erase( _pendingCombs.begin(), _pendingCombs.begin() + count );
+	
+	// Adding combinations can move the existing ones of a context
+	Modules::renderer().setShaderComb( 0x0 );
+
+	// Casters drawn while their combination was pending are missing from cached shadow maps
+	if( compiled ) Modules::renderer().invalidateShadowMapCache();
+}
+
+
 uint32 ShaderResource::calcCombMask( const std::vector< std::string > &flags )
 {	
 	uint32 combMask = 0;
@@ -143,6 +143,7 @@ struct ShaderCombination
 	int                 uni_skinMatRows;
 	int                 uni_lightPos, uni_lightDir, uni_lightColor;
 	int                 uni_shadowSplitDists, uni_shadowMats, uni_shadowMapSize, uni_shadowBias;
+	int                 uni_clusterGridSize, uni_clusterDepthParams, uni_clusterProjMat;
 	int                 uni_parPosArray, uni_parSizeAndRotArray, uni_parColorArray;
 	int                 uni_olayColor;
 
@@ -152,7 +153,13 @@ struct ShaderCombination
 
 
 	ShaderCombination() :
-		combMask( 0 ), shaderObj( 0 ), lastUpdateStamp( 0 )
+		combMask( 0 ), shaderObj( 0 ), lastUpdateStamp( 0 ), uni_frameBufSize( -1 ), uni_viewMat( -1 ),
+		uni_viewMatInv( -1 ), uni_projMat( -1 ), uni_viewProjMat( -1 ), uni_viewProjMatInv( -1 ),
+		uni_viewerPos( -1 ), uni_worldMat( -1 ), uni_worldNormalMat( -1 ), uni_nodeId( -1 ),
+		uni_customInstData( -1 ), uni_skinMatRows( -1 ), uni_lightPos( -1 ), uni_lightDir( -1 ),
+		uni_lightColor( -1 ), uni_shadowSplitDists( -1 ), uni_shadowMats( -1 ), uni_shadowMapSize( -1 ),
+		uni_shadowBias( -1 ), uni_clusterGridSize( -1 ), uni_clusterDepthParams( -1 ), uni_clusterProjMat( -1 ),
+		uni_parPosArray( -1 ), uni_parSizeAndRotArray( -1 ), uni_parColorArray( -1 ), uni_olayColor( -1 )
 	{
 	}
 };
@@ -161,6 +168,7 @@ struct ShaderCombination
 struct ShaderContext
 {
 	std::string                       id;
+	uint32                            nameId;  // Interned id, see ShaderResource::getContextId
 	uint32                            flagMask;
 	
 	// RenderConfig
@@ -181,10 +189,10 @@ struct ShaderContext
 
 
 	ShaderContext() :
-		blendStateSrc( BlendModes::Zero ), blendStateDst( BlendModes::Zero ), depthFunc( TestModes::LessEqual ),
-		cullMode( CullModes::Back ), depthTest( true ), writeDepth( true ), alphaToCoverage( false ), tessVerticesInPatchCount( 1 ),
-		vertCodeIdx( -1 ), fragCodeIdx( -1 ), geomCodeIdx( -1 ), tessCtlCodeIdx( -1 ), tessEvalCodeIdx( -1 ), computeCodeIdx( -1 ), compiled( false ),
-		blendingEnabled( false )
+		nameId( 0 ), blendStateSrc( BlendModes::Zero ), blendStateDst( BlendModes::Zero ), depthFunc( TestModes::LessEqual ),
+		cullMode( CullModes::Back ), tessVerticesInPatchCount( 1 ), depthTest( true ), writeDepth( true ), alphaToCoverage( false ),
+		blendingEnabled( false ), vertCodeIdx( -1 ), fragCodeIdx( -1 ), geomCodeIdx( -1 ), tessCtlCodeIdx( -1 ), tessEvalCodeIdx( -1 ),
+		computeCodeIdx( -1 ), compiled( false )
 	{
 	}
 };
@@ -233,6 +241,8 @@ public:
 	}
 
 	static uint32 calcCombMask( const std::vector< std::string > &flags );
+	static uint32 getContextId( const std::string &name ) { return _contextNames.getId( name ); }
+	static uint32 findContextId( const std::string &name ) { return _contextNames.findId( name ); }
 	
 	ShaderResource( const std::string &name, int flags );
 	~ShaderResource();
@@ -260,8 +270,32 @@ public:
 		return 0x0;
 	}
 
+	ShaderContext *findContext( uint32 nameId )
+	{
+		for( uint32 i = 0; i < _contexts.size(); ++i )
+			if( _contexts[i].nameId == nameId ) return &_contexts[i];
+		
+		return 0x0;
+	}
+
 	std::vector< ShaderContext > &getContexts() { return _contexts; }
 	CodeResource *getCode( uint32 index ) { return &_codeSections[index]; }
+	uint32 getLayoutStamp() const { return _layoutStamp; }
+
+	static void warmUpCombinations();
+	static void processPendingCombinations( bool all );
+	static uint32 getPendingCombinationCount() { return (uint32)_pendingCombs.size(); }
+
+private:
+	// Combination that is compiled in the background, see AsyncShaderCompilation
+	struct PendingCombination
+	{
+		ShaderResource  *shaderRes;
+		uint32          contextIdx;
+		uint32          combMask;
+		bool            assembled;
+		std::string     code[6];  // VS, FS, GS, TSCtl, TSEval, CS; empty if stage is not used
+	};
 
 private:
 	bool raiseError( const std::string &msg, int line = -1 );
@@ -269,12 +303,20 @@ private:
 
 	bool parseFXSectionContext( Tokenizer &tok, const char * identifier, int targetRenderBackend );
 
+	void assembleCombination( const ShaderContext &context, uint32 combMask, std::string *code ) const;
 	bool compileCombination( ShaderContext &context, ShaderCombination &sc );
+	bool compileCombination( ShaderContext &context, ShaderCombination &sc, const std::string *code );
+	bool queueCombination( ShaderContext &context, uint32 combMask );
+	void removePendingCombinations( int contextIdx );
+	static void assemblePendingFunc( void *userData, uint32 begin, uint32 end );
 	
 private:
 	static std::string            _vertPreamble, _fragPreamble, _geomPreamble, _tessCtlPreamble, _tessEvalPreamble, _computePreamble;
 	static std::string            _tmpCodeVS, _tmpCodeFS, _tmpCodeGS, _tmpCodeCS, _tmpCodeTSCtl, _tmpCodeTSEval;
 	static bool					  _defaultPreambleSet;
+	static NameIdRegistry         _contextNames;
+	static uint32                 _layoutStampCounter;
+	static std::vector< PendingCombination >  _pendingCombs;
 
 	std::vector< ShaderContext >  _contexts;
 	std::vector< ShaderSampler >  _samplers;
@@ -282,8 +324,10 @@ private:
 	std::vector< ShaderBuffer >   _buffers;
 	std::vector< CodeResource >   _codeSections;
 	std::set< uint32 >            _preLoadList;
+	uint32                        _layoutStamp;  // Changes whenever samplers, uniforms or buffers may change
 
 	friend class Renderer;
+	friend class MaterialResource;
 };
 
 typedef SmartResPtr< ShaderResource > PShaderResource;
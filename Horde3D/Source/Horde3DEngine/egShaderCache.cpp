@@ -0,0 +1,347 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2016 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+#include "egShaderCache.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include "utDebug.h"
+
+
+namespace Horde3D {
+
+using namespace std;
+
+// Entry files start with a header that is checked before the binary is handed to the device:
+// magic, version, hash, binary format, binary size, binary checksum
+static const char ShaderCacheEntryMagic[4] = { 'H', '3', 'D', 'S' };
+static const char ShaderCacheIndexMagic[4] = { 'H', '3', 'D', 'I' };
+static const uint32 ShaderCacheVersion = 1;
+static const uint32 ShaderCacheHeaderSize = 28;
+static const uint32 ShaderCacheIndexHeaderSize = 16;
+static const uint32 ShaderCacheIndexEntrySize = 16;
+
+
+static void hashBytes( uint64 &hash, const void *data, size_t size )
+{
+	// FNV-1a
+	const uint8 *bytes = (const uint8 *)data;
+	for( size_t i = 0; i < size; ++i )
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+}
+
+
+static uint32 calcChecksum( const uint8 *data, uint32 size )
+{
+	uint32 checksum = 2166136261u;
+	for( uint32 i = 0; i < size; ++i )
+	{
+		checksum ^= data[i];
+		checksum *= 16777619u;
+	}
+
+	return checksum;
+}
+
+
+template< typename T > static void writeValue( ostream &stream, const T &value )
+{
+	stream.write( (const char *)&value, sizeof( T ) );
+}
+
+
+template< typename T > static bool readValue( istream &stream, T &value )
+{
+	stream.read( (char *)&value, sizeof( T ) );
+	return stream.good();
+}
+
+
+ShaderCache::ShaderCache() :
+	_maxSize( 0 ), _size( 0 ), _useCounter( 0 ), _indexChanged( false )
+{
+}
+
+
+ShaderCache::~ShaderCache()
+{
+	close();
+}
+
+
+bool ShaderCache::open( const string &path, uint32 maxSize )
+{
+	close();
+
+	_path = path;
+	if( _path.empty() || (_path[_path.length() - 1] != '/' && _path[_path.length() - 1] != '\\') )
+		_path += "/";
+	_maxSize = maxSize;
+
+	// A missing or outdated index starts an empty cache; files of unknown entries get overwritten
+	if( !readIndex() )
+	{
+		_entries.clear();
+		_size = 0;
+		_useCounter = 0;
+	}
+
+	evict( _maxSize );
+
+	// Make sure that the directory is writable
+	if( !writeIndex() )
+	{
+		_path.clear();
+		_entries.clear();
+		_size = 0;
+		return false;
+	}
+
+	return true;
+}
+
+
+void ShaderCache::close()
+{
+	if( !isOpen() ) return;
+
+	if( _indexChanged ) writeIndex();
+
+	_path.clear();
+	_entries.clear();
+	_size = 0;
+	_useCounter = 0;
+}
+
+
+uint64 ShaderCache::calcHash( const char *const *sources, uint32 count, const string &deviceId )
+{
+	uint64 hash = 14695981039346656037ull;
+
+	hashBytes( hash, deviceId.c_str(), deviceId.length() + 1 );
+	for( uint32 i = 0; i < count; ++i )
+	{
+		// Distinguish missing stages from empty ones
+		uint8 available = sources[i] != 0x0 ? 1 : 0;
+		hashBytes( hash, &available, 1 );
+		if( available ) hashBytes( hash, sources[i], strlen( sources[i] ) + 1 );
+	}
+
+	return hash;
+}
+
+
+ShaderCacheResults::List ShaderCache::load( uint64 hash, uint32 &format, vector< uint8 > &data )
+{
+	int index = findEntry( hash );
+	if( index < 0 ) return ShaderCacheResults::Skipped;
+
+	ifstream inf( getEntryFileName( hash ).c_str(), ios::binary );
+
+	char magic[4];
+	uint32 version = 0, dataSize = 0, checksum = 0;
+	uint64 fileHash = 0;
+	bool valid = inf.good();
+
+	if( valid )
+	{
+		inf.read( magic, 4 );
+		valid = readValue( inf, version ) && readValue( inf, fileHash ) && readValue( inf, format ) &&
+		        readValue( inf, dataSize ) && readValue( inf, checksum );
+		valid = valid && memcmp( magic, ShaderCacheEntryMagic, 4 ) == 0 && version == ShaderCacheVersion &&
+		        fileHash == hash && dataSize > 0 && dataSize + ShaderCacheHeaderSize == _entries[index].size;
+	}
+	if( valid )
+	{
+		data.resize( dataSize );
+		inf.read( (char *)&data[0], dataSize );
+		valid = inf.good() && calcChecksum( &data[0], dataSize ) == checksum;
+	}
+	inf.close();
+
+	if( !valid )
+	{
+		removeEntry( (uint32)index );
+		writeIndex();
+		return ShaderCacheResults::Failed;
+	}
+
+	_entries[index].lastUse = ++_useCounter;
+	_indexChanged = true;
+
+	return ShaderCacheResults::Ok;
+}
+
+
+ShaderCacheResults::List ShaderCache::store( uint64 hash, uint32 format, const uint8 *data, uint32 size )
+{
+	uint32 fileSize = size + ShaderCacheHeaderSize;
+	if( size == 0 || size > _maxSize || _maxSize - size < ShaderCacheHeaderSize )
+		return ShaderCacheResults::Skipped;
+
+	int index = findEntry( hash );
+	if( index >= 0 ) removeEntry( (uint32)index );
+	evict( _maxSize - fileSize );
+
+	ofstream outf( getEntryFileName( hash ).c_str(), ios::binary | ios::trunc );
+	if( outf.good() )
+	{
+		outf.write( ShaderCacheEntryMagic, 4 );
+		writeValue( outf, ShaderCacheVersion );
+		writeValue( outf, hash );
+		writeValue( outf, format );
+		writeValue( outf, size );
+		writeValue( outf, calcChecksum( data, size ) );
+		outf.write( (const char *)data, size );
+	}
+	if( !outf.good() )
+	{
+		outf.close();
+		remove( getEntryFileName( hash ).c_str() );
+		return ShaderCacheResults::Failed;
+	}
+	outf.close();
+
+	ShaderCacheEntry entry;
+	entry.hash = hash;
+	entry.size = fileSize;
+	entry.lastUse = ++_useCounter;
+	_entries.push_back( entry );
+	_size += fileSize;
+
+	writeIndex();
+
+	return ShaderCacheResults::Ok;
+}
+
+
+void ShaderCache::invalidate( uint64 hash )
+{
+	int index = findEntry( hash );
+	if( index < 0 ) return;
+
+	removeEntry( (uint32)index );
+	writeIndex();
+}
+
+
+string ShaderCache::getEntryFileName( uint64 hash ) const
+{
+	char name[32];
+	sprintf( name, "%08x%08x.shb", (uint32)(hash >> 32), (uint32)hash );
+
+	return _path + name;
+}
+
+
+int ShaderCache::findEntry( uint64 hash ) const
+{
+	for( size_t i = 0, s = _entries.size(); i < s; ++i )
+	{
+		if( _entries[i].hash == hash ) return (int)i;
+	}
+
+	return -1;
+}
+
+
+void ShaderCache::removeEntry( uint32 index )
+{
+	remove( getEntryFileName( _entries[index].hash ).c_str() );
+
+	_size -= _entries[index].size;
+	_entries.erase( _entries.begin() + index );
+	_indexChanged = true;
+}
+
+
+void ShaderCache::evict( uint32 maxSize )
+{
+	// Remove least recently used entries
+	while( _size > maxSize && !_entries.empty() )
+	{
+		uint32 lruIndex = 0;
+		for( uint32 i = 1; i < (uint32)_entries.size(); ++i )
+		{
+			if( _entries[i].lastUse < _entries[lruIndex].lastUse ) lruIndex = i;
+		}
+
+		removeEntry( lruIndex );
+	}
+}
+
+
+bool ShaderCache::readIndex()
+{
+	ifstream inf( (_path + "index.bin").c_str(), ios::binary | ios::ate );
+	if( !inf.good() ) return false;
+
+	streamoff fileSize = inf.tellg();
+	inf.seekg( 0 );
+
+	char magic[4];
+	uint32 version = 0, count = 0;
+
+	inf.read( magic, 4 );
+	if( !readValue( inf, version ) || !readValue( inf, _useCounter ) || !readValue( inf, count ) ||
+	    memcmp( magic, ShaderCacheIndexMagic, 4 ) != 0 || version != ShaderCacheVersion )
+	{
+		return false;
+	}
+	
+	// The count is checked against the file size before it is used to allocate the entries
+	if( fileSize < ShaderCacheIndexHeaderSize ||
+	    (uint64)(fileSize - ShaderCacheIndexHeaderSize) / ShaderCacheIndexEntrySize < count )
+	{
+		return false;
+	}
+
+	_entries.resize( count );
+	_size = 0;
+	for( uint32 i = 0; i < count; ++i )
+	{
+		ShaderCacheEntry &entry = _entries[i];
+		if( !readValue( inf, entry.hash ) || !readValue( inf, entry.size ) || !readValue( inf, entry.lastUse ) )
+			return false;
+
+		_size += entry.size;
+	}
+
+	return true;
+}
+
+
+bool ShaderCache::writeIndex()
+{
+	ofstream outf( (_path + "index.bin").c_str(), ios::binary | ios::trunc );
+	if( !outf.good() ) return false;
+
+	outf.write( ShaderCacheIndexMagic, 4 );
+	writeValue( outf, ShaderCacheVersion );
+	writeValue( outf, _useCounter );
+	writeValue( outf, (uint32)_entries.size() );
+	for( size_t i = 0; i < _entries.size(); ++i )
+	{
+		writeValue( outf, _entries[i].hash );
+		writeValue( outf, _entries[i].size );
+		writeValue( outf, _entries[i].lastUse );
+	}
+
+	_indexChanged = !outf.good();
+	return outf.good();
+}
+
+}  // namespace
@@ -0,0 +1,91 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2016 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+#ifndef _egShaderCache_H_
+#define _egShaderCache_H_
+
+#include "egPrerequisites.h"
+#include <string>
+#include <vector>
+
+
+namespace Horde3D {
+
+// =================================================================================================
+// Shader Cache
+// =================================================================================================
+
+// Keeps program binaries of compiled shaders in a directory, so that they do not need to be
+// compiled again when the application is started the next time. Entries are identified by a hash
+// of the complete shader code and the render device, so changed code or a different driver never
+// hit an outdated entry. The cache does not depend on a render device and only stores the data
+// that is returned by RenderDeviceInterface::getShaderBinary. It does not use the engine modules
+// either, problems are reported to the caller, which is responsible for logging them.
+
+struct ShaderCacheResults
+{
+	enum List
+	{
+		Ok,
+		Skipped,  // Entry not found or binary too large for the cache
+		Failed    // Corrupt entry was discarded or entry could not be written
+	};
+};
+
+struct ShaderCacheEntry
+{
+	uint64  hash;
+	uint32  size;     // Size of entry file in bytes
+	uint32  lastUse;  // Use counter when entry was last loaded or stored
+};
+
+// -------------------------------------------------------------------------------------------------
+
+class ShaderCache
+{
+public:
+	ShaderCache();
+	~ShaderCache();
+
+	bool open( const std::string &path, uint32 maxSize );
+	void close();
+	bool isOpen() const { return !_path.empty(); }
+
+	static uint64 calcHash( const char *const *sources, uint32 count, const std::string &deviceId );
+
+	ShaderCacheResults::List load( uint64 hash, uint32 &format, std::vector< uint8 > &data );
+	ShaderCacheResults::List store( uint64 hash, uint32 format, const uint8 *data, uint32 size );
+	void invalidate( uint64 hash );
+
+	std::string getEntryFileName( uint64 hash ) const;
+
+	const std::string &getPath() const { return _path; }
+	uint32 getEntryCount() const { return (uint32)_entries.size(); }
+	uint32 getSize() const { return _size; }
+
+protected:
+	int findEntry( uint64 hash ) const;
+	void removeEntry( uint32 index );
+	void evict( uint32 maxSize );
+	bool readIndex();
+	bool writeIndex();
+
+protected:
+	std::string                      _path;  // Empty if cache is closed
+	std::vector< ShaderCacheEntry >  _entries;
+	uint32                           _maxSize, _size;  // In bytes
+	uint32                           _useCounter;
+	bool                             _indexChanged;
+};
+
+}
+#endif // _egShaderCache_H_
@@ -16,6 +16,7 @@
 #include "egCom.h"
 #include "egRenderer.h"
 #include "utImage.h"
+#include <algorithm>
 #include <cstring>
 
 #include "utDebug.h"
@@ -44,6 +45,28 @@ using namespace std;
 #define D3DFMT_A16B16G16R16F  113
 #define D3DFMT_A32B32G32R32F  116
 
+#define DXGI_FORMAT_R32G32B32A32_FLOAT    2
+#define DXGI_FORMAT_R16G16B16A16_FLOAT    10
+#define DXGI_FORMAT_R8G8B8A8_UNORM        28
+#define DXGI_FORMAT_R8G8B8A8_UNORM_SRGB   29
+#define DXGI_FORMAT_BC1_UNORM             71
+#define DXGI_FORMAT_BC1_UNORM_SRGB        72
+#define DXGI_FORMAT_BC2_UNORM             74
+#define DXGI_FORMAT_BC2_UNORM_SRGB        75
+#define DXGI_FORMAT_BC3_UNORM             77
+#define DXGI_FORMAT_BC3_UNORM_SRGB        78
+#define DXGI_FORMAT_BC4_UNORM             80
+#define DXGI_FORMAT_BC5_UNORM             83
+#define DXGI_FORMAT_B8G8R8A8_UNORM        87
+#define DXGI_FORMAT_B8G8R8X8_UNORM        88
+#define DXGI_FORMAT_B8G8R8A8_UNORM_SRGB   91
+#define DXGI_FORMAT_B8G8R8X8_UNORM_SRGB   93
+#define DXGI_FORMAT_BC7_UNORM             98
+#define DXGI_FORMAT_BC7_UNORM_SRGB        99
+
+#define D3D10_RESOURCE_DIMENSION_TEXTURE3D  4
+#define D3D10_RESOURCE_MISC_TEXTURECUBE     0x4
+
 
 struct DDSHeader
 {
@@ -72,8 +95,33 @@ struct DDSHeader
 } ddsHeader;
 
 
+// Extended header that follows the DDS header if the FourCC is 'DX10'
+struct DDSHeaderDX10
+{
+	uint32  dxgiFormat;
+	uint32  resourceDimension;
+	uint32  miscFlag;
+	uint32  arraySize;
+	uint32  miscFlags2;
+};
+
+
+// Header of images that were already decoded by decodeData, followed by the pixel data
+struct DecodedImageHeader
+{
+	int32   width, height;
+	uint32  hdr;
+};
+
+
+static const int StreamedBaseSize = 64;  // Mips up to this size are uploaded when loading a streamed texture
+static const size_t StreamedUploadLimit = 8 * 1024 * 1024;  // Bytes streamed in per frame at most
+
+
 unsigned char *TextureResource::mappedData = 0x0;
 int TextureResource::mappedWriteImage = -1;
+vector< TextureResource * > TextureResource::_streamedTextures;
+size_t TextureResource::_streamedMemSize = 0;
 uint32 TextureResource::defTex2DObject = 0;
 uint32 TextureResource::defTex3DObject = 0;
 uint32 TextureResource::defTexCubeObject = 0;
@@ -133,7 +181,8 @@ TextureResource::TextureResource( const string &name, int flags ) :
 TextureResource::TextureResource( const string &name, uint32 width, uint32 height, uint32 depth,
                                   TextureFormats::List fmt, int flags ) :
 	Resource( ResourceTypes::Texture, name, flags ),
-	_width( width ), _height( height ), _depth( depth ), _rbObj( 0 )
+	_width( width ), _height( height ), _depth( depth ), _rbObj( 0 ), _streamTopMip( 0 ), _streamBaseMip( 0 ),
+	_streamRequest( 0 ), _streamLastUse( 0 ), _streamMemSize( 0 )
 {	
 	_loaded = true;
 	_texFormat = fmt;
@@ -186,6 +235,9 @@ void TextureResource::initDefault()
 	_width = 0; _height = 0; _depth = 0;
 	_sRGB = false;
 	_hasMipMaps = true;
+	_streamTopMip = 0; _streamBaseMip = 0;
+	_streamRequest = 0; _streamLastUse = 0;
+	_streamMemSize = 0;
 	
 	if( _texType == TextureTypes::TexCube )
 		_texObject = defTexCubeObject;
@@ -200,6 +252,8 @@ void TextureResource::release()
 {
 	RenderDeviceInterface *rdi = Modules::renderer().getRenderDevice();
 
+	if( isStreamed() ) stopStreaming( false );
+
 	if( _rbObj != 0 )
 	{
 		// In this case _texObject is just points to the render buffer
@@ -226,7 +280,7 @@ bool TextureResource::raiseError( const string &msg )
 }
 
 
-bool TextureResource::checkDDS( const char *data, int size ) const
+bool TextureResource::checkDDS( const char *data, int size )
 {
     return size > 128 && *((uint32 *)data) == FOURCC( 'D', 'D', 'S', ' ' );
 }
@@ -278,7 +332,7 @@ bool TextureResource::loadDDS( const char *data, int size )
 	}
 	
 	// Get pixel format
-	int blockSize = 1, bytesPerBlock = 4;
+	int blockSize = 1, bytesPerBlock = 4, dataOffset = 128;
 	enum { pfBGRA, pfBGR, pfBGRX, pfRGB, pfRGBX, pfRGBA } pixFmt = pfBGRA;
 	
 	if( ddsHeader.pixFormat.dwFlags & DDPF_FOURCC )
@@ -297,6 +351,97 @@ bool TextureResource::loadDDS( const char *data, int size )
 			_texFormat = TextureFormats::DXT5;
 			blockSize = 4; bytesPerBlock = 16;
 			break;
+		case FOURCC( 'A', 'T', 'I', '1' ):
+		case FOURCC( 'B', 'C', '4', 'U' ):
+			_texFormat = TextureFormats::BC4;
+			blockSize = 4; bytesPerBlock = 8;
+			break;
+		case FOURCC( 'A', 'T', 'I', '2' ):
+		case FOURCC( 'B', 'C', '5', 'U' ):
+			_texFormat = TextureFormats::BC5;
+			blockSize = 4; bytesPerBlock = 16;
+			break;
+		case FOURCC( 'D', 'X', '1', '0' ):
+		{
+			if( size < 128 + (int)sizeof( DDSHeaderDX10 ) )
+				return raiseError( "Invalid DDS header" );
+			
+			DDSHeaderDX10 dx10Header;
+			elemcpy_le( (uint32 *)&dx10Header, (uint32 *)(data + 128), sizeof( DDSHeaderDX10 ) / sizeof( uint32 ) );
+			dataOffset += sizeof( DDSHeaderDX10 );
+
+			if( dx10Header.arraySize > 1 )
+				return raiseError( "DDS texture arrays are not supported" );
+			if( dx10Header.miscFlag & D3D10_RESOURCE_MISC_TEXTURECUBE )
+				_texType = TextureTypes::TexCube;
+			else if( dx10Header.resourceDimension == D3D10_RESOURCE_DIMENSION_TEXTURE3D )
+			{
+				_depth = std::max( ddsHeader.dwDepth, 1u );
+				_texType = TextureTypes::Tex3D;
+			}
+
+			switch( dx10Header.dxgiFormat )
+			{
+			case DXGI_FORMAT_BC1_UNORM_SRGB:
+				_sRGB = true;
+			case DXGI_FORMAT_BC1_UNORM:
+				_texFormat = TextureFormats::DXT1;
+				blockSize = 4; bytesPerBlock = 8;
+				break;
+			case DXGI_FORMAT_BC2_UNORM_SRGB:
+				_sRGB = true;
+			case DXGI_FORMAT_BC2_UNORM:
+				_texFormat = TextureFormats::DXT3;
+				blockSize = 4; bytesPerBlock = 16;
+				break;
+			case DXGI_FORMAT_BC3_UNORM_SRGB:
+				_sRGB = true;
+			case DXGI_FORMAT_BC3_UNORM:
+				_texFormat = TextureFormats::DXT5;
+				blockSize = 4; bytesPerBlock = 16;
+				break;
+			case DXGI_FORMAT_BC4_UNORM:
+				_texFormat = TextureFormats::BC4;
+				blockSize = 4; bytesPerBlock = 8;
+				break;
+			case DXGI_FORMAT_BC5_UNORM:
+				_texFormat = TextureFormats::BC5;
+				blockSize = 4; bytesPerBlock = 16;
+				break;
+			case DXGI_FORMAT_BC7_UNORM_SRGB:
+				_sRGB = true;
+			case DXGI_FORMAT_BC7_UNORM:
+				_texFormat = TextureFormats::BC7;
+				blockSize = 4; bytesPerBlock = 16;
+				break;
+			case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+				_sRGB = true;
+			case DXGI_FORMAT_R8G8B8A8_UNORM:
+				_texFormat = TextureFormats::BGRA8;
+				pixFmt = pfRGBA;
+				break;
+			case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+				_sRGB = true;
+			case DXGI_FORMAT_B8G8R8A8_UNORM:
+				_texFormat = TextureFormats::BGRA8;
+				break;
+			case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+				_sRGB = true;
+			case DXGI_FORMAT_B8G8R8X8_UNORM:
+				_texFormat = TextureFormats::BGRA8;
+				pixFmt = pfBGRX;
+				break;
+			case DXGI_FORMAT_R16G16B16A16_FLOAT:
+				_texFormat = TextureFormats::RGBA16F;
+				bytesPerBlock = 8;
+				break;
+			case DXGI_FORMAT_R32G32B32A32_FLOAT:
+				_texFormat = TextureFormats::RGBA32F;
+				bytesPerBlock = 16;
+				break;
+			}
+			break;
+		}
 		case D3DFMT_A16B16G16R16F: 
 			_texFormat = TextureFormats::RGBA16F;
 			bytesPerBlock = 8;
@@ -347,13 +492,25 @@ bool TextureResource::loadDDS( const char *data, int size )
 
 	RenderDeviceInterface *rdi = Modules::renderer().getRenderDevice();
 
-	// Create texture
+	if( (_texFormat == TextureFormats::BC4 || _texFormat == TextureFormats::BC5) && !rdi->getCaps().texRGTC )
+		return raiseError( "BC4 and BC5 textures are not supported by GPU" );
+	if( _texFormat == TextureFormats::BC7 && !rdi->getCaps().texBPTC )
+		return raiseError( "BC7 textures are not supported by GPU" );
+
+	// Large 2D textures with mips are streamed: only the small mips are uploaded now, the others are
+	// kept in main memory and uploaded when they are needed for rendering
+	bool streamed = Modules::config().texStreamingBudget > 0 && _texType == TextureTypes::Tex2D &&
+	                mipCount > 1 && std::max( _width, _height ) > StreamedBaseSize &&
+	                !(_flags & ResourceFlags::TexNoStreaming);
+
+	// Create texture; streamed textures get their mips uploaded later
 	_texObject = rdi->createTexture( _texType, _width, _height, _depth, _texFormat,
 	                                  mipCount > 1, false, false, _sRGB );
+	if( streamed ) _streamData.reserve( size - dataOffset );
 	
 	// Upload texture subresources
 	int numSlices = _texType == TextureTypes::TexCube ? 6 : 1;
-	unsigned char *pixels = (unsigned char *)(data + 128);
+	unsigned char *pixels = (unsigned char *)(data + dataOffset);
 
 	for( int i = 0; i < numSlices; ++i )
 	{
@@ -362,12 +519,16 @@ bool TextureResource::loadDDS( const char *data, int size )
 
 		for( int j = 0; j < mipCount; ++j )
 		{
-			size_t mipSize = std::max( width / blockSize, 1 ) * std::max( height / blockSize, 1 ) *
+			// Partial blocks at the border of compressed images are stored as whole blocks
+			size_t mipSize = ((width + blockSize - 1) / blockSize) * ((height + blockSize - 1) / blockSize) *
 			                 depth * bytesPerBlock;
 			
 			if( pixels + mipSize > (unsigned char *)data + size )
 				return raiseError( "Corrupt DDS" );
 
+			const unsigned char *uploadData = pixels;
+			size_t uploadSize = mipSize;
+
 			if( _texFormat == TextureFormats::BGRA8 && pixFmt != pfBGRA )
 			{
 				// Convert 8 bit DDS formats to BGRA
@@ -391,12 +552,19 @@ bool TextureResource::loadDDS( const char *data, int size )
 					for( uint32 k = 0; k < pixCount * 4; k += 4 )
 						*p++ = pixels[k+2] | pixels[k+1]<<8 | pixels[k+0]<<16 | pixels[k+3]<<24;
 				
-				rdi->uploadTextureData( _texObject, i, j, dstBuf );
+				uploadData = (unsigned char *)dstBuf;
+				uploadSize = pixCount * 4;
+			}
+
+			if( streamed )
+			{
+				StreamedMip mip = { _streamData.size(), uploadSize };
+				_streamMips.push_back( mip );
+				_streamData.insert( _streamData.end(), uploadData, uploadData + uploadSize );
 			}
 			else
 			{
-				// Upload DDS data directly
-				rdi->uploadTextureData( _texObject, i, j, pixels );
+				rdi->uploadTextureData( _texObject, i, j, uploadData );
 			}
 
 			pixels += mipSize;
@@ -410,33 +578,84 @@ bool TextureResource::loadDDS( const char *data, int size )
 
 	ASSERT( pixels == (unsigned char *)data + size );
 
+	if( streamed )
+	{
+		int maxSize = std::max( _width, _height );
+		while( _streamBaseMip + 1 < mipCount && (maxSize >> _streamBaseMip) > StreamedBaseSize ) ++_streamBaseMip;
+		
+		_streamedTextures.push_back( this );
+		_streamLastUse = Modules::renderer().getFrameID();
+		_streamTopMip = mipCount;  // No mips are resident yet
+		uploadStreamedMips( _streamBaseMip );
+	}
+
 	return true;
 }
 
 
-bool TextureResource::loadSTBI( const char *data, int size )
+void *TextureResource::decodeSTBI( const char *data, int size, int &width, int &height, bool &hdr )
 {
-	bool hdr = false;
+	// Does not touch any engine state and can be called from any thread
+	hdr = false;
 	if( stbi_is_hdr_from_memory( (unsigned char *)data, size ) > 0 ) hdr = true;
 	
 	int comps;
 	void *pixels = 0x0;
 	if( hdr )
-		pixels = stbi_loadf_from_memory( (unsigned char *)data, size, &_width, &_height, &comps, 4 );
+		pixels = stbi_loadf_from_memory( (unsigned char *)data, size, &width, &height, &comps, 4 );
 	else
-		pixels = stbi_load_from_memory( (unsigned char *)data, size, &_width, &_height, &comps, 4 );
+		pixels = stbi_load_from_memory( (unsigned char *)data, size, &width, &height, &comps, 4 );
 
-	if( pixels == 0x0 )
-		return raiseError( "Invalid image format (" + string( stbi_failure_reason() ) + ")" );
+	if( pixels == 0x0 ) return 0x0;
 
 	// Swizzle RGBA -> BGRA
 	uint32 *ptr = (uint32 *)pixels;
-	for( uint32 i = 0, si = _width * _height; i < si; ++i )
+	for( uint32 i = 0, si = width * height; i < si; ++i )
 	{
 		uint32 col = *ptr;
 		*ptr++ = (col & 0xFF00FF00) | ((col & 0x000000FF) << 16) | ((col & 0x00FF0000) >> 16);
 	}
+
+	return pixels;
+}
+
+
+bool TextureResource::loadSTBI( const char *data, int size )
+{
+	bool hdr;
+	void *pixels = decodeSTBI( data, size, _width, _height, hdr );
+
+	if( pixels == 0x0 )
+		return raiseError( "Invalid image format (" + string( stbi_failure_reason() ) + ")" );
+
+	bool result = uploadImage( pixels, hdr );
+	stbi_image_free( pixels );
+
+	return result;
+}
+
+
+bool TextureResource::loadDecoded( const char *data, int size )
+{
+	if( !Resource::load( data, size ) ) return false;
+	if( size < (int)sizeof( DecodedImageHeader ) ) return raiseError( "Corrupt decoded image" );
 	
+	DecodedImageHeader header;
+	memcpy( &header, data, sizeof( DecodedImageHeader ) );
+
+	size_t pixelSize = (size_t)header.width * header.height * (header.hdr ? 16 : 4);
+	if( header.width <= 0 || header.height <= 0 || sizeof( DecodedImageHeader ) + pixelSize > (size_t)size )
+		return raiseError( "Corrupt decoded image" );
+
+	_width = header.width;
+	_height = header.height;
+	
+	return uploadImage( data + sizeof( DecodedImageHeader ), header.hdr != 0 );
+}
+
+
+bool TextureResource::uploadImage( const void *pixels, bool hdr )
+{
 	_depth = 1;
 	_texType = TextureTypes::Tex2D;
 	_texFormat = hdr ? TextureFormats::RGBA16F : TextureFormats::BGRA8;
@@ -450,8 +669,6 @@ bool TextureResource::loadSTBI( const char *data, int size )
 		_hasMipMaps, _hasMipMaps, !(_flags & ResourceFlags::NoTexCompression), _sRGB );
 	rdi->uploadTextureData( _texObject, 0, 0, pixels );
 
-	stbi_image_free( pixels );
-
 	return true;
 }
 
@@ -467,6 +684,34 @@ bool TextureResource::load( const char *data, int size )
 }
 
 
+char *TextureResource::decodeData( const char *data, int size, int &decodedSize )
+{
+	// Runs the CPU heavy image decoding ahead of load, possibly on a worker thread. The result
+	// can be passed to load instead of the original file data.
+	decodedSize = 0;
+	if( data == 0x0 || size <= 0 || checkDDS( data, size ) ) return 0x0;
+
+	int width, height;
+	bool hdr;
+	void *pixels = decodeSTBI( data, size, width, height, hdr );
+	if( pixels == 0x0 ) return 0x0;  // Error will be reported when loading the original data
+
+	DecodedImageHeader header;
+	header.width = width;
+	header.height = height;
+	header.hdr = hdr ? 1 : 0;
+	
+	size_t pixelSize = (size_t)width * height * (hdr ? 16 : 4);
+	char *decoded = new char[sizeof( DecodedImageHeader ) + pixelSize];
+	memcpy( decoded, &header, sizeof( DecodedImageHeader ) );
+	memcpy( decoded + sizeof( DecodedImageHeader ), pixels, pixelSize );
+	stbi_image_free( pixels );
+
+	decodedSize = (int)(sizeof( DecodedImageHeader ) + pixelSize);
+	return decoded;
+}
+
+
 int TextureResource::getMipCount() const
 {
 	if( _hasMipMaps )
@@ -476,6 +721,162 @@ int TextureResource::getMipCount() const
 }
 
 
+int TextureResource::getStreamedMipForSize( float pixels ) const
+{
+	// Smallest mip that still has at least as many texels as the texture covers pixels on screen
+	int mip = 0, maxSize = std::max( _width, _height );
+	while( mip < _streamBaseMip && (float)(maxSize >> (mip + 1)) >= pixels ) ++mip;
+
+	return mip;
+}
+
+
+size_t TextureResource::calcStreamedMemSize( int topMip ) const
+{
+	size_t memSize = 0;
+	for( size_t i = topMip; i < _streamMips.size(); ++i )
+		memSize += _streamMips[i].size;
+
+	return memSize;
+}
+
+
+size_t TextureResource::uploadStreamedMips( int topMip )
+{
+	RenderDeviceInterface *rdi = Modules::renderer().getRenderDevice();
+
+	// The texture object covers the whole mip chain; only the mips that become resident are
+	// uploaded and dropped mips are released by moving the base level
+	size_t uploadSize = 0;
+	for( int i = topMip; i < _streamTopMip; ++i )
+	{
+		rdi->uploadTextureData( _texObject, 0, i, &_streamData[_streamMips[i].offset] );
+		uploadSize += _streamMips[i].size;
+	}
+	rdi->setTextureBaseLevel( _texObject, topMip );
+	_streamTopMip = topMip;
+
+	size_t memSize = calcStreamedMemSize( topMip );
+	_streamedMemSize = _streamedMemSize - _streamMemSize + memSize;
+	_streamMemSize = memSize;
+	Modules::stats().incStat( EngineStats::StreamedTextureUploadSize, (float)uploadSize );
+	
+	return uploadSize;
+}
+
+
+void TextureResource::stopStreaming( bool uploadAllMips )
+{
+	if( uploadAllMips && _streamTopMip > 0 ) uploadStreamedMips( 0 );
+
+	_streamedMemSize -= _streamMemSize;
+
+	// A DDS that turns out to be corrupt while its mips are collected has stream data but
+	// was never registered
+	vector< TextureResource * >::iterator itr =
+		std::find( _streamedTextures.begin(), _streamedTextures.end(), this );
+	if( itr != _streamedTextures.end() ) _streamedTextures.erase( itr );
+
+	vector< unsigned char >().swap( _streamData );
+	_streamMips.clear();
+	_streamTopMip = 0; _streamBaseMip = 0;
+	_streamMemSize = 0;
+}
+
+
+bool TextureResource::evictStreamedMips( size_t targetSize, uint32 frameID, size_t &nextIndex )
+{
+	// Textures are sorted by last use; the ones used in the current frame only lose the mips that are
+	// larger than requested
+	while( _streamedMemSize > targetSize && nextIndex < _streamedTextures.size() )
+	{
+		TextureResource *tex = _streamedTextures[nextIndex];
+		if( tex->_streamLastUse == frameID ) break;
+
+		if( tex->_streamTopMip < tex->_streamBaseMip )
+			tex->uploadStreamedMips( tex->_streamBaseMip );
+		++nextIndex;
+	}
+
+	for( size_t i = nextIndex, s = _streamedTextures.size(); i < s && _streamedMemSize > targetSize; ++i )
+	{
+		TextureResource *tex = _streamedTextures[i];
+		int mip = tex->getStreamedMipForSize( tex->_streamRequest );
+		if( mip > tex->_streamTopMip ) tex->uploadStreamedMips( mip );
+	}
+
+	return _streamedMemSize <= targetSize;
+}
+
+
+void TextureResource::updateStreaming()
+{
+	if( _streamedTextures.empty() ) return;
+
+	uint32 frameID = Modules::renderer().getFrameID();
+	size_t budget = (size_t)Modules::config().texStreamingBudget * 1024 * 1024;
+	
+	vector< TextureResource * > requests;
+	for( size_t i = 0, s = _streamedTextures.size(); i < s; ++i )
+	{
+		TextureResource *tex = _streamedTextures[i];
+		if( tex->_streamRequest <= 0 ) continue;
+		
+		tex->_streamLastUse = frameID;
+		if( tex->getStreamedMipForSize( tex->_streamRequest ) < tex->_streamTopMip )
+			requests.push_back( tex );
+	}
+	std::stable_sort( _streamedTextures.begin(), _streamedTextures.end(), StreamedLRUCompFunc() );
+	std::stable_sort( requests.begin(), requests.end(), StreamedRequestCompFunc() );
+	
+	// Get back under budget (it may have been lowered) by evicting unused textures; if that is not
+	// enough, the largest textures in use lose one mip at a time
+	size_t nextEvict = 0;
+	while( !evictStreamedMips( budget, frameID, nextEvict ) )
+	{
+		TextureResource *largest = 0x0;
+		for( size_t i = nextEvict, s = _streamedTextures.size(); i < s; ++i )
+		{
+			TextureResource *tex = _streamedTextures[i];
+			if( tex->_streamTopMip < tex->_streamBaseMip &&
+			    (largest == 0x0 || tex->_streamMemSize > largest->_streamMemSize) )
+				largest = tex;
+		}
+		if( largest == 0x0 ) break;  // Base mips alone exceed budget
+
+		largest->uploadStreamedMips( largest->_streamTopMip + 1 );
+	}
+	
+	// Stream in requested mips; if there is not enough room even after evicting all unused textures,
+	// a smaller mip is used
+	size_t uploadSize = 0;
+	for( size_t i = 0; i < requests.size() && uploadSize < StreamedUploadLimit; ++i )
+	{
+		TextureResource *tex = requests[i];
+		int mip = tex->getStreamedMipForSize( tex->_streamRequest );
+
+		for( ; mip < tex->_streamTopMip; ++mip )
+		{
+			size_t extraSize = tex->calcStreamedMemSize( mip ) - tex->_streamMemSize;
+			if( extraSize <= budget && evictStreamedMips( budget - extraSize, frameID, nextEvict ) ) break;
+		}
+
+		if( mip < tex->_streamTopMip ) uploadSize += tex->uploadStreamedMips( mip );
+	}
+
+	for( size_t i = 0, s = _streamedTextures.size(); i < s; ++i )
+		_streamedTextures[i]->_streamRequest = 0;
+}
+
+
+void TextureResource::finishStreaming()
+{
+	// Uploads all mips of streamed textures and releases their main memory copies
+	while( !_streamedTextures.empty() )
+		_streamedTextures.back()->stopStreaming( true );
+}
+
+
 int TextureResource::getElemCount( int elem ) const
 {
 	switch( elem )
@@ -537,6 +938,9 @@ void *TextureResource::mapStream( int elem, int elemIdx, int stream, bool read,
 		{
 			RenderDeviceInterface *rdi = Modules::renderer().getRenderDevice();
 
+			// Mapped images must match the texture object, so the texture is not streamed anymore
+			if( isStreamed() ) stopStreaming( true );
+
 			mappedData = Modules::renderer().useScratchBuf(
 				rdi->calcTextureSize( _texFormat, _width, _height, _depth ), 16 ); // 16 byte aligned
 			
@@ -59,6 +59,9 @@ public:
 	void initDefault();
 	void release();
 	bool load( const char *data, int size );
+	bool loadDecoded( const char *data, int size );
+
+	static char *decodeData( const char *data, int size, int &decodedSize );
 
 	int getElemCount( int elem ) const;
 	int getElemParamI( int elem, int elemIdx, int param ) const;
@@ -74,6 +77,14 @@ public:
 	uint32 getRBObject() const { return _rbObj; }
 	bool hasMipMaps() const { return _hasMipMaps; }
 
+	// Mip streaming
+	bool isStreamed() const { return !_streamMips.empty(); }
+	void requestStreamedSize( float pixels ) { if( pixels > _streamRequest ) _streamRequest = pixels; }
+	static void updateStreaming();
+	static void finishStreaming();
+	static size_t getStreamedCount() { return _streamedTextures.size(); }
+	static size_t getStreamedMemSize() { return _streamedMemSize; }
+
 public:
 	static uint32 defTex2DObject;
 	static uint32 defTex3DObject;
@@ -81,14 +92,45 @@ public:
 
 protected:
 	bool raiseError( const std::string &msg );
-	bool checkDDS( const char *data, int size ) const;
+	static bool checkDDS( const char *data, int size );
+	static void *decodeSTBI( const char *data, int size, int &width, int &height, bool &hdr );
 	bool loadDDS( const char *data, int size );
 	bool loadSTBI( const char *data, int size );
+	bool uploadImage( const void *pixels, bool hdr );
 	int getMipCount() const;
+
+	int getStreamedMipForSize( float pixels ) const;
+	size_t calcStreamedMemSize( int topMip ) const;
+	size_t uploadStreamedMips( int topMip );  // Returns the number of uploaded bytes
+	void stopStreaming( bool uploadAllMips );
+	static bool evictStreamedMips( size_t targetSize, uint32 frameID, size_t &nextIndex );
 	
 protected:
+	struct StreamedMip
+	{
+		size_t  offset, size;
+	};
+
+	struct StreamedLRUCompFunc  // Functor for std::sort, least recently used textures first
+	{
+		bool operator()( const TextureResource *a, const TextureResource *b ) const
+			{ return a->_streamLastUse < b->_streamLastUse; }
+	};
+
+	struct StreamedRequestCompFunc  // Functor for std::sort, textures missing the most mips first
+	{
+		bool operator()( const TextureResource *a, const TextureResource *b ) const
+		{
+			return a->_streamTopMip - a->getStreamedMipForSize( a->_streamRequest ) >
+			       b->_streamTopMip - b->getStreamedMipForSize( b->_streamRequest );
+		}
+	};
+	
 	static unsigned char  *mappedData;
 	static int            mappedWriteImage;
+
+	static std::vector< TextureResource * >  _streamedTextures;
+	static size_t                            _streamedMemSize;
 	
 	TextureTypes::List    _texType;
 	TextureFormats::List  _texFormat;
@@ -98,6 +140,14 @@ protected:
 	bool                  _sRGB;
 	bool                  _hasMipMaps;
 
+	std::vector< unsigned char >  _streamData;  // Pixels of all mips in upload format
+	std::vector< StreamedMip >    _streamMips;  // Empty if texture is not streamed
+	int                           _streamTopMip;  // Mip that is currently the first one on the GPU
+	int                           _streamBaseMip;  // Mips from here on are always resident
+	float                         _streamRequest;  // Largest screen size in pixels requested in current frame
+	uint32                        _streamLastUse;  // Frame in which texture was last requested
+	size_t                        _streamMemSize;  // Size of resident mips
+
 	friend class ResourceManager;
 };
 
@@ -21,6 +21,8 @@ namespace glExt
 	bool EXT_framebuffer_multisample = false;
 	bool EXT_texture_filter_anisotropic = false;
 	bool EXT_texture_compression_s3tc = false;
+	bool ARB_texture_compression_rgtc = false;
+	bool ARB_texture_compression_bptc = false;
 	bool EXT_texture_sRGB = false;
 	bool ARB_texture_float = false;
 	bool ARB_texture_non_power_of_two = false;
@@ -1243,6 +1245,9 @@ bool initOpenGLExtensions( bool forceLegacyFuncs )
 	glExt::EXT_texture_filter_anisotropic = isExtensionSupported( "GL_EXT_texture_filter_anisotropic" );
 
 	glExt::EXT_texture_compression_s3tc = isExtensionSupported( "GL_EXT_texture_compression_s3tc" ) || isExtensionSupported( "GL_S3_s3tc" );
+	glExt::ARB_texture_compression_rgtc = isExtensionSupported( "GL_ARB_texture_compression_rgtc" ) ||
+		isExtensionSupported( "GL_EXT_texture_compression_rgtc" );
+	glExt::ARB_texture_compression_bptc = isExtensionSupported( "GL_ARB_texture_compression_bptc" );
 
 	return r;
 }
@@ -56,6 +56,8 @@ namespace glExt
 	extern bool EXT_framebuffer_multisample;
 	extern bool EXT_texture_filter_anisotropic;
 	extern bool EXT_texture_compression_s3tc;
+	extern bool ARB_texture_compression_rgtc;
+	extern bool ARB_texture_compression_bptc;
 	extern bool EXT_texture_sRGB;
 	extern bool ARB_texture_float;
 	extern bool ARB_texture_non_power_of_two;
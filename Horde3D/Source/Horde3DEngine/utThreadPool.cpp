@@ -0,0 +1,139 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2016 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+#include "utThreadPool.h"
+#include <algorithm>
+
+#include "utDebug.h"
+
+
+namespace Horde3D {
+
+// *************************************************************************************************
+// Class ThreadPool
+// *************************************************************************************************
+
+ThreadPool::ThreadPool() :
+	_generation( 0 ), _busyWorkers( 0 ), _quit( false ), _jobFunc( 0x0 ), _jobUserData( 0x0 ),
+	_jobCount( 0 ), _jobChunkSize( 1 ), _jobNextIndex( 0 )
+{
+}
+
+
+ThreadPool::~ThreadPool()
+{
+	setNumWorkers( 0 );
+}
+
+
+uint32 ThreadPool::getDefaultNumWorkers()
+{
+	// Calling thread takes part in the work, so one core less is needed
+	uint32 numCores = std::thread::hardware_concurrency();
+	return numCores > 1 ? numCores - 1 : 0;
+}
+
+
+void ThreadPool::setNumWorkers( uint32 numWorkers )
+{
+	if( numWorkers == _workers.size() ) return;
+	
+	// Stop existing workers
+	if( !_workers.empty() )
+	{
+		{
+			std::lock_guard< std::mutex > lock( _mutex );
+			_quit = true;
+		}
+		_wakeCond.notify_all();
+		
+		for( size_t i = 0; i < _workers.size(); ++i ) _workers[i].join();
+		_workers.clear();
+		_quit = false;
+	}
+
+	// Workers get the current generation so that they only pick up jobs issued after their creation
+	for( uint32 i = 0; i < numWorkers; ++i )
+		_workers.push_back( std::thread( &ThreadPool::workerMain, this, _generation ) );
+}
+
+
+void ThreadPool::parallelFor( uint32 count, uint32 minChunkSize, ParallelJobFunc func, void *userData )
+{
+	if( count == 0 ) return;
+	if( minChunkSize == 0 ) minChunkSize = 1;
+
+	// Run small jobs directly
+	if( _workers.empty() || count <= minChunkSize )
+	{
+		func( userData, 0, count );
+		return;
+	}
+
+	// Use a few chunks per thread for load balancing
+	uint32 numThreads = (uint32)_workers.size() + 1;
+	uint32 chunkSize = std::max( minChunkSize, (count + numThreads * 4 - 1) / (numThreads * 4) );
+
+	{
+		std::lock_guard< std::mutex > lock( _mutex );
+		_jobFunc = func;
+		_jobUserData = userData;
+		_jobCount = count;
+		_jobChunkSize = chunkSize;
+		_jobNextIndex.store( 0 );
+		_busyWorkers = (uint32)_workers.size();
+		++_generation;
+	}
+	_wakeCond.notify_all();
+
+	runChunks();
+
+	// Wait until all workers have finished their chunks
+	std::unique_lock< std::mutex > lock( _mutex );
+	while( _busyWorkers > 0 ) _doneCond.wait( lock );
+	_jobFunc = 0x0;
+}
+
+
+void ThreadPool::runChunks()
+{
+	for( ;; )
+	{
+		uint32 begin = _jobNextIndex.fetch_add( _jobChunkSize );
+		if( begin >= _jobCount ) break;
+
+		_jobFunc( _jobUserData, begin, std::min( begin + _jobChunkSize, _jobCount ) );
+	}
+}
+
+
+void ThreadPool::workerMain( uint32 lastGeneration )
+{
+	for( ;; )
+	{
+		{
+			std::unique_lock< std::mutex > lock( _mutex );
+			while( !_quit && _generation == lastGeneration ) _wakeCond.wait( lock );
+			if( _quit ) return;
+			lastGeneration = _generation;
+		}
+
+		runChunks();
+
+		{
+			std::lock_guard< std::mutex > lock( _mutex );
+			if( --_busyWorkers == 0 ) _doneCond.notify_one();
+		}
+	}
+}
+
+}  // namespace
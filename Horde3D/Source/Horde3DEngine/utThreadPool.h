@@ -0,0 +1,68 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2016 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+#ifndef _utThreadPool_H_
+#define _utThreadPool_H_
+
+#include "utPlatform.h"
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+
+namespace Horde3D {
+
+// =================================================================================================
+// Thread Pool
+// =================================================================================================
+
+// Job function processing the index range [begin, end)
+typedef void (*ParallelJobFunc)( void *userData, uint32 begin, uint32 end );
+
+class ThreadPool
+{
+public:
+	ThreadPool();
+	~ThreadPool();
+
+	void setNumWorkers( uint32 numWorkers );
+	uint32 getNumWorkers() const { return (uint32)_workers.size(); }
+	
+	// Splits [0, count) into chunks of at least minChunkSize indices and processes them on the
+	// workers and the calling thread; returns when all chunks are done. Not reentrant.
+	void parallelFor( uint32 count, uint32 minChunkSize, ParallelJobFunc func, void *userData );
+
+	static uint32 getDefaultNumWorkers();
+
+protected:
+	void workerMain( uint32 lastGeneration );
+	void runChunks();
+
+protected:
+	std::vector< std::thread >  _workers;
+	std::mutex                  _mutex;
+	std::condition_variable     _wakeCond, _doneCond;
+	uint32                      _generation;
+	uint32                      _busyWorkers;
+	bool                        _quit;
+
+	// Current job
+	ParallelJobFunc             _jobFunc;
+	void                        *_jobUserData;
+	uint32                      _jobCount, _jobChunkSize;
+	std::atomic< uint32 >       _jobNextIndex;
+};
+
+}
+#endif // _utThreadPool_H_
@@ -22,8 +22,14 @@
 #		define NOMINMAX
 #	endif
 #	include <windows.h>
+#else
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <fcntl.h>
+#	include <unistd.h>
 #endif
 #include <cstdlib>
+#include <climits>
 #include <cstring>
 #include <string>
 #include <sstream>
@@ -31,6 +37,12 @@
 #include <map>
 #include <fstream>
 #include <iomanip>
+#include <deque>
+#include <set>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
 
 using namespace Horde3D;
 using namespace std;
@@ -78,33 +90,9 @@ string cleanPath( string path )
 	return path;
 }
 
-}  // namespace
-
-
-// =================================================================================================
-// Exported API functions
-// =================================================================================================
-
-using namespace Horde3DUtils;
-
 
-DLLEXP const char *h3dutGetResourcePath( int type )
+vector< string > splitContentDirs( const char *contentDir )
 {
-	return resourcePaths[type].c_str();
-}
-
-
-DLLEXP void h3dutSetResourcePath( int type, const char *path )
-{
-	string s = path != 0x0 ? path : "";
-
-	resourcePaths[type] = cleanPath( s );
-}
-
-
-DLLEXP bool h3dutLoadResourcesFromDisk( const char *contentDir )
-{
-	bool result = true;
 	string dir;
 	vector< string > dirs;
 
@@ -122,63 +110,354 @@ DLLEXP bool h3dutLoadResourcesFromDisk( const char *contentDir )
 			dir = "";
 		}
 	} while( *c++ != '\0' );
+
+	return dirs;
+}
+
+
+// =================================================================================================
+// Asynchronous resource loading
+// =================================================================================================
+
+// Worker threads read the resource files and run the engine's thread-safe decoding step on them.
+// All other engine calls are made on the thread that updates the loader.
+
+struct AsyncLoadItem
+{
+	H3DRes  res;
+	int     type;
+	string  fileName;  // Relative to the content directories
+	char    *data;
+	int     size;
+	bool    found, decoded, mapped;
+
+	AsyncLoadItem() : res( 0 ), type( 0 ), data( 0x0 ), size( 0 ), found( false ), decoded( false ), mapped( false ) {}
+};
+
+struct AsyncLoader
+{
+	vector< string >          dirs;
+	vector< thread >          workers;
+	deque< AsyncLoadItem * >  pending, finished;
+	set< H3DRes >             queued;  // Only accessed by the updating thread
+	mutex                     mtx;
+	condition_variable        workCond, finishCond;
+	bool                      quit;
+
+	AsyncLoader() : quit( false ) {}
+};
+
+struct AsyncLoadStats
+{
+	int  numLoaded, numTotal, numFailed;
+
+	AsyncLoadStats() : numLoaded( 0 ), numTotal( 0 ), numFailed( 0 ) {}
+};
+
+AsyncLoader     *asyncLoader = 0x0;
+AsyncLoadStats  asyncStats;
+
+
+bool mapResourceFile( const string &fileName, AsyncLoadItem &item )
+{
+	// Returns false if the file could not be mapped; the caller falls back to reading it
+	size_t fileSize = 0;
+	void *view = 0x0;
 	
-	// Get the first resource that needs to be loaded
-	int res = h3dQueryUnloadedResource( 0 );
+#if defined( PLATFORM_WIN ) || defined( __MINGW32__ )
+	HANDLE file = CreateFileA( fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, 0x0, OPEN_EXISTING,
+	                           FILE_FLAG_SEQUENTIAL_SCAN, 0x0 );
+	if( file == INVALID_HANDLE_VALUE ) return false;
 	
-	char *dataBuf = 0;
-	size_t bufSize = 0;
+	LARGE_INTEGER size;
+	if( !GetFileSizeEx( file, &size ) || size.QuadPart == 0 || size.QuadPart > INT_MAX )
+	{
+		CloseHandle( file );
+		return false;
+	}
+	fileSize = (size_t)size.QuadPart;
+
+	HANDLE mapping = CreateFileMappingA( file, 0x0, PAGE_READONLY, 0, 0, 0x0 );
+	CloseHandle( file );
+	if( mapping == 0x0 ) return false;
+	
+	view = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+	CloseHandle( mapping );
+	if( view == 0x0 ) return false;
+#else
+	int fd = open( fileName.c_str(), O_RDONLY );
+	if( fd < 0 ) return false;
+
+	struct stat st;
+	if( fstat( fd, &st ) != 0 || st.st_size == 0 || st.st_size > INT_MAX )
+	{
+		close( fd );
+		return false;
+	}
+	fileSize = (size_t)st.st_size;
+
+	view = mmap( 0x0, fileSize, PROT_READ, MAP_PRIVATE, fd, 0 );
+	close( fd );
+	if( view == MAP_FAILED ) return false;
+	madvise( view, fileSize, MADV_WILLNEED );
+#endif
+
+	// Fault the pages in on the worker so that loading does not wait for the disk
+	volatile char dummy = 0;
+	for( size_t i = 0; i < fileSize; i += 4096 ) dummy += ((char *)view)[i];
+	(void)dummy;
+
+	item.data = (char *)view;
+	item.size = (int)fileSize;
+	item.found = true;
+	item.mapped = true;
+	
+	return true;
+}
+
+
+void unmapResourceFile( AsyncLoadItem &item )
+{
+#if defined( PLATFORM_WIN ) || defined( __MINGW32__ )
+	UnmapViewOfFile( item.data );
+#else
+	munmap( item.data, (size_t)item.size );
+#endif
+	item.data = 0x0;
+	item.mapped = false;
+}
+
 
-	while( res != 0 )
+void readResourceFile( const vector< string > &dirs, AsyncLoadItem &item )
+{
+	ifstream inf;
+	
+	// Loop over search paths and try to open files
+	for( unsigned int i = 0; i < dirs.size(); ++i )
 	{
-		ifstream inf;
+		string fileName = dirs[i] + item.fileName;
+
+		// Geometry is mapped so that the engine can upload it without an intermediate copy
+		if( item.type == H3DResTypes::Geometry && mapResourceFile( fileName, item ) ) return;
 		
-		// Loop over search paths and try to open files
-		for( unsigned int i = 0; i < dirs.size(); ++i )
+		inf.clear();
+		inf.open( fileName.c_str(), ios::binary );
+		if( inf.good() ) break;
+	}
+
+	if( !inf.good() ) return;
+	
+	// Find size of resource file
+	inf.seekg( 0, ios::end );
+	size_t fileSize = (size_t)inf.tellg();
+	item.found = true;
+	if( fileSize == 0 ) return;
+
+	// Copy resource file to memory
+	item.data = new char[fileSize];
+	item.size = (int)fileSize;
+	inf.seekg( 0 );
+	inf.read( item.data, fileSize );
+	inf.close();
+}
+
+
+void asyncLoadWorker( AsyncLoader *loader )
+{
+	for( ;; )
+	{
+		AsyncLoadItem *item = 0x0;
 		{
-			string fileName = dirs[i] + resourcePaths[h3dGetResType( res )] + "/" + h3dGetResName( res );
-			inf.clear();
-			inf.open( fileName.c_str(), ios::binary );
-			if( inf.good() ) break;
+			unique_lock< mutex > lock( loader->mtx );
+			while( !loader->quit && loader->pending.empty() ) loader->workCond.wait( lock );
+			if( loader->quit ) return;
+			
+			item = loader->pending.front();
+			loader->pending.pop_front();
 		}
 
-		// Open resource file
-		if( inf.good() ) // Resource file found
+		readResourceFile( loader->dirs, *item );
+
+		if( item->data != 0x0 )
 		{
-			// Find size of resource file
-			inf.seekg( 0, ios::end );
-			size_t fileSize = (size_t) inf.tellg();
-			if( bufSize < fileSize  )
+			int decodedSize;
+			char *decoded = h3dDecodeResourceData( item->type, item->data, item->size, &decodedSize );
+			if( decoded != 0x0 )
 			{
-				delete[] dataBuf;				
-				dataBuf = new char[fileSize];
-				if( !dataBuf )
-				{
-					bufSize = 0;
-					continue;
-				}
-				bufSize = fileSize;
+				delete[] item->data;
+				item->data = decoded;
+				item->size = decodedSize;
+				item->decoded = true;
 			}
-			if( fileSize == 0 )	continue;
-			// Copy resource file to memory
-			inf.seekg( 0 );
-			inf.read( dataBuf, fileSize );
-			inf.close();
-			// Send resource data to engine
-			result &= h3dLoadResource( res, dataBuf, ( int ) fileSize );
 		}
-		else // Resource file not found
+
+		{
+			lock_guard< mutex > lock( loader->mtx );
+			loader->finished.push_back( item );
+		}
+		loader->finishCond.notify_one();
+	}
+}
+
+
+void queueUnloadedResources( AsyncLoader *loader )
+{
+	vector< AsyncLoadItem * > items;
+	
+	// Resources stay unloaded until the updating thread passes their data to the engine,
+	// so the queued set is used to skip resources that are already in flight
+	for( H3DRes res = h3dQueryNextUnloadedResource( 0 ); res != 0; res = h3dQueryNextUnloadedResource( res ) )
+	{
+		if( !loader->queued.insert( res ).second ) continue;
+		
+		AsyncLoadItem *item = new AsyncLoadItem();
+		item->res = res;
+		item->type = h3dGetResType( res );
+		item->fileName = resourcePaths[item->type] + "/" + h3dGetResName( res );
+		items.push_back( item );
+	}
+
+	if( items.empty() ) return;
+
+	asyncStats.numTotal += (int)items.size();
+	{
+		lock_guard< mutex > lock( loader->mtx );
+		loader->pending.insert( loader->pending.end(), items.begin(), items.end() );
+	}
+	loader->workCond.notify_all();
+}
+
+
+bool updateAsyncLoading( float maxTime, bool block )
+{
+	if( asyncLoader == 0x0 ) return true;
+
+	chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+	queueUnloadedResources( asyncLoader );
+	
+	while( asyncStats.numLoaded < asyncStats.numTotal )
+	{
+		AsyncLoadItem *item = 0x0;
+		{
+			unique_lock< mutex > lock( asyncLoader->mtx );
+			if( block )
+				while( asyncLoader->finished.empty() ) asyncLoader->finishCond.wait( lock );
+			if( asyncLoader->finished.empty() ) break;
+
+			item = asyncLoader->finished.front();
+			asyncLoader->finished.pop_front();
+		}
+		
+		// Send resource data to engine; NULL tells the engine to use the default resource
+		bool loaded = item->decoded ? h3dLoadDecodedResource( item->res, item->data, item->size ) :
+		              h3dLoadResource( item->res, item->found ? item->data : 0x0, item->size );
+		if( !item->found || (item->data != 0x0 && !loaded) ) ++asyncStats.numFailed;
+		++asyncStats.numLoaded;
+
+		if( item->mapped ) unmapResourceFile( *item );
+		else if( item->decoded ) h3dReleaseDecodedResourceData( item->data );
+		else delete[] item->data;
+		asyncLoader->queued.erase( item->res );
+		delete item;
+
+		// Start loading resources that were referenced by the loaded ones as soon as the workers
+		// run out of queued files; rescanning after every single load would be quadratic
+		bool starving;
 		{
-			// Tell engine to use the dafault resource by using NULL as data pointer
-			h3dLoadResource( res, 0x0, 0 );
-			result = false;
+			lock_guard< mutex > lock( asyncLoader->mtx );
+			starving = asyncLoader->pending.empty();
 		}
-		// Get next unloaded resource
-		res = h3dQueryUnloadedResource( 0 );
+		if( starving ) queueUnloadedResources( asyncLoader );
+
+		if( !block && chrono::duration< float, milli >( chrono::steady_clock::now() - startTime ).count() >= maxTime )
+			break;
 	}
-	delete[] dataBuf;
 
-	return result;
+	if( asyncStats.numLoaded < asyncStats.numTotal ) return false;
+
+	// Everything is loaded, shut down workers
+	{
+		lock_guard< mutex > lock( asyncLoader->mtx );
+		asyncLoader->quit = true;
+	}
+	asyncLoader->workCond.notify_all();
+	for( size_t i = 0; i < asyncLoader->workers.size(); ++i )
+		asyncLoader->workers[i].join();
+	
+	delete asyncLoader; asyncLoader = 0x0;
+
+	return true;
+}
+
+}  // namespace
+
+
+// =================================================================================================
+// Exported API functions
+// =================================================================================================
+
+using namespace Horde3DUtils;
+
+
+DLLEXP const char *h3dutGetResourcePath( int type )
+{
+	return resourcePaths[type].c_str();
+}
+
+
+DLLEXP void h3dutSetResourcePath( int type, const char *path )
+{
+	string s = path != 0x0 ? path : "";
+
+	resourcePaths[type] = cleanPath( s );
+}
+
+
+DLLEXP bool h3dutBeginLoadResourcesAsync( const char *contentDir, int numThreads )
+{
+	if( asyncLoader != 0x0 ) return false;
+
+	asyncLoader = new AsyncLoader();
+	asyncLoader->dirs = splitContentDirs( contentDir );
+	asyncStats = AsyncLoadStats();
+
+	if( numThreads <= 0 ) numThreads = (int)thread::hardware_concurrency();
+	if( numThreads <= 0 ) numThreads = 2;
+	
+	for( int i = 0; i < numThreads; ++i )
+		asyncLoader->workers.push_back( thread( asyncLoadWorker, asyncLoader ) );
+
+	queueUnloadedResources( asyncLoader );
+	
+	return true;
+}
+
+
+DLLEXP bool h3dutUpdateLoadResourcesAsync( float maxTime )
+{
+	return updateAsyncLoading( maxTime, false );
+}
+
+
+DLLEXP float h3dutGetLoadResourcesAsyncProgress( int *numLoaded, int *numTotal, int *numFailed )
+{
+	if( numLoaded != 0x0 ) *numLoaded = asyncStats.numLoaded;
+	if( numTotal != 0x0 ) *numTotal = asyncStats.numTotal;
+	if( numFailed != 0x0 ) *numFailed = asyncStats.numFailed;
+
+	return asyncStats.numTotal > 0 ? (float)asyncStats.numLoaded / asyncStats.numTotal : 1.0f;
+}
+
+
+DLLEXP bool h3dutLoadResourcesFromDisk( const char *contentDir )
+{
+	// Finish a pending asynchronous load first
+	if( asyncLoader != 0x0 ) updateAsyncLoading( 0, true );
+
+	h3dutBeginLoadResourcesAsync( contentDir, 0 );
+	updateAsyncLoading( 0, true );
+
+	return asyncStats.numFailed == 0;
 }
 
 
@@ -295,31 +574,133 @@ DLLEXP bool h3dutDumpMessages()
 }
 
 
-DLLEXP void h3dutShowText( const char *text, float x, float y, float size, float colR,
-                           float colG, float colB, H3DRes fontMaterialRes )
+DLLEXP bool h3dutDumpProfilerTrace( const char *filename )
 {
-	if( text == 0x0 || *text == '\0' ) return;
+	if( filename == 0x0 ) return false;
 	
-	float ovFontVerts[64 * 16];
-	float *p = ovFontVerts;
-	float pos = 0;
+	const char *trace = h3dGetProfilerTrace();
+	size_t length = strlen( trace );
+
+	size_t bytesWritten = 0;
+	FILE *f = fopen( filename, "wb" );
+	if( f )
+	{
+		bytesWritten = fwrite( trace, 1, length, f );
+		fclose( f );
+	}
+
+	return bytesWritten == length;
+}
+
+
+// =================================================================================================
+// Text
+// =================================================================================================
+
+struct TextObject
+{
+	string           text;
+	float            x, y, size;
+	float            colR, colG, colB;
+	H3DRes           fontMatRes;
+	vector< float >  verts;  // Glyph quads built from the parameters above
+};
+
+map< int, TextObject >  textObjects;
+int                     nextTextObjHandle = 1;
+
+
+int buildTextVerts( const char *text, float x, float y, float size, vector< float > &verts )
+{
+	verts.resize( 0 );
 	
-	do
+	float pos = 0, line = 0;
+	for( ; *text != '\0'; ++text )
 	{
-		unsigned char ch = (unsigned char)*text++;
+		unsigned char ch = (unsigned char)*text;
+		if( ch == '\n' )
+		{
+			pos = 0;
+			line += 1.f;
+			continue;
+		}
 
 		float u0 = 0.0625f * (ch % 16);
 		float v0 = 1.0f - 0.0625f * (ch / 16);
+		float x0 = x + size * 0.5f * pos, y0 = y + size * line;
 
-		*p++ = x + size * 0.5f * pos;         *p++ = y;         *p++ = u0;            *p++ = v0;
-		*p++ = x + size * 0.5f * pos,         *p++ = y + size;  *p++ = u0;            *p++ = v0 - 0.0625f;
-		*p++ = x + size * 0.5f * pos + size;  *p++ = y + size;  *p++ = u0 + 0.0625f;  *p++ = v0 - 0.0625f;
-		*p++ = x + size * 0.5f * pos + size;  *p++ = y;         *p++ = u0 + 0.0625f;  *p++ = v0;
+		float quad[16] = { x0,         y0,         u0,            v0,
+		                   x0,         y0 + size,  u0,            v0 - 0.0625f,
+		                   x0 + size,  y0 + size,  u0 + 0.0625f,  v0 - 0.0625f,
+		                   x0 + size,  y0,         u0 + 0.0625f,  v0 };
+		verts.insert( verts.end(), quad, quad + 16 );
 		
 		pos += 1.f;
-	} while( *text && pos < 64 );
+	}
+
+	return (int)verts.size() / 4;
+}
+
+
+DLLEXP void h3dutShowText( const char *text, float x, float y, float size, float colR,
+                           float colG, float colB, H3DRes fontMaterialRes )
+{
+	if( text == 0x0 || *text == '\0' ) return;
+	
+	// Reuse storage of previous calls
+	static vector< float > ovFontVerts;
+	int numVerts = buildTextVerts( text, x, y, size, ovFontVerts );
+
+	if( numVerts > 0 )
+		h3dShowOverlays( &ovFontVerts[0], numVerts, colR, colG, colB, 1.f, fontMaterialRes, 0 );
+}
+
+
+DLLEXP int h3dutCreateText( H3DRes fontMaterialRes )
+{
+	TextObject &textObj = textObjects[nextTextObjHandle];
+	textObj.x = 0; textObj.y = 0; textObj.size = 0;
+	textObj.colR = 1; textObj.colG = 1; textObj.colB = 1;
+	textObj.fontMatRes = fontMaterialRes;
+
+	return nextTextObjHandle++;
+}
+
+
+DLLEXP void h3dutDestroyText( int textObj )
+{
+	textObjects.erase( textObj );
+}
+
+
+DLLEXP bool h3dutSetText( int textObj, const char *text, float x, float y, float size,
+                          float colR, float colG, float colB )
+{
+	map< int, TextObject >::iterator itr = textObjects.find( textObj );
+	if( itr == textObjects.end() ) return false;
+	TextObject &obj = itr->second;
+	
+	if( text == 0x0 ) text = "";
+	obj.colR = colR; obj.colG = colG; obj.colB = colB;
+
+	// Glyph geometry is only rebuilt when it has changed
+	if( obj.text == text && obj.x == x && obj.y == y && obj.size == size ) return true;
+	
+	obj.text = text;
+	obj.x = x; obj.y = y; obj.size = size;
+	buildTextVerts( text, x, y, size, obj.verts );
+
+	return true;
+}
+
+
+DLLEXP void h3dutShowTextObject( int textObj )
+{
+	map< int, TextObject >::iterator itr = textObjects.find( textObj );
+	if( itr == textObjects.end() || itr->second.verts.empty() ) return;
+	TextObject &obj = itr->second;
 
-	h3dShowOverlays( ovFontVerts, (int)pos * 4, colR, colG, colB, 1.f, fontMaterialRes, 0 );
+	h3dShowOverlays( &obj.verts[0], (int)obj.verts.size() / 4, obj.colR, obj.colG, obj.colB, 1.f, obj.fontMatRes, 0 );
 }
 
 
@@ -0,0 +1,301 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2016 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+// Converts XML scene graph files to the binary scene graph format that is loaded by the
+// SceneGraph resource; the format is described in egSceneGraphRes.cpp
+
+#include "utPlatform.h"
+#include "utEndian.h"
+#include "utXML.h"
+#include "rapidxml_print.h"
+#include <cstdlib>
+#include <cmath>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace Horde3D;
+
+
+struct AttribTypes
+{
+	enum List
+	{
+		Float = 0,
+		Int,
+		String
+	};
+};
+
+static const uint32 NoString = 0xFFFFFFFF;
+
+
+// little endian element writer
+template< class T >
+inline void append_le( vector< char > &buf, const T *data, size_t count )
+{
+	size_t pos = buf.size();
+	buf.resize( pos + sizeof( T ) * count );
+	elemcpyd_le( (T *)&buf[pos], data, count );
+}
+
+
+class SceneGraphWriter
+{
+public:
+	SceneGraphWriter() : _nodeCount( 0 ) {}
+
+	void writeNode( XMLNode &xmlNode );
+	bool save( const string &fileName );
+	uint32 getNodeCount() const { return _nodeCount; }
+
+private:
+	uint32 addString( const string &str );
+	uint32 addType( const string &typeName );
+
+private:
+	vector< string >         _strings;
+	map< string, uint32 >    _stringMap;
+	vector< uint32 >         _types;
+	map< string, uint32 >    _typeMap;
+	vector< char >           _nodeData;
+	uint32                   _nodeCount;
+};
+
+
+uint32 SceneGraphWriter::addString( const string &str )
+{
+	map< string, uint32 >::iterator itr = _stringMap.find( str );
+	if( itr != _stringMap.end() ) return itr->second;
+
+	_strings.push_back( str );
+	_stringMap[str] = (uint32)_strings.size() - 1;
+	return (uint32)_strings.size() - 1;
+}
+
+
+uint32 SceneGraphWriter::addType( const string &typeName )
+{
+	map< string, uint32 >::iterator itr = _typeMap.find( typeName );
+	if( itr != _typeMap.end() ) return itr->second;
+
+	_types.push_back( addString( typeName ) );
+	_typeMap[typeName] = (uint32)_types.size() - 1;
+	return (uint32)_types.size() - 1;
+}
+
+
+bool isBaseAttribute( const char *name )
+{
+	return strcmp( name, "name" ) == 0 ||
+	       strcmp( name, "tx" ) == 0 || strcmp( name, "ty" ) == 0 || strcmp( name, "tz" ) == 0 ||
+	       strcmp( name, "rx" ) == 0 || strcmp( name, "ry" ) == 0 || strcmp( name, "rz" ) == 0 ||
+	       strcmp( name, "sx" ) == 0 || strcmp( name, "sy" ) == 0 || strcmp( name, "sz" ) == 0;
+}
+
+
+AttribTypes::List classifyValue( const char *str, int32 &intValue, float &floatValue )
+{
+	// Integers are only stored as such if they can be printed back exactly
+	char *end = 0x0;
+	long l = strtol( str, &end, 10 );
+	if( *str != '\0' && *end == '\0' && l >= -2147483647L && l <= 2147483647L )
+	{
+		char buf[16];
+		snprintf( buf, sizeof( buf ), "%li", l );
+		if( strcmp( buf, str ) == 0 )
+		{
+			intValue = (int32)l;
+			return AttribTypes::Int;
+		}
+	}
+
+	// Plain decimal numbers, no hex values, infinities or NaNs
+	if( *str != '\0' && strspn( str, "0123456789+-.eE" ) == strlen( str ) )
+	{
+		double d = strtod( str, &end );
+		if( *end == '\0' && fabs( d ) <= 3.4e38 )
+		{
+			floatValue = (float)d;
+			return AttribTypes::Float;
+		}
+	}
+
+	return AttribTypes::String;
+}
+
+
+void SceneGraphWriter::writeNode( XMLNode &xmlNode )
+{
+	++_nodeCount;
+
+	// Type and base attributes
+	uint32 value = addType( xmlNode.getName() );
+	append_le( _nodeData, &value, 1 );
+	value = addString( xmlNode.getAttribute( "name", "" ) );
+	append_le( _nodeData, &value, 1 );
+
+	const char *transAttribs[9] = { "tx", "ty", "tz", "rx", "ry", "rz", "sx", "sy", "sz" };
+	for( uint32 i = 0; i < 9; ++i )
+	{
+		float f = (float)atof( xmlNode.getAttribute( transAttribs[i], i < 6 ? "0" : "1" ) );
+		append_le( _nodeData, &f, 1 );
+	}
+
+	value = NoString;
+	XMLNode attachment = xmlNode.getFirstChild( "Attachment" );
+	if( !attachment.isEmpty() )
+	{
+		string attachmentString;
+		rapidxml::print( std::back_inserter( attachmentString ), *attachment.getRapidXMLNode(), 0 );
+		value = addString( attachmentString );
+	}
+	append_le( _nodeData, &value, 1 );
+
+	// Counts
+	vector< XMLAttribute > attribs;
+	for( XMLAttribute attrib = xmlNode.getFirstAttrib(); !attrib.isEmpty(); attrib = attrib.getNextAttrib() )
+	{
+		if( !isBaseAttribute( attrib.getName() ) ) attribs.push_back( attrib );
+	}
+
+	vector< XMLNode > children;
+	for( XMLNode child = xmlNode.getFirstChild(); !child.isEmpty(); child = child.getNextSibling() )
+	{
+		if( child.getRapidXMLNode()->type() == rapidxml::node_element &&
+		    strcmp( child.getName(), "Attachment" ) != 0 )
+		{
+			children.push_back( child );
+		}
+	}
+
+	value = (uint32)attribs.size();
+	append_le( _nodeData, &value, 1 );
+	value = (uint32)children.size();
+	append_le( _nodeData, &value, 1 );
+
+	// Custom attributes
+	for( size_t i = 0; i < attribs.size(); ++i )
+	{
+		int32 intValue;
+		float floatValue;
+		uint32 type = classifyValue( attribs[i].getValue(), intValue, floatValue );
+
+		value = addString( attribs[i].getName() );
+		append_le( _nodeData, &value, 1 );
+		append_le( _nodeData, &type, 1 );
+
+		if( type == AttribTypes::Int ) append_le( _nodeData, &intValue, 1 );
+		else if( type == AttribTypes::Float ) append_le( _nodeData, &floatValue, 1 );
+		else
+		{
+			value = addString( attribs[i].getValue() );
+			append_le( _nodeData, &value, 1 );
+		}
+	}
+
+	for( size_t i = 0; i < children.size(); ++i )
+	{
+		writeNode( children[i] );
+	}
+}
+
+
+bool SceneGraphWriter::save( const string &fileName )
+{
+	vector< char > data;
+	uint32 value;
+
+	// Header
+	append_le( data, "H3DS", 4 );
+	value = 1;
+	append_le( data, &value, 1 );
+
+	// String table
+	uint32 dataSize = 0;
+	for( size_t i = 0; i < _strings.size(); ++i ) dataSize += (uint32)_strings[i].length() + 1;
+
+	value = (uint32)_strings.size();
+	append_le( data, &value, 1 );
+	append_le( data, &dataSize, 1 );
+	for( size_t i = 0; i < _strings.size(); ++i )
+		append_le( data, _strings[i].c_str(), _strings[i].length() + 1 );
+
+	// Type table
+	value = (uint32)_types.size();
+	append_le( data, &value, 1 );
+	if( !_types.empty() ) append_le( data, &_types[0], _types.size() );
+
+	// Nodes
+	data.insert( data.end(), _nodeData.begin(), _nodeData.end() );
+
+	FILE *f = fopen( fileName.c_str(), "wb" );
+	if( f == 0x0 ) return false;
+
+	bool result = fwrite( &data[0], 1, data.size(), f ) == data.size();
+	fclose( f );
+
+	return result;
+}
+
+
+void printHelp()
+{
+	cout << "Usage:" << endl;
+	cout << "SceneGraphConv input [output]" << endl;
+	cout << endl;
+	cout << "input             XML scene graph file to be converted" << endl;
+	cout << "output            binary scene graph file (default: input without .xml extension)" << endl;
+}
+
+
+int main( int argc, char **argv )
+{
+	cout << "Horde3D SceneGraphConv - 1.0.0" << endl << endl;
+
+	if( argc < 2 || argc > 3 || argv[1][0] == '-' )
+	{
+		printHelp();
+		return 1;
+	}
+
+	string input = argv[1], output;
+	if( argc > 2 )
+		output = argv[2];
+	else if( input.length() > 4 && _stricmp( input.c_str() + input.length() - 4, ".xml" ) == 0 )
+		output = input.substr( 0, input.length() - 4 );
+	else
+		output = input + ".bin";
+
+	XMLDoc doc;
+	if( !doc.parseFile( input.c_str() ) || doc.hasError() )
+	{
+		cout << "Error: Failed to parse '" << input << "'" << endl;
+		return 1;
+	}
+
+	XMLNode rootNode = doc.getRootNode();
+	SceneGraphWriter writer;
+	writer.writeNode( rootNode );
+
+	if( !writer.save( output ) )
+	{
+		cout << "Error: Failed to write '" << output << "'" << endl;
+		return 1;
+	}
+
+	cout << "Converted " << writer.getNodeCount() << " nodes to '" << output << "'" << endl;
+	return 0;
+}
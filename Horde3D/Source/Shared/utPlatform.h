@@ -120,6 +120,18 @@ typedef unsigned long long uint64;
 #   define vsnprintf _vsnprintf
 #endif
 
+// SIMD instruction sets (define H3D_NO_SIMD to use the scalar code paths only)
+#if !defined( H3D_NO_SIMD )
+#	if defined( __AVX2__ )
+#		define H3D_SIMD_AVX2
+#	endif
+#	if defined( __SSE2__ ) || defined( _M_X64 ) || (defined( _M_IX86_FP ) && _M_IX86_FP >= 2)
+#		define H3D_SIMD_SSE2
+#	elif defined( __ARM_NEON ) || defined( __ARM_NEON__ )
+#		define H3D_SIMD_NEON
+#	endif
+#endif
+
 // Runtime assertion
 #if defined( _DEBUG )
 #	define ASSERT( exp ) assert( exp );
@@ -0,0 +1,377 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2016 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+#include "baker.h"
+#include "bcEncoder.h"
+#include "utEndian.h"
+#include "../Horde3DEngine/utImage.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace std;
+using namespace Horde3D;
+
+
+#define FOURCC( c0, c1, c2, c3 ) ((c0) | (c1<<8) | (c2<<16) | (c3<<24))
+
+#define DDSD_CAPS             0x00000001
+#define DDSD_HEIGHT           0x00000002
+#define DDSD_WIDTH            0x00000004
+#define DDSD_PIXELFORMAT      0x00001000
+#define DDSD_MIPMAPCOUNT      0x00020000
+#define DDSD_LINEARSIZE       0x00080000
+
+#define DDPF_FOURCC           0x00000004
+
+#define DDSCAPS_COMPLEX       0x00000008
+#define DDSCAPS_TEXTURE       0x00001000
+#define DDSCAPS_MIPMAP        0x00400000
+
+#define D3DFMT_A16B16G16R16F  113
+
+#define DXGI_FORMAT_BC1_UNORM_SRGB        72
+#define DXGI_FORMAT_BC3_UNORM_SRGB        78
+#define DXGI_FORMAT_BC4_UNORM             80
+#define DXGI_FORMAT_BC5_UNORM             83
+#define DXGI_FORMAT_BC7_UNORM             98
+#define DXGI_FORMAT_BC7_UNORM_SRGB        99
+
+#define D3D10_RESOURCE_DIMENSION_TEXTURE2D  3
+
+
+// One level of the mip chain with RGBA float pixels
+struct MipLevel
+{
+	int              width, height;
+	vector< float >  pixels;
+};
+
+
+static const char *formatNames[] = { "auto", "BC1", "BC3", "BC4", "BC5", "BC7" };
+
+
+static bool readFile( const string &fileName, vector< char > &data )
+{
+	FILE *f = fopen( fileName.c_str(), "rb" );
+	if( f == 0x0 ) return false;
+
+	fseek( f, 0, SEEK_END );
+	long size = ftell( f );
+	fseek( f, 0, SEEK_SET );
+
+	data.resize( size > 0 ? size : 0 );
+	bool result = size > 0 && fread( &data[0], 1, size, f ) == (size_t)size;
+	fclose( f );
+
+	return result;
+}
+
+
+static bool writeFile( const string &fileName, const vector< char > &data )
+{
+	FILE *f = fopen( fileName.c_str(), "wb" );
+	if( f == 0x0 ) return false;
+
+	bool result = fwrite( &data[0], 1, data.size(), f ) == data.size();
+	fclose( f );
+
+	return result;
+}
+
+
+static float toLinear( float c )
+{
+	return c <= 0.04045f ? c / 12.92f : powf( (c + 0.055f) / 1.055f, 2.4f );
+}
+
+
+static float toSRGB( float c )
+{
+	return c <= 0.0031308f ? c * 12.92f : 1.055f * powf( c, 1.0f / 2.4f ) - 0.055f;
+}
+
+
+static uint16 toHalf( float f )
+{
+	uint32 bits;
+	memcpy( &bits, &f, 4 );
+
+	uint32 sign = (bits >> 16) & 0x8000;
+	int exponent = (int)((bits >> 23) & 0xFF) - 127 + 15;
+	uint32 mantissa = bits & 0x007FFFFF;
+
+	if( ((bits >> 23) & 0xFF) == 0xFF )  // Inf and NaN
+		return (uint16)(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+	if( exponent >= 31 )  // Overflow
+		return (uint16)(sign | 0x7C00);
+	if( exponent <= 0 )  // Denormal or zero
+	{
+		if( exponent < -10 ) return (uint16)sign;
+		mantissa |= 0x00800000;
+		uint32 shift = 14 - exponent;
+		return (uint16)(sign | ((mantissa + (1 << (shift - 1))) >> shift));
+	}
+
+	// Round to nearest; a carry into the exponent is still correct
+	return (uint16)((sign | (exponent << 10) | (mantissa >> 13)) + ((mantissa >> 12) & 1));
+}
+
+
+// Box filter using the "floor" convention of the engine for odd sizes
+static void downsample( const MipLevel &src, MipLevel &dest )
+{
+	dest.width = max( src.width >> 1, 1 );
+	dest.height = max( src.height >> 1, 1 );
+	dest.pixels.resize( dest.width * dest.height * 4 );
+
+	for( int y = 0; y < dest.height; ++y )
+	{
+		int y0 = min( y * 2, src.height - 1 ), y1 = min( y * 2 + 1, src.height - 1 );
+		for( int x = 0; x < dest.width; ++x )
+		{
+			int x0 = min( x * 2, src.width - 1 ), x1 = min( x * 2 + 1, src.width - 1 );
+			for( int c = 0; c < 4; ++c )
+			{
+				dest.pixels[(y * dest.width + x) * 4 + c] = 0.25f * (
+					src.pixels[(y0 * src.width + x0) * 4 + c] + src.pixels[(y0 * src.width + x1) * 4 + c] +
+					src.pixels[(y1 * src.width + x0) * 4 + c] + src.pixels[(y1 * src.width + x1) * 4 + c] );
+			}
+		}
+	}
+}
+
+
+static void compressLevel( const MipLevel &level, BakeFormats::List format, bool sRGB, vector< char > &data )
+{
+	// Back to 8 bit, RGBA order
+	vector< uint8 > pixels( level.width * level.height * 4 );
+	for( size_t i = 0; i < pixels.size(); ++i )
+	{
+		float value = level.pixels[i];
+		if( sRGB && (i & 3) != 3 ) value = toSRGB( value );
+		pixels[i] = (uint8)(min( max( value, 0.0f ), 1.0f ) * 255.0f + 0.5f);
+	}
+
+	int blockBytes = format == BakeFormats::BC1 || format == BakeFormats::BC4 ? 8 : 16;
+	int blocksX = (level.width + 3) / 4, blocksY = (level.height + 3) / 4;
+	size_t pos = data.size();
+	data.resize( pos + blocksX * blocksY * blockBytes );
+
+	for( int by = 0; by < blocksY; ++by )
+	{
+		for( int bx = 0; bx < blocksX; ++bx )
+		{
+			// Partial blocks at the border repeat the last row and column
+			uint8 block[16 * 4];
+			for( int y = 0; y < 4; ++y )
+			{
+				int sy = min( by * 4 + y, level.height - 1 );
+				for( int x = 0; x < 4; ++x )
+				{
+					int sx = min( bx * 4 + x, level.width - 1 );
+					memcpy( &block[(y * 4 + x) * 4], &pixels[(sy * level.width + sx) * 4], 4 );
+				}
+			}
+
+			uint8 *out = (uint8 *)&data[pos];
+			switch( format )
+			{
+			case BakeFormats::BC1: encodeBC1( block, out ); break;
+			case BakeFormats::BC3: encodeBC3( block, out ); break;
+			case BakeFormats::BC4: encodeBC4( block, out ); break;
+			case BakeFormats::BC5: encodeBC5( block, out ); break;
+			default: encodeBC7( block, out ); break;
+			}
+			pos += blockBytes;
+		}
+	}
+}
+
+
+static void appendHeader( vector< char > &data, int width, int height, int mipCount, uint32 fourCC,
+                          uint32 dxgiFormat, uint32 topLevelSize )
+{
+	uint32 header[32];
+	memset( header, 0, sizeof( header ) );
+
+	header[0] = FOURCC( 'D', 'D', 'S', ' ' );
+	header[1] = 124;
+	header[2] = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+	header[3] = height;
+	header[4] = width;
+	header[5] = topLevelSize;
+	header[7] = mipCount;
+	header[19] = 32;  // Pixel format
+	header[20] = DDPF_FOURCC;
+	header[21] = fourCC;
+	header[27] = DDSCAPS_TEXTURE | (mipCount > 1 ? DDSCAPS_MIPMAP | DDSCAPS_COMPLEX : 0);
+
+	size_t pos = data.size();
+	data.resize( pos + sizeof( header ) );
+	elemcpyd_le( (uint32 *)&data[pos], header, 32 );
+
+	if( fourCC == FOURCC( 'D', 'X', '1', '0' ) )
+	{
+		uint32 dx10Header[5] = { dxgiFormat, D3D10_RESOURCE_DIMENSION_TEXTURE2D, 0, 1, 0 };
+
+		pos = data.size();
+		data.resize( pos + sizeof( dx10Header ) );
+		elemcpyd_le( (uint32 *)&data[pos], dx10Header, 5 );
+	}
+}
+
+
+bool bakeTexture( const string &srcFile, const string &destFile, const BakeOptions &options, string &info )
+{
+	vector< char > fileData;
+	if( !readFile( srcFile, fileData ) )
+	{
+		info = "Failed to read '" + srcFile + "'";
+		return false;
+	}
+	if( fileData.size() >= 4 && memcmp( &fileData[0], "DDS ", 4 ) == 0 )
+	{
+		info = "'" + srcFile + "' is already a DDS file";
+		return false;
+	}
+
+	// Decode image
+	const stbi_uc *buffer = (const stbi_uc *)&fileData[0];
+	int bufferSize = (int)fileData.size();
+	bool hdr = stbi_is_hdr_from_memory( buffer, bufferSize ) > 0;
+	int comps;
+
+	// BC4 and BC5 store data channels, which are never sRGB encoded
+	bool sRGB = options.sRGB && !hdr && options.format != BakeFormats::BC4 && options.format != BakeFormats::BC5;
+
+	vector< MipLevel > levels( 1 );
+	MipLevel &base = levels[0];
+	bool hasAlpha = false;
+
+	if( hdr )
+	{
+		float *pixels = stbi_loadf_from_memory( buffer, bufferSize, &base.width, &base.height, &comps, 4 );
+		if( pixels == 0x0 )
+		{
+			info = "Failed to decode '" + srcFile + "' (" + stbi_failure_reason() + ")";
+			return false;
+		}
+		base.pixels.assign( pixels, pixels + base.width * base.height * 4 );
+		stbi_image_free( pixels );
+	}
+	else
+	{
+		stbi_uc *pixels = stbi_load_from_memory( buffer, bufferSize, &base.width, &base.height, &comps, 4 );
+		if( pixels == 0x0 )
+		{
+			info = "Failed to decode '" + srcFile + "' (" + stbi_failure_reason() + ")";
+			return false;
+		}
+
+		float table[256];
+		for( int i = 0; i < 256; ++i )
+			table[i] = sRGB ? toLinear( i / 255.0f ) : i / 255.0f;
+
+		base.pixels.resize( base.width * base.height * 4 );
+		for( size_t i = 0; i < base.pixels.size(); ++i )
+		{
+			if( (i & 3) == 3 )
+			{
+				base.pixels[i] = pixels[i] / 255.0f;
+				if( pixels[i] != 255 ) hasAlpha = true;
+			}
+			else
+				base.pixels[i] = table[pixels[i]];
+		}
+		stbi_image_free( pixels );
+	}
+
+	// Build full mip chain; this invalidates base
+	while( levels.back().width > 1 || levels.back().height > 1 )
+	{
+		levels.push_back( MipLevel() );
+		downsample( levels[levels.size() - 2], levels.back() );
+	}
+
+	// Write DDS
+	const MipLevel &top = levels[0];
+	vector< char > data;
+	char buf[128];
+
+	if( hdr )
+	{
+		appendHeader( data, top.width, top.height, (int)levels.size(), D3DFMT_A16B16G16R16F, 0,
+		              top.width * top.height * 8 );
+
+		for( size_t i = 0; i < levels.size(); ++i )
+		{
+			vector< uint16 > halfs( levels[i].pixels.size() );
+			for( size_t j = 0; j < halfs.size(); ++j ) halfs[j] = toHalf( levels[i].pixels[j] );
+
+			size_t pos = data.size();
+			data.resize( pos + halfs.size() * 2 );
+			elemcpyd_le( (uint16 *)&data[pos], &halfs[0], halfs.size() );
+		}
+
+		snprintf( buf, sizeof( buf ), "RGBA16F %ix%i, %i mips", top.width, top.height, (int)levels.size() );
+	}
+	else
+	{
+		BakeFormats::List format = options.format;
+		if( format == BakeFormats::Auto ) format = hasAlpha ? BakeFormats::BC3 : BakeFormats::BC1;
+
+		// The legacy FourCCs are used where possible since they are understood by more tools
+		uint32 fourCC = FOURCC( 'D', 'X', '1', '0' ), dxgiFormat = 0;
+		switch( format )
+		{
+		case BakeFormats::BC1:
+			if( sRGB ) dxgiFormat = DXGI_FORMAT_BC1_UNORM_SRGB;
+			else fourCC = FOURCC( 'D', 'X', 'T', '1' );
+			break;
+		case BakeFormats::BC3:
+			if( sRGB ) dxgiFormat = DXGI_FORMAT_BC3_UNORM_SRGB;
+			else fourCC = FOURCC( 'D', 'X', 'T', '5' );
+			break;
+		case BakeFormats::BC4:
+			dxgiFormat = DXGI_FORMAT_BC4_UNORM;
+			break;
+		case BakeFormats::BC5:
+			dxgiFormat = DXGI_FORMAT_BC5_UNORM;
+			break;
+		default:
+			dxgiFormat = sRGB ? DXGI_FORMAT_BC7_UNORM_SRGB : DXGI_FORMAT_BC7_UNORM;
+			break;
+		}
+
+		int blockBytes = format == BakeFormats::BC1 || format == BakeFormats::BC4 ? 8 : 16;
+		appendHeader( data, top.width, top.height, (int)levels.size(), fourCC, dxgiFormat,
+		              ((top.width + 3) / 4) * ((top.height + 3) / 4) * blockBytes );
+
+		for( size_t i = 0; i < levels.size(); ++i )
+			compressLevel( levels[i], format, sRGB, data );
+
+		snprintf( buf, sizeof( buf ), "%s%s %ix%i, %i mips", formatNames[format], sRGB ? " sRGB" : "",
+		          top.width, top.height, (int)levels.size() );
+	}
+
+	if( !writeFile( destFile, data ) )
+	{
+		info = "Failed to write '" + destFile + "'";
+		return false;
+	}
+
+	info = buf;
+	return true;
+}
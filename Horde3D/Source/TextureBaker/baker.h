@@ -0,0 +1,48 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2016 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+#ifndef _baker_H_
+#define _baker_H_
+
+#include <string>
+
+
+struct BakeFormats
+{
+	enum List
+	{
+		Auto,  // BC1 for opaque images, BC3 otherwise
+		BC1,
+		BC3,
+		BC4,
+		BC5,
+		BC7
+	};
+};
+
+
+struct BakeOptions
+{
+	BakeFormats::List  format;
+	bool               sRGB;  // Color data is sRGB encoded; mips are filtered in linear space
+
+	BakeOptions() : format( BakeFormats::Auto ), sRGB( false ) {}
+};
+
+
+// Decodes an image file, builds the full mip chain and writes it block compressed as DDS file;
+// HDR images are stored uncompressed as RGBA16F. Can be called from several threads at once.
+// On success, info receives a short description of the output, otherwise the error message.
+bool bakeTexture( const std::string &srcFile, const std::string &destFile, const BakeOptions &options,
+                  std::string &info );
+
+#endif // _baker_H_
@@ -0,0 +1,648 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2016 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+#include "bcEncoder.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace std;
+
+
+namespace {
+
+// =================================================================================================
+// Helpers
+// =================================================================================================
+
+// Principal axis of the first dims components of a point set (power iteration on the covariance)
+void computePrincipalAxis( const float (*points)[4], const bool *used, int dims, float *mean, float *axis )
+{
+	int count = 0;
+	for( int d = 0; d < 4; ++d ) mean[d] = 0;
+	for( int i = 0; i < 16; ++i )
+	{
+		if( !used[i] ) continue;
+		for( int d = 0; d < dims; ++d ) mean[d] += points[i][d];
+		++count;
+	}
+	for( int d = 0; d < dims; ++d ) mean[d] /= (float)max( count, 1 );
+
+	float cov[4][4] = { { 0 } };
+	for( int i = 0; i < 16; ++i )
+	{
+		if( !used[i] ) continue;
+		for( int a = 0; a < dims; ++a )
+			for( int b = 0; b < dims; ++b )
+				cov[a][b] += (points[i][a] - mean[a]) * (points[i][b] - mean[b]);
+	}
+
+	// Start with the component of the largest variance
+	int start = 0;
+	for( int d = 1; d < dims; ++d )
+		if( cov[d][d] > cov[start][start] ) start = d;
+	for( int d = 0; d < 4; ++d ) axis[d] = d == start ? 1.0f : 0.0f;
+
+	for( int iter = 0; iter < 8; ++iter )
+	{
+		float v[4] = { 0, 0, 0, 0 }, maxComp = 0;
+		for( int a = 0; a < dims; ++a )
+		{
+			for( int b = 0; b < dims; ++b ) v[a] += cov[a][b] * axis[b];
+			maxComp = max( maxComp, fabsf( v[a] ) );
+		}
+		if( maxComp < 1e-6f ) break;
+		for( int d = 0; d < dims; ++d ) axis[d] = v[d] / maxComp;
+	}
+
+	float len = 0;
+	for( int d = 0; d < dims; ++d ) len += axis[d] * axis[d];
+	len = sqrtf( len );
+	for( int d = 0; d < dims; ++d ) axis[d] = len > 0 ? axis[d] / len : 0;
+}
+
+
+// Endpoints at the extreme projections of the points onto the axis
+void computeAxisEndpoints( const float (*points)[4], const bool *used, int dims,
+                           const float *mean, const float *axis, float *e0, float *e1 )
+{
+	float minT = 1e10f, maxT = -1e10f;
+	for( int i = 0; i < 16; ++i )
+	{
+		if( !used[i] ) continue;
+		float t = 0;
+		for( int d = 0; d < dims; ++d ) t += (points[i][d] - mean[d]) * axis[d];
+		minT = min( minT, t );
+		maxT = max( maxT, t );
+	}
+	if( minT > maxT ) minT = maxT = 0;
+
+	for( int d = 0; d < dims; ++d )
+	{
+		e0[d] = mean[d] + axis[d] * maxT;
+		e1[d] = mean[d] + axis[d] * minT;
+	}
+}
+
+
+// Least squares endpoints for fixed interpolation weights; weights[i] is the contribution of e0
+bool refineEndpoints( const float (*points)[4], const bool *used, const float *weights, int dims,
+                      float *e0, float *e1 )
+{
+	float aa = 0, ab = 0, bb = 0, ax[4] = { 0, 0, 0, 0 }, bx[4] = { 0, 0, 0, 0 };
+	for( int i = 0; i < 16; ++i )
+	{
+		if( !used[i] ) continue;
+		float a = weights[i], b = 1.0f - a;
+		aa += a * a; ab += a * b; bb += b * b;
+		for( int d = 0; d < dims; ++d )
+		{
+			ax[d] += a * points[i][d];
+			bx[d] += b * points[i][d];
+		}
+	}
+
+	float det = aa * bb - ab * ab;
+	if( fabsf( det ) < 1e-6f ) return false;
+
+	for( int d = 0; d < dims; ++d )
+	{
+		e0[d] = min( max( (ax[d] * bb - bx[d] * ab) / det, 0.0f ), 255.0f );
+		e1[d] = min( max( (bx[d] * aa - ax[d] * ab) / det, 0.0f ), 255.0f );
+	}
+	return true;
+}
+
+
+// =================================================================================================
+// Color blocks (BC1 and color part of BC3)
+// =================================================================================================
+
+uint16 packRGB565( const float *c )
+{
+	int r = (int)(min( max( c[0], 0.0f ), 255.0f ) * 31.0f / 255.0f + 0.5f);
+	int g = (int)(min( max( c[1], 0.0f ), 255.0f ) * 63.0f / 255.0f + 0.5f);
+	int b = (int)(min( max( c[2], 0.0f ), 255.0f ) * 31.0f / 255.0f + 0.5f);
+	return (uint16)((r << 11) | (g << 5) | b);
+}
+
+
+void unpackRGB565( uint16 c, int *rgb )
+{
+	int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+	rgb[0] = (r << 3) | (r >> 2);
+	rgb[1] = (g << 2) | (g >> 4);
+	rgb[2] = (b << 3) | (b >> 2);
+}
+
+
+struct ColorBlock
+{
+	uint16  c0, c1;
+	uint8   indices[16];
+	float   error;
+};
+
+
+// Chooses the indices for the quantized endpoints; in the 3 color mode index 3 is transparent
+void evalColorBlock( const float (*colors)[4], const bool *opaque, bool threeColor, ColorBlock &block )
+{
+	int palette[4][3];
+	unpackRGB565( block.c0, palette[0] );
+	unpackRGB565( block.c1, palette[1] );
+
+	int numColors;
+	if( block.c0 == block.c1 )
+	{
+		numColors = 1;
+	}
+	else if( threeColor )
+	{
+		for( int d = 0; d < 3; ++d )
+			palette[2][d] = (palette[0][d] + palette[1][d]) / 2;
+		numColors = 3;
+	}
+	else
+	{
+		for( int d = 0; d < 3; ++d )
+		{
+			palette[2][d] = (2 * palette[0][d] + palette[1][d]) / 3;
+			palette[3][d] = (palette[0][d] + 2 * palette[1][d]) / 3;
+		}
+		numColors = 4;
+	}
+
+	block.error = 0;
+	for( int i = 0; i < 16; ++i )
+	{
+		if( !opaque[i] )
+		{
+			block.indices[i] = 3;
+			continue;
+		}
+
+		float bestDist = 1e10f;
+		for( int j = 0; j < numColors; ++j )
+		{
+			float dist = 0;
+			for( int d = 0; d < 3; ++d )
+				dist += (colors[i][d] - palette[j][d]) * (colors[i][d] - palette[j][d]);
+			if( dist < bestDist )
+			{
+				bestDist = dist;
+				block.indices[i] = (uint8)j;
+			}
+		}
+		block.error += bestDist;
+	}
+}
+
+
+void fitColorEndpoints( const float (*colors)[4], const bool *opaque, bool threeColor,
+                        const float *e0, const float *e1, ColorBlock &block )
+{
+	block.c0 = packRGB565( e0 );
+	block.c1 = packRGB565( e1 );
+
+	// The endpoint order selects the mode: c0 > c1 for 4 colors, c0 <= c1 for 3 colors
+	if( threeColor ? block.c0 > block.c1 : block.c0 < block.c1 ) swap( block.c0, block.c1 );
+
+	evalColorBlock( colors, opaque, threeColor, block );
+}
+
+
+void encodeColorBlock( const uint8 *rgba, bool allowTransparent, uint8 *out )
+{
+	float colors[16][4];
+	bool opaque[16];
+	bool threeColor = false;
+	bool anyOpaque = false;
+
+	for( int i = 0; i < 16; ++i )
+	{
+		for( int d = 0; d < 4; ++d ) colors[i][d] = rgba[i * 4 + d];
+		opaque[i] = !allowTransparent || rgba[i * 4 + 3] >= 128;
+		if( !opaque[i] ) threeColor = true;
+		else anyOpaque = true;
+	}
+
+	ColorBlock best;
+	if( !anyOpaque )
+	{
+		best.c0 = best.c1 = 0;
+		for( int i = 0; i < 16; ++i ) best.indices[i] = 3;
+	}
+	else
+	{
+		float mean[4], axis[4], e0[4], e1[4];
+		computePrincipalAxis( colors, opaque, 3, mean, axis );
+		computeAxisEndpoints( colors, opaque, 3, mean, axis, e0, e1 );
+		fitColorEndpoints( colors, opaque, threeColor, e0, e1, best );
+
+		// Refine the endpoints for the chosen indices
+		static const float weights4[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+		static const float weights3[4] = { 1.0f, 0.0f, 0.5f, 0.0f };
+		for( int iter = 0; iter < 3 && best.error > 0; ++iter )
+		{
+			float weights[16];
+			for( int i = 0; i < 16; ++i )
+				weights[i] = (threeColor ? weights3 : weights4)[best.indices[i]];
+
+			if( !refineEndpoints( colors, opaque, weights, 3, e0, e1 ) ) break;
+
+			ColorBlock candidate;
+			fitColorEndpoints( colors, opaque, threeColor, e0, e1, candidate );
+			if( candidate.error >= best.error ) break;
+			best = candidate;
+		}
+	}
+
+	uint32 indexBits = 0;
+	for( int i = 0; i < 16; ++i ) indexBits |= (uint32)best.indices[i] << (i * 2);
+
+	out[0] = (uint8)(best.c0 & 0xFF); out[1] = (uint8)(best.c0 >> 8);
+	out[2] = (uint8)(best.c1 & 0xFF); out[3] = (uint8)(best.c1 >> 8);
+	for( int i = 0; i < 4; ++i ) out[4 + i] = (uint8)(indexBits >> (i * 8));
+}
+
+
+// =================================================================================================
+// Single channel blocks (BC4, BC5 and alpha part of BC3)
+// =================================================================================================
+
+float evalChannelBlock( const int *values, int a0, int a1, uint8 *indices )
+{
+	int palette[8];
+	palette[0] = a0;
+	palette[1] = a1;
+	if( a0 > a1 )
+	{
+		for( int j = 1; j < 7; ++j ) palette[j + 1] = ((7 - j) * a0 + j * a1) / 7;
+	}
+	else
+	{
+		for( int j = 1; j < 5; ++j ) palette[j + 1] = ((5 - j) * a0 + j * a1) / 5;
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+
+	float error = 0;
+	for( int i = 0; i < 16; ++i )
+	{
+		int bestDist = 1 << 30;
+		for( int j = 0; j < 8; ++j )
+		{
+			int dist = (values[i] - palette[j]) * (values[i] - palette[j]);
+			if( dist < bestDist )
+			{
+				bestDist = dist;
+				indices[i] = (uint8)j;
+			}
+		}
+		error += (float)bestDist;
+	}
+	return error;
+}
+
+
+void encodeChannelBlock( const uint8 *rgba, int channel, uint8 *out )
+{
+	int values[16];
+	int minValue = 255, maxValue = 0;
+	int minInner = 255, maxInner = 0;
+
+	for( int i = 0; i < 16; ++i )
+	{
+		values[i] = rgba[i * 4 + channel];
+		minValue = min( minValue, values[i] );
+		maxValue = max( maxValue, values[i] );
+		if( values[i] != 0 && values[i] != 255 )
+		{
+			minInner = min( minInner, values[i] );
+			maxInner = max( maxInner, values[i] );
+		}
+	}
+
+	// 8 value mode spanning the whole range
+	uint8 indices[16], candidate[16];
+	int a0 = maxValue, a1 = minValue;
+	float error = evalChannelBlock( values, a0, a1, indices );
+
+	// 6 value mode, which has exact 0 and 255 in addition to the interpolated range
+	if( error > 0 && (minValue == 0 || maxValue == 255) )
+	{
+		if( minInner > maxInner ) minInner = maxInner = 0;
+		float error6 = evalChannelBlock( values, minInner, maxInner, candidate );
+		if( error6 < error )
+		{
+			a0 = minInner;
+			a1 = maxInner;
+			memcpy( indices, candidate, sizeof( indices ) );
+		}
+	}
+
+	uint64 indexBits = 0;
+	for( int i = 0; i < 16; ++i ) indexBits |= (uint64)indices[i] << (i * 3);
+
+	out[0] = (uint8)a0;
+	out[1] = (uint8)a1;
+	for( int i = 0; i < 6; ++i ) out[2 + i] = (uint8)(indexBits >> (i * 8));
+}
+
+
+// =================================================================================================
+// BC7 (modes 5 and 6)
+// =================================================================================================
+
+const int bc7Weights2[4] = { 0, 21, 43, 64 };
+const int bc7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+
+// Mode 6: RGBA endpoints with 7 bits and a p-bit each, 4 bit indices
+struct BC7Mode6Block
+{
+	int    endpoints[2][4];
+	int    pbits[2];
+	uint8  indices[16];
+	float  error;
+};
+
+
+void evalMode6Block( const float (*pixels)[4], BC7Mode6Block &block )
+{
+	int e[2][4], palette[16][4];
+	for( int j = 0; j < 2; ++j )
+		for( int d = 0; d < 4; ++d )
+			e[j][d] = (block.endpoints[j][d] << 1) | block.pbits[j];
+
+	for( int j = 0; j < 16; ++j )
+		for( int d = 0; d < 4; ++d )
+			palette[j][d] = ((64 - bc7Weights4[j]) * e[0][d] + bc7Weights4[j] * e[1][d] + 32) >> 6;
+
+	block.error = 0;
+	for( int i = 0; i < 16; ++i )
+	{
+		float bestDist = 1e10f;
+		for( int j = 0; j < 16; ++j )
+		{
+			float dist = 0;
+			for( int d = 0; d < 4; ++d )
+				dist += (pixels[i][d] - palette[j][d]) * (pixels[i][d] - palette[j][d]);
+			if( dist < bestDist )
+			{
+				bestDist = dist;
+				block.indices[i] = (uint8)j;
+			}
+		}
+		block.error += bestDist;
+	}
+}
+
+
+// Tries all p-bit combinations for the unquantized endpoints
+void fitMode6Endpoints( const float (*pixels)[4], const float *e0, const float *e1, BC7Mode6Block &best )
+{
+	best.error = 1e30f;
+
+	for( int p = 0; p < 4; ++p )
+	{
+		BC7Mode6Block candidate;
+		candidate.pbits[0] = p & 1;
+		candidate.pbits[1] = p >> 1;
+		for( int d = 0; d < 4; ++d )
+		{
+			candidate.endpoints[0][d] = min( max( (int)floorf( (e0[d] - candidate.pbits[0]) * 0.5f + 0.5f ), 0 ), 127 );
+			candidate.endpoints[1][d] = min( max( (int)floorf( (e1[d] - candidate.pbits[1]) * 0.5f + 0.5f ), 0 ), 127 );
+		}
+
+		evalMode6Block( pixels, candidate );
+		if( candidate.error < best.error ) best = candidate;
+	}
+}
+
+
+void encodeMode6( const float (*pixels)[4], BC7Mode6Block &best )
+{
+	bool used[16];
+	for( int i = 0; i < 16; ++i ) used[i] = true;
+
+	float mean[4], axis[4], e0[4], e1[4];
+	computePrincipalAxis( pixels, used, 4, mean, axis );
+	computeAxisEndpoints( pixels, used, 4, mean, axis, e0, e1 );
+	fitMode6Endpoints( pixels, e0, e1, best );
+
+	for( int iter = 0; iter < 2 && best.error > 0; ++iter )
+	{
+		float weights[16];
+		for( int i = 0; i < 16; ++i ) weights[i] = 1.0f - bc7Weights4[best.indices[i]] / 64.0f;
+		if( !refineEndpoints( pixels, used, weights, 4, e0, e1 ) ) break;
+
+		BC7Mode6Block candidate;
+		fitMode6Endpoints( pixels, e0, e1, candidate );
+		if( candidate.error >= best.error ) break;
+		best = candidate;
+	}
+
+	// The most significant bit of the first index is implicitly zero
+	if( best.indices[0] >= 8 )
+	{
+		for( int d = 0; d < 4; ++d ) swap( best.endpoints[0][d], best.endpoints[1][d] );
+		swap( best.pbits[0], best.pbits[1] );
+		for( int i = 0; i < 16; ++i ) best.indices[i] = (uint8)(15 - best.indices[i]);
+	}
+}
+
+
+// Mode 5: separate RGB endpoints with 7 bits and alpha endpoints with 8 bits, 2 bit indices each;
+// suits blocks where alpha does not change along with the color
+struct BC7Mode5Channels
+{
+	int    endpoints[2][3];
+	uint8  indices[16];
+	float  error;
+};
+
+
+void evalMode5Channels( const float (*points)[4], int dims, int bits, BC7Mode5Channels &block )
+{
+	int palette[4][3];
+	for( int j = 0; j < 4; ++j )
+	{
+		for( int d = 0; d < dims; ++d )
+		{
+			int e0 = block.endpoints[0][d], e1 = block.endpoints[1][d];
+			if( bits == 7 )
+			{
+				e0 = (e0 << 1) | (e0 >> 6);
+				e1 = (e1 << 1) | (e1 >> 6);
+			}
+			palette[j][d] = ((64 - bc7Weights2[j]) * e0 + bc7Weights2[j] * e1 + 32) >> 6;
+		}
+	}
+
+	block.error = 0;
+	for( int i = 0; i < 16; ++i )
+	{
+		float bestDist = 1e10f;
+		for( int j = 0; j < 4; ++j )
+		{
+			float dist = 0;
+			for( int d = 0; d < dims; ++d )
+				dist += (points[i][d] - palette[j][d]) * (points[i][d] - palette[j][d]);
+			if( dist < bestDist )
+			{
+				bestDist = dist;
+				block.indices[i] = (uint8)j;
+			}
+		}
+		block.error += bestDist;
+	}
+}
+
+
+void fitMode5Channels( const float (*points)[4], int dims, int bits, BC7Mode5Channels &best )
+{
+	bool used[16];
+	for( int i = 0; i < 16; ++i ) used[i] = true;
+
+	float mean[4], axis[4], e0[4], e1[4];
+	computePrincipalAxis( points, used, dims, mean, axis );
+	computeAxisEndpoints( points, used, dims, mean, axis, e0, e1 );
+
+	float scale = (float)((1 << bits) - 1) / 255.0f;
+	for( int iter = 0; iter < 3; ++iter )
+	{
+		BC7Mode5Channels candidate;
+		for( int d = 0; d < dims; ++d )
+		{
+			candidate.endpoints[0][d] = (int)(min( max( e0[d], 0.0f ), 255.0f ) * scale + 0.5f);
+			candidate.endpoints[1][d] = (int)(min( max( e1[d], 0.0f ), 255.0f ) * scale + 0.5f);
+		}
+		evalMode5Channels( points, dims, bits, candidate );
+
+		if( iter > 0 && candidate.error >= best.error ) break;
+		best = candidate;
+		if( best.error == 0 ) break;
+
+		float weights[16];
+		for( int i = 0; i < 16; ++i ) weights[i] = 1.0f - bc7Weights2[best.indices[i]] / 64.0f;
+		if( !refineEndpoints( points, used, weights, dims, e0, e1 ) ) break;
+	}
+
+	if( best.indices[0] >= 2 )
+	{
+		for( int d = 0; d < dims; ++d ) swap( best.endpoints[0][d], best.endpoints[1][d] );
+		for( int i = 0; i < 16; ++i ) best.indices[i] = (uint8)(3 - best.indices[i]);
+	}
+}
+
+
+class BitWriter
+{
+public:
+	BitWriter( uint8 *data ) : _data( data ), _pos( 0 ) { memset( data, 0, 16 ); }
+
+	void write( uint32 value, int bits )
+	{
+		for( int i = 0; i < bits; ++i, ++_pos )
+			_data[_pos >> 3] |= (uint8)(((value >> i) & 1) << (_pos & 7));
+	}
+
+private:
+	uint8  *_data;
+	int    _pos;
+};
+
+}  // namespace
+
+
+// =================================================================================================
+// Block encoders
+// =================================================================================================
+
+void encodeBC1( const uint8 *rgba, uint8 *block )
+{
+	encodeColorBlock( rgba, true, block );
+}
+
+
+void encodeBC3( const uint8 *rgba, uint8 *block )
+{
+	encodeChannelBlock( rgba, 3, block );
+	encodeColorBlock( rgba, false, block + 8 );
+}
+
+
+void encodeBC4( const uint8 *rgba, uint8 *block )
+{
+	encodeChannelBlock( rgba, 0, block );
+}
+
+
+void encodeBC5( const uint8 *rgba, uint8 *block )
+{
+	encodeChannelBlock( rgba, 0, block );
+	encodeChannelBlock( rgba, 1, block + 8 );
+}
+
+
+void encodeBC7( const uint8 *rgba, uint8 *block )
+{
+	float pixels[16][4], alphas[16][4];
+	for( int i = 0; i < 16; ++i )
+	{
+		for( int d = 0; d < 4; ++d ) pixels[i][d] = rgba[i * 4 + d];
+		alphas[i][0] = pixels[i][3];
+	}
+
+	BC7Mode6Block mode6 = BC7Mode6Block();
+	encodeMode6( pixels, mode6 );
+
+	// Mode 5 is only fitted if mode 6 is lossy
+	BC7Mode5Channels mode5Color = BC7Mode5Channels(), mode5Alpha = BC7Mode5Channels();
+	if( mode6.error > 0 )
+	{
+		fitMode5Channels( pixels, 3, 7, mode5Color );
+		fitMode5Channels( alphas, 1, 8, mode5Alpha );
+	}
+
+	BitWriter writer( block );
+	if( mode6.error == 0 || mode6.error <= mode5Color.error + mode5Alpha.error )
+	{
+		writer.write( 1 << 6, 7 );
+		for( int d = 0; d < 4; ++d )
+		{
+			writer.write( mode6.endpoints[0][d], 7 );
+			writer.write( mode6.endpoints[1][d], 7 );
+		}
+		writer.write( mode6.pbits[0], 1 );
+		writer.write( mode6.pbits[1], 1 );
+		writer.write( mode6.indices[0], 3 );
+		for( int i = 1; i < 16; ++i ) writer.write( mode6.indices[i], 4 );
+	}
+	else
+	{
+		writer.write( 1 << 5, 6 );
+		writer.write( 0, 2 );  // No channel rotation
+		for( int d = 0; d < 3; ++d )
+		{
+			writer.write( mode5Color.endpoints[0][d], 7 );
+			writer.write( mode5Color.endpoints[1][d], 7 );
+		}
+		writer.write( mode5Alpha.endpoints[0][0], 8 );
+		writer.write( mode5Alpha.endpoints[1][0], 8 );
+		writer.write( mode5Color.indices[0], 1 );
+		for( int i = 1; i < 16; ++i ) writer.write( mode5Color.indices[i], 2 );
+		writer.write( mode5Alpha.indices[0], 1 );
+		for( int i = 1; i < 16; ++i ) writer.write( mode5Alpha.indices[i], 2 );
+	}
+}
@@ -0,0 +1,35 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2016 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+#ifndef _bcEncoder_H_
+#define _bcEncoder_H_
+
+#include "utPlatform.h"
+
+
+// Block encoders for the BCn formats; each function compresses a block of 4x4 RGBA8 pixels
+// (row by row) and writes the encoded block in the little endian layout used by DDS files.
+// The encoders do a principal axis fit with a least squares refinement and are meant for
+// offline use where quality matters more than speed.
+
+// 8 bytes; uses the transparent 3 color mode for blocks with alpha below 128
+void encodeBC1( const uint8 *rgba, uint8 *block );
+// 16 bytes; interpolated alpha followed by a color block
+void encodeBC3( const uint8 *rgba, uint8 *block );
+// 8 bytes; red channel
+void encodeBC4( const uint8 *rgba, uint8 *block );
+// 16 bytes; red and green channel
+void encodeBC5( const uint8 *rgba, uint8 *block );
+// 16 bytes; uses mode 6 (RGBA endpoints) or mode 5 (separate RGB and alpha endpoints)
+void encodeBC7( const uint8 *rgba, uint8 *block );
+
+#endif // _bcEncoder_H_
@@ -0,0 +1,331 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2016 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+// Bakes image files to DDS textures with precomputed mip chains and block compression, so that
+// the engine can upload them directly instead of decoding, building mips and compressing at
+// load time. The engine detects DDS files by their contents, so baked textures can keep the names
+// of the source images and replace them without changing any materials.
+
+#include "baker.h"
+#include "utPlatform.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef PLATFORM_WIN
+#   define WIN32_LEAN_AND_MEAN 1
+#	ifndef NOMINMAX
+#		define NOMINMAX
+#	endif
+#	include <windows.h>
+#	include <direct.h>
+#else
+#	include <sys/stat.h>
+#	include <dirent.h>
+#endif
+
+using namespace std;
+
+
+static const char *imageExtensions[] = { ".png", ".jpg", ".jpeg", ".tga", ".bmp", ".psd", ".hdr" };
+
+static mutex logMutex;
+
+
+void log( const string &msg )
+{
+	lock_guard< mutex > lock( logMutex );
+	cout << msg << endl;
+}
+
+
+string cleanPath( const string &path )
+{
+	size_t len = path.length();
+	if( len == 0 ) return path;
+
+	string cleanedPath = path;
+	replace( cleanedPath.begin(), cleanedPath.end(), '\\', '/');
+	if( cleanedPath[len - 1] == '/' )
+		return cleanedPath.substr( 0, len - 1 );
+	else
+		return cleanedPath;
+}
+
+
+void createDirectories( const string &basePath, const string &newPath )
+{
+	for( size_t i = 1; i < newPath.length(); ++i )
+	{
+		if( newPath[i] == '/' )
+			_mkdir( (basePath + newPath.substr( 0, i )).c_str() );
+	}
+}
+
+
+bool isImageFile( const string &fileName )
+{
+	for( size_t i = 0; i < sizeof( imageExtensions ) / sizeof( imageExtensions[0] ); ++i )
+	{
+		size_t extLen = strlen( imageExtensions[i] );
+		if( fileName.length() > extLen &&
+		    _stricmp( fileName.c_str() + (fileName.length() - extLen), imageExtensions[i] ) == 0 )
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+void createAssetList( const string &basePath, const string &assetPath, vector< string > &assetList )
+{
+	vector< string >  directories;
+	vector< string >  files;
+
+// Find all files and subdirectories in current search path
+#ifdef PLATFORM_WIN
+	string searchString( basePath + assetPath + "*" );
+
+	WIN32_FIND_DATA fdat;
+	HANDLE h = FindFirstFile( searchString.c_str(), &fdat );
+	if( h == INVALID_HANDLE_VALUE ) return;
+	do
+	{
+		// Ignore hidden files
+		if( strcmp( fdat.cFileName, "." ) == 0 || strcmp( fdat.cFileName, ".." ) == 0 ||
+		    fdat.dwFileAttributes & FILE_ATTRIBUTE_HIDDEN )
+		{
+			continue;
+		}
+
+		if( fdat.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY )
+			directories.push_back( fdat.cFileName );
+		else
+			files.push_back( fdat.cFileName );
+	} while( FindNextFile( h, &fdat ) );
+	FindClose( h );
+#else
+	dirent *dirEnt;
+	struct stat fileStat;
+	string finalPath = basePath + assetPath;
+	DIR *dir = opendir( finalPath.c_str() );
+	if( dir == 0x0 ) return;
+
+	while( (dirEnt = readdir( dir )) != 0x0 )
+	{
+		if( dirEnt->d_name[0] == '.' ) continue;  // Ignore hidden files
+
+		lstat( (finalPath + dirEnt->d_name).c_str(), &fileStat );
+
+		if( S_ISDIR( fileStat.st_mode ) )
+			directories.push_back( dirEnt->d_name );
+		else if( S_ISREG( fileStat.st_mode ) )
+			files.push_back( dirEnt->d_name );
+	}
+
+	closedir( dir );
+
+	sort( directories.begin(), directories.end() );
+	sort( files.begin(), files.end() );
+#endif
+
+	for( unsigned int i = 0; i < files.size(); ++i )
+	{
+		if( isImageFile( files[i] ) ) assetList.push_back( assetPath + files[i] );
+	}
+
+	// Search in subdirectories
+	for( unsigned int i = 0; i < directories.size(); ++i )
+	{
+		createAssetList( basePath, assetPath + directories[i] + "/", assetList );
+	}
+}
+
+
+void printHelp()
+{
+	log( "Usage:" );
+	log( "TextureBaker input [optional arguments]" );
+	log( "" );
+	log( "input             image file or directory to be processed" );
+	log( "-base path        base path where the repository root is located" );
+	log( "-dest path        existing destination path where output is written" );
+	log( "-format fmt       auto|bc1|bc3|bc4|bc5|bc7 (default: auto, BC1 for opaque images, else BC3)" );
+	log( "-srgb             images are sRGB encoded (mips are filtered in linear space)" );
+	log( "-ddsExt           replace the file extension with .dds instead of keeping the file names" );
+	log( "-threads count    number of worker threads (default: number of cores)" );
+}
+
+
+int main( int argc, char **argv )
+{
+	log( "Horde3D TextureBaker - 1.0.0" );
+	log( "" );
+
+	if( argc < 2 )
+	{
+		printHelp();
+		return 1;
+	}
+
+	// =============================================================================================
+	// Parse arguments
+	// =============================================================================================
+
+	vector< string > assetList;
+	string input = argv[1], basePath = "./", outPath = "./";
+	BakeOptions options;
+	bool ddsExt = false;
+	int threadCount = (int)thread::hardware_concurrency();
+
+	// Make sure that first argument ist not an option
+	if( argv[1][0] == '-' )
+	{
+		log( "Missing input file or dir; use . for repository root" );
+		return 1;
+	}
+
+	// Check optional arguments
+	for( int i = 2; i < argc; ++i )
+	{
+		string arg = argv[i];
+
+		if( _stricmp( arg.c_str(), "-base" ) == 0 && argc > i + 1 )
+		{
+			basePath = cleanPath( argv[++i] ) + "/";
+		}
+		else if( _stricmp( arg.c_str(), "-dest" ) == 0 && argc > i + 1 )
+		{
+			outPath = cleanPath( argv[++i] ) + "/";
+		}
+		else if( _stricmp( arg.c_str(), "-format" ) == 0 && argc > i + 1 )
+		{
+			++i;
+			if( _stricmp( argv[i], "auto" ) == 0 ) options.format = BakeFormats::Auto;
+			else if( _stricmp( argv[i], "bc1" ) == 0 ) options.format = BakeFormats::BC1;
+			else if( _stricmp( argv[i], "bc3" ) == 0 ) options.format = BakeFormats::BC3;
+			else if( _stricmp( argv[i], "bc4" ) == 0 ) options.format = BakeFormats::BC4;
+			else if( _stricmp( argv[i], "bc5" ) == 0 ) options.format = BakeFormats::BC5;
+			else if( _stricmp( argv[i], "bc7" ) == 0 ) options.format = BakeFormats::BC7;
+			else
+			{
+				log( string( "Invalid format: '" ) + argv[i] + "'" );
+				return 1;
+			}
+		}
+		else if( _stricmp( arg.c_str(), "-srgb" ) == 0 )
+		{
+			options.sRGB = true;
+		}
+		else if( _stricmp( arg.c_str(), "-ddsExt" ) == 0 )
+		{
+			ddsExt = true;
+		}
+		else if( _stricmp( arg.c_str(), "-threads" ) == 0 && argc > i + 1 )
+		{
+			threadCount = atoi( argv[++i] );
+		}
+		else
+		{
+			log( "Invalid arguments: '" + arg + "'" );
+			printHelp();
+			return 1;
+		}
+	}
+
+	// Check whether input is single file or directory and create asset input list
+	if( isImageFile( input ) )
+	{
+		input = cleanPath( input );
+
+		// Check if it's an absolute path
+		if( input[0] == '/' || input[1] == ':' )
+		{
+			size_t index = input.find_last_of( '/' );
+			basePath = input.substr( 0, index + 1 );
+			input = input.substr( index + 1 );
+		}
+		assetList.push_back( input );
+	}
+	else
+	{
+		if( input == "." ) input = "";
+		else input = cleanPath( input ) + "/";
+		createAssetList( basePath, input, assetList );
+	}
+
+	if( !ddsExt && basePath == outPath )
+	{
+		log( "Error: Destination must differ from base path, otherwise the source images are overwritten; "
+		     "use -ddsExt to bake next to the source images" );
+		return 1;
+	}
+
+	// =============================================================================================
+	// Batch baking
+	// =============================================================================================
+
+	threadCount = max( min( threadCount, (int)assetList.size() ), 1 );
+	log( "Baking " + to_string( assetList.size() ) + " textures on " + to_string( threadCount ) + " threads" );
+	log( "" );
+
+	// Directories are created up front so that the workers do not race for them
+	vector< string > destList( assetList.size() );
+	for( size_t i = 0; i < assetList.size(); ++i )
+	{
+		destList[i] = assetList[i];
+		if( ddsExt )
+		{
+			size_t extPos = destList[i].find_last_of( '.' );
+			destList[i] = destList[i].substr( 0, extPos ) + ".dds";
+		}
+		createDirectories( outPath, destList[i] );
+	}
+
+	atomic< size_t > nextAsset( 0 );
+	atomic< int > failedCount( 0 );
+
+	auto worker = [&]()
+	{
+		for( size_t i = nextAsset++; i < assetList.size(); i = nextAsset++ )
+		{
+			string info;
+			if( bakeTexture( basePath + assetList[i], outPath + destList[i], options, info ) )
+			{
+				log( "Baked '" + assetList[i] + "' (" + info + ")" );
+			}
+			else
+			{
+				log( "Error: " + info );
+				++failedCount;
+			}
+		}
+	};
+
+	vector< thread > threads;
+	for( int i = 1; i < threadCount; ++i ) threads.push_back( thread( worker ) );
+	worker();
+	for( size_t i = 0; i < threads.size(); ++i ) threads[i].join();
+
+	log( "" );
+	log( to_string( assetList.size() - failedCount ) + " of " + to_string( assetList.size() ) + " textures baked" );
+
+	return failedCount > 0 ? 1 : 0;
+}
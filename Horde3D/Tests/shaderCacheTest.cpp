@@ -0,0 +1,222 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2016 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+
+// Tests for the on-disk shader program cache: hashing, storing and loading entries,
+// detection of corrupt entries and index files and LRU eviction
+
+#include "egShaderCache.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#   include <direct.h>
+#   define mkdir( path, mode ) _mkdir( path )
+#else
+#   include <sys/stat.h>
+#endif
+
+using namespace Horde3D;
+using namespace std;
+
+
+static int failures = 0;
+
+#define CHECK( cond ) \
+	if( !(cond) ) { printf( "%s(%i): check failed: %s\n", __FILE__, __LINE__, #cond ); ++failures; }
+
+
+static vector< uint8 > makeBinary( uint32 size, uint8 seed )
+{
+	vector< uint8 > data( size );
+	for( uint32 i = 0; i < size; ++i ) data[i] = (uint8)(seed + i * 7);
+
+	return data;
+}
+
+
+static void clearCache( const string &dir )
+{
+	ShaderCache cache;
+	if( cache.open( dir, 1 ) ) cache.close();  // Evicts everything that does not fit into 1 byte
+	remove( (dir + "/index.bin").c_str() );
+}
+
+
+static void testHash()
+{
+	const char *sources1[3] = { "void main() {}", "void main() { gl_FragColor = vec4( 1 ); }", 0x0 };
+	const char *sources2[3] = { "void main() {}", "void main() { gl_FragColor = vec4( 0 ); }", 0x0 };
+	const char *sources3[3] = { "void main() {}", "void main() { gl_FragColor = vec4( 1 ); }", "" };
+	
+	uint64 hash = ShaderCache::calcHash( sources1, 3, "device" );
+	CHECK( hash == ShaderCache::calcHash( sources1, 3, "device" ) );
+	CHECK( hash != ShaderCache::calcHash( sources2, 3, "device" ) );
+	CHECK( hash != ShaderCache::calcHash( sources1, 3, "otherDevice" ) );
+	// Missing stages are distinguished from empty ones
+	CHECK( hash != ShaderCache::calcHash( sources3, 3, "device" ) );
+	CHECK( hash != ShaderCache::calcHash( sources1, 2, "device" ) );
+}
+
+
+static void testStoreLoad( const string &dir )
+{
+	clearCache( dir );
+	vector< uint8 > binary = makeBinary( 1000, 1 ), data;
+	uint32 format = 0;
+
+	{
+		ShaderCache cache;
+		CHECK( cache.open( dir, 1024 * 1024 ) );
+		CHECK( cache.getEntryCount() == 0 );
+		CHECK( cache.load( 1, format, data ) == ShaderCacheResults::Skipped );
+		CHECK( cache.store( 1, 42, &binary[0], (uint32)binary.size() ) == ShaderCacheResults::Ok );
+		CHECK( cache.load( 1, format, data ) == ShaderCacheResults::Ok );
+		CHECK( format == 42 && data == binary );
+	}
+
+	// Entries survive closing and reopening the cache
+	ShaderCache cache;
+	CHECK( cache.open( dir, 1024 * 1024 ) );
+	CHECK( cache.getEntryCount() == 1 );
+	data.clear(); format = 0;
+	CHECK( cache.load( 1, format, data ) == ShaderCacheResults::Ok );
+	CHECK( format == 42 && data == binary );
+
+	// Storing an existing hash replaces the entry
+	vector< uint8 > binary2 = makeBinary( 500, 2 );
+	CHECK( cache.store( 1, 43, &binary2[0], (uint32)binary2.size() ) == ShaderCacheResults::Ok );
+	CHECK( cache.getEntryCount() == 1 );
+	CHECK( cache.load( 1, format, data ) == ShaderCacheResults::Ok );
+	CHECK( format == 43 && data == binary2 );
+
+	// Binaries that do not fit into the cache are not stored
+	CHECK( cache.store( 2, 42, &binary[0], 0 ) == ShaderCacheResults::Skipped );
+	vector< uint8 > huge = makeBinary( 2 * 1024 * 1024, 3 );
+	CHECK( cache.store( 2, 42, &huge[0], (uint32)huge.size() ) == ShaderCacheResults::Skipped );
+	CHECK( cache.getEntryCount() == 1 );
+
+	cache.invalidate( 1 );
+	CHECK( cache.getEntryCount() == 0 && cache.getSize() == 0 );
+	CHECK( cache.load( 1, format, data ) == ShaderCacheResults::Skipped );
+}
+
+
+static void testCorruptEntries( const string &dir )
+{
+	clearCache( dir );
+	vector< uint8 > binary = makeBinary( 1000, 4 ), data;
+	uint32 format = 0;
+
+	ShaderCache cache;
+	CHECK( cache.open( dir, 1024 * 1024 ) );
+	for( uint64 hash = 1; hash <= 3; ++hash )
+		CHECK( cache.store( hash, 42, &binary[0], (uint32)binary.size() ) == ShaderCacheResults::Ok );
+
+	// Flipped byte in the binary fails the checksum
+	{
+		fstream f( cache.getEntryFileName( 1 ).c_str(), ios::binary | ios::in | ios::out );
+		f.seekp( 100 );
+		f.put( 0x55 );
+	}
+	CHECK( cache.load( 1, format, data ) == ShaderCacheResults::Failed );
+	CHECK( cache.getEntryCount() == 2 );
+	CHECK( cache.load( 1, format, data ) == ShaderCacheResults::Skipped );
+
+	// Truncated entry file
+	{
+		ofstream f( cache.getEntryFileName( 2 ).c_str(), ios::binary | ios::trunc );
+		f.write( (const char *)&binary[0], 20 );
+	}
+	CHECK( cache.load( 2, format, data ) == ShaderCacheResults::Failed );
+
+	// Missing entry file
+	remove( cache.getEntryFileName( 3 ).c_str() );
+	CHECK( cache.load( 3, format, data ) == ShaderCacheResults::Failed );
+	CHECK( cache.getEntryCount() == 0 && cache.getSize() == 0 );
+	cache.close();
+
+	// An index with a huge entry count is rejected instead of allocated
+	CHECK( cache.open( dir, 1024 * 1024 ) );
+	CHECK( cache.store( 1, 42, &binary[0], (uint32)binary.size() ) == ShaderCacheResults::Ok );
+	cache.close();
+	{
+		fstream f( (dir + "/index.bin").c_str(), ios::binary | ios::in | ios::out );
+		uint32 count = 0x7FFFFFFF;
+		f.seekp( 12 );
+		f.write( (const char *)&count, 4 );
+	}
+	CHECK( cache.open( dir, 1024 * 1024 ) );
+	CHECK( cache.getEntryCount() == 0 && cache.getSize() == 0 );
+	cache.close();
+
+	// Garbage index
+	{
+		ofstream f( (dir + "/index.bin").c_str(), ios::binary | ios::trunc );
+		f << "not an index";
+	}
+	CHECK( cache.open( dir, 1024 * 1024 ) );
+	CHECK( cache.getEntryCount() == 0 );
+}
+
+
+static void testEviction( const string &dir )
+{
+	clearCache( dir );
+	vector< uint8 > binary = makeBinary( 1000, 5 ), data;
+	uint32 format = 0;
+
+	// Room for three entries including their headers
+	ShaderCache cache;
+	CHECK( cache.open( dir, 3100 ) );
+	for( uint64 hash = 1; hash <= 3; ++hash )
+		CHECK( cache.store( hash, 42, &binary[0], (uint32)binary.size() ) == ShaderCacheResults::Ok );
+	CHECK( cache.getEntryCount() == 3 );
+
+	// Using entry 1 makes entry 2 the least recently used one
+	CHECK( cache.load( 1, format, data ) == ShaderCacheResults::Ok );
+	CHECK( cache.store( 4, 42, &binary[0], (uint32)binary.size() ) == ShaderCacheResults::Ok );
+	CHECK( cache.getEntryCount() == 3 && cache.getSize() <= 3100 );
+	CHECK( cache.load( 2, format, data ) == ShaderCacheResults::Skipped );
+	CHECK( cache.load( 1, format, data ) == ShaderCacheResults::Ok );
+	CHECK( cache.load( 3, format, data ) == ShaderCacheResults::Ok );
+	CHECK( cache.load( 4, format, data ) == ShaderCacheResults::Ok );
+	cache.close();
+
+	// Use order is kept across sessions and a smaller limit evicts when opening
+	CHECK( cache.open( dir, 2100 ) );
+	CHECK( cache.getEntryCount() == 2 );
+	CHECK( cache.load( 1, format, data ) == ShaderCacheResults::Skipped );
+	CHECK( cache.load( 3, format, data ) == ShaderCacheResults::Ok );
+	CHECK( cache.load( 4, format, data ) == ShaderCacheResults::Ok );
+}
+
+
+int main( int argc, char **argv )
+{
+	string dir = argc > 1 ? argv[1] : "ShaderCacheTestDir";
+	mkdir( dir.c_str(), 0755 );
+
+	testHash();
+	testStoreLoad( dir );
+	testCorruptEntries( dir );
+	testEviction( dir );
+	clearCache( dir );
+
+	if( failures > 0 ) printf( "%i checks failed\n", failures );
+	else printf( "All checks passed\n" );
+
+	return failures > 0 ? 1 : 0;
+}